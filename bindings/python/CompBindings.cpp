@@ -82,13 +82,16 @@ void registerCompilation(py::module_& m) {
         .def_readwrite("allowUseBeforeDeclare", &CompilationOptions::allowUseBeforeDeclare)
         .def_readwrite("allowDupInitialDrivers", &CompilationOptions::allowDupInitialDrivers)
         .def_readwrite("strictDriverChecking", &CompilationOptions::strictDriverChecking)
+        .def_readwrite("disableInstanceCaching", &CompilationOptions::disableInstanceCaching)
+        .def_readwrite("numThreads", &CompilationOptions::numThreads)
         .def_readwrite("lintMode", &CompilationOptions::lintMode)
         .def_readwrite("suppressUnused", &CompilationOptions::suppressUnused)
         .def_readwrite("ignoreUnknownModules", &CompilationOptions::ignoreUnknownModules)
         .def_readwrite("scriptMode", &CompilationOptions::scriptMode)
         .def_readwrite("defaultTimeScale", &CompilationOptions::defaultTimeScale)
         .def_readwrite("topModules", &CompilationOptions::topModules)
-        .def_readwrite("paramOverrides", &CompilationOptions::paramOverrides);
+        .def_readwrite("paramOverrides", &CompilationOptions::paramOverrides)
+        .def_readwrite("elabScopes", &CompilationOptions::elabScopes);
 
     py::class_<Compilation>(m, "Compilation")
         .def(py::init<>())
@@ -97,6 +100,8 @@ void registerCompilation(py::module_& m) {
         .def_property_readonly("isFinalized", &Compilation::isFinalized)
         .def_property_readonly("sourceManager", &Compilation::getSourceManager)
         .def("addSyntaxTree", &Compilation::addSyntaxTree, "tree"_a)
+        .def("addPrecompiledPackage", &Compilation::addPrecompiledPackage, "tree"_a,
+             "diagnostics"_a)
         .def("getSyntaxTrees", &Compilation::getSyntaxTrees)
         .def("getRoot", py::overload_cast<>(&Compilation::getRoot), byrefint)
         .def("addSystemSubroutine",
@@ -114,6 +119,8 @@ void registerCompilation(py::module_& m) {
         .def("getSemanticDiagnostics", &Compilation::getSemanticDiagnostics, byrefint)
         .def("getAllDiagnostics", &Compilation::getAllDiagnostics, byrefint)
         .def("addDiagnostics", &Compilation::addDiagnostics, "diagnostics"_a)
+        .def("recompile", &Compilation::recompile, "oldTree"_a, "newTree"_a)
+        .def("getPackageDiagnostics", &Compilation::getPackageDiagnostics, "package"_a)
         .def("getType", py::overload_cast<SyntaxKind>(&Compilation::getType, py::const_), byrefint,
              "kind"_a)
         .def("getNetType", &Compilation::getNetType, byrefint, "kind"_a)
@@ -157,8 +164,10 @@ void registerCompilation(py::module_& m) {
         .def("processCommandFile", &Driver::processCommandFile, "fileName"_a, "makeRelative"_a)
         .def("processOptions", &Driver::processOptions)
         .def("runPreprocessor", &Driver::runPreprocessor, "includeComments"_a,
-             "includeDirectives"_a, "obfuscateIds"_a, "useFixedObfuscationSeed"_a = false)
+             "includeDirectives"_a, "obfuscateIds"_a, "useFixedObfuscationSeed"_a = false,
+             "outputDir"_a = "")
         .def("reportMacros", &Driver::reportMacros)
+        .def("reportPreprocessorStats", &Driver::reportPreprocessorStats)
         .def("parseAllSources", &Driver::parseAllSources)
         .def("createOptionBag", &Driver::createOptionBag)
         .def("createCompilation", &Driver::createCompilation)
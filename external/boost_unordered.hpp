@@ -2422,7 +2422,7 @@ private:
 
   void fast_copy_elements_from(const table& x)
   {
-    if(arrays.elements){
+    if(arrays.elements&&x.arrays.elements){
       copy_elements_array_from(x);
       std::memcpy(
         arrays.groups,x.arrays.groups,
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 
 #include "slang/ast/InstancePath.h"
 #include "slang/ast/Scope.h"
@@ -46,6 +47,7 @@ class Symbol;
 class SystemSubroutine;
 class ValueDriver;
 struct AssertionInstanceDetails;
+struct DiagnosticVisitor;
 
 using DriverIntervalMap = IntervalMap<uint32_t, const ValueDriver*>;
 using UnrollIntervalMap = IntervalMap<uint32_t, std::monostate>;
@@ -143,6 +145,18 @@ struct SLANG_EXPORT CompilationOptions {
     /// for an unknown definition.
     bool ignoreUnknownModules = false;
 
+    /// If true, disable sharing the elaboration of instance bodies between instances
+    /// of the same definition that have identical parameter values.
+    bool disableInstanceCaching = false;
+
+    /// The number of threads to use for elaborating the design's top-level instances
+    /// when collecting semantic diagnostics. A value of 0 means to use the number of
+    /// threads supported by the system, and 1 disables threading. Elaboration stays on
+    /// a single thread if instances can refer to each other through hierarchical names
+    /// rooted at a top-level instance or `$root`, or if the design has defparams or bind
+    /// directives. The error limit applies to each top-level instance separately.
+    uint32_t numThreads = 1;
+
     /// When in script mode, suppress some errors that are otherwise pretty
     /// annoying when not in a batch context. For example, top-level modules
     /// that have interface ports will cause an error if this is not set.
@@ -160,6 +174,12 @@ struct SLANG_EXPORT CompilationOptions {
     /// A list of parameters to override, of the form &lt;name>=&lt;value> -- note that
     /// for now at least this only applies to parameters in top-level modules.
     std::vector<std::string> paramOverrides;
+
+    /// If non-empty, a list of hierarchical paths (such as "top.u_core.u_alu") of
+    /// instances, instance arrays, generate blocks or packages to restrict elaboration
+    /// to. Only the scopes named here are fully elaborated and checked for errors;
+    /// the rest of the design is resolved only as far as needed to connect them.
+    std::vector<std::string> elabScopes;
 };
 
 /// A node in a tree representing an instance in the design
@@ -213,6 +233,12 @@ public:
     /// by calling @a getRoot this call will throw an exception.
     void addSyntaxTree(std::shared_ptr<syntax::SyntaxTree> tree);
 
+    /// Adds a syntax tree holding packages whose semantic diagnostics are already
+    /// known, such as one loaded from a PackageImage. The packages are not checked
+    /// again during elaboration and @a diagnostics are reported in their place.
+    void addPrecompiledPackage(std::shared_ptr<syntax::SyntaxTree> tree,
+                               const Diagnostics& diagnostics);
+
     /// Gets the set of syntax trees that have been added to the compilation.
     std::span<const std::shared_ptr<syntax::SyntaxTree>> getSyntaxTrees() const;
 
@@ -237,6 +263,29 @@ public:
     /// Gets all of the diagnostics produced during compilation.
     const Diagnostics& getAllDiagnostics();
 
+    /// Creates a new compilation with the same options and syntax trees as this one,
+    /// except that @a oldTree is replaced by @a newTree. The existing compilation is
+    /// left unchanged.
+    ///
+    /// If this compilation's semantic diagnostics have already been collected, the new
+    /// compilation only elaborates again the definitions and packages that the change
+    /// can affect. That includes anything declared in either tree and anything recorded
+    /// (via @a noteDependency) as depending on those names, everything instantiated
+    /// beneath a changed declaration, and the parents of affected instances.
+    /// Diagnostics for the rest of the design are carried over. Their type arguments
+    /// are formatted up front, so this compilation can be destroyed afterward.
+    /// Otherwise, or if any of the trees involved contain bind directives or defparams
+    /// (which can affect definitions anywhere in the design), the new compilation
+    /// starts from scratch.
+    std::unique_ptr<Compilation> recompile(const syntax::SyntaxTree& oldTree,
+                                           std::shared_ptr<syntax::SyntaxTree> newTree);
+
+    /// Gets the semantic diagnostics issued for the given package, with their type
+    /// arguments formatted up front so they don't refer back to this compilation.
+    /// If the whole design hasn't been elaborated by @a getSemanticDiagnostics (because
+    /// of the error limit, for instance) this returns std::nullopt instead.
+    std::optional<Diagnostics> getPackageDiagnostics(const PackageSymbol& package);
+
     /// @}
     /// @name Utility and convenience methods
     /// @{
@@ -398,6 +447,8 @@ public:
     /// for a @a className class. Returns a tuple of syntax pointer and symbol
     /// index in the defining scope, along with a pointer that should be set to true if
     /// the resulting decl is considered "used". If not found, the syntax pointer will be null.
+    /// While elaborating in parallel, the caller must hold lockSharedState() for as long
+    /// as it uses that pointer.
     std::tuple<const syntax::SyntaxNode*, SymbolIndex, bool*> findOutOfBlockDecl(
         const Scope& scope, std::string_view className, std::string_view declName) const;
 
@@ -405,6 +456,16 @@ public:
     /// elaborated by the compilation to hook up connections to their interface prototypes.
     void addExternInterfaceMethod(const SubroutineSymbol& method);
 
+    /// Gets the block items that make up the body of the given subroutine declaration.
+    /// If the syntax tree containing the declaration deferred parsing of the body
+    /// (see @a ParserOptions::deferSubroutineBodies) it gets parsed the first time
+    /// this is called, and any syntax errors are reported as compilation diagnostics.
+    /// Deferred bodies in uninstantiated instances of library definitions are never
+    /// parsed; they are treated as empty instead. @a scope is the scope in which
+    /// the subroutine is being created.
+    const syntax::SyntaxList<syntax::SyntaxNode>& getSubroutineItems(
+        const syntax::FunctionDeclarationSyntax& syntax, const Scope& scope);
+
     /// Notes that there is a default clocking block associated with the specified scope.
     void noteDefaultClocking(const Scope& scope, const Symbol& clocking, SourceRange range);
 
@@ -470,6 +531,26 @@ public:
     /// The second item is only relevant for nodes where it makes sense; e.g. variables and nets.
     std::pair<bool, bool> isReferenced(const syntax::SyntaxNode& node) const;
 
+    /// Notes that a hierarchical name lookup resolved to the given symbol.
+    /// This is used to decide which instance bodies can be shared during elaboration.
+    void noteHierarchicalReference(const Symbol& target);
+
+    /// Gets the targets of all hierarchical name lookups performed thus far, in the
+    /// order they were resolved. While top-level instances are being elaborated in
+    /// parallel, only the lookups made for the calling thread's instance are included.
+    std::span<const Symbol* const> getHierarchicalReferences() const;
+
+    /// Notes that elaborating @a scope depends on the definition or package with the
+    /// given @a name, whether or not one by that name exists. If @a viaInstantiation
+    /// is true, the dependency comes only from instantiating the definition, and it
+    /// doesn't carry over to anything that in turn depends on @a scope. These are used
+    /// by @a recompile to work out what a change to a syntax tree can affect.
+    void noteDependency(const Scope& scope, std::string_view name, bool viaInstantiation = false);
+
+    /// Notes that elaborating @a scope depends on @a target, which is found in some
+    /// other definition or package (for example through a hierarchical reference).
+    void noteDependency(const Scope& scope, const Symbol& target);
+
     /// Notes that the given symbol has a name conflict in its parent scope.
     /// This will cause appropriate errors to be issued.
     void noteNameConflict(const Symbol& symbol);
@@ -484,14 +565,24 @@ public:
     /// Gets the default time scale to use when none is specified in the source code.
     std::optional<TimeScale> getDefaultTimeScale() const { return options.defaultTimeScale; }
 
-    /// Gets the next system ID to use for identifying enum types.
-    int getNextEnumSystemId() { return nextEnumSystemId++; }
+    /// Sets @a id to the next system ID to use for identifying enum types.
+    void assignEnumSystemId(int& id);
 
-    /// Gets the next system ID to use for identifying struct types.
-    int getNextStructSystemId() { return nextStructSystemId++; }
+    /// Sets @a id to the next system ID to use for identifying struct types.
+    void assignStructSystemId(int& id);
 
-    /// Gets the next system ID to use for identifying union types.
-    int getNextUnionSystemId() { return nextUnionSystemId++; }
+    /// Sets @a id to the next system ID to use for identifying union types.
+    void assignUnionSystemId(int& id);
+
+    /// Locks state that is shared between threads while top-level instances are
+    /// being elaborated in parallel (see CompilationOptions::numThreads).
+    /// If that isn't happening the returned lock doesn't own anything.
+    [[nodiscard]] std::unique_lock<std::recursive_mutex> lockSharedState() const;
+
+    /// While top-level instances are being elaborated in parallel, returns a nonzero
+    /// value that identifies the instance the calling thread is working on.
+    /// Returns zero otherwise.
+    uint32_t getParallelElabId() const;
 
     /// @}
     /// @name Types
@@ -614,8 +705,8 @@ private:
     void trackImport(Scope::ImportDataIndex& index, const WildcardImportSymbol& import);
     std::span<const WildcardImportSymbol*> queryImports(Scope::ImportDataIndex index);
 
-    bool doTypoCorrection() const { return typoCorrections < options.typoCorrectionLimit; }
-    void didTypoCorrection() { typoCorrections++; }
+    bool doTypoCorrection() const;
+    void didTypoCorrection();
 
     std::span<const AttributeSymbol* const> getAttributes(const void* ptr) const;
 
@@ -628,6 +719,8 @@ private:
     void checkModportExports(
         std::span<const std::pair<const InterfacePortSymbol*, const ModportSymbol*>> modports);
     void checkElemTimeScale(std::optional<TimeScale> timeScale, SourceRange sourceRange);
+    bool canElaborateInParallel();
+    void elaborateInParallel(DiagnosticVisitor& visitor, uint32_t errorLimit);
     void resolveDefParamsAndBinds();
     void resolveBindTargets(const syntax::BindDirectiveSyntax& syntax, const Scope& scope,
                             SmallVector<const Symbol*>& instTargets, const Definition** defTarget);
@@ -676,6 +769,32 @@ private:
     // for things like variables and nets.
     flat_hash_map<const syntax::SyntaxNode*, std::pair<bool, bool>> referenceStatusMap;
 
+    // The targets of all hierarchical name lookups resolved so far.
+    std::vector<const Symbol*> hierarchicalReferences;
+
+    // Dependencies between the parts of the design, for use by recompile(). Each
+    // definition, package, and compilation unit that depends on something is identified
+    // by its declaration syntax, which is shared across recompiles for unchanged trees.
+    // The map goes from the name of the thing depended upon to each dependent, along
+    // with whether that dependency is only through instantiation.
+    flat_hash_map<std::string_view, flat_hash_map<const syntax::SyntaxNode*, bool>> dependents;
+
+    // Each semantic diagnostic along with the declaration (as above) it came from,
+    // or nullptr for ones that don't belong to any particular declaration.
+    std::vector<std::pair<const syntax::SyntaxNode*, Diagnostic>> ownedDiagnostics;
+
+    // If this compilation was created by recompile(), the declarations whose diagnostics
+    // were carried over instead of being elaborated again, and those diagnostics. Bodies
+    // of the declarations in reusedPaths are still walked through in order to reach
+    // instances beneath them that do need elaborating.
+    flat_hash_set<const syntax::SyntaxNode*> reusedOwners;
+    flat_hash_set<const syntax::SyntaxNode*> reusedPaths;
+    std::vector<std::pair<const syntax::SyntaxNode*, Diagnostic>> carriedDiagnostics;
+
+    // Set once the whole design has been elaborated and its diagnostics collected,
+    // which makes the results usable as the starting point for recompile().
+    bool fullyElaborated = false;
+
     // The lookup table for top-level modules. The value is a pair, with the second
     // element being a boolean indicating whether there exists at least one nested
     // module with the given name (requiring a more involved lookup).
@@ -718,6 +837,12 @@ private:
     // Map from syntax nodes to parse-time metadata about them.
     flat_hash_map<const syntax::ModuleDeclarationSyntax*, DefinitionMetadata> definitionMetadata;
 
+    // Map from subroutine declarations whose bodies weren't parsed along with their
+    // syntax trees to the body items, once they've been parsed on demand.
+    flat_hash_map<const syntax::FunctionDeclarationSyntax*,
+                  std::pair<syntax::SyntaxTree*, const syntax::SyntaxList<syntax::SyntaxNode>*>>
+        deferredBodies;
+
     // The name map for all module, interface, and program definitions.
     // The key is a combination of definition name + the scope in which it was declared.
     flat_hash_map<std::tuple<std::string_view, const Scope*>, Definition*> definitionMap;
@@ -755,6 +880,11 @@ private:
     int nextStructSystemId = 1;
     int nextUnionSystemId = 1;
 
+    // Set while top-level instances are being elaborated in parallel, during which
+    // sharedStateMutex guards the state here that more than one thread can touch.
+    bool elaboratingInParallel = false;
+    mutable std::recursive_mutex sharedStateMutex;
+
     // This is storage for a temporary diagnostic that is being constructed.
     // Typically this is done in-place within the diagMap, but for diagnostics
     // that have been supressed we need space to return *something* to the caller.
@@ -7,6 +7,8 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include <atomic>
+
 #include "slang/ast/SemanticFacts.h"
 #include "slang/syntax/SyntaxFwd.h"
 #include "slang/util/Hash.h"
@@ -156,17 +158,17 @@ public:
     std::string_view getArticleKindString() const;
 
     /// Returns true if the definition has been instantiated anywhere in the design.
-    bool isInstantiated() const { return instantiated; }
+    bool isInstantiated() const { return instantiated.load(std::memory_order_relaxed); }
 
     /// Notes that the definition has been instantiated.
-    void noteInstantiated() const { instantiated = true; }
+    void noteInstantiated() const { instantiated.store(true, std::memory_order_relaxed); }
 
     /// Gets the hierarchical path to the definition, appending it
     /// to the provided string.
     void getHierarchicalPath(std::string& buffer) const;
 
 private:
-    mutable bool instantiated = false;
+    mutable std::atomic<bool> instantiated = false;
 };
 
 } // namespace slang::ast
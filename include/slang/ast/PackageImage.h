@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------------
+//! @file PackageImage.h
+//! @brief Support for saving and loading precompiled packages
+//
+// SPDX-FileCopyrightText: Michael Popoloski
+// SPDX-License-Identifier: MIT
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "slang/diagnostics/Diagnostics.h"
+#include "slang/util/Util.h"
+
+namespace slang {
+
+class Bag;
+class SourceManager;
+
+} // namespace slang
+
+namespace slang::syntax {
+
+class SyntaxTree;
+
+} // namespace slang::syntax
+
+namespace slang::ast {
+
+class Compilation;
+class PackageSymbol;
+
+/// Saves and loads precompiled images of packages, which let large packages that
+/// rarely change (UVM, for instance) skip preprocessing and semantic checking in
+/// every compilation that uses them.
+///
+/// An image holds the package's fully preprocessed source text (with all macros
+/// expanded and includes inlined), preceded by the `timescale, `default_nettype,
+/// and `unconnected_drive settings that were in effect for it, along with the
+/// semantic diagnostics that were issued for it. Loading an image parses that text
+/// and hands it to the compilation via Compilation::addPrecompiledPackage, which
+/// reports the stored diagnostics instead of checking the package again.
+///
+/// Images are tied to the version of the library that wrote them and to a hash
+/// of the options that can change what a package means, such as predefined macros
+/// and the compilation options. Loading fails if either doesn't match.
+class SLANG_EXPORT PackageImage {
+public:
+    /// The version of the image format. Bumped whenever the layout changes.
+    static constexpr uint32_t FormatVersion = 2;
+
+    /// Possible results of loading an image.
+    enum class Status {
+        /// The image was loaded successfully.
+        Ok,
+
+        /// The data is not a package image, or it is truncated or corrupt.
+        Malformed,
+
+        /// The image was written by a different version of the library.
+        VersionMismatch,
+
+        /// The image was written with options that differ from the current ones.
+        OptionsMismatch
+    };
+
+    /// The result of loading an image.
+    struct LoadResult {
+        /// Indicates whether loading succeeded, and if not, why.
+        Status status = Status::Malformed;
+
+        /// The name of the package in the image.
+        std::string name;
+
+        /// The syntax tree parsed from the image, or nullptr if loading failed.
+        std::shared_ptr<syntax::SyntaxTree> tree;
+
+        /// The semantic diagnostics that were issued for the package when the
+        /// image was written, located within the text of @a tree.
+        Diagnostics diagnostics;
+    };
+
+    /// Writes an image of the given package. The package's compilation must have
+    /// already been fully elaborated via Compilation::getSemanticDiagnostics;
+    /// if it wasn't, nothing is written and std::nullopt is returned.
+    /// @a options should be the same set used to create the compilation.
+    static std::optional<std::string> save(Compilation& compilation,
+                                           const PackageSymbol& package, const Bag& options);
+
+    /// Loads an image previously written by @a save. The package's text is added to
+    /// @a sourceManager under the given @a path, and parsed using @a options, which
+    /// must hash the same as the options used to write the image.
+    static LoadResult load(std::string_view data, std::string_view path,
+                           SourceManager& sourceManager, const Bag& options);
+
+    /// Computes the hash of the parts of @a options that an image depends on.
+    static uint64_t hashOptions(const Bag& options);
+};
+
+} // namespace slang::ast
@@ -183,7 +183,7 @@ private:
     public:
         SpecializationKey(const GenericClassDefSymbol& def,
                           std::span<const ConstantValue* const> paramValues,
-                          std::span<const Type* const> typeParams);
+                          std::span<const Type* const> typeParams, uint32_t parallelElabId);
 
         size_t hash() const { return savedHash; }
 
@@ -193,6 +193,7 @@ private:
         const GenericClassDefSymbol* definition;
         std::span<const ConstantValue* const> paramValues;
         std::span<const Type* const> typeParams;
+        uint32_t parallelElabId;
         size_t savedHash;
     };
 
@@ -74,6 +74,13 @@ public:
     const PortConnection* getPortConnection(const InterfacePortSymbol& port) const;
     std::span<const PortConnection* const> getPortConnections() const;
 
+    /// If elaboration found this instance to be identical to an earlier one (same
+    /// definition and parameter values, with no hierarchical references reaching into
+    /// or out of it), returns the body of that earlier instance. That body was fully
+    /// elaborated on behalf of both instances, while the members of this instance's
+    /// own body are only resolved on demand. Otherwise returns nullptr.
+    const InstanceBodySymbol* getCanonicalBody() const { return canonicalBody; }
+
     void serializeTo(ASTSerializer& serializer) const;
 
     static void fromSyntax(Compilation& compilation,
@@ -105,10 +112,13 @@ public:
     void visitExprs(TVisitor&& visitor) const; // implementation is in ASTVisitor.h
 
 private:
+    friend struct DiagnosticVisitor;
+
     void resolvePortConnections() const;
 
     mutable PointerMap* connectionMap = nullptr;
     mutable std::span<const PortConnection* const> connections;
+    mutable const InstanceBodySymbol* canonicalBody = nullptr;
 };
 
 class SLANG_EXPORT InstanceBodySymbol : public Symbol, public Scope {
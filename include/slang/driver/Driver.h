@@ -9,6 +9,7 @@
 #pragma once
 
 #include "slang/diagnostics/DiagnosticEngine.h"
+#include "slang/syntax/DefinitionIndex.h"
 #include "slang/text/SourceManager.h"
 #include "slang/util/Bag.h"
 #include "slang/util/CommandLine.h"
@@ -54,6 +55,10 @@ public:
     /// A list of syntax trees that have been parsed.
     std::vector<std::shared_ptr<syntax::SyntaxTree>> syntaxTrees;
 
+    /// An index of the definitions declared in all of the @a syntaxTrees,
+    /// filled in as they are parsed.
+    syntax::DefinitionIndex definitionIndex;
+
     /// A container for various options that can be parsed and applied
     /// to the compilation process.
     struct Options {
@@ -104,9 +109,21 @@ public:
         /// The maximum number of lexer errors that can be encountered before giving up.
         std::optional<uint32_t> maxLexerErrors;
 
-        /// The number of threads to use for parsing.
+        /// The number of threads to use for parsing. If explicitly set, this is also the
+        /// number of threads used to elaborate independent top-level instances
+        /// (see ast::CompilationOptions::numThreads).
         std::optional<uint32_t> numThreads;
 
+        /// A directory in which to cache parsed syntax trees across runs.
+        std::optional<std::string> syntaxCacheDir;
+
+        /// If true, the bodies of functions and tasks in library files aren't parsed
+        /// until they are needed during elaboration.
+        std::optional<bool> deferLibraryBodies;
+
+        /// If true, whitespace and comments are not kept in parsed syntax trees.
+        std::optional<bool> leanTrivia;
+
         /// @}
         /// @name Compilation
         /// @{
@@ -167,6 +184,10 @@ public:
         /// means not taking into account procedural for loop unrolling.
         std::optional<bool> strictDriverChecking;
 
+        /// If true, elaborate every instance body separately instead of sharing the
+        /// elaboration of instances with identical definitions and parameter values.
+        std::optional<bool> disableInstanceCaching;
+
         /// If true, only perform linting of code, don't try to elaborate a full hierarchy.
         std::optional<bool> onlyLint;
 
@@ -179,6 +200,9 @@ public:
         /// for now at least this only applies to parameters in top-level modules.
         std::vector<std::string> paramOverrides;
 
+        /// A list of hierarchical paths of scopes to restrict elaboration to.
+        std::vector<std::string> elabScopes;
+
         /// @}
         /// @name Diagnostics control
         /// @{
@@ -231,6 +255,18 @@ public:
         /// A list of library files to include in the compilation.
         std::vector<std::string> libraryFiles;
 
+        /// A list of precompiled package images to load in place of
+        /// the source for those packages.
+        std::vector<std::string> packageImages;
+
+        /// A list of packages to write precompiled images of once the design has
+        /// been compiled, of the form &lt;name>=&lt;filename>.
+        std::vector<std::string> writePackageImages;
+
+        /// If true, source files will be memory mapped instead of being
+        /// copied into memory when they are loaded.
+        std::optional<bool> memoryMapFiles;
+
         /// @}
     } options;
 
@@ -284,13 +320,25 @@ public:
     /// @param useFixedObfuscationSeed If true, obfuscated identifiers will be generated with
     ///                                a fixed randomization seed, meaning they will be the
     ///                                same every time the program is run. Used for testing.
+    /// @param outputDir If not empty, the output for each source file is written to a
+    ///                  file of the same name in this directory instead of to stdout.
+    ///                  Unless --single-unit is set, files are preprocessed independently
+    ///                  and in parallel.
     /// @returns true on success and false if errors were encountered.
+    ///
+    /// Output is written out as it is produced rather than being buffered up front,
+    /// so some of it may already have been printed by the time an error is reported.
     [[nodiscard]] bool runPreprocessor(bool includeComments, bool includeDirectives,
-                                       bool obfuscateIds, bool useFixedObfuscationSeed = false);
+                                       bool obfuscateIds, bool useFixedObfuscationSeed = false,
+                                       std::string_view outputDir = {});
 
     /// Prints all macros from all loaded buffers to stdout.
     void reportMacros();
 
+    /// Prints statistics about `include directives and macro expansions
+    /// handled while parsing all of the @a syntaxTrees to stdout.
+    void reportPreprocessorStats();
+
     /// Parses all loaded buffers into syntax trees and appends the resulting trees
     /// to the @a syntaxTrees list.
     /// @returns true on success and false if errors were encountered.
@@ -311,7 +359,22 @@ public:
     /// @returns true if compilation succeeded and false if errors were encountered.
     [[nodiscard]] bool reportCompilation(ast::Compilation& compilation, bool quiet);
 
+    /// Writes precompiled images of the packages requested by the
+    /// @a writePackageImages option. The compilation must already have
+    /// been fully elaborated, as by @a reportCompilation.
+    /// @returns true on success and false if errors were encountered.
+    [[nodiscard]] bool writePackageImages(ast::Compilation& compilation);
+
 private:
+    void addSyntaxTrees(ast::Compilation& compilation) const;
+    SourceBuffer readSource(const std::filesystem::path& path, std::string_view fileName);
+
+    // Precomputed diagnostics for the trees loaded from package images.
+    flat_hash_map<const syntax::SyntaxTree*, Diagnostics> packageImageDiags;
+
+    // Source files named on the command line, loaded by processOptions.
+    std::vector<std::pair<std::string, std::filesystem::path>> pendingSources;
+
     bool anyFailedLoads = false;
 };
 
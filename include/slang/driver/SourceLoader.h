@@ -13,6 +13,7 @@
 #include <span>
 #include <vector>
 
+#include "slang/syntax/DefinitionIndex.h"
 #include "slang/syntax/SyntaxFwd.h"
 #include "slang/text/Glob.h"
 #include "slang/util/Hash.h"
@@ -103,6 +104,10 @@ public:
     /// Loads and parses all of the source files that have been added to the loader.
     SyntaxTreeList loadAndParseSources();
 
+    /// Gets an index of all of the definitions declared in the trees
+    /// that have been loaded and parsed so far.
+    const syntax::DefinitionIndex& getDefinitionIndex() const { return definitionIndex; }
+
 private:
     struct Library {
         std::string_view name;
@@ -126,6 +131,7 @@ private:
     flat_hash_set<std::string_view> uniqueExtensions;
     SyntaxTreeList libraryMaps;
     ErrorCallback errorCallback;
+    syntax::DefinitionIndex definitionIndex;
 
     static constexpr int MinFilesForThreading = 4;
 };
@@ -27,6 +27,13 @@ struct SLANG_EXPORT LexerOptions {
     /// The maximum number of errors that can occur before the rest of the source
     /// buffer is skipped.
     uint32_t maxErrors = 16;
+
+    /// If true, whitespace and comments are not kept as separate trivia. Each run of
+    /// them is collapsed into a single shared newline or space trivia element, which
+    /// preserves line and spacing information for the preprocessor but means the
+    /// resulting syntax can no longer be printed back to its original text.
+    /// Directives, pragmas, and protected regions are unaffected.
+    bool leanTrivia = false;
 };
 
 /// Possible encodings for encrypted text used in a pragma protect region.
@@ -43,6 +50,20 @@ public:
     Lexer(SourceBuffer buffer, BumpAllocator& alloc, Diagnostics& diagnostics,
           LexerOptions options = LexerOptions{});
 
+    /// Constructs a lexer that replays @a cachedTokens, previously lexed from the
+    /// same text with the given @a keywordVersion, instead of lexing them again.
+    /// If the lexer is later asked for tokens using a different keyword version,
+    /// or for raw encoded text, it switches to lexing the source text directly.
+    Lexer(SourceBuffer buffer, std::span<const Token> cachedTokens,
+          KeywordVersion keywordVersion, BumpAllocator& alloc, Diagnostics& diagnostics,
+          LexerOptions options = LexerOptions{});
+
+    /// Constructs a lexer that starts at @a startOffset within @a buffer instead of at
+    /// its beginning. The offset should be at a token boundary; the tokens get the same
+    /// locations they would have if the whole buffer had been lexed.
+    Lexer(SourceBuffer buffer, size_t startOffset, BumpAllocator& alloc,
+          Diagnostics& diagnostics, LexerOptions options = LexerOptions{});
+
     // Not copyable
     Lexer(const Lexer&) = delete;
     Lexer& operator=(const Lexer&) = delete;
@@ -56,12 +77,26 @@ public:
     /// is on the same line as the previous token we've lexed.
     bool isNextTokenOnSameLine();
 
+    /// Skips over the source text of a disabled conditional compilation region, up to
+    /// but not including the next conditional directive (`ifdef, `ifndef, `elsif, `else
+    /// or `endif). Only comments, strings and directives are recognized, which is much
+    /// faster than lexing each token in the region, but the same diagnostics are issued.
+    ///
+    /// @returns the skipped text, or std::nullopt if the region doesn't end in this
+    /// buffer or the lexer is replaying cached tokens. In that case nothing is consumed
+    /// and the caller should lex the region token by token instead.
+    std::optional<std::string_view> skipDisabledRegion(KeywordVersion keywordVersion);
+
     /// Lexes a token that contains encoded text as part of a protected envelope.
     Token lexEncodedText(ProtectEncoding encoding, uint32_t expectedBytes, bool singleLine);
 
     /// Returns the library with which the lexer's source buffer is associated.
     const SourceLibrary* getLibrary() const { return library; }
 
+    /// Gets the number of bytes of trivia that were not allocated because
+    /// the lexer was told to only keep lean trivia.
+    size_t getTriviaBytesSaved() const { return triviaBytesSaved; }
+
     /// Concatenates two tokens together; used for macro pasting.
     static Token concatenateTokens(BumpAllocator& alloc, Token left, Token right);
 
@@ -86,6 +121,8 @@ private:
           Diagnostics& diagnostics, LexerOptions options);
 
     Token lexToken(KeywordVersion keywordVersion);
+    Token replayToken();
+    void stopReplay();
     Token lexEscapeSequence(bool isMacroName);
     Token lexNumericLiteral();
     Token lexDollarSign();
@@ -109,6 +146,7 @@ private:
     Token create(TokenKind kind, Args&&... args);
 
     void addTrivia(TriviaKind kind);
+    std::span<Trivia const> getTrivia();
     Diagnostic& addDiag(DiagCode code, size_t offset);
 
     // source pointer manipulation
@@ -153,10 +191,18 @@ private:
     // temporary storage for building arrays of trivia
     SmallVector<Trivia, 32> triviaBuffer;
 
+    // the number of trivia bytes avoided by collapsing trivia in lean mode
+    size_t triviaBytesSaved = 0;
+
     // temporary storage for building string literals
     SmallVector<char> stringBuffer;
 
     const SourceLibrary* library = nullptr;
+
+    // if non-empty, tokens are replayed from this list instead of being lexed
+    std::span<const Token> cachedTokens;
+    KeywordVersion cachedKeywordVersion{};
+    size_t cachedIndex = 0;
 };
 
 } // namespace slang::parsing
@@ -20,8 +20,8 @@ namespace slang::parsing {
 enum class TokenKind : uint16_t;
 
 /// Different restricted sets of keywords that can be set using the
-/// `begin_keywords directive. The values of the enum correspond to indexes to
-/// allKeywords[] in LexerFacts.cpp
+/// `begin_keywords directive. Each version's set of keywords is a superset
+/// of those of all the versions that come before it.
 enum class SLANG_EXPORT KeywordVersion : uint8_t {
     v1364_1995 = 0,
     v1364_2001_noconfig = 1,
@@ -39,8 +39,10 @@ public:
     static std::string_view getTokenKindText(TokenKind kind);
     static KeywordVersion getDefaultKeywordVersion();
     static std::optional<KeywordVersion> getKeywordVersion(std::string_view text);
-    static const flat_hash_map<std::string_view, TokenKind>* getKeywordTable(
-        KeywordVersion version);
+
+    /// Gets the kind of keyword represented by @a text in the given keyword version,
+    /// or TokenKind::Unknown if the text is not a keyword in that version.
+    static TokenKind getKeywordKind(std::string_view text, KeywordVersion version);
 
     static syntax::SyntaxKind getDirectiveKind(std::string_view directive);
     static std::string_view getDirectiveText(syntax::SyntaxKind kind);
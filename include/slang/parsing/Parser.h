@@ -125,6 +125,13 @@ struct SLANG_EXPORT ParserOptions {
     /// The maximum depth of nested language constructs (statements, exceptions) before
     /// we give up for fear of stack overflow.
     uint32_t maxRecursionDepth = 1024;
+
+    /// If true, the bodies of functions and tasks that declare their ports in a port list
+    /// are not parsed. Their tokens are recorded in @a ParserMetadata::deferredBodies instead
+    /// so that they can be parsed later on, if and when the subroutine is actually needed.
+    /// Syntax errors in bodies that never get parsed are not reported, and the bodies are
+    /// left out of the syntax tree itself (and therefore out of any printed output).
+    bool deferSubroutineBodies = false;
 };
 
 /// Implements a full syntax parser for SystemVerilog.
@@ -154,6 +161,11 @@ public:
     /// but for snippets of code this can be convenient.
     syntax::SyntaxNode& parseGuess();
 
+    /// Parse the items of a subroutine body whose parsing was deferred (see
+    /// @a ParserOptions::deferSubroutineBodies), given the body's recorded @a tokens.
+    std::span<syntax::SyntaxNode*> parseDeferredBody(
+        const syntax::FunctionDeclarationSyntax& syntax, std::span<const Token> tokens);
+
     /// Check whether the parser has consumed the entire input stream.
     bool isDone();
 
@@ -291,6 +303,7 @@ private:
     syntax::FunctionDeclarationSyntax& parseFunctionDeclaration(AttrList attributes, syntax::SyntaxKind functionKind, TokenKind endKind, syntax::SyntaxKind parentKind);
     Token parseLifetime();
     std::span<syntax::SyntaxNode*> parseBlockItems(TokenKind endKind, Token& end, bool inConstructor);
+    bool skipDeferredBody(TokenKind endKind, std::span<Token>& tokens);
     syntax::GenvarDeclarationSyntax& parseGenvarDeclaration(AttrList attributes);
     syntax::LoopGenerateSyntax& parseLoopGenerateConstruct(AttrList attributes);
     syntax::IfGenerateSyntax& parseIfGenerateConstruct(AttrList attributes);
@@ -12,10 +12,46 @@
 
 #include "slang/parsing/Token.h"
 #include "slang/syntax/SyntaxFwd.h"
+#include "slang/util/Function.h"
 #include "slang/util/Util.h"
 
 namespace slang::parsing {
 
+/// Statistics about how a preprocessor has handled `include directives.
+struct SLANG_EXPORT IncludeStats {
+    /// The number of `include directives that named a file that could be opened.
+    uint32_t numIncludes = 0;
+
+    /// The number of times an included file was actually entered and lexed.
+    uint32_t numEntered = 0;
+
+    /// The number of includes that were skipped because the file was
+    /// marked with `pragma once.
+    uint32_t numSkippedPragmaOnce = 0;
+
+    /// The number of includes that were skipped because the file is wrapped
+    /// in an include guard whose macro was already defined.
+    uint32_t numSkippedGuard = 0;
+
+    /// The number of distinct files that were found to have an include guard.
+    uint32_t numGuardsDetected = 0;
+};
+
+/// Statistics about how a preprocessor has expanded macros.
+struct SLANG_EXPORT MacroStats {
+    /// The number of macro usages expanded in source text (not counting
+    /// usages nested inside the bodies or arguments of other macros).
+    uint32_t numExpansions = 0;
+
+    /// The number of expansions of object-like macros that reused the
+    /// tokens cached from a previous expansion of the same macro.
+    uint32_t numCacheHits = 0;
+
+    /// The number of cached expansions that were discarded because their
+    /// macro was redefined or undefined.
+    uint32_t numCacheInvalidations = 0;
+};
+
 /// Various bits of metadata collected during parsing.
 struct SLANG_EXPORT ParserMetadata {
     /// Collection of metadata that can be associated with a syntax node at parse time.
@@ -48,6 +84,11 @@ struct SLANG_EXPORT ParserMetadata {
     /// A list of all interface port headers parsed.
     std::vector<const syntax::InterfacePortHeaderSyntax*> interfacePorts;
 
+    /// Subroutine declarations whose bodies were not parsed because the parser was
+    /// told to defer them, along with the tokens that make up each body (not
+    /// including its end keyword).
+    flat_hash_map<const syntax::FunctionDeclarationSyntax*, std::span<const Token>> deferredBodies;
+
     /// The EOF token, if one has already been consumed by the parser.
     /// Otherwise an empty token.
     Token eofToken;
@@ -58,8 +99,33 @@ struct SLANG_EXPORT ParserMetadata {
     /// Indicates whether the parse tree has any bind directives.
     bool hasBindDirectives = false;
 
+    /// Statistics about the `include directives processed by the preprocessor.
+    IncludeStats includeStats;
+
+    /// Statistics about the macros expanded by the preprocessor.
+    MacroStats macroStats;
+
+    /// The number of bytes of trivia that were not allocated for this tree
+    /// because it was parsed with lean trivia (see LexerOptions::leanTrivia).
+    size_t triviaBytesSaved = 0;
+
     /// Constructs a new set of parser metadata by walking the provided syntax tree.
     static ParserMetadata fromSyntax(const syntax::SyntaxNode& root, const SourceLibrary* library);
+
+    /// Constructs a new set of parser metadata for a tree produced by a structurally
+    /// shared edit (see SyntaxRewriter::transformShared) of a tree with the given
+    /// @a original metadata. Only the changed parts of the tree are walked:
+    /// @a rebuilt maps each node of the original tree that was copied to its copy,
+    /// @a removed holds the roots of the subtrees that were removed or replaced,
+    /// @a inserted holds the roots of the subtrees that were added, and @a getParent
+    /// returns the parent of a node in the new tree (see SyntaxTree::getParent).
+    static ParserMetadata fromSharedEdit(
+        const ParserMetadata& original, const syntax::SyntaxNode& root,
+        const flat_hash_map<const syntax::SyntaxNode*, syntax::SyntaxNode*>& rebuilt,
+        std::span<const syntax::SyntaxNode* const> removed,
+        std::span<const syntax::SyntaxNode* const> inserted,
+        function_ref<const syntax::SyntaxNode*(const syntax::SyntaxNode&)> getParent,
+        const SourceLibrary* library);
 };
 
 } // namespace slang::parsing
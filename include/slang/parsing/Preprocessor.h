@@ -11,6 +11,7 @@
 
 #include "slang/parsing/Lexer.h"
 #include "slang/parsing/NumberParser.h"
+#include "slang/parsing/ParserMetadata.h"
 #include "slang/parsing/Token.h"
 #include "slang/syntax/SyntaxNode.h"
 #include "slang/text/SourceLocation.h"
@@ -31,6 +32,9 @@ struct PragmaExpressionSyntax;
 
 namespace slang::parsing {
 
+class TokenCache;
+struct PreprocessorDependencies;
+
 /// Contains various options that can control preprocessing behavior.
 struct SLANG_EXPORT PreprocessorOptions {
     /// The maximum depth of the include stack; further attempts to include
@@ -50,6 +54,93 @@ struct SLANG_EXPORT PreprocessorOptions {
 
     /// A set of preprocessor directives to be ignored.
     flat_hash_set<std::string_view> ignoreDirectives;
+
+    /// An optional cache of lexed tokens, shared with other preprocessors,
+    /// used to avoid lexing commonly included files over and over again.
+    /// The cache is ignored if it was created for a different source manager.
+    std::shared_ptr<TokenCache> tokenCache;
+};
+
+/// A snapshot of the state that carries over from one source file to the next when
+/// multiple files are preprocessed as a single compilation unit. Starting a preprocessor
+/// from a snapshot lets a file be preprocessed without first processing all of the
+/// files that come before it.
+struct SLANG_EXPORT PreprocessorState {
+    /// All macros that are currently defined (other than built-in ones), keyed by name.
+    flat_hash_map<std::string_view, const syntax::DefineDirectiveSyntax*> macros;
+
+    /// Files (identified by a pointer to the start of their text) that have been
+    /// found to be wrapped in an include guard, along with the guarding macro name.
+    flat_hash_map<const char*, std::string_view> includeGuards;
+
+    /// Files (identified the same way) that have been marked `pragma once.
+    flat_hash_set<const char*> includeOnceHeaders;
+
+    /// The active `timescale, if any.
+    std::optional<TimeScale> timeScale;
+
+    /// The active `default_nettype.
+    TokenKind defaultNetType = TokenKind::WireKeyword;
+
+    /// The active `unconnected_drive setting.
+    TokenKind unconnectedDrive = TokenKind::Unknown;
+
+    /// Updates this state with the changes recorded while preprocessing a file.
+    void apply(const PreprocessorDependencies& dependencies);
+};
+
+/// Records how preprocessing a file depended on the state it started with, which
+/// allows checking after the fact whether starting from a different state would
+/// have produced the same results, along with the changes it made to that state.
+struct SLANG_EXPORT PreprocessorDependencies {
+    /// Names of macros that were looked up before the file changed them.
+    flat_hash_set<std::string_view> usedMacros;
+
+    /// Files that were the target of an `include directive.
+    flat_hash_set<const char*> usedHeaders;
+
+    /// The changes made to the starting state: macros that were defined (or null
+    /// if they were undefined), newly found include guards and `pragma once files,
+    /// and the directive settings in effect at the end of the file.
+    PreprocessorState changes;
+
+    /// Set if the file used `undefineall, which undefines every macro that
+    /// isn't listed in @a changes.
+    bool undefinedAll = false;
+
+    /// Set if the file ended with state that can't be carried over to another
+    /// file via a snapshot, such as an unterminated conditional directive, or
+    /// if its results depend on directives that haven't been applied yet.
+    bool unbalanced = false;
+
+    /// A `line directive found in the file.
+    struct LineDirective {
+        SourceLocation location;
+        size_t lineNum;
+        std::string_view name;
+        uint8_t level;
+    };
+
+    /// A diagnostic control directive found in the file via `pragma diagnostic.
+    struct DiagnosticDirective {
+        SourceLocation location;
+        std::string_view name;
+        DiagnosticSeverity severity;
+    };
+
+    /// Directives that would otherwise have been registered with the source manager.
+    /// They're held back so that nothing is left behind if the results are discarded;
+    /// call @a applyDirectives once the results are known to be kept.
+    std::vector<LineDirective> lineDirectives;
+    std::vector<DiagnosticDirective> diagDirectives;
+
+    /// Checks whether preprocessing that started from the @a assumed state would
+    /// have had the same results if it had started from the @a actual state.
+    bool isSatisfiedBy(const PreprocessorState& assumed, const PreprocessorState& actual) const;
+
+    /// Registers the recorded `line and `pragma diagnostic directives with
+    /// the given source manager.
+    void applyDirectives(SourceManager& sourceManager) const;
 };
 
 /// Preprocessor - Interface between lexer and parser
@@ -68,7 +159,10 @@ public:
 
     /// Push a new source file onto the stack.
     void pushSource(std::string_view source, std::string_view name = "source");
-    void pushSource(SourceBuffer buffer);
+
+    /// Push a new source file onto the stack. If @a startOffset is given, reading starts
+    /// at that offset into the buffer instead of at the beginning (see Lexer).
+    void pushSource(SourceBuffer buffer, size_t startOffset = 0);
 
     /// Predefines the given macro definition. The given definition string is lexed
     /// as if it were source text immediately following a `define directive.
@@ -98,6 +192,20 @@ public:
     /// macros that have been defined.
     void resetAllDirectives();
 
+    /// Gets a snapshot of the state that would carry over into the next source file,
+    /// if it were processed as part of the same compilation unit.
+    PreprocessorState getState() const;
+
+    /// Restores the state that carries over between source files from a snapshot
+    /// previously taken via @a getState, possibly from a different preprocessor.
+    void setState(const PreprocessorState& state);
+
+    /// Starts recording the ways in which preprocessing depends on the state the
+    /// preprocessor started from into @a dependencies, which must outlive it.
+    void trackDependencies(PreprocessorDependencies& dependencies) {
+        this->dependencies = &dependencies;
+    }
+
     /// Increases the preprocessor's view of the depth of parsed design elements,
     /// such as modules or interfaces. A parser calls this whenever starting to
     /// parse a new design element so that the preprocessor can enforce rules about
@@ -140,6 +248,16 @@ public:
     /// Gets all macros that have been defined thus far in the preprocessor.
     std::vector<const syntax::DefineDirectiveSyntax*> getDefinedMacros() const;
 
+    /// Gets statistics about the `include directives processed thus far.
+    const IncludeStats& getIncludeStats() const { return includeStats; }
+
+    /// Gets statistics about the macros expanded thus far.
+    const MacroStats& getMacroStats() const { return macroStats; }
+
+    /// Gets the number of bytes of trivia that were not allocated because
+    /// the lexers were told to only keep lean trivia.
+    size_t getTriviaBytesSaved() const;
+
 private:
     Preprocessor(const Preprocessor& other);
     Preprocessor& operator=(const Preprocessor& other) = delete;
@@ -148,6 +266,8 @@ private:
     Token nextProcessed();
     Token nextRaw();
     void popSource();
+    void pushIncludedSource(SourceBuffer buffer);
+    void trackIncludeGuard(Token token);
 
     // directive handling methods
     Token handleDirectives(Token token);
@@ -197,6 +317,8 @@ private:
     void applyResetAllPragma(const syntax::PragmaDirectiveSyntax& pragma);
     void applyOncePragma(const syntax::PragmaDirectiveSyntax& pragma);
     void applyDiagnosticPragma(const syntax::PragmaDirectiveSyntax& pragma);
+    void addDiagnosticDirective(SourceLocation location, std::string_view name,
+                                DiagnosticSeverity severity);
     void ensurePragmaArgs(const syntax::PragmaDirectiveSyntax& pragma, size_t count);
     void ensureNoPragmaArgs(Token keyword, const syntax::PragmaExpressionSyntax* args);
     void resetProtectState();
@@ -287,6 +409,15 @@ private:
     bool applyMacroOps(std::span<Token const> tokens, SmallVectorBase<Token>& dest);
     void createBuiltInMacro(std::string_view name, int value, std::string_view valueStr = {});
 
+    // Caching of fully expanded object-like macros.
+    bool expandCachedMacro(MacroDef macro, Token directive);
+    void cacheMacroExpansion(MacroDef macro);
+    void invalidateCachedExpansion(std::string_view name);
+
+    // Notes the lookup or modification of a macro when tracking dependencies.
+    void noteMacroUse(std::string_view name);
+    void noteMacroChange(std::string_view name, const syntax::DefineDirectiveSyntax* syntax);
+
     static bool isSameMacro(const syntax::DefineDirectiveSyntax& left,
                             const syntax::DefineDirectiveSyntax& right);
 
@@ -317,6 +448,28 @@ private:
         BranchEntry(bool taken) : anyTaken(taken), currentActive(taken) {}
     };
 
+    // Tracks whether a source file has the form of a classic include guard, where
+    // the first token is an `ifndef and the only thing after its matching `endif is
+    // the end of the file. Files that have this form can be skipped entirely when
+    // included again as long as the guard macro remains defined.
+    struct IncludeGuardState {
+        enum State { Start, Opening, Open, Closed, Invalid };
+
+        BufferID buffer;
+        const char* bufferStart;
+        std::string_view macroName;
+        size_t branchDepth = 0;
+        State state = Start;
+
+        IncludeGuardState(SourceBuffer buffer) :
+            buffer(buffer.id), bufferStart(buffer.data.data()) {}
+    };
+
+    // Gets the include guard state for the active source, if there is one.
+    IncludeGuardState* getIncludeGuard() {
+        return includeGuardStack.empty() ? nullptr : &includeGuardStack.back();
+    }
+
     // Helper class for parsing macro arguments. There's a lot of otherwise overlapping code that
     // this class consolidates, but it makes it a little confusing. If a buffer is provided via
     // setBuffer(), tokens are pulled from there first. Otherwise it just pulls from the main
@@ -361,15 +514,33 @@ private:
     PreprocessorOptions options;
     LexerOptions lexerOptions;
 
+    // shared cache of lexed tokens for included files, if one is in use
+    TokenCache* tokenCache = nullptr;
+
     // stack of active lexers; each `include pushes a new lexer
     SmallVector<std::unique_ptr<Lexer>, 2> lexerStack;
 
+    // include guard detection state for each entry in the lexer stack
+    SmallVector<IncludeGuardState, 2> includeGuardStack;
+
     // keep track of nested processor branches (ifdef, ifndef, else, elsif, endif)
     SmallVector<BranchEntry, 2> branchStack;
 
     // map from macro name to macro definition
     flat_hash_map<std::string_view, MacroDef> macros;
 
+    // The fully expanded tokens of an object-like macro, saved so that later
+    // usages don't need to redo the expansion. Token locations are offsets
+    // into the expansion buffer, which always starts at offset zero.
+    struct CachedExpansion {
+        const syntax::DefineDirectiveSyntax* syntax = nullptr;
+        std::span<const Token> tokens;
+        bool cacheable = false;
+    };
+
+    // map from macro name to its cached expansion, if it has one
+    flat_hash_map<std::string_view, CachedExpansion> expansionCache;
+
     // list of expanded macro tokens to drain before continuing with active lexer
     SmallVector<Token> expandedTokens;
     Token* currentMacroToken = nullptr;
@@ -392,6 +563,19 @@ private:
     // have been marked `pragma once so that we avoid trying to include them more than once.
     flat_hash_set<const char*> includeOnceHeaders;
 
+    // A map of files (identified the same way as above) that have been found to be
+    // wrapped in an include guard, to the name of the guarding macro.
+    flat_hash_map<const char*, std::string_view> includeGuards;
+
+    IncludeStats includeStats;
+    MacroStats macroStats;
+
+    // The trivia bytes saved by lexers that have already been popped.
+    size_t triviaBytesSaved = 0;
+
+    // Where to record dependencies on the starting state, if anywhere.
+    PreprocessorDependencies* dependencies = nullptr;
+
     /// Various state set by preprocessor directives.
     std::vector<KeywordVersion> keywordVersionStack;
     std::optional<TimeScale> activeTimeScale;
@@ -112,10 +112,14 @@ public:
     std::span<Token const> getSkippedTokens() const;
 
     Trivia clone(BumpAllocator& alloc) const;
+
+private:
+    friend class Token;
 };
 #if !defined(_M_IX86)
 static_assert(sizeof(Trivia) == 16);
 #endif
+static_assert(std::is_trivially_copyable_v<Trivia>);
 
 /// Represents a single lexed token, including leading trivia, original location, token kind,
 /// and any related information derived from the token itself (such as the lexeme).
@@ -188,6 +192,11 @@ public:
                               std::string_view rawText, SourceLocation location) const;
     [[nodiscard]] Token deepClone(BumpAllocator& alloc) const;
 
+    /// Changes the location of the token in place. Every copy of a token shares its
+    /// location, so this is only safe for tokens that nothing else holds on to, such
+    /// as the ones in a syntax tree that is being taken over by a new one.
+    void setLocation(SourceLocation location);
+
     static Token createMissing(BumpAllocator& alloc, TokenKind kind, SourceLocation location);
     static Token createExpected(BumpAllocator& alloc, Diagnostics& diagnostics, Token actual,
                                 TokenKind expected, Token lastConsumed, Token matchingDelim);
@@ -198,19 +207,26 @@ private:
     void init(BumpAllocator& alloc, TokenKind kind, std::span<Trivia const> trivia,
               std::string_view rawText, SourceLocation location);
 
+    static uint8_t getImplicitTrivia(std::span<Trivia const> trivia);
+
     // Some data is stored directly in the token here because we have 6 bytes of padding that
     // would otherwise go unused. The rest is stored in the info block.
     bool missing : 1;
     uint8_t triviaCountSmall : 4;
-    uint8_t reserved : 3;
+    uint8_t implicitTrivia : 2;
+    uint8_t reserved : 1;
     NumericTokenFlags numFlags;
     uint32_t rawLen = 0;
     Info* info = nullptr;
 
     // We use some free bits in the token structure to count how many trivia elements
-    // this token has. This is enough space for the vast majority of tokens, but for
-    // cases with more, triviaCountSmall gets set to all 1's and the real count is
-    // included in the info structure.
+    // this token has. That many trivia are stored inline at the end of the info block,
+    // which is enough space for the vast majority of tokens. For cases with more,
+    // triviaCountSmall gets set to all 1's and the info block instead holds a pointer
+    // to the trivia along with the real count.
+    //
+    // Tokens whose only trivia is a single space or a single newline (which is most
+    // of them) don't store anything at all; implicitTrivia says which one it was.
     static constexpr int MaxTriviaSmallCount = (1 << 4) - 2;
 };
 
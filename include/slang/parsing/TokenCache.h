@@ -0,0 +1,70 @@
+//------------------------------------------------------------------------------
+//! @file TokenCache.h
+//! @brief Thread-safe cache of lexed tokens for commonly included files
+//
+// SPDX-FileCopyrightText: Michael Popoloski
+// SPDX-License-Identifier: MIT
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <memory>
+#include <shared_mutex>
+#include <span>
+#include <tuple>
+
+#include "slang/parsing/Lexer.h"
+#include "slang/parsing/LexerFacts.h"
+#include "slang/parsing/Token.h"
+#include "slang/text/SourceLocation.h"
+#include "slang/util/BumpAllocator.h"
+#include "slang/util/Hash.h"
+
+namespace slang {
+class SourceManager;
+}
+
+namespace slang::parsing {
+
+/// A cache of the token streams lexed from source files, which can be shared by
+/// multiple preprocessors (possibly running on different threads) so that files
+/// that are included over and over again, such as common macro headers, only need
+/// to be lexed once.
+///
+/// Buffers are identified by their text, so the cache can only be used with the
+/// source manager it was created for. A buffer's tokens are only cached once it
+/// has been requested more than once, and only if lexing it produced no diagnostics.
+class SLANG_EXPORT TokenCache {
+public:
+    /// Constructs a new cache for buffers loaded by the given source manager.
+    explicit TokenCache(const SourceManager& sourceManager);
+
+    /// Gets the source manager whose buffers are cached.
+    const SourceManager& getSourceManager() const { return sourceManager; }
+
+    /// Gets the cached tokens for the given @a buffer, lexed with the given
+    /// keyword version and lexer options. The returned tokens include the trailing
+    /// EndOfFile token and have locations that refer to whichever buffer was first
+    /// cached for the same text; callers are expected to relocate them.
+    ///
+    /// @returns the cached tokens, or an empty span if the buffer should be
+    /// lexed normally instead.
+    std::span<const Token> get(const SourceBuffer& buffer, KeywordVersion keywordVersion,
+                               const LexerOptions& options);
+
+private:
+    enum class State { Seen, Lexing, Cached, Uncacheable };
+
+    struct Entry {
+        State state = State::Seen;
+        std::span<const Token> tokens;
+        std::unique_ptr<BumpAllocator> alloc;
+    };
+
+    using Key = std::tuple<const char*, KeywordVersion, uint32_t, bool>;
+
+    const SourceManager& sourceManager;
+    flat_hash_map<Key, Entry> entries;
+    mutable std::shared_mutex mutex;
+};
+
+} // namespace slang::parsing
@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------
+//! @file DefinitionIndex.h
+//! @brief Thread-safe index of the definitions declared in syntax trees
+//
+// SPDX-FileCopyrightText: Michael Popoloski
+// SPDX-License-Identifier: MIT
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+#include "slang/util/Hash.h"
+
+namespace slang::syntax {
+
+class SyntaxNode;
+class SyntaxTree;
+
+/// An index of the names of all modules, interfaces, programs, packages, and
+/// classes declared across a set of syntax trees, mapped to the syntax nodes
+/// that declare them.
+///
+/// The index is built from the metadata collected while each tree was parsed,
+/// so adding a tree doesn't need to walk it. Trees can be added from multiple
+/// threads at once, for example as each one finishes parsing on a thread pool.
+class SLANG_EXPORT DefinitionIndex {
+public:
+    /// A single declaration of a name.
+    struct Entry {
+        /// The syntax node that declares the definition. This is either a
+        /// ModuleDeclarationSyntax or a ClassDeclarationSyntax.
+        const SyntaxNode* syntax = nullptr;
+
+        /// The tree that contains the declaration.
+        const SyntaxTree* tree = nullptr;
+    };
+
+    /// Adds all of the definitions declared in the given @a tree.
+    /// This method is thread-safe.
+    void add(const SyntaxTree& tree);
+
+    /// Returns true if the given @a name is declared in any added tree.
+    bool contains(std::string_view name) const;
+
+    /// Gets all of the declarations of the given @a name, in no particular order.
+    std::vector<Entry> find(std::string_view name) const;
+
+    /// Gets the number of distinct names in the index.
+    size_t size() const;
+
+    /// Finds the names of all definitions that the given @a tree refers to (by
+    /// instantiating, importing, or scoping them) that aren't in the index, and
+    /// adds them to @a results. This is used to search for library files that
+    /// might provide the missing definitions.
+    void findMissingNames(const SyntaxTree& tree,
+                          flat_hash_set<std::string_view>& results) const;
+
+private:
+    flat_hash_map<std::string_view, std::vector<Entry>> entries;
+    mutable std::shared_mutex mutex;
+};
+
+} // namespace slang::syntax
@@ -7,6 +7,7 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include <optional>
 #include <string>
 
 #include "slang/parsing/Token.h"
@@ -44,6 +45,11 @@ public:
     SyntaxPrinter& print(const SyntaxNode& node);
 
     /// Print the provided @a tree to the internal buffer.
+    ///
+    /// If the tree was produced by SyntaxRewriter::transformShared and the printer is
+    /// set up to print source text exactly (as @a printFile does), subtrees that were
+    /// left unchanged are copied straight from the original source text instead of
+    /// being printed token by token.
     /// @return a reference to this object, to allow chaining additional method calls.
     SyntaxPrinter& print(const SyntaxTree& tree);
 
@@ -99,13 +105,28 @@ public:
     /// @return a copy of the internal text buffer.
     std::string str() const { return buffer; }
 
+    /// @return the number of characters currently in the internal text buffer.
+    size_t size() const { return buffer.size(); }
+
+    /// Moves the contents of the internal text buffer out, leaving it empty.
+    /// Printing can continue afterward, which allows large outputs to be
+    /// written out incrementally instead of being built up all at once.
+    /// @return the previous contents of the internal text buffer.
+    std::string take();
+
     /// A helper method that assists in printing an entire syntax tree back to source
     /// text. A SyntaxPrinter with useful defaults is constructed, the tree is printed,
     /// and the resulting text is returned.
     static std::string printFile(const SyntaxTree& tree);
 
 private:
+    bool printsExactSourceText() const;
+    void printFromSource(const SyntaxNode& node, const SyntaxTree& tree, bool knownUnchanged);
+    std::optional<std::string_view> getSourceText(const SyntaxNode& node) const;
+    void appendDisabledText(std::string_view text);
+
     std::string buffer;
+    char lastTaken = 0;
     const SourceManager* sourceManager = nullptr;
     bool includeTrivia = true;
     bool includeMissing = false;
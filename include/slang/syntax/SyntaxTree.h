@@ -17,6 +17,7 @@
 namespace slang {
 
 class SourceManager;
+class ThreadPool;
 struct SourceBuffer;
 
 } // namespace slang
@@ -30,6 +31,34 @@ namespace slang::syntax {
 class SyntaxNode;
 struct DefineDirectiveSyntax;
 
+/// Describes how a node in a syntax tree produced by a structurally shared edit
+/// (see SyntaxRewriter::transformShared) relates to the tree it was derived from.
+enum class SyntaxEditKind {
+    /// The node is shared, unmodified, with the tree that was edited.
+    Unchanged,
+
+    /// The node is a copy of a node from the edited tree that was made because
+    /// something beneath it changed. Its children may still be shared.
+    Rebuilt,
+
+    /// The node was inserted by the edit, either as a new node or as the
+    /// replacement for an existing one.
+    Inserted
+};
+
+/// Describes a single change made to the text of a source buffer, such as
+/// one reported by an editor.
+struct SLANG_EXPORT TextEdit {
+    /// The offset, in the original text, of the start of the replaced range.
+    size_t offset = 0;
+
+    /// The length of the replaced range; zero for a pure insertion.
+    size_t length = 0;
+
+    /// The text that replaces the range; empty for a pure deletion.
+    std::string_view newText;
+};
+
 /// The SyntaxTree is the easiest way to interface with the lexer / preprocessor /
 /// parser stack. Give it some source text and it produces a parse tree.
 ///
@@ -46,6 +75,17 @@ public:
     SyntaxTree(SyntaxNode* root, SourceManager& sourceManager, BumpAllocator&& alloc,
                const SourceLibrary* library, std::shared_ptr<SyntaxTree> parent = nullptr);
 
+    /// Constructs a syntax tree that was derived from @a parent by a structurally shared
+    /// edit. Every node reachable from @a root that isn't listed in @a editedNodes is
+    /// shared with (and owned by) the parent tree. @a metadata is the parent's metadata
+    /// updated for the edit (see ParserMetadata::fromSharedEdit). @a parents maps each
+    /// node whose parent differs from the one it has in the parent tree (or, for nodes
+    /// not from the parent tree, from its parent pointer) to its parent in this tree.
+    SyntaxTree(SyntaxNode* root, SourceManager& sourceManager, BumpAllocator&& alloc,
+               std::shared_ptr<SyntaxTree> parent, parsing::ParserMetadata&& metadata,
+               flat_hash_map<const SyntaxNode*, SyntaxEditKind>&& editedNodes,
+               flat_hash_map<const SyntaxNode*, const SyntaxNode*>&& parents);
+
     SyntaxTree(SyntaxTree&& other) = default;
     ~SyntaxTree();
 
@@ -133,6 +173,29 @@ public:
                                                    const Bag& options = {},
                                                    MacroList inheritedMacros = {});
 
+    /// Creates a syntax tree by concatenating several loaded source buffers, just like
+    /// @a fromBuffers, but parses the buffers concurrently.
+    ///
+    /// Each buffer is first parsed on its own, starting from a guess at the preprocessor
+    /// state (macros and directive settings) that the buffers before it leave behind.
+    /// The guesses are then checked in order against the actual state, and any buffer
+    /// whose results depended on a wrong guess is parsed again from the right state.
+    /// If a buffer ends in the middle of a construct that continues into the next one,
+    /// the buffers are parsed in order as usual.
+    ///
+    /// @a buffers is the list of buffers that should be concatenated to form
+    /// the compilation unit to parse.
+    /// @a sourceManager is the manager that owns the buffers.
+    /// @a threadPool is the pool of threads to use for parsing.
+    /// @a options is an optional bag of lexer, preprocessor, and parser options.
+    /// @a inheritedMacros is a list of macros to predefine in the new syntax tree.
+    /// @return the created and parsed syntax tree.
+    static std::shared_ptr<SyntaxTree> fromBuffersInParallel(std::span<const SourceBuffer> buffers,
+                                                             SourceManager& sourceManager,
+                                                             ThreadPool& threadPool,
+                                                             const Bag& options = {},
+                                                             MacroList inheritedMacros = {});
+
     /// Creates a syntax tree from a library map file.
     /// @a path is the path to the source file on disk.
     /// @a sourceManager is the manager that owns all of the loaded source code.
@@ -164,9 +227,34 @@ public:
                                                             SourceManager& sourceManager,
                                                             const Bag& options = {});
 
+    /// Creates a syntax tree by applying a set of edits to the text of an existing tree.
+    /// Only the top-level members touched by the edits are lexed and parsed again;
+    /// the rest are moved over from @a oldTree as they are, along with their diagnostics
+    /// and parser metadata. If the edits could change the state of the preprocessor (or
+    /// the old tree can't otherwise be reused) the new text is fully parsed instead, so
+    /// the result is always the same as parsing the edited text from scratch.
+    ///
+    /// Reusing syntax from @a oldTree changes it in place, so that only happens if this
+    /// call holds the last reference to it; pass it with std::move and don't keep any
+    /// other pointers into it. If anything else still refers to the old tree it's left
+    /// alone and the new text is fully parsed.
+    ///
+    /// @a oldTree is the tree to update, which must have been created from a single buffer.
+    /// @a edits is the list of edits, sorted by offset and non-overlapping.
+    /// @a name is an optional name to give to the new source buffer.
+    /// @a path is an optional path to give to the new source buffer.
+    /// @return the created and parsed syntax tree.
+    static std::shared_ptr<SyntaxTree> fromEdits(std::shared_ptr<SyntaxTree> oldTree,
+                                                 std::span<const TextEdit> edits,
+                                                 std::string_view name = "source"sv,
+                                                 std::string_view path = "");
+
     /// Gets any diagnostics generated while parsing.
     Diagnostics& diagnostics() { return diagnosticsBuffer; }
 
+    /// Gets any diagnostics generated while parsing.
+    const Diagnostics& diagnostics() const { return diagnosticsBuffer; }
+
     /// Gets the allocator containing the memory for the parse tree.
     BumpAllocator& allocator() { return alloc; }
 
@@ -194,6 +282,22 @@ public:
     /// Gets various bits of metadata collected during parsing.
     const parsing::ParserMetadata& getMetadata() const { return *metadata; }
 
+    /// Gets how the given node, which must be part of this tree, was affected by
+    /// the structurally shared edits (if any) that produced this tree.
+    SyntaxEditKind getEditKind(const SyntaxNode& node) const;
+
+    /// Gets the parent of the given node, which must be part of this tree. Nodes that
+    /// structurally shared edits kept from the tree they were derived from still have
+    /// their parent pointers set within that tree, so for trees produced that way this
+    /// should be used instead of SyntaxNode::parent. For all other trees they're the same.
+    const SyntaxNode* getParent(const SyntaxNode& node) const;
+
+    /// Indicates whether this tree was produced by structurally shared edits (see
+    /// SyntaxRewriter::transformShared) of a tree created by parsing, such that the
+    /// nodes left unchanged can be printed directly from their original source text.
+    /// This is never true for trees parsed with lean trivia.
+    bool canPrintUnchangedFromSource() const { return sharesParentNodes && exactSourceText; }
+
     /// Gets the list of macros that were defined at the end of the loaded source file.
     MacroList getDefinedMacros() const { return macros; }
 
@@ -204,6 +308,8 @@ public:
     static SourceManager& getDefaultSourceManager();
 
 private:
+    friend class SyntaxTreeCache;
+
     SyntaxTree(SyntaxNode* root, SourceManager& sourceManager, BumpAllocator&& alloc,
                Diagnostics&& diagnostics, parsing::ParserMetadata&& metadata,
                std::vector<const DefineDirectiveSyntax*>&& macros, Bag options);
@@ -213,6 +319,11 @@ private:
                                               const Bag& options, MacroList inheritedMacros,
                                               bool guess);
 
+    static std::shared_ptr<SyntaxTree> reparse(SyntaxTree& oldTree,
+                                               std::span<const TextEdit> edits,
+                                               std::string_view oldText,
+                                               const SourceBuffer& buffer);
+
     SyntaxNode* rootNode;
     SourceManager& sourceMan;
     BumpAllocator alloc;
@@ -221,6 +332,14 @@ private:
     std::unique_ptr<parsing::ParserMetadata> metadata;
     std::vector<const DefineDirectiveSyntax*> macros;
     std::shared_ptr<SyntaxTree> parentTree;
+    flat_hash_map<const SyntaxNode*, SyntaxEditKind> editedNodes;
+    flat_hash_map<const SyntaxNode*, const SyntaxNode*> parents;
+    bool sharesParentNodes = false;
+    bool exactSourceText = false;
+
+    // The amount of source text whose syntax was replaced by incremental reparses
+    // (see fromEdits) but whose memory is still held by the allocator.
+    size_t replacedTextSize = 0;
 };
 
 } // namespace slang::syntax
@@ -0,0 +1,76 @@
+//------------------------------------------------------------------------------
+//! @file SyntaxTreeCache.h
+//! @brief Persistent on-disk cache of parsed syntax trees
+//
+// SPDX-FileCopyrightText: Michael Popoloski
+// SPDX-License-Identifier: MIT
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "slang/util/Bag.h"
+
+namespace slang {
+class SourceManager;
+struct SourceBuffer;
+} // namespace slang
+
+namespace slang::syntax {
+
+class SyntaxTree;
+struct DefineDirectiveSyntax;
+
+/// Contains options for caching parsed syntax trees on disk.
+struct SLANG_EXPORT SyntaxTreeCacheOptions {
+    /// The directory in which serialized syntax trees are stored.
+    /// If empty, syntax trees are not cached.
+    std::string directory;
+};
+
+/// Stores parsed syntax trees in a directory on disk, keyed by a hash of the
+/// source text, the options used to parse it, the include directories that were
+/// searched, and any inherited macros, so that later runs can load the tree
+/// instead of lexing and parsing it again.
+///
+/// A cached tree records every file it included along with a hash of that file's
+/// contents; editing any of those files causes the cached tree to be ignored.
+/// Only trees that parsed without any diagnostics are stored.
+class SLANG_EXPORT SyntaxTreeCache {
+public:
+    using MacroList = std::span<const DefineDirectiveSyntax* const>;
+
+    /// Constructs a new cache that stores its files in @a directory.
+    explicit SyntaxTreeCache(std::filesystem::path directory);
+
+    /// Computes the key under which a tree parsed from the given inputs is stored.
+    /// The returned key is an opaque blob that includes everything that can affect
+    /// the result of the parse, other than the contents of included files.
+    static std::vector<char> getKey(const SourceManager& sourceManager,
+                                    std::span<const SourceBuffer> sources, const Bag& options,
+                                    MacroList inheritedMacros);
+
+    /// Tries to load a previously stored syntax tree for the given @a key.
+    /// The source manager is only modified if the load succeeds.
+    /// @returns the loaded tree, or nullptr if there is no valid cache entry.
+    std::shared_ptr<SyntaxTree> load(std::span<const char> key, SourceManager& sourceManager,
+                                     std::span<const SourceBuffer> sources,
+                                     const Bag& options) const;
+
+    /// Stores the given syntax @a tree under the given @a key.
+    /// @returns true if the tree was stored, and false if it was not eligible
+    /// for caching or the cache file could not be written.
+    bool store(std::span<const char> key, const SyntaxTree& tree,
+               std::span<const SourceBuffer> sources) const;
+
+private:
+    std::filesystem::path getPath(std::span<const char> key) const;
+
+    std::filesystem::path directory;
+};
+
+} // namespace slang::syntax
@@ -12,6 +12,7 @@
 #include "slang/syntax/AllSyntax.h"
 #include "slang/syntax/SyntaxTree.h"
 #include "slang/util/Hash.h"
+#include "slang/util/SmallVector.h"
 #include "slang/util/TypeTraits.h"
 
 namespace slang::syntax {
@@ -21,6 +22,11 @@ namespace slang::syntax {
 /// Use this type as a base class for syntax tree visitors. It will default to
 /// traversing all children of each node. Add implementations for any specific
 /// node types you want to handle.
+///
+/// Visitors that only care about a few kinds of nodes can declare them by providing
+/// a `static bool isHandledKind(SyntaxKind)` method. Child nodes that can't possibly
+/// contain any handled kind (as determined by @a canContainKind) are then skipped
+/// entirely, including all of their tokens.
 template<typename TDerived>
 class SyntaxVisitor {
 public:
@@ -39,8 +45,13 @@ public:
     void visitDefault(T&& node) {
         for (uint32_t i = 0; i < node.getChildCount(); i++) {
             auto child = node.childNode(i);
-            if (child)
+            if (child) {
+                if constexpr (requires { TDerived::isHandledKind(SyntaxKind::Unknown); }) {
+                    if (!shouldVisitKind(child->kind))
+                        continue;
+                }
                 child->visit(*DERIVED);
+            }
             else {
                 auto token = node.childToken(i);
                 if (token)
@@ -52,6 +63,30 @@ public:
 private:
     // This is to make things compile if the derived class doesn't provide an implementation.
     void visitToken(parsing::Token) {}
+
+    static bool shouldVisitKind(SyntaxKind kind) {
+        static constexpr size_t NumKinds = std::tuple_size_v<decltype(SyntaxKind_traits::values)>;
+        static const auto table = [] {
+            SmallVector<SyntaxKind> handled;
+            for (auto k : SyntaxKind_traits::values) {
+                if (TDerived::isHandledKind(k))
+                    handled.push_back(k);
+            }
+
+            std::array<bool, NumKinds> result{};
+            for (auto k : SyntaxKind_traits::values) {
+                auto& entry = result[size_t(k)];
+                for (auto h : handled) {
+                    if (k == h || canContainKind(k, h)) {
+                        entry = true;
+                        break;
+                    }
+                }
+            }
+            return result;
+        }();
+        return table[size_t(kind)];
+    }
 };
 
 namespace detail {
@@ -92,7 +127,8 @@ struct SLANG_EXPORT ChangeCollection {
 
 SLANG_EXPORT std::shared_ptr<SyntaxTree> transformTree(
     BumpAllocator&& alloc, const std::shared_ptr<SyntaxTree>& tree, const ChangeCollection& commits,
-    const std::vector<std::shared_ptr<SyntaxTree>>& tempTrees, const SourceLibrary* library);
+    const std::vector<std::shared_ptr<SyntaxTree>>& tempTrees, const SourceLibrary* library,
+    bool shareUnchanged = false);
 
 } // namespace detail
 
@@ -111,16 +147,24 @@ public:
     /// Otherwise, the changes are applied and the newly rewritten syntax tree is returned.
     std::shared_ptr<SyntaxTree> transform(const std::shared_ptr<SyntaxTree>& tree,
                                           const SourceLibrary* library = nullptr) {
-        sourceManager = &tree->sourceManager();
-        commits.clear();
-        tempTrees.clear();
-
-        tree->root().visit(*this);
-
-        if (commits.empty())
-            return tree;
+        return doTransform(tree, library, /* shareUnchanged */ false);
+    }
 
-        return transformTree(std::move(alloc), tree, commits, tempTrees, library);
+    /// Transforms the given syntax tree in the same way as @a transform, except that
+    /// only the nodes on the path from the root down to each change are copied. All
+    /// other nodes are shared with the original tree, which the new tree keeps alive,
+    /// so the cost of building the new tree scales with the size of the changes instead
+    /// of the size of the tree. SyntaxPrinter takes advantage of this to print shared
+    /// subtrees directly from the original source text.
+    ///
+    /// The original tree is left untouched, so shared nodes keep their parent pointers
+    /// into it; use SyntaxTree::getParent to find their parents in the new tree.
+    ///
+    /// @return if no changes are requested, returns the original syntax tree.
+    /// Otherwise, the changes are applied and the newly rewritten syntax tree is returned.
+    std::shared_ptr<SyntaxTree> transformShared(const std::shared_ptr<SyntaxTree>& tree,
+                                                const SourceLibrary* library = nullptr) {
+        return doTransform(tree, library, /* shareUnchanged */ true);
     }
 
 protected:
@@ -192,6 +236,20 @@ protected:
     static const parsing::Trivia SingleSpace;
 
 private:
+    std::shared_ptr<SyntaxTree> doTransform(const std::shared_ptr<SyntaxTree>& tree,
+                                            const SourceLibrary* library, bool shareUnchanged) {
+        sourceManager = &tree->sourceManager();
+        commits.clear();
+        tempTrees.clear();
+
+        tree->root().visit(*this);
+
+        if (commits.empty())
+            return tree;
+
+        return transformTree(std::move(alloc), tree, commits, tempTrees, library, shareUnchanged);
+    }
+
     SourceManager* sourceManager = nullptr;
     detail::ChangeCollection commits;
     std::vector<std::shared_ptr<SyntaxTree>> tempTrees;
@@ -11,14 +11,17 @@
 #include <filesystem>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <shared_mutex>
 #include <span>
+#include <tuple>
 #include <variant>
 #include <vector>
 
 #include "slang/text/SourceLocation.h"
 #include "slang/util/Hash.h"
+#include "slang/util/OS.h"
 #include "slang/util/Util.h"
 
 namespace slang {
@@ -53,6 +56,12 @@ public:
     /// @returns true on success and false on failure (i.e. if the given path does not exist).
     [[nodiscard]] bool addUserDirectory(std::string_view path);
 
+    /// Gets the system include directories, in the order in which they are searched.
+    std::vector<std::filesystem::path> getSystemDirectories() const;
+
+    /// Gets the user include directories, in the order in which they are searched.
+    std::vector<std::filesystem::path> getUserDirectories() const;
+
     /// Gets the source line number for a given source location.
     size_t getLineNumber(SourceLocation location) const;
 
@@ -154,11 +163,27 @@ public:
     /// Returns true if the given file path is already loaded and cached in the source manager.
     bool isCached(const std::filesystem::path& path) const;
 
+    /// Clears all cached information used to speed up header lookups, including
+    /// the contents of include directories, files known not to exist, and the
+    /// results of previous calls to @a readHeader. This happens automatically when
+    /// include directories are added; call it manually if files may have been
+    /// added or removed on disk since headers were last read.
+    void clearIncludeCache();
+
     /// Sets whether filenames should be made "proximate" to the current directory
     /// for diagnostic reporting purposes. This is on by default but can be
     /// disabled to always use the simple filename.
     void setDisableProximatePaths(bool set) { disableProximatePaths = set; }
 
+    /// Sets whether source files loaded from disk should be memory mapped instead
+    /// of being copied into heap allocated buffers. Files that are too small to
+    /// benefit, or that are not regular files (such as pipes), are always read
+    /// normally. This is off by default.
+    ///
+    /// Note that mapped files must not be modified on disk for as long as the
+    /// source manager is alive.
+    void setMemoryMapFiles(bool set) { memoryMapFiles = set; }
+
     /// Adds a line directive at the given location.
     void addLineDirective(SourceLocation location, size_t lineNum, std::string_view name,
                           uint8_t level);
@@ -219,15 +244,22 @@ private:
     // Stores actual file contents and metadata; only one per loaded file
     struct FileData {
         const std::string name;                       // name of the file
-        const std::vector<char> mem;                  // file contents
+        const std::vector<char> mem;                  // file contents, if read into memory
+        const MappedFile mapped;                      // file contents, if memory mapped
         std::vector<size_t> lineOffsets;              // cache of compute line offsets
         const std::filesystem::path* const directory; // directory in which the file exists
         const std::filesystem::path fullPath;         // full path to the file
 
         FileData(const std::filesystem::path* directory, std::string name, std::vector<char>&& data,
-                 std::filesystem::path fullPath) :
+                 MappedFile&& mapped, std::filesystem::path fullPath) :
             name(std::move(name)),
-            mem(std::move(data)), directory(directory), fullPath(std::move(fullPath)) {}
+            mem(std::move(data)), mapped(std::move(mapped)), directory(directory),
+            fullPath(std::move(fullPath)) {}
+
+        // Gets the file contents, including the trailing null terminator.
+        std::string_view text() const {
+            return mapped.valid() ? mapped.text() : std::string_view(mem.data(), mem.size());
+        }
     };
 
     // Stores a pointer to file data along with information about where we included it.
@@ -270,7 +302,49 @@ private:
             expansionRange(expansionRange), macroName(macroName) {}
     };
 
-    // This mutex protects pretty much everything in this class.
+    using BufferEntry = std::variant<FileInfo, ExpansionInfo>;
+
+    // An append-only list of buffer entries that can be read without taking any
+    // locks. Entries are stored in a fixed number of chunks that double in size,
+    // so once an entry has been added it never moves. Adding an entry claims a
+    // slot with an atomic increment and then marks the slot as ready once it has
+    // been filled in, so writers don't need a lock either.
+    class BufferEntryStore {
+    public:
+        BufferEntryStore() = default;
+        BufferEntryStore(const BufferEntryStore&) = delete;
+        BufferEntryStore& operator=(const BufferEntryStore&) = delete;
+        ~BufferEntryStore();
+
+        // Adds a new entry and returns its index.
+        uint32_t append(BufferEntry&& entry);
+
+        // Gets the entry at the given index, or nullptr if there isn't one.
+        const BufferEntry* get(uint32_t index) const;
+        BufferEntry* get(uint32_t index);
+
+        // The number of slots that have been claimed. Slots near the end
+        // may still be in the process of being filled in.
+        uint32_t size() const { return count.load(std::memory_order_acquire); }
+
+    private:
+        struct Slot {
+            BufferEntry entry;
+            std::atomic<bool> ready = false;
+        };
+
+        static constexpr uint32_t FirstChunkBits = 10;
+        static constexpr uint32_t NumChunks = 33 - FirstChunkBits;
+
+        Slot* getSlot(uint32_t index, bool create) const;
+
+        mutable std::atomic<Slot*> chunks[NumChunks] = {};
+        std::atomic<uint32_t> count = 0;
+    };
+
+    // This mutex protects the file cache, the line directive and line offset
+    // information for files, and the diagnostic directives. The buffer entries
+    // themselves don't need it.
     mutable std::shared_mutex mutex;
 
     // This mutex is specifically for protecting the system and user
@@ -278,7 +352,7 @@ private:
     mutable std::shared_mutex includeDirMutex;
 
     // index from BufferID to buffer metadata
-    std::vector<std::variant<FileInfo, ExpansionInfo>> bufferEntries;
+    BufferEntryStore bufferEntries;
 
     // cache for file lookups; this holds on to the actual file data
     flat_hash_map<std::string, std::unique_ptr<FileData>> lookupCache;
@@ -287,6 +361,24 @@ private:
     std::vector<std::filesystem::path> systemDirectories;
     std::vector<std::filesystem::path> userDirectories;
 
+    // This mutex protects the caches used to speed up header lookups below.
+    // It is never held while acquiring either of the other mutexes.
+    mutable std::shared_mutex includeCacheMutex;
+
+    // The names of the entries in directories that have been searched for headers,
+    // folded to lowercase. A missing value means that the directory could not be read.
+    using DirectoryListing = std::optional<flat_hash_set<std::string>>;
+    flat_hash_map<std::filesystem::path::string_type, DirectoryListing> directoryListings;
+
+    // Full paths of headers that we have already tried and failed to open.
+    flat_hash_set<std::filesystem::path::string_type> missingHeaders;
+
+    // Results of previous header lookups, keyed by the directory of the including
+    // file, whether it was a system include, and the path as written. A null
+    // result means the header could not be found.
+    using IncludeKey = std::tuple<const std::filesystem::path*, bool, std::string>;
+    flat_hash_map<IncludeKey, FileData*> includeResolutions;
+
     // uniquified backing memory for directories
     std::set<std::filesystem::path> directories;
 
@@ -295,12 +387,16 @@ private:
 
     std::atomic<uint32_t> unnamedBufferCount = 0;
     bool disableProximatePaths = false;
+    bool memoryMapFiles = false;
 
-    template<IsLock TLock>
-    FileInfo* getFileInfo(BufferID buffer, TLock& lock);
+    // Files smaller than this are always read into memory even when memory
+    // mapping is enabled, since the cost of setting up and tearing down the
+    // mapping outweighs the cost of the copy.
+    static constexpr size_t MinMappedFileSize = 16 * 1024;
 
-    template<IsLock TLock>
-    const FileInfo* getFileInfo(BufferID buffer, TLock& lock) const;
+    FileInfo* getFileInfo(BufferID buffer);
+    const FileInfo* getFileInfo(BufferID buffer) const;
+    const ExpansionInfo* getExpansionInfo(BufferID buffer) const;
 
     SourceBuffer createBufferEntry(FileData* fd, SourceLocation includedFrom,
                                    const SourceLibrary* library,
@@ -308,30 +404,24 @@ private:
 
     SourceBuffer openCached(const std::filesystem::path& fullPath, SourceLocation includedFrom,
                             const SourceLibrary* library);
+    SourceBuffer openHeader(const std::filesystem::path& directory,
+                            const std::filesystem::path& path, SourceLocation includedFrom,
+                            const SourceLibrary* library);
+    bool mayContain(const std::filesystem::path& directory, const std::filesystem::path& path);
     SourceBuffer cacheBuffer(std::filesystem::path&& path, std::string&& pathStr,
                              SourceLocation includedFrom, const SourceLibrary* library,
-                             std::vector<char>&& buffer);
+                             std::vector<char>&& buffer, MappedFile&& mapped);
 
     template<IsLock TLock>
     size_t getRawLineNumber(SourceLocation location, TLock& lock) const;
 
-    template<IsLock TLock>
-    bool isMacroLocImpl(SourceLocation location, TLock& lock) const;
-
-    template<IsLock TLock>
-    bool isMacroArgLocImpl(SourceLocation location, TLock& lock) const;
-
-    template<IsLock TLock>
-    SourceLocation getFullyExpandedLocImpl(SourceLocation location, TLock& lock) const;
-
-    template<IsLock TLock>
-    SourceLocation getOriginalLocImpl(SourceLocation location, TLock& lock) const;
-
-    template<IsLock TLock>
-    SourceRange getExpansionRangeImpl(SourceLocation location, TLock& lock) const;
+    bool isMacroLocImpl(SourceLocation location) const;
+    bool isMacroArgLocImpl(SourceLocation location) const;
+    SourceLocation getFullyExpandedLocImpl(SourceLocation location) const;
+    SourceLocation getOriginalLocImpl(SourceLocation location) const;
+    SourceRange getExpansionRangeImpl(SourceLocation location) const;
 
-    static void computeLineOffsets(const std::vector<char>& buffer,
-                                   std::vector<size_t>& offsets) noexcept;
+    static void computeLineOffsets(std::string_view text, std::vector<size_t>& offsets) noexcept;
 };
 
 } // namespace slang
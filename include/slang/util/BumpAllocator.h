@@ -40,6 +40,9 @@ public:
 
     /// Allocate @a size bytes of memory with the given @a alignment.
     byte* allocate(size_t size, size_t alignment) {
+        if (threadAllocators) [[unlikely]]
+            return allocateForThread(size, alignment);
+
         byte* base = alignPtr(head->current, alignment);
         byte* next = base + size;
         if (next > endPtr)
@@ -53,6 +56,12 @@ public:
     /// The other allocator will be in a moved-from state after the call.
     void steal(BumpAllocator&& other);
 
+    /// Sets whether the allocator can be used from more than one thread at a time.
+    /// While it can, each thread that allocates gets its own set of segments, and all
+    /// of them are handed over to this allocator once the mode is turned back off.
+    /// Changing the mode must not race with any allocations.
+    void setMultiThreaded(bool enabled);
+
 protected:
     // Allocations are tracked as a linked list of segments.
     struct Segment {
@@ -63,11 +72,18 @@ protected:
     Segment* head;
     byte* endPtr;
 
+    // Per-thread allocators in use while multithreaded mode is on.
+    struct ThreadAllocators;
+    ThreadAllocators* threadAllocators = nullptr;
+
     enum { INITIAL_SIZE = 512, SEGMENT_SIZE = 4096 };
 
     // Slow path handling of allocation.
     byte* allocateSlow(size_t size, size_t alignment);
 
+    // Allocation while in multithreaded mode.
+    byte* allocateForThread(size_t size, size_t alignment);
+
     static byte* alignPtr(byte* ptr, size_t alignment) {
         return reinterpret_cast<byte*>((reinterpret_cast<uintptr_t>(ptr) + alignment - 1) &
                                        ~(alignment - 1));
@@ -21,6 +21,32 @@ class text_style;
 
 namespace slang {
 
+/// A read-only view of a file that has been memory mapped into the address
+/// space of the process. The mapping is released when the object is destroyed.
+class SLANG_EXPORT MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    /// Gets the contents of the mapped file. The returned view includes
+    /// the null terminator that follows the file's actual contents.
+    std::string_view text() const { return {data, size}; }
+
+    /// Returns true if the object holds a valid mapping and false otherwise.
+    bool valid() const { return data != nullptr; }
+
+private:
+    friend class OS;
+    void release() noexcept;
+
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
 /// A collection of various OS-specific utility functions.
 class SLANG_EXPORT OS {
 public:
@@ -44,6 +70,16 @@ public:
     /// Note that the buffer will be null-terminated.
     static bool readFile(const std::filesystem::path& path, std::vector<char>& buffer);
 
+    /// Memory maps the file at @a path for reading. If successful, the mapping is
+    /// placed into @a result -- otherwise, returns false, and the caller should
+    /// fall back to @a readFile instead.
+    ///
+    /// Mapping fails for files that are not regular files (such as pipes) or that
+    /// are smaller than @a minSize bytes. It also fails if the size of the file is
+    /// an exact multiple of the page size, since in that case there is no room in
+    /// the final page for a null terminator.
+    static bool mapFile(const std::filesystem::path& path, size_t minSize, MappedFile& result);
+
     /// Prints text to stdout.
     static void print(std::string_view text);
 
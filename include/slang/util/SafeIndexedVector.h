@@ -8,7 +8,6 @@
 #pragma once
 
 #include <deque>
-#include <vector>
 
 namespace slang {
 
@@ -19,9 +18,8 @@ namespace slang {
 /// Indices are never invalidated until they are removed from the index, at
 /// which point they are placed on a freelist and potentially reused.
 ///
-/// The index uses a vector internally for managing storage and therefore
-/// has the same performance characteristics when adding new elements and
-/// there are no open slots in the freelist.
+/// The index uses a deque internally for managing storage, so references to
+/// elements are not invalidated when new elements are added.
 ///
 /// Note that index zero is always reserved as an invalid sentinel value.
 /// The Index type must be explicitly convertible to and from size_t.
@@ -100,7 +98,7 @@ public:
     T& operator[](Index index) { return storage[static_cast<size_t>(index)]; }
 
 private:
-    std::vector<T> storage;
+    std::deque<T> storage;
     std::deque<Index> freelist;
 };
 
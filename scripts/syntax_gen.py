@@ -558,6 +558,98 @@ size_t SyntaxNode::getChildCount() const {
         cppf.write("    return *alloc.emplace<{}>({});\n".format(k, argNames))
         cppf.write("}\n\n")
 
+    # Write out the generic createNode method, which builds a node of any
+    # kind from a list of children given in getChild() order.
+    outf.write("\n")
+    outf.write(
+        "    /// Creates a node of the given @a kind from its @a children, which must be\n"
+    )
+    outf.write(
+        "    /// provided in the same order that SyntaxNode::getChild would return them.\n"
+    )
+    outf.write(
+        "    /// List members are provided as list nodes (of any list kind) and are copied.\n"
+    )
+    outf.write(
+        "    /// @returns the new node, or nullptr if the children don't match the kind.\n"
+    )
+    outf.write(
+        "    SyntaxNode* createNode(SyntaxKind kind, std::span<const TokenOrSyntax> children);\n"
+    )
+
+    typeKinds = {}
+    for kind, typeName in kindmap.items():
+        typeKinds.setdefault(typeName, []).append(kind)
+
+    cppf.write(
+        """static void resetList(SyntaxNode& owner, SyntaxListBase& list, SyntaxNode& source,
+                      BumpAllocator& alloc) {
+    auto& sourceList = source.as<SyntaxListBase>();
+    SmallVector<TokenOrSyntax> buffer(sourceList.getChildCount(), UninitializedTag());
+    for (size_t i = 0; i < sourceList.getChildCount(); i++)
+        buffer.push_back(sourceList.getChild(i));
+
+    list.resetAll(alloc, buffer);
+    for (auto& child : buffer) {
+        if (child.isNode())
+            child.node()->parent = &owner;
+    }
+}
+
+SyntaxNode* SyntaxFactory::createNode(SyntaxKind kind, std::span<const TokenOrSyntax> children) {
+    auto token = [&](size_t index) {
+        return children[index].isToken() ? children[index].token() : Token();
+    };
+    auto node = [&](size_t index) {
+        return children[index].isNode() ? children[index].node() : nullptr;
+    };
+
+    switch (kind) {
+"""
+    )
+    for k, v in sorted(alltypes.items()):
+        if not v.final:
+            continue
+
+        for kind in sorted(typeKinds[k]):
+            cppf.write("        case SyntaxKind::{}:\n".format(kind))
+        cppf.write("        {\n")
+
+        checks = ["children.size() != {}".format(len(v.combinedMembers))]
+        args = ["kind"] if "kind" in v.argNames else []
+        lists = []
+        for i, m in enumerate(v.combinedMembers):
+            if m[0] == "Token":
+                args.append("token({})".format(i))
+            elif m[1] in v.pointerMembers:
+                checks.append("!node({})".format(i))
+                args.append("nullptr")
+                lists.append((i, m[1]))
+            elif m[1] in v.optionalMembers:
+                args.append(
+                    "node({0}) ? &node({0})->as<{1}>() : nullptr".format(i, m[2])
+                )
+            else:
+                checks.append("!node({})".format(i))
+                args.append("node({})->as<{}>()".format(i, m[2]))
+
+        cppf.write("            if ({})\n".format(" || ".join(checks)))
+        cppf.write("                return nullptr;\n\n")
+        cppf.write(
+            "            auto result = alloc.emplace<{}>({});\n".format(k, ", ".join(args))
+        )
+        for i, name in lists:
+            cppf.write(
+                "            resetList(*result, result->{}, *node({}), alloc);\n".format(name, i)
+            )
+        cppf.write("            return result;\n")
+        cppf.write("        }\n")
+
+    cppf.write("        default:\n")
+    cppf.write("            return nullptr;\n")
+    cppf.write("    }\n")
+    cppf.write("}\n\n")
+
     # Write out toString methods for SyntaxKind enum.
     cppf.write(
         """
@@ -597,10 +689,12 @@ std::string_view toString(SyntaxKind kind) {
     )
     for k, _ in sorted(kindmap.items()):
         cppf.write("    SyntaxKind::{},\n".format(k))
-    cppf.write(
-        """};
+    cppf.write("};\n\n")
+
+    writeReachableKinds(cppf, alltypes, kindmap, reverseKindmap)
 
-#ifdef SLANG_RTTI_ENABLED
+    cppf.write(
+        """#ifdef SLANG_RTTI_ENABLED
 const std::type_info* typeFromSyntaxKind(SyntaxKind kind) {
     switch (kind) {
         case SyntaxKind::Unknown: break;
@@ -738,6 +832,11 @@ public:
 
 SLANG_EXPORT const std::type_info* typeFromSyntaxKind(SyntaxKind kind);
 
+/// @return true if a syntax node of kind @a parent can have a node of kind
+/// @a descendant anywhere beneath it in a syntax tree, as determined by the
+/// declared types of each syntax node's members.
+SLANG_EXPORT bool canContainKind(SyntaxKind parent, SyntaxKind descendant);
+
 }}
 """.format(
             len(kindmap.items()) + 4
@@ -771,6 +870,93 @@ class SyntaxNode;
     outf.write("\n}\n")
 
 
+def writeReachableKinds(cppf, alltypes, kindmap, reverseKindmap):
+    # Syntax kinds are numbered in the same order as the SyntaxKind enum.
+    listKinds = ["Unknown", "SyntaxList", "TokenList", "SeparatedList"]
+    allkinds = listKinds + [k for k, _ in sorted(kindmap.items())]
+    ordinals = {k: i for i, k in enumerate(allkinds)}
+
+    # Figure out which kinds can be direct children of each kind of node,
+    # based on the declared types of its members.
+    def kindsOfType(typename):
+        if typename == "SyntaxNode":
+            return set(allkinds[1:])
+        return set(reverseKindmap.get(typename, []))
+
+    children = {}
+    for k, v in kindmap.items():
+        direct = set()
+        for m in alltypes[v].combinedMembers:
+            typename = m[2]
+            if typename == "Token":
+                continue
+            elif typename == "TokenList":
+                direct.add("TokenList")
+            elif typename.startswith("SyntaxList<"):
+                direct.add("SyntaxList")
+                direct |= kindsOfType(typename[11:-1])
+            elif typename.startswith("SeparatedSyntaxList<"):
+                direct.add("SeparatedList")
+                direct |= kindsOfType(typename[20:-1])
+            else:
+                direct |= kindsOfType(typename)
+        children[k] = direct
+
+    # Take the transitive closure to find every kind that can appear anywhere
+    # beneath each kind of node.
+    reachable = {}
+    for k in kindmap:
+        seen = set()
+        stack = [k]
+        while stack:
+            for c in children.get(stack.pop(), ()):
+                if c not in seen:
+                    seen.add(c)
+                    stack.append(c)
+        reachable[k] = seen
+
+    words = (len(allkinds) + 63) // 64
+    cppf.write(
+        "static constexpr uint64_t ReachableKinds[{}][{}] = {{\n".format(
+            len(kindmap), words
+        )
+    )
+    for k, _ in sorted(kindmap.items()):
+        bits = [0] * words
+        for c in reachable[k]:
+            bits[ordinals[c] // 64] |= 1 << (ordinals[c] % 64)
+        cppf.write(
+            "    {{{}}}, // {}\n".format(
+                ", ".join("0x{:x}".format(b) for b in bits), k
+            )
+        )
+    cppf.write(
+        """}};
+
+bool canContainKind(SyntaxKind parent, SyntaxKind descendant) {{
+    switch (parent) {{
+        case SyntaxKind::Unknown:
+        case SyntaxKind::TokenList:
+            return false;
+        case SyntaxKind::SyntaxList:
+        case SyntaxKind::SeparatedList:
+            // Lists don't know the type of their elements here.
+            return descendant != SyntaxKind::Unknown;
+        default:
+            break;
+    }}
+
+    auto row = size_t(parent) - {};
+    auto col = size_t(descendant);
+    return (ReachableKinds[row][col / 64] >> (col % 64)) & 1;
+}}
+
+""".format(
+            len(listKinds)
+        )
+    )
+
+
 def generateSyntaxClone(builddir, alltypes, kindmap):
     # Start the clone source file.
     clonef = open(os.path.join(builddir, "SyntaxClone.cpp"), "w")
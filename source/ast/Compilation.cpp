@@ -22,8 +22,10 @@
 #include "slang/parsing/Parser.h"
 #include "slang/parsing/Preprocessor.h"
 #include "slang/syntax/SyntaxTree.h"
+#include "slang/syntax/SyntaxVisitor.h"
 #include "slang/text/CharInfo.h"
 #include "slang/text/SourceManager.h"
+#include "slang/util/ThreadPool.h"
 #include "slang/util/TimeTrace.h"
 
 using namespace slang::parsing;
@@ -47,6 +49,35 @@ const PackageSymbol& createStdPackage(Compilation&);
 
 namespace slang::ast {
 
+namespace {
+
+// State kept separately for each top-level instance while they are being elaborated
+// in parallel. Diagnostics are collected here and merged into the compilation
+// afterwards, in the same order as they would have been issued serially.
+struct ElabWorker {
+    const Compilation* compilation = nullptr;
+    uint32_t id = 0;
+    size_t numErrors = 0;
+    uint32_t typoCorrections = 0;
+    std::vector<int*> enumSystemIds;
+    std::vector<int*> structSystemIds;
+    std::vector<int*> unionSystemIds;
+    std::deque<Diagnostic> diags;
+    Diagnostic tempDiag{{}, {}};
+    flat_hash_set<std::tuple<DiagCode, SourceLocation>> errorKeys;
+    std::vector<const Symbol*> hierarchicalReferences;
+};
+
+thread_local ElabWorker* currentElabWorker = nullptr;
+
+ElabWorker* getElabWorker(const Compilation& compilation) {
+    if (currentElabWorker && currentElabWorker->compilation == &compilation)
+        return currentElabWorker;
+    return nullptr;
+}
+
+} // namespace
+
 Compilation::Compilation(const Bag& options) :
     options(options.getOrDefault<CompilationOptions>()), driverMapAllocator(*this),
     unrollIntervalMapAllocator(*this), tempDiag({}, {}) {
@@ -233,6 +264,9 @@ void Compilation::addSyntaxTree(std::shared_ptr<SyntaxTree> tree) {
     for (auto& name : tree->getMetadata().globalInstances)
         globalInstantiations.emplace(name);
 
+    for (auto& [decl, _] : tree->getMetadata().deferredBodies)
+        deferredBodies.emplace(decl, std::pair{tree.get(), nullptr});
+
     if (node.kind == SyntaxKind::CompilationUnit) {
         for (auto member : node.as<CompilationUnitSyntax>().members)
             unit->addMembers(*member);
@@ -245,6 +279,37 @@ void Compilation::addSyntaxTree(std::shared_ptr<SyntaxTree> tree) {
     cachedParseDiagnostics.reset();
 }
 
+void Compilation::addPrecompiledPackage(std::shared_ptr<SyntaxTree> tree,
+                                        const Diagnostics& diagnostics) {
+    SmallVector<const SyntaxNode*> packages;
+    for (auto& [node, _] : tree->getMetadata().nodeMap) {
+        if (node->kind == SyntaxKind::PackageDeclaration)
+            packages.push_back(node);
+    }
+
+    addSyntaxTree(std::move(tree));
+    if (packages.empty())
+        return;
+
+    // Attribute each diagnostic to the package that contains it, so that
+    // elaboration skips checking those packages and reports these instead.
+    for (auto package : packages)
+        reusedOwners.insert(package);
+
+    for (auto& diag : diagnostics) {
+        auto owner = packages[0];
+        for (auto package : packages) {
+            auto range = package->sourceRange();
+            if (diag.location.buffer() == range.start().buffer() &&
+                diag.location >= range.start() && diag.location < range.end()) {
+                owner = package;
+                break;
+            }
+        }
+        carriedDiagnostics.emplace_back(owner, diag);
+    }
+}
+
 std::span<const std::shared_ptr<SyntaxTree>> Compilation::getSyntaxTrees() const {
     return syntaxTrees;
 }
@@ -427,6 +492,8 @@ const CompilationUnitSymbol* Compilation::getCompilationUnit(
 
 const Definition* Compilation::getDefinition(std::string_view lookupName,
                                              const Scope& scope) const {
+    auto lock = lockSharedState();
+
     // First try to do a quick lookup in the top definitions map (most definitions are global).
     // If the flag is set it means we have to do a full scope lookup instead.
     if (auto it = topDefinitions.find(lookupName); it != topDefinitions.end()) {
@@ -448,6 +515,7 @@ const Definition* Compilation::getDefinition(std::string_view lookupName,
 }
 
 const Definition* Compilation::getDefinition(const ModuleDeclarationSyntax& syntax) const {
+    auto lock = lockSharedState();
     if (auto it = definitionFromSyntax.find(&syntax); it != definitionFromSyntax.end()) {
         // If this definition is no longer referenced by the definitionsMap
         // it probably got booted by an (illegal) duplicate definition.
@@ -521,6 +589,8 @@ static void checkExternUdpMatch(const Scope& scope, const UdpPortListSyntax& ext
 
 void Compilation::createDefinition(const Scope& scope, LookupLocation location,
                                    const ModuleDeclarationSyntax& syntax) {
+    auto lock = lockSharedState();
+
     // We can only be missing metadata if the definition is created programmatically
     // (i.e. not via the parser) so we just fill in the parent's default net type
     // so that it's not a null pointer.
@@ -676,21 +746,25 @@ const SystemSubroutine* Compilation::getSystemMethod(SymbolKind typeKind,
 
 void Compilation::setAttributes(const Symbol& symbol,
                                 std::span<const AttributeSymbol* const> attributes) {
+    auto lock = lockSharedState();
     attributeMap[&symbol] = attributes;
 }
 
 void Compilation::setAttributes(const Statement& stmt,
                                 std::span<const AttributeSymbol* const> attributes) {
+    auto lock = lockSharedState();
     attributeMap[&stmt] = attributes;
 }
 
 void Compilation::setAttributes(const Expression& expr,
                                 std::span<const AttributeSymbol* const> attributes) {
+    auto lock = lockSharedState();
     attributeMap[&expr] = attributes;
 }
 
 void Compilation::setAttributes(const PortConnection& conn,
                                 std::span<const AttributeSymbol* const> attributes) {
+    auto lock = lockSharedState();
     attributeMap[&conn] = attributes;
 }
 
@@ -712,6 +786,7 @@ std::span<const AttributeSymbol* const> Compilation::getAttributes(
 }
 
 std::span<const AttributeSymbol* const> Compilation::getAttributes(const void* ptr) const {
+    auto lock = lockSharedState();
     auto it = attributeMap.find(ptr);
     if (it == attributeMap.end())
         return {};
@@ -721,11 +796,13 @@ std::span<const AttributeSymbol* const> Compilation::getAttributes(const void* p
 
 void Compilation::notePackageExportCandidate(const PackageSymbol& packageScope,
                                              const Symbol& symbol) {
+    auto lock = lockSharedState();
     packageExportCandidateMap[&packageScope][symbol.name] = &symbol;
 }
 
 const Symbol* Compilation::findPackageExportCandidate(const PackageSymbol& packageScope,
                                                       std::string_view name) const {
+    auto lock = lockSharedState();
     if (auto it = packageExportCandidateMap.find(&packageScope);
         it != packageExportCandidateMap.end()) {
         if (auto symIt = it->second.find(name); symIt != it->second.end())
@@ -735,15 +812,18 @@ const Symbol* Compilation::findPackageExportCandidate(const PackageSymbol& packa
 }
 
 void Compilation::noteBindDirective(const BindDirectiveSyntax& syntax, const Scope& scope) {
+    auto lock = lockSharedState();
     bindDirectives.emplace_back(&syntax, &scope);
 }
 
 void Compilation::noteInstanceWithDefBind(const Symbol& instance) {
     auto& def = instance.as<InstanceBodySymbol>().getDefinition();
+    auto lock = lockSharedState();
     instancesWithDefBinds[&def].push_back(&instance);
 }
 
 void Compilation::noteDPIExportDirective(const DPIExportSyntax& syntax, const Scope& scope) {
+    auto lock = lockSharedState();
     dpiExports.emplace_back(&syntax, &scope);
 }
 
@@ -751,6 +831,7 @@ void Compilation::addOutOfBlockDecl(const Scope& scope, const ScopedNameSyntax&
                                     const SyntaxNode& syntax, SymbolIndex index) {
     std::string_view className = name.left->getLastToken().valueText();
     std::string_view declName = name.right->getLastToken().valueText();
+    auto lock = lockSharedState();
     auto [it, inserted] = outOfBlockDecls.emplace(std::make_tuple(className, declName, &scope),
                                                   std::make_tuple(&syntax, &name, index, false));
 
@@ -767,6 +848,7 @@ void Compilation::addOutOfBlockDecl(const Scope& scope, const ScopedNameSyntax&
 std::tuple<const SyntaxNode*, SymbolIndex, bool*> Compilation::findOutOfBlockDecl(
     const Scope& scope, std::string_view className, std::string_view declName) const {
 
+    auto lock = lockSharedState();
     auto it = outOfBlockDecls.find({className, declName, &scope});
     if (it != outOfBlockDecls.end()) {
         auto& [syntax, name, index, used] = it->second;
@@ -777,11 +859,61 @@ std::tuple<const SyntaxNode*, SymbolIndex, bool*> Compilation::findOutOfBlockDec
 }
 
 void Compilation::addExternInterfaceMethod(const SubroutineSymbol& method) {
+    auto lock = lockSharedState();
     externInterfaceMethods.push_back(&method);
 }
 
+const SyntaxList<SyntaxNode>& Compilation::getSubroutineItems(
+    const FunctionDeclarationSyntax& syntax, const Scope& scope) {
+    auto lock = lockSharedState();
+    auto it = deferredBodies.find(&syntax);
+    if (it == deferredBodies.end())
+        return syntax.items;
+
+    auto& [tree, items] = it->second;
+    if (!items && tree->isLibrary) {
+        // Library definitions that are never instantiated only get elaborated
+        // to check their declarations, so don't pay to parse their bodies.
+        for (auto curr = &scope; curr; curr = curr->asSymbol().getParentScope()) {
+            auto& sym = curr->asSymbol();
+            if (sym.kind == SymbolKind::InstanceBody) {
+                if (sym.as<InstanceBodySymbol>().isUninstantiated) {
+                    static const SyntaxList<SyntaxNode> emptyItems(std::span<SyntaxNode*>{});
+                    return emptyItems;
+                }
+                break;
+            }
+        }
+    }
+
+    if (!items) {
+        // The body tokens have already been preprocessed, so the preprocessor
+        // here only serves as an (empty) source of tokens for the parser.
+        Diagnostics parseDiags;
+        Preprocessor preprocessor(tree->sourceManager(), *this, parseDiags, tree->options());
+        parseDiags.clear();
+
+        Parser parser(preprocessor, tree->options());
+        auto body = parser.parseDeferredBody(syntax,
+                                             tree->getMetadata().deferredBodies.at(&syntax));
+
+        auto list = emplace<SyntaxList<SyntaxNode>>(body);
+        auto parent = const_cast<FunctionDeclarationSyntax*>(&syntax);
+        list->parent = parent;
+        for (auto child : *list)
+            child->parent = parent;
+
+        for (auto& diag : parseDiags)
+            addDiag(diag);
+
+        items = list;
+    }
+    return *items;
+}
+
 void Compilation::noteDefaultClocking(const Scope& scope, const Symbol& clocking,
                                       SourceRange range) {
+    auto lock = lockSharedState();
     auto [it, inserted] = defaultClockingMap.emplace(&scope, &clocking);
     if (!inserted) {
         auto& diag = scope.addDiag(diag::MultipleDefaultClocking, range);
@@ -808,6 +940,7 @@ void Compilation::noteDefaultClocking(const ASTContext& context,
 }
 
 const Symbol* Compilation::getDefaultClocking(const Scope& scope) const {
+    auto lock = lockSharedState();
     auto curr = &scope;
     while (true) {
         if (auto it = defaultClockingMap.find(curr); it != defaultClockingMap.end())
@@ -821,6 +954,7 @@ const Symbol* Compilation::getDefaultClocking(const Scope& scope) const {
 
 void Compilation::noteGlobalClocking(const Scope& scope, const Symbol& clocking,
                                      SourceRange range) {
+    auto lock = lockSharedState();
     auto [it, inserted] = globalClockingMap.emplace(&scope, &clocking);
     if (!inserted) {
         auto& diag = scope.addDiag(diag::MultipleGlobalClocking, range);
@@ -829,6 +963,7 @@ void Compilation::noteGlobalClocking(const Scope& scope, const Symbol& clocking,
 }
 
 const Symbol* Compilation::getGlobalClocking(const Scope& scope) const {
+    auto lock = lockSharedState();
     auto curr = &scope;
     do {
         if (auto it = globalClockingMap.find(curr); it != globalClockingMap.end())
@@ -841,6 +976,7 @@ const Symbol* Compilation::getGlobalClocking(const Scope& scope) const {
 }
 
 void Compilation::noteDefaultDisable(const Scope& scope, const Expression& expr) {
+    auto lock = lockSharedState();
     auto [it, inserted] = defaultDisableMap.emplace(&scope, &expr);
     if (!inserted) {
         auto& diag = scope.addDiag(diag::MultipleDefaultDisable, expr.sourceRange);
@@ -849,10 +985,60 @@ void Compilation::noteDefaultDisable(const Scope& scope, const Expression& expr)
 }
 
 void Compilation::noteNameConflict(const Symbol& symbol) {
+    auto lock = lockSharedState();
     nameConflicts.push_back(&symbol);
 }
 
+// Finds the declaration that the given symbol belongs to for the purposes of
+// tracking dependencies: the definition of the instance body it's in, the package
+// it's in, or failing those the compilation unit it's in.
+static const SyntaxNode* getDependencyOwner(const Symbol& symbol) {
+    auto sym = &symbol;
+    while (true) {
+        switch (sym->kind) {
+            case SymbolKind::Instance:
+                return &sym->as<InstanceSymbol>().getDefinition().syntax;
+            case SymbolKind::InstanceBody:
+                return &sym->as<InstanceBodySymbol>().getDefinition().syntax;
+            case SymbolKind::Package:
+            case SymbolKind::CompilationUnit:
+                return sym->getSyntax();
+            default:
+                break;
+        }
+
+        auto scope = sym->getParentScope();
+        if (!scope)
+            return nullptr;
+        sym = &scope->asSymbol();
+    }
+}
+
+static std::string_view getDeclarationName(const SyntaxNode& owner) {
+    if (ModuleDeclarationSyntax::isKind(owner.kind))
+        return owner.as<ModuleDeclarationSyntax>().header->name.valueText();
+    return {};
+}
+
+void Compilation::noteDependency(const Scope& scope, std::string_view name,
+                                 bool viaInstantiation) {
+    auto owner = getDependencyOwner(scope.asSymbol());
+    if (!owner || name.empty())
+        return;
+
+    auto lock = lockSharedState();
+    auto [it, inserted] = dependents[name].emplace(owner, viaInstantiation);
+    if (!inserted)
+        it->second &= viaInstantiation;
+}
+
+void Compilation::noteDependency(const Scope& scope, const Symbol& target) {
+    if (auto owner = getDependencyOwner(target))
+        noteDependency(scope, getDeclarationName(*owner));
+}
+
 const Expression* Compilation::getDefaultDisable(const Scope& scope) const {
+    auto lock = lockSharedState();
     auto curr = &scope;
     while (true) {
         if (auto it = defaultDisableMap.find(curr); it != defaultDisableMap.end())
@@ -870,6 +1056,7 @@ void Compilation::noteExternModule(const Scope& scope, const ExternModuleDeclSyn
         return;
 
     auto targetScope = scope.asSymbol().kind == SymbolKind::CompilationUnit ? root.get() : &scope;
+    auto lock = lockSharedState();
     auto [it, inserted] = externModuleMap.emplace(std::tuple(name, targetScope), &syntax);
     if (!inserted) {
         checkExternModMatch(scope, *syntax.header, *it->second->header,
@@ -887,6 +1074,7 @@ void Compilation::noteExternModule(const Scope& scope, const ExternModuleDeclSyn
 
 const ExternModuleDeclSyntax* Compilation::getExternModule(std::string_view name,
                                                            const Scope& scope) const {
+    auto lock = lockSharedState();
     const Scope* searchScope = &scope;
     do {
         auto it = externModuleMap.find(std::make_tuple(name, searchScope));
@@ -918,6 +1106,7 @@ void Compilation::noteExternPrimitive(const Scope& scope, const ExternUdpDeclSyn
         return;
 
     auto targetScope = scope.asSymbol().kind == SymbolKind::CompilationUnit ? root.get() : &scope;
+    auto lock = lockSharedState();
     auto [it, inserted] = externUdpMap.emplace(std::tuple(name, targetScope), &syntax);
     if (!inserted) {
         checkExternUdpMatch(scope, *syntax.portList, *it->second->portList, name,
@@ -935,6 +1124,7 @@ void Compilation::noteExternPrimitive(const Scope& scope, const ExternUdpDeclSyn
 
 const ExternUdpDeclSyntax* Compilation::getExternPrimitive(std::string_view name,
                                                            const Scope& scope) const {
+    auto lock = lockSharedState();
     const Scope* searchScope = &scope;
     do {
         auto it = externUdpMap.find(std::make_tuple(name, searchScope));
@@ -961,6 +1151,7 @@ bool Compilation::errorIfMissingExternPrimitive(std::string_view name, const Sco
 }
 
 void Compilation::noteReference(const SyntaxNode& node, bool isLValue) {
+    auto lock = lockSharedState();
     auto [it, inserted] = referenceStatusMap.emplace(&node, std::pair{!isLValue, isLValue});
     if (!inserted) {
         it->second.first |= !isLValue;
@@ -974,6 +1165,7 @@ void Compilation::noteReference(const Symbol& symbol, bool isLValue) {
 }
 
 std::pair<bool, bool> Compilation::isReferenced(const SyntaxNode& node) const {
+    auto lock = lockSharedState();
     auto it = referenceStatusMap.find(&node);
     if (it == referenceStatusMap.end())
         return {false, false};
@@ -981,6 +1173,60 @@ std::pair<bool, bool> Compilation::isReferenced(const SyntaxNode& node) const {
     return it->second;
 }
 
+void Compilation::noteHierarchicalReference(const Symbol& target) {
+    if (auto worker = getElabWorker(*this))
+        worker->hierarchicalReferences.push_back(&target);
+    else
+        hierarchicalReferences.push_back(&target);
+}
+
+std::span<const Symbol* const> Compilation::getHierarchicalReferences() const {
+    if (auto worker = getElabWorker(*this))
+        return worker->hierarchicalReferences;
+    return hierarchicalReferences;
+}
+
+// Types created while elaborating in parallel are given provisional IDs that
+// are only unique within their worker; they get renumbered once all of the
+// workers are done so that they come out the same as in a serial run.
+void Compilation::assignEnumSystemId(int& id) {
+    if (auto worker = getElabWorker(*this)) {
+        id = nextEnumSystemId + int(worker->enumSystemIds.size());
+        worker->enumSystemIds.push_back(&id);
+        return;
+    }
+    id = nextEnumSystemId++;
+}
+
+void Compilation::assignStructSystemId(int& id) {
+    if (auto worker = getElabWorker(*this)) {
+        id = nextStructSystemId + int(worker->structSystemIds.size());
+        worker->structSystemIds.push_back(&id);
+        return;
+    }
+    id = nextStructSystemId++;
+}
+
+void Compilation::assignUnionSystemId(int& id) {
+    if (auto worker = getElabWorker(*this)) {
+        id = nextUnionSystemId + int(worker->unionSystemIds.size());
+        worker->unionSystemIds.push_back(&id);
+        return;
+    }
+    id = nextUnionSystemId++;
+}
+
+std::unique_lock<std::recursive_mutex> Compilation::lockSharedState() const {
+    if (!elaboratingInParallel)
+        return {};
+    return std::unique_lock(sharedStateMutex);
+}
+
+uint32_t Compilation::getParallelElabId() const {
+    auto worker = getElabWorker(*this);
+    return worker ? worker->id : 0;
+}
+
 const NameSyntax& Compilation::parseName(std::string_view name) {
     Diagnostics localDiags;
     auto& result = tryParseName(name, localDiags);
@@ -995,6 +1241,7 @@ const NameSyntax& Compilation::parseName(std::string_view name) {
 }
 
 const NameSyntax& Compilation::tryParseName(std::string_view name, Diagnostics& localDiags) {
+    auto lock = lockSharedState();
     SourceManager& sourceMan = SyntaxTree::getDefaultSourceManager();
     Preprocessor preprocessor(sourceMan, *this, localDiags);
     preprocessor.pushSource(name);
@@ -1022,6 +1269,148 @@ const Diagnostics& Compilation::getParseDiagnostics() {
     return *cachedParseDiagnostics;
 }
 
+bool Compilation::canElaborateInParallel() {
+    // Defparams and binds reach into the hierarchy from anywhere,
+    // so elaborating any one instance can affect the others.
+    for (auto& tree : syntaxTrees) {
+        auto& meta = tree->getMetadata();
+        if (meta.hasDefparams || meta.hasBindDirectives)
+            return false;
+    }
+
+    flat_hash_set<std::string_view> topNames;
+    for (auto inst : getRoot().topInstances)
+        topNames.emplace(inst->name);
+
+    // Otherwise look for hierarchical names that start at a top-level instance, or at
+    // $root, which are the only ways for one top-level instance to refer to another.
+    struct Visitor : public SyntaxVisitor<Visitor> {
+        const flat_hash_set<std::string_view>& topNames;
+        bool found = false;
+
+        explicit Visitor(const flat_hash_set<std::string_view>& topNames) : topNames(topNames) {}
+
+        void handle(const ScopedNameSyntax& syntax) {
+            if (found)
+                return;
+
+            if (syntax.separator.kind == TokenKind::Dot) {
+                const NameSyntax* left = &syntax;
+                while (left->kind == SyntaxKind::ScopedName)
+                    left = left->as<ScopedNameSyntax>().left;
+
+                if (left->kind == SyntaxKind::RootScope) {
+                    found = true;
+                    return;
+                }
+
+                Token name;
+                if (left->kind == SyntaxKind::IdentifierName)
+                    name = left->as<IdentifierNameSyntax>().identifier;
+                else if (left->kind == SyntaxKind::IdentifierSelectName)
+                    name = left->as<IdentifierSelectNameSyntax>().identifier;
+
+                if (name && topNames.contains(name.valueText())) {
+                    found = true;
+                    return;
+                }
+            }
+            visitDefault(syntax);
+        }
+    };
+
+    Visitor visitor(topNames);
+    for (auto& tree : syntaxTrees) {
+        tree->root().visit(visitor);
+        if (visitor.found)
+            return false;
+
+        // Subroutine bodies that haven't been parsed yet only have their tokens to go on.
+        for (auto& [_, tokens] : tree->getMetadata().deferredBodies) {
+            for (size_t i = 0; i < tokens.size(); i++) {
+                if (tokens[i].kind == TokenKind::RootSystemName)
+                    return false;
+
+                if (tokens[i].kind == TokenKind::Identifier && i + 1 < tokens.size() &&
+                    tokens[i + 1].kind == TokenKind::Dot &&
+                    topNames.contains(tokens[i].valueText())) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void Compilation::elaborateInParallel(DiagnosticVisitor& visitor, uint32_t errorLimit) {
+    auto& tops = getRoot().topInstances;
+    std::vector<ElabWorker> workers(tops.size());
+    std::deque<DiagnosticVisitor> visitors;
+    for (size_t i = 0; i < tops.size(); i++) {
+        auto& worker = workers[i];
+        worker.compilation = this;
+        worker.id = uint32_t(i + 1);
+        worker.numErrors = numErrors;
+        worker.typoCorrections = typoCorrections;
+        visitors.emplace_back(*this, worker.numErrors, errorLimit, visitor.cacheInstances);
+    }
+
+    // Everything allocated from here on must be safe to do from several threads.
+    auto setMultiThreaded = [this](bool enabled) {
+        elaboratingInParallel = enabled;
+        BumpAllocator::setMultiThreaded(enabled);
+        symbolMapAllocator.setMultiThreaded(enabled);
+        pointerMapAllocator.setMultiThreaded(enabled);
+        constantAllocator.setMultiThreaded(enabled);
+        genericClassAllocator.setMultiThreaded(enabled);
+        assertionDetailsAllocator.setMultiThreaded(enabled);
+    };
+
+    std::vector<std::future<void>> results;
+    setMultiThreaded(true);
+    {
+        auto numThreads = std::min(options.numThreads, uint32_t(tops.size()));
+        ThreadPool threadPool(numThreads);
+        for (size_t i = 0; i < tops.size(); i++) {
+            results.emplace_back(threadPool.submit([&, i] {
+                currentElabWorker = &workers[i];
+                auto guard = ScopeGuard([] { currentElabWorker = nullptr; });
+                tops[i]->visit(visitors[i]);
+                visitors[i].finalize();
+            }));
+        }
+        threadPool.waitForAll();
+    }
+    setMultiThreaded(false);
+
+    for (auto& result : results)
+        result.get();
+
+    // Add everything found in the same order as if the instances
+    // had been elaborated one after the other.
+    auto renumber = [](int& nextId, const std::vector<int*>& ids) {
+        for (auto id : ids)
+            *id = nextId++;
+    };
+
+    uint32_t prevTypoCorrections = typoCorrections;
+    for (size_t i = 0; i < tops.size(); i++) {
+        auto& worker = workers[i];
+        for (auto& diag : worker.diags)
+            addDiag(std::move(diag));
+
+        hierarchicalReferences.insert(hierarchicalReferences.end(),
+                                      worker.hierarchicalReferences.begin(),
+                                      worker.hierarchicalReferences.end());
+        typoCorrections += worker.typoCorrections - prevTypoCorrections;
+        renumber(nextEnumSystemId, worker.enumSystemIds);
+        renumber(nextStructSystemId, worker.structSystemIds);
+        renumber(nextUnionSystemId, worker.unionSystemIds);
+
+        visitor.merge(visitors[i]);
+    }
+}
+
 const Diagnostics& Compilation::getSemanticDiagnostics() {
     if (cachedSemanticDiagnostics)
         return *cachedSemanticDiagnostics;
@@ -1029,10 +1418,46 @@ const Diagnostics& Compilation::getSemanticDiagnostics() {
     // If we haven't already done so, touch every symbol, scope, statement,
     // and expression tree so that we can be sure we have all the diagnostics.
     uint32_t errorLimit = options.errorLimit == 0 ? UINT32_MAX : options.errorLimit;
-    DiagnosticVisitor elabVisitor(*this, numErrors, errorLimit);
-    getRoot().visit(elabVisitor);
+    std::optional<ElabScopeWalker> scopeWalker;
+    if (!options.elabScopes.empty())
+        scopeWalker.emplace(options.elabScopes);
+
+    std::optional<ElabReuse> reuse;
+    if (!reusedOwners.empty())
+        reuse.emplace(reusedOwners, reusedPaths);
+
+    DiagnosticVisitor elabVisitor(*this, numErrors, errorLimit, !options.disableInstanceCaching);
+    elabVisitor.reuse = reuse ? &*reuse : nullptr;
+    if (scopeWalker) {
+        scopeWalker->walk(getRoot(), elabVisitor);
+    }
+    else if (options.numThreads != 1 && !reuse && getRoot().topInstances.size() > 1 &&
+             canElaborateInParallel()) {
+        // Everything that the top-level instances can share, like packages and
+        // compilation units, is elaborated up front so that the threads only
+        // ever need to look at it.
+        for (auto& member : getRoot().members()) {
+            if (member.kind != SymbolKind::Instance)
+                member.visit(elabVisitor);
+        }
+
+        for (auto [_, package] : packageMap) {
+            if (package->hasExportAll || !package->exportDecls.empty())
+                package->findForImport(""sv);
+        }
+        elabVisitor.visitGenericClasses();
+
+        if (numErrors <= errorLimit)
+            elaborateInParallel(elabVisitor, errorLimit);
+    }
+    else {
+        getRoot().visit(elabVisitor);
+    }
     elabVisitor.finalize();
 
+    if (scopeWalker)
+        scopeWalker->reportMissing(getRoot());
+
     // Note for the following checks here: anything that depends on a list
     // stored in the compilation object should think carefully about taking
     // a copy of that list first before iterating over it, because your check
@@ -1103,7 +1528,7 @@ const Diagnostics& Compilation::getSemanticDiagnostics() {
         }
     }
 
-    if (!options.scriptMode) {
+    if (!options.scriptMode && !scopeWalker) {
         // Top level instances cannot have interface or ref ports.
         for (auto inst : getRoot().topInstances) {
             for (auto port : inst->body.getPortList()) {
@@ -1138,8 +1563,12 @@ const Diagnostics& Compilation::getSemanticDiagnostics() {
         // Report on unused definitions.
         for (auto def : unreferencedDefs) {
             // If this is an interface, it may have been referenced in a port.
+            // When only some of the design's scopes are elaborated that port may
+            // never have been visited, so interfaces can't be reported reliably.
             if (elabVisitor.usedIfacePorts.find(def) != elabVisitor.usedIfacePorts.end())
                 continue;
+            if (!options.elabScopes.empty() && def->definitionKind == DefinitionKind::Interface)
+                continue;
 
             auto hasUnusedAttrib = [&] {
                 for (auto attr : def->attributes) {
@@ -1153,9 +1582,17 @@ const Diagnostics& Compilation::getSemanticDiagnostics() {
                 def->scope.addDiag(diag::UnusedDefinition, def->location) << def->getKindString();
         }
 
-        if (!elabVisitor.hierarchyProblem && numErrors == 0) {
+        bool anyCarriedErrors = std::ranges::any_of(carriedDiagnostics, [](auto& entry) {
+            return entry.second.isError();
+        });
+
+        if (!elabVisitor.hierarchyProblem && numErrors == 0 && !anyCarriedErrors) {
             PostElabVisitor postElabVisitor(*this);
-            getRoot().visit(postElabVisitor);
+            postElabVisitor.reuse = reuse ? &*reuse : nullptr;
+            if (scopeWalker)
+                scopeWalker->walk(getRoot(), postElabVisitor);
+            else
+                getRoot().visit(postElabVisitor);
         }
     }
 
@@ -1203,7 +1640,7 @@ const Diagnostics& Compilation::getSemanticDiagnostics() {
             auto parent = symbol->as<InstanceBodySymbol>().parentInstance;
             SLANG_ASSERT(parent);
 
-            count++;
+            count += elabVisitor.getShareWeight(&symbol->as<InstanceBodySymbol>());
             if (auto scope = parent->getParentScope()) {
                 auto& sym = scope->asSymbol();
                 if (sym.kind != SymbolKind::Root && sym.kind != SymbolKind::CompilationUnit) {
@@ -1234,10 +1671,31 @@ const Diagnostics& Compilation::getSemanticDiagnostics() {
         }
     }
 
+    // Remember which declaration each diagnostic came from so that recompile() can
+    // tell which ones to carry over. Anything found here for a declaration that was
+    // itself carried over can only repeat what was carried over with it.
+    Diagnostics merged;
+    for (auto& diag : results) {
+        auto owner = diag.symbol ? getDependencyOwner(*diag.symbol) : nullptr;
+        if (owner && reusedOwners.contains(owner))
+            continue;
+
+        ownedDiagnostics.emplace_back(owner, diag);
+        merged.emplace_back(std::move(diag));
+    }
+
+    for (auto& entry : carriedDiagnostics) {
+        ownedDiagnostics.emplace_back(entry);
+        merged.emplace_back(entry.second);
+    }
+
     if (sourceManager)
-        results.sort(*sourceManager);
+        merged.sort(*sourceManager);
+
+    fullyElaborated = !elabVisitor.hierarchyProblem && numErrors <= errorLimit &&
+                      options.elabScopes.empty();
 
-    cachedSemanticDiagnostics.emplace(std::move(results));
+    cachedSemanticDiagnostics.emplace(std::move(merged));
     return *cachedSemanticDiagnostics;
 }
 
@@ -1254,6 +1712,202 @@ const Diagnostics& Compilation::getAllDiagnostics() {
     return *cachedAllDiagnostics;
 }
 
+// Formats any type arguments of the given diagnostic (and its notes) into strings
+// and drops its symbol, so that it no longer refers to anything in the compilation
+// that produced it.
+static void detachDiagnostic(Diagnostic& diag, TypeArgFormatter& formatter) {
+    formatter.startMessage(diag);
+    for (auto& arg : diag.args) {
+        if (auto custom = std::get_if<Diagnostic::CustomArgType>(&arg);
+            custom && custom->first == SLANG_TYPEOF(const Type*)) {
+            arg = formatter.format(custom->second);
+        }
+    }
+
+    diag.symbol = nullptr;
+    for (auto& note : diag.notes)
+        detachDiagnostic(note, formatter);
+}
+
+std::optional<Diagnostics> Compilation::getPackageDiagnostics(const PackageSymbol& package) {
+    if (!fullyElaborated)
+        return std::nullopt;
+
+    Diagnostics results;
+    TypeArgFormatter formatter;
+    for (auto& [owner, diag] : ownedDiagnostics) {
+        if (owner && owner == package.getSyntax())
+            detachDiagnostic(results.emplace_back(diag), formatter);
+    }
+    return results;
+}
+
+std::unique_ptr<Compilation> Compilation::recompile(const SyntaxTree& oldTree,
+                                                    std::shared_ptr<SyntaxTree> newTree) {
+    auto oldIt = std::ranges::find_if(syntaxTrees,
+                                      [&](auto& tree) { return tree.get() == &oldTree; });
+    if (oldIt == syntaxTrees.end())
+        SLANG_THROW(std::invalid_argument("oldTree is not part of this compilation"));
+
+    auto result = std::make_unique<Compilation>(options);
+    for (auto& tree : syntaxTrees)
+        result->addSyntaxTree(tree.get() == &oldTree ? newTree : tree);
+
+    if (!fullyElaborated)
+        return result;
+
+    // Bind directives and defparams can reach into definitions anywhere in the
+    // design, which the dependency tracking below doesn't account for, so if any
+    // tree (including the one being replaced) has them just start from scratch.
+    auto hasRemoteEffects = [](const SyntaxTree& tree) {
+        auto& meta = tree.getMetadata();
+        return meta.hasBindDirectives || meta.hasDefparams;
+    };
+    if (hasRemoteEffects(oldTree))
+        return result;
+
+    for (auto& tree : result->syntaxTrees) {
+        if (hasRemoteEffects(*tree))
+            return result;
+    }
+
+    // Everything declared in either version of the tree is affected by the change,
+    // and so is everything that depends on their names. Unless the dependency is
+    // only through instantiation, those dependents' names count as changed as well.
+    // Anything a changed declaration instantiates might now get different parameters
+    // (or stop or start being a top-level module) so those are affected too, along
+    // with everything below them.
+    flat_hash_map<std::string_view, SmallVector<const SyntaxNode*>> ownersByName;
+    flat_hash_map<const SyntaxNode*, SmallVector<std::string_view>> instantiates;
+    for (auto& def : definitionMemory)
+        ownersByName[def->name].push_back(&def->syntax);
+    for (auto& [name, package] : packageMap)
+        ownersByName[name].push_back(package->getSyntax());
+    for (auto& [name, deps] : dependents) {
+        for (auto [owner, viaInstantiation] : deps) {
+            if (viaInstantiation)
+                instantiates[owner].push_back(name);
+        }
+    }
+
+    flat_hash_set<const SyntaxNode*> affected;
+    flat_hash_set<std::string_view> changedNames, changedBelow;
+    SmallVector<std::string_view> worklist, belowWorklist;
+    auto nameChangedBelow = [&](std::string_view name) {
+        if (!name.empty() && changedBelow.insert(name).second)
+            belowWorklist.push_back(name);
+    };
+    auto nameChanged = [&](std::string_view name) {
+        if (!name.empty() && changedNames.insert(name).second) {
+            worklist.push_back(name);
+            nameChangedBelow(name);
+        }
+    };
+
+    auto oldTop = &oldTree.root();
+    while (oldTop->parent)
+        oldTop = oldTop->parent;
+    affected.insert(oldTop);
+
+    const SyntaxTree* trees[] = {&oldTree, newTree.get()};
+    for (auto tree : trees) {
+        auto& meta = tree->getMetadata();
+        for (auto& [node, _] : meta.nodeMap)
+            nameChanged(getDeclarationName(*node));
+        for (auto name : meta.globalInstances)
+            nameChangedBelow(name);
+    }
+    for (auto& [node, _] : oldTree.getMetadata().nodeMap)
+        affected.insert(node);
+
+    while (!worklist.empty() || !belowWorklist.empty()) {
+        if (!worklist.empty()) {
+            auto name = worklist.back();
+            worklist.pop_back();
+
+            if (auto it = dependents.find(name); it != dependents.end()) {
+                for (auto [owner, viaInstantiation] : it->second) {
+                    affected.insert(owner);
+                    if (!viaInstantiation)
+                        nameChanged(getDeclarationName(*owner));
+                }
+            }
+        }
+        else {
+            auto name = belowWorklist.back();
+            belowWorklist.pop_back();
+
+            if (auto it = ownersByName.find(name); it != ownersByName.end()) {
+                for (auto owner : it->second) {
+                    affected.insert(owner);
+                    if (auto instIt = instantiates.find(owner); instIt != instantiates.end()) {
+                        for (auto childName : instIt->second)
+                            nameChangedBelow(childName);
+                    }
+                }
+            }
+        }
+    }
+
+    auto& reused = result->reusedOwners;
+    auto reuse = [&](const SyntaxNode* owner) {
+        if (owner && !affected.contains(owner))
+            reused.insert(owner);
+    };
+
+    for (auto& def : definitionMemory)
+        reuse(&def->syntax);
+    for (auto& [_, package] : packageMap)
+        reuse(package->getSyntax());
+    for (auto unit : compilationUnits)
+        reuse(unit->getSyntax());
+
+    // Anything that instantiates an affected definition, directly or not, needs
+    // its body walked through to get to the instances that need elaborating.
+    SmallVector<const SyntaxNode*> pathWorklist(affected.begin(), affected.end());
+    while (!pathWorklist.empty()) {
+        auto node = pathWorklist.back();
+        pathWorklist.pop_back();
+
+        if (auto it = dependents.find(getDeclarationName(*node)); it != dependents.end()) {
+            for (auto [owner, viaInstantiation] : it->second) {
+                if (viaInstantiation && reused.contains(owner) &&
+                    result->reusedPaths.insert(owner).second) {
+                    pathWorklist.push_back(owner);
+                }
+            }
+        }
+    }
+
+    // The new compilation won't rediscover the dependencies of anything it doesn't
+    // elaborate again, so copy those over. The names get copied too, since they
+    // might point into the tree that's being replaced.
+    for (auto& [name, deps] : dependents) {
+        for (auto [owner, viaInstantiation] : deps) {
+            if (!reused.contains(owner))
+                continue;
+
+            auto it = result->dependents.find(name);
+            if (it == result->dependents.end()) {
+                auto mem = reinterpret_cast<char*>(result->allocate(name.size(), 1));
+                memcpy(mem, name.data(), name.size());
+                it = result->dependents.try_emplace(std::string_view(mem, name.size())).first;
+            }
+            it->second.emplace(owner, viaInstantiation);
+        }
+    }
+
+    TypeArgFormatter formatter;
+    for (auto& [owner, diag] : ownedDiagnostics) {
+        if (owner && reused.contains(owner)) {
+            auto& carried = result->carriedDiagnostics.emplace_back(owner, diag);
+            detachDiagnostic(carried.second, formatter);
+        }
+    }
+
+    return result;
+}
+
 void Compilation::addDiagnostics(const Diagnostics& diagnostics) {
     for (auto& diag : diagnostics)
         addDiag(diag);
@@ -1274,7 +1928,24 @@ Diagnostic& Compilation::addDiag(Diagnostic diag) {
     // Filter out diagnostics that came from inside an uninstantiated generate block.
     SLANG_ASSERT(diag.symbol);
     SLANG_ASSERT(diag.location);
-    if (isSuppressed(diag.symbol)) {
+    bool suppressed = isSuppressed(diag.symbol);
+
+    // While elaborating in parallel, each thread holds on to its diagnostics until
+    // they can all be added in order. The diagMap isn't modified in the meantime.
+    if (auto worker = getElabWorker(*this)) {
+        if (suppressed) {
+            worker->tempDiag = std::move(diag);
+            return worker->tempDiag;
+        }
+
+        auto key = std::make_tuple(diag.code, diag.location);
+        if (diag.isError() && !diagMap.contains(key) && worker->errorKeys.emplace(key).second)
+            worker->numErrors++;
+
+        return worker->diags.emplace_back(std::move(diag));
+    }
+
+    if (suppressed) {
         tempDiag = std::move(diag);
         return tempDiag;
     }
@@ -1307,7 +1978,8 @@ const ImplicitTypeSyntax& Compilation::createEmptyTypeSyntax(SourceLocation loc)
 }
 
 void Compilation::forceElaborate(const Symbol& symbol) {
-    DiagnosticVisitor visitor(*this, numErrors,
+    auto worker = getElabWorker(*this);
+    DiagnosticVisitor visitor(*this, worker ? worker->numErrors : numErrors,
                               options.errorLimit == 0 ? UINT32_MAX : options.errorLimit);
     symbol.visit(visitor);
 }
@@ -1332,6 +2004,8 @@ const Type& Compilation::getType(bitwidth_t width, bitmask<IntegralFlags> flags)
     SLANG_ASSERT(width > 0 && width <= SVInt::MAX_BITS);
     uint32_t key = width;
     key |= uint32_t(flags.bits()) << SVInt::BITWIDTH_BITS;
+
+    auto lock = lockSharedState();
     auto it = vectorTypeCache.find(key);
     if (it != vectorTypeCache.end())
         return *it->second;
@@ -1371,12 +2045,14 @@ const Type& Compilation::getTypeRefType() {
 }
 
 Scope::DeferredMemberData& Compilation::getOrAddDeferredData(Scope::DeferredMemberIndex& index) {
+    auto lock = lockSharedState();
     if (index == Scope::DeferredMemberIndex::Invalid)
         index = deferredData.emplace();
     return deferredData[index];
 }
 
 void Compilation::trackImport(Scope::ImportDataIndex& index, const WildcardImportSymbol& import) {
+    auto lock = lockSharedState();
     if (index != Scope::ImportDataIndex::Invalid)
         importData[index].push_back(&import);
     else
@@ -1386,9 +2062,24 @@ void Compilation::trackImport(Scope::ImportDataIndex& index, const WildcardImpor
 std::span<const WildcardImportSymbol*> Compilation::queryImports(Scope::ImportDataIndex index) {
     if (index == Scope::ImportDataIndex::Invalid)
         return {};
+
+    auto lock = lockSharedState();
     return importData[index];
 }
 
+bool Compilation::doTypoCorrection() const {
+    if (auto worker = getElabWorker(*this))
+        return worker->typoCorrections < options.typoCorrectionLimit;
+    return typoCorrections < options.typoCorrectionLimit;
+}
+
+void Compilation::didTypoCorrection() {
+    if (auto worker = getElabWorker(*this))
+        worker->typoCorrections++;
+    else
+        typoCorrections++;
+}
+
 void Compilation::parseParamOverrides(
     flat_hash_map<std::string_view, const ConstantValue*>& results) {
     if (options.paramOverrides.empty())
@@ -1635,6 +2326,7 @@ void Compilation::checkModportExports(
 }
 
 void Compilation::checkElemTimeScale(std::optional<TimeScale> timeScale, SourceRange sourceRange) {
+    auto lock = lockSharedState();
     if (timeScale) {
         if (anyElemsWithTimescales)
             return;
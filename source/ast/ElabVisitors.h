@@ -10,17 +10,219 @@
 #include "slang/ast/ASTVisitor.h"
 #include "slang/diagnostics/CompilationDiags.h"
 #include "slang/diagnostics/DeclarationsDiags.h"
+#include "slang/syntax/AllSyntax.h"
 #include "slang/util/TimeTrace.h"
 
 namespace slang::ast {
 
 using namespace syntax;
 
+// Identifies an instance body by its definition and parameter values, which
+// (barring hierarchical references) fully determine what the body contains.
+struct InstanceCacheKey {
+    const InstanceBodySymbol* body;
+    size_t hash;
+
+    explicit InstanceCacheKey(const InstanceBodySymbol& body) : body(&body) {
+        hash = 0;
+        hash_combine(hash, &body.getDefinition(), body.isFromBind);
+        for (auto param : body.parameters) {
+            if (param->symbol.kind == SymbolKind::Parameter) {
+                hash_combine(hash, param->symbol.as<ParameterSymbol>().getValue().hash());
+            }
+            else {
+                auto& type = param->symbol.as<TypeParameterSymbol>().targetType.getType();
+                hash_combine(hash, type.hash());
+            }
+        }
+    }
+
+    bool operator==(const InstanceCacheKey& other) const {
+        if (&body->getDefinition() != &other.body->getDefinition() ||
+            body->isFromBind != other.body->isFromBind ||
+            body->parameters.size() != other.body->parameters.size()) {
+            return false;
+        }
+
+        for (size_t i = 0; i < body->parameters.size(); i++) {
+            auto& lhs = body->parameters[i]->symbol;
+            auto& rhs = other.body->parameters[i]->symbol;
+            if (lhs.kind != rhs.kind)
+                return false;
+
+            if (lhs.kind == SymbolKind::Parameter) {
+                if (lhs.as<ParameterSymbol>().getValue() != rhs.as<ParameterSymbol>().getValue())
+                    return false;
+            }
+            else {
+                auto& lt = lhs.as<TypeParameterSymbol>().targetType.getType();
+                auto& rt = rhs.as<TypeParameterSymbol>().targetType.getType();
+                if (!lt.isMatching(rt))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    struct Hasher {
+        size_t operator()(const InstanceCacheKey& key) const { return key.hash; }
+    };
+};
+
+// Tells the elaboration visitors which parts of a design created by Compilation::recompile
+// had their diagnostics carried over. Definitions, packages and compilation units are
+// identified by their declaration syntax.
+struct ElabReuse {
+    enum Action { Visit, WalkThrough, Skip };
+
+    const flat_hash_set<const SyntaxNode*>& owners;
+    const flat_hash_set<const SyntaxNode*>& paths;
+
+    Action getAction(const SyntaxNode* owner) const {
+        if (!owners.contains(owner))
+            return Visit;
+        return paths.contains(owner) ? WalkThrough : Skip;
+    }
+};
+
+// Visits just the instances beneath the given scope, looking through generate
+// blocks and instance arrays, without visiting anything else along the way.
+template<typename TVisitor>
+void visitInstancesWithin(const Scope& scope, TVisitor& visitor) {
+    for (auto& member : scope.members()) {
+        switch (member.kind) {
+            case SymbolKind::Instance:
+                member.visit(visitor);
+                break;
+            case SymbolKind::InstanceArray:
+            case SymbolKind::GenerateBlockArray:
+                visitInstancesWithin(member.as<Scope>(), visitor);
+                break;
+            case SymbolKind::GenerateBlock:
+                if (!member.as<GenerateBlockSymbol>().isUninstantiated)
+                    visitInstancesWithin(member.as<GenerateBlockSymbol>(), visitor);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Restricts elaboration to the hierarchical scopes listed in CompilationOptions::elabScopes.
+// Symbols inside one of the scopes are visited in full by the given visitor; instances,
+// instance arrays and generate blocks on the way down to one are walked through without
+// being visited themselves, and everything else is skipped. Anything outside of the
+// scopes is then only elaborated if something inside them refers to it.
+class ElabScopeWalker {
+public:
+    explicit ElabScopeWalker(std::span<const std::string> scopes) :
+        scopes(scopes), found(scopes.size()) {}
+
+    template<typename TVisitor>
+    void walk(const Scope& scope, TVisitor& visitor) {
+        for (auto& member : scope.members()) {
+            switch (member.kind) {
+                case SymbolKind::CompilationUnit:
+                    walk(member.as<CompilationUnitSymbol>(), visitor);
+                    break;
+                case SymbolKind::Instance:
+                case SymbolKind::InstanceArray:
+                case SymbolKind::GenerateBlock:
+                case SymbolKind::GenerateBlockArray:
+                case SymbolKind::Package:
+                    walkMember(member, visitor);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    // Reports any of the scopes that weren't found anywhere in the design.
+    void reportMissing(const RootSymbol& root) const {
+        for (size_t i = 0; i < scopes.size(); i++) {
+            if (found[i])
+                continue;
+
+            // A scope nested inside another one that was found is never looked
+            // for directly, since its parent gets visited as a whole.
+            bool nested = false;
+            for (size_t j = 0; j < scopes.size(); j++) {
+                if (found[j] && isWithin(scopes[i], scopes[j])) {
+                    nested = true;
+                    break;
+                }
+            }
+
+            if (!nested)
+                root.addDiag(diag::InvalidElabScope, SourceLocation::NoLocation) << scopes[i];
+        }
+    }
+
+private:
+    template<typename TVisitor>
+    void walkMember(const Symbol& member, TVisitor& visitor) {
+        std::string path;
+        member.getHierarchicalPath(path);
+
+        bool onPath = false;
+        for (size_t i = 0; i < scopes.size(); i++) {
+            if (path == scopes[i] || isWithin(path, scopes[i])) {
+                if (path == scopes[i])
+                    found[i] = true;
+
+                member.visit(visitor);
+                return;
+            }
+
+            if (isWithin(scopes[i], path))
+                onPath = true;
+        }
+
+        if (!onPath)
+            return;
+
+        if (member.kind == SymbolKind::Instance) {
+            auto& body = member.as<InstanceSymbol>().body;
+            if (!body.isUninstantiated)
+                walk(body, visitor);
+        }
+        else if (member.kind == SymbolKind::GenerateBlock) {
+            auto& block = member.as<GenerateBlockSymbol>();
+            if (!block.isUninstantiated)
+                walk(block, visitor);
+        }
+        else if (member.kind != SymbolKind::Package) {
+            walk(member.as<Scope>(), visitor);
+        }
+    }
+
+    // Returns true if @a path names something strictly inside of @a scope.
+    static bool isWithin(std::string_view path, std::string_view scope) {
+        return path.size() > scope.size() && path.starts_with(scope) &&
+               (path[scope.size()] == '.' || path[scope.size()] == '[');
+    }
+
+    std::span<const std::string> scopes;
+    std::vector<bool> found;
+};
+
 // This visitor is used to touch every node in the AST to ensure that all lazily
 // evaluated members have been realized and we have recorded every diagnostic.
+//
+// If instance caching is enabled, instances that have the same definition and
+// parameter values as an instance visited earlier share that instance's body
+// instead of having their own visited. Bodies reached by hierarchical references
+// are unshared again in finalize().
+//
+// If @a reuse is set, parts of the design whose diagnostics were carried over from
+// an earlier compilation are skipped, or only walked through to reach instances
+// beneath them that need visiting.
 struct DiagnosticVisitor : public ASTVisitor<DiagnosticVisitor, false, false> {
-    DiagnosticVisitor(Compilation& compilation, const size_t& numErrors, uint32_t errorLimit) :
-        compilation(compilation), numErrors(numErrors), errorLimit(errorLimit) {}
+    DiagnosticVisitor(Compilation& compilation, const size_t& numErrors, uint32_t errorLimit,
+                      bool cacheInstances = false) :
+        compilation(compilation), numErrors(numErrors), errorLimit(errorLimit),
+        cacheInstances(cacheInstances) {}
 
     template<typename T>
     void handle(const T& symbol) {
@@ -149,6 +351,15 @@ struct DiagnosticVisitor : public ASTVisitor<DiagnosticVisitor, false, false> {
         genericClasses.push_back(&symbol);
     }
 
+    void handle(const TypeAliasType& symbol) {
+        if (!handleDefault(symbol))
+            return;
+
+        // This is computed lazily; make sure it's done before anything that can be
+        // shared between threads is looked at by more than one of them.
+        symbol.getCanonicalType();
+    }
+
     void handle(const NetType& symbol) {
         if (!handleDefault(symbol))
             return;
@@ -269,15 +480,37 @@ struct DiagnosticVisitor : public ASTVisitor<DiagnosticVisitor, false, false> {
 
         instanceCount[&symbol.getDefinition()]++;
 
-        for (auto attr : compilation.getAttributes(symbol))
-            attr->getValue();
-
-        for (auto conn : symbol.getPortConnections()) {
-            conn->getExpression();
-            conn->checkSimulatedNetTypes();
-            for (auto attr : compilation.getAttributes(*conn))
+        // The attributes and connections belong to the parent, so they were
+        // carried over along with it if we're only walking through it.
+        if (!walkingThrough) {
+            for (auto attr : compilation.getAttributes(symbol))
                 attr->getValue();
-        };
+
+            for (auto conn : symbol.getPortConnections()) {
+                conn->getExpression();
+                conn->checkSimulatedNetTypes();
+                for (auto attr : compilation.getAttributes(*conn))
+                    attr->getValue();
+            };
+        }
+
+        auto action = reuse ? reuse->getAction(&symbol.getDefinition().syntax) : ElabReuse::Visit;
+        if (action == ElabReuse::Skip)
+            return;
+
+        std::optional<InstanceCacheKey> cacheKey;
+        if (cacheInstances && action == ElabReuse::Visit) {
+            if (isCacheable(symbol.body)) {
+                cacheKey.emplace(symbol.body);
+                if (auto it = instanceCache.find(*cacheKey); it != instanceCache.end()) {
+                    symbol.canonicalBody = it->second;
+                    bodyShareCounts.try_emplace(it->second, 1).first->second++;
+                    sharedInstances.push_back(&symbol);
+                    return;
+                }
+            }
+            visitedInstances.push_back(&symbol);
+        }
 
         // Detect infinite recursion, which happens if we see this exact
         // instance body somewhere higher up in the stack.
@@ -301,17 +534,57 @@ struct DiagnosticVisitor : public ASTVisitor<DiagnosticVisitor, false, false> {
             return;
         }
 
+        if (action == ElabReuse::WalkThrough) {
+            if (!symbol.body.isUninstantiated) {
+                auto wasWalkingThrough = std::exchange(walkingThrough, true);
+                visitInstancesWithin(symbol.body, *this);
+                walkingThrough = wasWalkingThrough;
+            }
+            return;
+        }
+
+        // Bodies that make hierarchical references can't be shared, since
+        // upward references resolve differently depending on the instance.
+        auto numHierRefs = compilation.getHierarchicalReferences().size();
+        auto wasWalkingThrough = std::exchange(walkingThrough, false);
         visit(symbol.body);
+        walkingThrough = wasWalkingThrough;
+
+        if (cacheKey && !hierarchyProblem &&
+            compilation.getHierarchicalReferences().size() == numHierRefs) {
+            instanceCache.emplace(*cacheKey, &symbol.body);
+        }
     }
 
     void handle(const SubroutineSymbol& symbol) {
         if (!handleDefault(symbol))
             return;
 
+        // Also computed lazily; see the TypeAliasType handler above.
+        symbol.hasOutputArgs();
+
         if (symbol.flags.has(MethodFlags::DPIImport))
             dpiImports.push_back(&symbol);
     }
 
+    void handle(const CompilationUnitSymbol& symbol) {
+        // Packages are carried over separately from the unit that declares them.
+        if (reuse && reuse->owners.contains(symbol.getSyntax())) {
+            for (auto& member : symbol.members()) {
+                if (member.kind == SymbolKind::Package)
+                    member.visit(*this);
+            }
+            return;
+        }
+        handleDefault(symbol);
+    }
+
+    void handle(const PackageSymbol& symbol) {
+        if (reuse && reuse->owners.contains(symbol.getSyntax()))
+            return;
+        handleDefault(symbol);
+    }
+
     void handle(const DefParamSymbol& symbol) {
         if (!handleDefault(symbol))
             return;
@@ -385,11 +658,85 @@ struct DiagnosticVisitor : public ASTVisitor<DiagnosticVisitor, false, false> {
     }
 
     void finalize() {
-        // Once everything has been visited, go back over and check things that might
-        // have been influenced by visiting later symbols. Unfortunately visiting
-        // a specialization can trigger more specializations to be made for the
-        // same or other generic classs, so we need to be careful here when iterating.
-        SmallSet<const Type*, 8> visitedSpecs;
+        // Hierarchical references can reach into specific instances, so bodies that
+        // they touched can't be shared after all. Visiting those bodies can find more
+        // hierarchical references, so keep going until there are no more.
+        flat_hash_set<const InstanceBodySymbol*> touched;
+        size_t hierRefIndex = 0;
+        while (!sharedInstances.empty() && !hierarchyProblem) {
+            auto refs = compilation.getHierarchicalReferences();
+            for (; hierRefIndex < refs.size(); hierRefIndex++) {
+                auto symbol = refs[hierRefIndex];
+                if (symbol->kind == SymbolKind::Instance)
+                    symbol = &symbol->as<InstanceSymbol>().body;
+
+                while (symbol) {
+                    if (symbol->kind == SymbolKind::InstanceBody) {
+                        auto& body = symbol->as<InstanceBodySymbol>();
+                        if (!touched.emplace(&body).second)
+                            break;
+                        symbol = body.parentInstance;
+                        if (!symbol)
+                            break;
+                    }
+
+                    auto scope = symbol->getParentScope();
+                    symbol = scope ? &scope->asSymbol() : nullptr;
+                }
+            }
+
+            SmallVector<const InstanceSymbol*> toVisit;
+            size_t numStillShared = 0;
+            for (auto inst : sharedInstances) {
+                auto canonical = inst->canonicalBody;
+                if (!touched.contains(&inst->body) && !touched.contains(canonical)) {
+                    sharedInstances[numStillShared++] = inst;
+                    continue;
+                }
+
+                if (--bodyShareCounts[canonical] == 1)
+                    bodyShareCounts.erase(canonical);
+
+                inst->canonicalBody = nullptr;
+                toVisit.push_back(inst);
+            }
+            sharedInstances.resize(numStillShared);
+
+            if (toVisit.empty())
+                break;
+
+            for (auto inst : toVisit) {
+                visitedInstances.push_back(inst);
+                visit(inst->body);
+            }
+        }
+
+        // Instances that were never visited still count towards the number of
+        // instances of their definitions, as do any instances nested inside them.
+        if (!bodyShareCounts.empty()) {
+            instanceCount.clear();
+            for (auto inst : visitedInstances)
+                instanceCount[&inst->getDefinition()] += getShareWeight(inst->getParentScope());
+            for (auto inst : sharedInstances)
+                instanceCount[&inst->getDefinition()] += getShareWeight(inst->getParentScope());
+        }
+
+        visitGenericClasses();
+
+        // Go back over and find generic classes that were never instantiated
+        // and force an empty one to make sure we collect all diagnostics that
+        // don't depend on parameter values.
+        for (auto symbol : genericClasses) {
+            if (symbol->numSpecializations() == 0)
+                symbol->getInvalidSpecialization().visit(*this);
+        }
+    }
+
+    // Once everything has been visited, go back over and check things that might
+    // have been influenced by visiting later symbols. Unfortunately visiting
+    // a specialization can trigger more specializations to be made for the
+    // same or other generic classs, so we need to be careful here when iterating.
+    void visitGenericClasses() {
         SmallVector<const Type*> toVisit;
         bool didSomething;
         do {
@@ -408,24 +755,75 @@ struct DiagnosticVisitor : public ASTVisitor<DiagnosticVisitor, false, false> {
                 toVisit.clear();
             }
         } while (didSomething);
+    }
 
-        // Go back over and find generic classes that were never instantiated
-        // and force an empty one to make sure we collect all diagnostics that
-        // don't depend on parameter values.
-        for (auto symbol : genericClasses) {
-            if (symbol->numSpecializations() == 0)
-                symbol->getInvalidSpecialization().visit(*this);
+    // Adds in what another visitor found in a different part of the design, once it
+    // has been finalized. Generic classes were already taken care of by the other visitor.
+    void merge(const DiagnosticVisitor& other) {
+        for (auto& [def, count] : other.instanceCount)
+            instanceCount[def] += count;
+
+        bodyShareCounts.insert(other.bodyShareCounts.begin(), other.bodyShareCounts.end());
+        visitedInstances.append_range(other.visitedInstances);
+        sharedInstances.append_range(other.sharedInstances);
+        usedIfacePorts.insert(other.usedIfacePorts.begin(), other.usedIfacePorts.end());
+        dpiImports.append_range(other.dpiImports);
+        externIfaceProtos.append_range(other.externIfaceProtos);
+        modportsWithExports.append_range(other.modportsWithExports);
+        hierarchyProblem |= other.hierarchyProblem;
+    }
+
+    // Returns the number of times the given scope occurs in the full design hierarchy,
+    // taking into account instance bodies that stand in for other, identical instances.
+    size_t getShareWeight(const Scope* scope) const {
+        size_t weight = 1;
+        auto symbol = scope ? &scope->asSymbol() : nullptr;
+        while (symbol) {
+            if (symbol->kind == SymbolKind::InstanceBody) {
+                auto& body = symbol->as<InstanceBodySymbol>();
+                if (auto it = bodyShareCounts.find(&body); it != bodyShareCounts.end())
+                    weight *= it->second;
+
+                symbol = body.parentInstance;
+                if (!symbol)
+                    break;
+            }
+
+            auto parent = symbol->getParentScope();
+            symbol = parent ? &parent->asSymbol() : nullptr;
         }
+        return weight;
+    }
+
+    static bool isCacheable(const InstanceBodySymbol& body) {
+        if (body.hierarchyOverrideNode || body.isUninstantiated)
+            return false;
+
+        // Interface ports connect to specific instances elsewhere in the design.
+        for (auto port : body.getPortList()) {
+            if (port->kind == SymbolKind::InterfacePort)
+                return false;
+        }
+        return true;
     }
 
     Compilation& compilation;
     const size_t& numErrors;
     uint32_t errorLimit;
+    bool cacheInstances;
     bool hierarchyProblem = false;
+    bool walkingThrough = false;
+    const ElabReuse* reuse = nullptr;
     flat_hash_map<const Definition*, size_t> instanceCount;
+    flat_hash_map<InstanceCacheKey, const InstanceBodySymbol*, InstanceCacheKey::Hasher>
+        instanceCache;
+    flat_hash_map<const InstanceBodySymbol*, size_t> bodyShareCounts;
+    SmallVector<const InstanceSymbol*> visitedInstances;
+    SmallVector<const InstanceSymbol*> sharedInstances;
     flat_hash_set<const InstanceBodySymbol*> activeInstanceBodies;
     flat_hash_set<const Definition*> usedIfacePorts;
     SmallVector<const GenericClassDefSymbol*> genericClasses;
+    SmallSet<const Type*, 8> visitedSpecs;
     SmallVector<const SubroutineSymbol*> dpiImports;
     SmallVector<const MethodPrototypeSymbol*> externIfaceProtos;
     SmallVector<std::pair<const InterfacePortSymbol*, const ModportSymbol*>> modportsWithExports;
@@ -541,6 +939,40 @@ struct DefParamVisitor : public ASTVisitor<DefParamVisitor, false, false> {
 struct PostElabVisitor : public ASTVisitor<PostElabVisitor, false, false> {
     explicit PostElabVisitor(Compilation& compilation) : compilation(compilation) {}
 
+    const ElabReuse* reuse = nullptr;
+
+    void handle(const InstanceSymbol& symbol) {
+        // Usage is tracked per syntax node, so a shared body would
+        // only repeat what was reported for its canonical body.
+        if (symbol.getCanonicalBody())
+            return;
+
+        auto action = reuse ? reuse->getAction(&symbol.getDefinition().syntax) : ElabReuse::Visit;
+        if (action == ElabReuse::WalkThrough) {
+            if (!symbol.body.isUninstantiated)
+                visitInstancesWithin(symbol.body, *this);
+        }
+        else if (action == ElabReuse::Visit) {
+            visitDefault(symbol);
+        }
+    }
+
+    void handle(const CompilationUnitSymbol& symbol) {
+        if (reuse && reuse->owners.contains(symbol.getSyntax())) {
+            for (auto& member : symbol.members()) {
+                if (member.kind == SymbolKind::Package)
+                    member.visit(*this);
+            }
+            return;
+        }
+        visitDefault(symbol);
+    }
+
+    void handle(const PackageSymbol& symbol) {
+        if (!reuse || !reuse->owners.contains(symbol.getSyntax()))
+            visitDefault(symbol);
+    }
+
     void handle(const NetSymbol& symbol) {
         if (symbol.isImplicit) {
             checkValueUnused(symbol, diag::UnusedImplicitNet, diag::UnusedImplicitNet,
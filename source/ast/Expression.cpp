@@ -1278,6 +1278,8 @@ void Expression::findPotentiallyImplicitNets(
         Visitor(const ASTContext& context, SmallVectorBase<const IdentifierNameSyntax*>& results) :
             context(context), results(results) {}
 
+        static bool isHandledKind(SyntaxKind kind) { return NameSyntax::isKind(kind); }
+
         void handle(const NameSyntax& nameSyntax) {
             if (nameSyntax.kind != SyntaxKind::IdentifierName)
                 return;
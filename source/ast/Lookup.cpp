@@ -697,6 +697,7 @@ bool resolveColonNames(SmallVectorBase<NamePlusLoc>& nameParts, int colonParts,
     }
 
     if (lookForPackage) {
+        context.getCompilation().noteDependency(*context.scope, name.text);
         symbol = context.getCompilation().getPackage(name.text);
         if (!symbol) {
             if (!context.scope->isUninstantiated()) {
@@ -984,6 +985,10 @@ void Lookup::name(const NameSyntax& syntax, const ASTContext& context, bitmask<L
             // Handle qualified names separately.
             qualified(syntax.as<ScopedNameSyntax>(), context, flags, result);
             unwrapResult(scope, syntax.sourceRange(), result);
+            if (result.found && result.isHierarchical) {
+                scope.getCompilation().noteHierarchicalReference(*result.found);
+                scope.getCompilation().noteDependency(scope, *result.found);
+            }
             if (flags.has(LookupFlags::NoSelectors))
                 result.errorIfSelectors(context);
             return;
@@ -0,0 +1,456 @@
+//------------------------------------------------------------------------------
+// PackageImage.cpp
+// Support for saving and loading precompiled packages
+//
+// SPDX-FileCopyrightText: Michael Popoloski
+// SPDX-License-Identifier: MIT
+//------------------------------------------------------------------------------
+#include "slang/ast/PackageImage.h"
+
+#include <bit>
+#include <fmt/core.h>
+
+#include "slang/ast/Compilation.h"
+#include "slang/ast/symbols/CompilationUnitSymbols.h"
+#include "slang/parsing/LexerFacts.h"
+#include "slang/parsing/ParserMetadata.h"
+#include "slang/parsing/Preprocessor.h"
+#include "slang/syntax/SyntaxPrinter.h"
+#include "slang/syntax/SyntaxTree.h"
+#include "slang/text/SourceManager.h"
+#include "slang/util/Bag.h"
+#include "slang/util/Hash.h"
+#include "slang/util/Version.h"
+
+namespace slang::ast {
+
+using namespace parsing;
+using namespace syntax;
+
+static constexpr std::string_view Magic = "SLPKGIMG"sv;
+static constexpr uint32_t NoOffset = UINT32_MAX;
+
+namespace {
+
+enum class ArgKind : uint8_t { String, SignedInt, UnsignedInt, Char, Real, ShortReal };
+
+std::string getLibraryVersion() {
+    return fmt::format("{}.{}.{}+{}", VersionInfo::getMajor(), VersionInfo::getMinor(),
+                       VersionInfo::getPatch(), VersionInfo::getHash());
+}
+
+// Prints the package's syntax back to text, remembering where each of its tokens
+// ended up so that source locations in its diagnostics can be mapped into the text.
+class TextMapper {
+public:
+    TextMapper() { printer.setIncludeComments(false); }
+
+    // The text is parsed on its own when the image is loaded, so the directive
+    // state that was in effect for the package has to be written out ahead of it.
+    void printDirectives(const ParserMetadata::Node& state) {
+        if (state.timeScale)
+            printer.append(fmt::format("`timescale {}\n", state.timeScale->toString()));
+
+        auto netType = state.defaultNetType == TokenKind::Unknown
+                           ? "none"sv
+                           : LexerFacts::getTokenKindText(state.defaultNetType);
+        printer.append(fmt::format("`default_nettype {}\n", netType));
+
+        if (state.unconnectedDrive != TokenKind::Unknown) {
+            printer.append(fmt::format("`unconnected_drive {}\n",
+                                       LexerFacts::getTokenKindText(state.unconnectedDrive)));
+        }
+    }
+
+    void print(const SyntaxNode& node) {
+        size_t childCount = node.getChildCount();
+        for (size_t i = 0; i < childCount; i++) {
+            if (auto childNode = node.childNode(i); childNode)
+                print(*childNode);
+            else if (auto token = node.childToken(i); token)
+                print(token);
+        }
+    }
+
+    std::string finish() {
+        for (auto& [_, entries] : tokenMap)
+            std::ranges::sort(entries, {}, &Entry::offset);
+        return printer.str();
+    }
+
+    uint32_t map(SourceLocation loc) const {
+        if (loc == SourceLocation::NoLocation)
+            return NoOffset;
+
+        auto it = tokenMap.find(loc.buffer().getId());
+        if (it == tokenMap.end())
+            return NoOffset;
+
+        // Find the last token that starts at or before the location.
+        auto& entries = it->second;
+        auto entryIt = std::ranges::upper_bound(entries, loc.offset(), {}, &Entry::offset);
+        if (entryIt == entries.begin())
+            return NoOffset;
+
+        --entryIt;
+        size_t delta = loc.offset() - entryIt->offset;
+        if (delta > entryIt->length)
+            return NoOffset;
+
+        return uint32_t(entryIt->printedOffset + delta);
+    }
+
+private:
+    struct Entry {
+        size_t offset;
+        size_t length;
+        size_t printedOffset;
+    };
+
+    void print(Token token) {
+        printer.print(token);
+        if (token.isMissing())
+            return;
+
+        auto loc = token.location();
+        auto length = token.rawText().size();
+        tokenMap[loc.buffer().getId()].push_back({loc.offset(), length, printer.size() - length});
+    }
+
+    SyntaxPrinter printer;
+    flat_hash_map<uint32_t, std::vector<Entry>> tokenMap;
+};
+
+class ImageWriter {
+public:
+    void write(uint8_t value) { data.push_back(char(value)); }
+
+    void write(uint32_t value) { writeRaw(value); }
+    void write(uint64_t value) { writeRaw(value); }
+
+    void write(std::string_view str) {
+        write(uint32_t(str.size()));
+        data.append(str);
+    }
+
+    void write(const Diagnostic& diag, const TextMapper& mapper) {
+        write(uint32_t(diag.code.getSubsystem()));
+        write(uint32_t(diag.code.getCode()));
+        write(mapper.map(diag.location));
+
+        write(uint32_t(diag.args.size()));
+        for (auto& arg : diag.args) {
+            std::visit(
+                [&](auto&& t) {
+                    using T = std::decay_t<decltype(t)>;
+                    if constexpr (std::is_same_v<T, std::string>) {
+                        write(uint8_t(ArgKind::String));
+                        write(t);
+                    }
+                    else if constexpr (std::is_same_v<T, int64_t>) {
+                        write(uint8_t(ArgKind::SignedInt));
+                        write(uint64_t(t));
+                    }
+                    else if constexpr (std::is_same_v<T, uint64_t>) {
+                        write(uint8_t(ArgKind::UnsignedInt));
+                        write(t);
+                    }
+                    else if constexpr (std::is_same_v<T, char>) {
+                        write(uint8_t(ArgKind::Char));
+                        write(uint8_t(t));
+                    }
+                    else if constexpr (std::is_same_v<T, ConstantValue>) {
+                        if (t.isReal()) {
+                            write(uint8_t(ArgKind::Real));
+                            write(std::bit_cast<uint64_t>(double(t.real())));
+                        }
+                        else if (t.isShortReal()) {
+                            write(uint8_t(ArgKind::ShortReal));
+                            write(std::bit_cast<uint32_t>(float(t.shortReal())));
+                        }
+                        else {
+                            write(uint8_t(ArgKind::String));
+                            write(t.toString());
+                        }
+                    }
+                    else {
+                        // Type arguments have already been formatted to strings;
+                        // there's nothing meaningful to save for anything else.
+                        write(uint8_t(ArgKind::String));
+                        write(""sv);
+                    }
+                },
+                arg);
+        }
+
+        SmallVector<std::pair<uint32_t, uint32_t>> ranges;
+        for (auto& range : diag.ranges) {
+            auto start = mapper.map(range.start());
+            auto end = mapper.map(range.end());
+            if (start != NoOffset && end != NoOffset && start <= end)
+                ranges.emplace_back(start, end);
+        }
+
+        write(uint32_t(ranges.size()));
+        for (auto [start, end] : ranges) {
+            write(start);
+            write(end);
+        }
+
+        write(uint8_t(diag.coalesceCount.has_value()));
+        write(uint64_t(diag.coalesceCount.value_or(0)));
+
+        // Notes that point outside of the package (at a declaration in some
+        // other package, say) have nowhere to point once loaded, so drop them.
+        SmallVector<const Diagnostic*> notes;
+        for (auto& note : diag.notes) {
+            if (note.location == SourceLocation::NoLocation ||
+                mapper.map(note.location) != NoOffset) {
+                notes.push_back(&note);
+            }
+        }
+
+        write(uint32_t(notes.size()));
+        for (auto note : notes)
+            write(*note, mapper);
+    }
+
+    std::string data;
+
+private:
+    template<typename T>
+    void writeRaw(T value) {
+        char buf[sizeof(T)];
+        memcpy(buf, &value, sizeof(T));
+        data.append(buf, sizeof(T));
+    }
+};
+
+class ImageReader {
+public:
+    explicit ImageReader(std::string_view data) : data(data) {}
+
+    bool ok() const { return valid; }
+
+    uint8_t readByte() { return readRaw<uint8_t>(); }
+    uint32_t readU32() { return readRaw<uint32_t>(); }
+    uint64_t readU64() { return readRaw<uint64_t>(); }
+
+    std::string_view readString() {
+        auto size = readU32();
+        if (!check(size))
+            return {};
+
+        auto result = data.substr(0, size);
+        data.remove_prefix(size);
+        return result;
+    }
+
+    std::string_view readBytes(size_t count) {
+        if (!check(count))
+            return {};
+
+        auto result = data.substr(0, count);
+        data.remove_prefix(count);
+        return result;
+    }
+
+    Diagnostic readDiag(BufferID buffer, size_t textSize, uint32_t depth = 0) {
+        Diagnostic diag;
+        auto subsystem = readU32();
+        auto code = readU32();
+        diag.code = DiagCode(DiagSubsystem(subsystem), uint16_t(code));
+        diag.location = readLocation(buffer, textSize);
+
+        auto numArgs = readU32();
+        for (uint32_t i = 0; i < numArgs && valid; i++) {
+            switch (ArgKind(readByte())) {
+                case ArgKind::String:
+                    diag.args.emplace_back(std::string(readString()));
+                    break;
+                case ArgKind::SignedInt:
+                    diag.args.emplace_back(int64_t(readU64()));
+                    break;
+                case ArgKind::UnsignedInt:
+                    diag.args.emplace_back(readU64());
+                    break;
+                case ArgKind::Char:
+                    diag.args.emplace_back(char(readByte()));
+                    break;
+                case ArgKind::Real:
+                    diag.args.emplace_back(ConstantValue(real_t(std::bit_cast<double>(readU64()))));
+                    break;
+                case ArgKind::ShortReal:
+                    diag.args.emplace_back(
+                        ConstantValue(shortreal_t(std::bit_cast<float>(readU32()))));
+                    break;
+                default:
+                    valid = false;
+                    break;
+            }
+        }
+
+        auto numRanges = readU32();
+        for (uint32_t i = 0; i < numRanges && valid; i++) {
+            auto start = readLocation(buffer, textSize);
+            auto end = readLocation(buffer, textSize);
+            diag.ranges.emplace_back(start, end);
+        }
+
+        auto hasCoalesceCount = readByte();
+        auto coalesceCount = readU64();
+        if (hasCoalesceCount)
+            diag.coalesceCount = size_t(coalesceCount);
+
+        // Guard against runaway nesting in corrupt data.
+        auto numNotes = readU32();
+        if (numNotes && depth > 16)
+            valid = false;
+
+        for (uint32_t i = 0; i < numNotes && valid; i++)
+            diag.notes.emplace_back(readDiag(buffer, textSize, depth + 1));
+
+        return diag;
+    }
+
+private:
+    bool check(size_t count) {
+        if (count > data.size())
+            valid = false;
+        return valid;
+    }
+
+    template<typename T>
+    T readRaw() {
+        T value{};
+        if (check(sizeof(T))) {
+            memcpy(&value, data.data(), sizeof(T));
+            data.remove_prefix(sizeof(T));
+        }
+        return value;
+    }
+
+    SourceLocation readLocation(BufferID buffer, size_t textSize) {
+        auto offset = readU32();
+        if (offset == NoOffset)
+            return SourceLocation::NoLocation;
+
+        if (offset > textSize) {
+            valid = false;
+            return SourceLocation::NoLocation;
+        }
+
+        return SourceLocation(buffer, offset);
+    }
+
+    std::string_view data;
+    bool valid = true;
+};
+
+} // namespace
+
+uint64_t PackageImage::hashOptions(const Bag& options) {
+    auto ppoptions = options.getOrDefault<PreprocessorOptions>();
+    auto coptions = options.getOrDefault<CompilationOptions>();
+
+    size_t seed = 0;
+    for (auto& define : ppoptions.predefines)
+        hash_combine(seed, define);
+    for (auto& undef : ppoptions.undefines)
+        hash_combine(seed, undef);
+
+    hash_combine(seed, coptions.maxInstanceDepth, coptions.maxGenerateSteps,
+                 coptions.maxConstexprDepth, coptions.maxConstexprSteps,
+                 coptions.maxConstexprBacktrace, coptions.errorLimit, coptions.typoCorrectionLimit,
+                 coptions.minTypMax, coptions.allowHierarchicalConst, coptions.relaxEnumConversions,
+                 coptions.allowUseBeforeDeclare, coptions.allowDupInitialDrivers,
+                 coptions.strictDriverChecking, coptions.lintMode, coptions.suppressUnused,
+                 coptions.scriptMode);
+
+    if (coptions.defaultTimeScale)
+        hash_combine(seed, coptions.defaultTimeScale->toString());
+
+    return seed;
+}
+
+std::optional<std::string> PackageImage::save(Compilation& compilation,
+                                              const PackageSymbol& package, const Bag& options) {
+    auto syntax = package.getSyntax();
+    SLANG_ASSERT(syntax);
+
+    auto diagnostics = compilation.getPackageDiagnostics(package);
+    if (!diagnostics)
+        return std::nullopt;
+
+    TextMapper mapper;
+    for (auto& tree : compilation.getSyntaxTrees()) {
+        auto& nodeMap = tree->getMetadata().nodeMap;
+        if (auto it = nodeMap.find(syntax); it != nodeMap.end()) {
+            mapper.printDirectives(it->second);
+            break;
+        }
+    }
+    mapper.print(*syntax);
+    auto text = mapper.finish();
+
+    ImageWriter writer;
+    writer.data.append(Magic);
+    writer.write(FormatVersion);
+    writer.write(getLibraryVersion());
+    writer.write(hashOptions(options));
+    writer.write(package.name);
+    writer.write(text);
+
+    writer.write(uint32_t(diagnostics->size()));
+    for (auto& diag : *diagnostics)
+        writer.write(diag, mapper);
+
+    return std::move(writer.data);
+}
+
+PackageImage::LoadResult PackageImage::load(std::string_view data, std::string_view path,
+                                            SourceManager& sourceManager, const Bag& options) {
+    LoadResult result;
+    ImageReader reader(data);
+    if (reader.readBytes(Magic.size()) != Magic)
+        return result;
+
+    auto formatVersion = reader.readU32();
+    auto libraryVersion = reader.readString();
+    if (!reader.ok())
+        return result;
+
+    if (formatVersion != FormatVersion || libraryVersion != getLibraryVersion()) {
+        result.status = Status::VersionMismatch;
+        return result;
+    }
+
+    auto optionsHash = reader.readU64();
+    auto name = reader.readString();
+    auto text = reader.readString();
+    if (!reader.ok())
+        return result;
+
+    if (optionsHash != hashOptions(options)) {
+        result.status = Status::OptionsMismatch;
+        return result;
+    }
+
+    auto buffer = sourceManager.assignText(path, text);
+
+    Diagnostics diagnostics;
+    auto numDiags = reader.readU32();
+    for (uint32_t i = 0; i < numDiags && reader.ok(); i++)
+        diagnostics.emplace_back(reader.readDiag(buffer.id, text.size()));
+
+    if (!reader.ok())
+        return result;
+
+    result.status = Status::Ok;
+    result.name = std::string(name);
+    result.tree = SyntaxTree::fromBuffer(buffer, sourceManager, options);
+    result.diagnostics = std::move(diagnostics);
+    return result;
+}
+
+} // namespace slang::ast
@@ -1603,6 +1603,7 @@ public:
                 auto bounds = ValueDriver::getBounds(*state.longestStaticPrefix, evalCtx,
                                                      *state.rootType);
                 if (bounds) {
+                    auto lock = comp.lockSharedState();
                     state.intervals.unionWith(*bounds, {}, comp.getUnrollIntervalMapAllocator());
                 }
             }
@@ -1647,6 +1648,7 @@ private:
                     for (auto it = state.intervals.begin(); it != state.intervals.end(); ++it)
                         state.symbol->addDriver(it.bounds(), *driver);
 
+                    auto lock = comp.lockSharedState();
                     state.intervals.clear(comp.getUnrollIntervalMapAllocator());
                 }
             }
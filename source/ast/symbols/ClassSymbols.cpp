@@ -754,7 +754,11 @@ const Type* GenericClassDefSymbol::getDefaultSpecialization() const {
 
     auto result = getSpecializationImpl(ASTContext(*scope, LookupLocation::max), location,
                                         /* forceInvalidParams */ false, nullptr);
-    defaultSpecialization = result;
+
+    // Specializations made while elaborating in parallel belong to one
+    // top-level instance, so they can't be remembered for everyone.
+    if (!scope->getCompilation().getParallelElabId())
+        defaultSpecialization = result;
     return result;
 }
 
@@ -834,9 +838,23 @@ const Type* GenericClassDefSymbol::getSpecializationImpl(
         }
     }
 
-    SpecializationKey key(*this, paramValues.copy(comp), typeParams.copy(comp));
-    if (auto it = specMap.find(key); it != specMap.end())
-        return it->second;
+    // While top-level instances are elaborated in parallel each of them makes its own
+    // specializations, apart from the ones that already existed beforehand.
+    auto paramValuesCopy = paramValues.copy(comp);
+    auto typeParamsCopy = typeParams.copy(comp);
+    auto elabId = comp.getParallelElabId();
+    {
+        auto lock = comp.lockSharedState();
+        SpecializationKey key(*this, paramValuesCopy, typeParamsCopy, 0);
+        if (auto it = specMap.find(key); it != specMap.end())
+            return it->second;
+
+        if (elabId) {
+            SpecializationKey threadKey(*this, paramValuesCopy, typeParamsCopy, elabId);
+            if (auto it = specMap.find(threadKey); it != specMap.end())
+                return it->second;
+        }
+    }
 
     // Not found, so this is a new entry. Fill in its members and store the
     // specialization for later lookup. If we have a specialization function,
@@ -845,7 +863,9 @@ const Type* GenericClassDefSymbol::getSpecializationImpl(
         specializeFunc(comp, *classType);
     else
         classType->populate(*scope, getSyntax()->as<ClassDeclarationSyntax>());
-    specMap.emplace(key, classType);
+
+    auto lock = comp.lockSharedState();
+    specMap.emplace(SpecializationKey(*this, paramValuesCopy, typeParamsCopy, elabId), classType);
     return classType;
 }
 
@@ -876,13 +896,13 @@ void GenericClassDefSymbol::serializeTo(ASTSerializer& serializer) const {
 
 GenericClassDefSymbol::SpecializationKey::SpecializationKey(
     const GenericClassDefSymbol& def, std::span<const ConstantValue* const> paramValues,
-    std::span<const Type* const> typeParams) :
+    std::span<const Type* const> typeParams, uint32_t parallelElabId) :
     definition(&def),
-    paramValues(paramValues), typeParams(typeParams) {
+    paramValues(paramValues), typeParams(typeParams), parallelElabId(parallelElabId) {
 
     // Precompute the hash.
     size_t h = 0;
-    hash_combine(h, definition);
+    hash_combine(h, definition, parallelElabId);
     for (auto val : paramValues)
         hash_combine(h, val ? val->hash() : 0);
     for (auto type : typeParams)
@@ -892,7 +912,7 @@ GenericClassDefSymbol::SpecializationKey::SpecializationKey(
 
 bool GenericClassDefSymbol::SpecializationKey::operator==(const SpecializationKey& other) const {
     if (savedHash != other.savedHash || definition != other.definition ||
-        paramValues.size() != other.paramValues.size() ||
+        parallelElabId != other.parallelElabId || paramValues.size() != other.paramValues.size() ||
         typeParams.size() != other.typeParams.size()) {
         return false;
     }
@@ -1030,7 +1050,20 @@ const Constraint& ConstraintBlockSymbol::getConstraints() const {
         auto& outerScope = *parentSym.getParentScope();
         auto& comp = outerScope.getCompilation();
 
-        auto [declSyntax, index, used] = comp.findOutOfBlockDecl(outerScope, parentSym.name, name);
+        const SyntaxNode* declSyntax;
+        SymbolIndex index;
+        {
+            auto lock = comp.lockSharedState();
+            auto [foundSyntax, foundIndex, used] = comp.findOutOfBlockDecl(outerScope,
+                                                                           parentSym.name, name);
+            declSyntax = foundSyntax;
+            index = foundIndex;
+            if (declSyntax && declSyntax->kind == SyntaxKind::ConstraintDeclaration &&
+                !name.empty()) {
+                *used = true;
+            }
+        }
+
         if (!declSyntax || declSyntax->kind != SyntaxKind::ConstraintDeclaration || name.empty()) {
             if (!isPure && !name.empty()) {
                 DiagCode code = isExplicitExtern ? diag::NoMemberImplFound : diag::NoConstraintBody;
@@ -1041,7 +1074,6 @@ const Constraint& ConstraintBlockSymbol::getConstraints() const {
         }
 
         auto& cds = declSyntax->as<ConstraintDeclarationSyntax>();
-        *used = true;
 
         if (isPure) {
             auto& diag = outerScope.addDiag(diag::BodyForPureConstraint, cds.name->sourceRange());
@@ -381,6 +381,7 @@ void InstanceSymbol::fromSyntax(Compilation& comp, const HierarchyInstantiationS
             parentOverrideNode = findParentOverrideNode(*context.scope);
     }
 
+    comp.noteDependency(*context.scope, syntax.type.valueText(), /* viaInstantiation */ true);
     auto definition = comp.getDefinition(syntax.type.valueText(), *context.scope);
     if (!definition) {
         // This might actually be a user-defined primitive instantiation.
@@ -476,7 +477,10 @@ void InstanceSymbol::fromFixupSyntax(Compilation& comp, const Definition& defini
         loc = loc + decl->name.rawText().length();
         context.addDiag(diag::InstanceMissingParens, loc) << definition.getKindString();
 
-        auto instName = comp.emplace<InstanceNameSyntax>(decl->name, decl->dimensions);
+        // The dimensions are cloned so that the original (possibly shared) syntax
+        // nodes don't get reparented under the synthesized instance name.
+        auto instName = comp.emplace<InstanceNameSyntax>(decl->name,
+                                                         *deepClone(decl->dimensions, comp));
         auto instance = comp.emplace<HierarchicalInstanceSyntax>(
             instName, missing(TokenKind::OpenParenthesis, loc), std::span<TokenOrSyntax>(),
             missing(TokenKind::CloseParenthesis, loc));
@@ -67,6 +67,7 @@ const PackageSymbol* ExplicitImportSymbol::package() const {
 static const PackageSymbol* findPackage(std::string_view packageName, const Scope& lookupScope,
                                         SourceLocation errorLoc) {
     auto& comp = lookupScope.getCompilation();
+    comp.noteDependency(lookupScope, packageName);
     auto package = comp.getPackage(packageName);
     if (!package && !packageName.empty() && !comp.getOptions().lintMode)
         lookupScope.addDiag(diag::UnknownPackage, errorLoc) << packageName;
@@ -150,10 +150,11 @@ const ParameterSymbolBase& ParameterBuilder::createParam(const Definition::Param
             // a type parameter, so fix it up into a NamedTypeSyntax to get a type from it.
             tt.addFlags(DeclaredTypeFlags::TypeOverridden);
             if (NameSyntax::isKind(newInitializer->kind)) {
-                // const_cast is ugly but safe here, we're only going to refer to it
-                // by const reference everywhere down.
-                auto& nameSyntax = const_cast<NameSyntax&>(newInitializer->as<NameSyntax>());
-                auto namedType = comp.emplace<NamedTypeSyntax>(nameSyntax);
+                // Wrap a shallow clone of the name instead of the original node, since
+                // the wrapper takes ownership of its parent pointer and the syntax tree
+                // may be shared with other compilations.
+                auto nameSyntax = clone(newInitializer->as<NameSyntax>(), comp);
+                auto namedType = comp.emplace<NamedTypeSyntax>(*nameSyntax);
 
                 tt.setTypeSyntax(*namedType);
             }
@@ -48,6 +48,7 @@ std::tuple<const Definition*, std::string_view> getInterfacePortInfo(
 
     auto& comp = scope.getCompilation();
     auto token = header.nameOrKeyword;
+    comp.noteDependency(scope, token.valueText());
     auto def = comp.getDefinition(token.valueText(), scope);
     std::string_view modport;
 
@@ -116,6 +117,7 @@ public:
 
                     // If we didn't find a valid type, try to find a definition.
                     if (!found || !found->isType()) {
+                        comp.noteDependency(scope, simpleName);
                         if (auto definition = comp.getDefinition(simpleName, scope)) {
                             if (definition->definitionKind != DefinitionKind::Interface) {
                                 auto& diag = scope.addDiag(diag::PortTypeNotInterfaceOrData,
@@ -50,8 +50,9 @@ const Statement& SubroutineSymbol::getBody() const {
             Statement::StatementContext stmtCtx(context);
             stmtCtx.blocks = blocks;
 
-            stmt = &Statement::bindItems(syntax->as<FunctionDeclarationSyntax>().items, context,
-                                         stmtCtx);
+            auto& items = getCompilation().getSubroutineItems(
+                syntax->as<FunctionDeclarationSyntax>(), *this);
+            stmt = &Statement::bindItems(items, context, stmtCtx);
         }
     }
     return *stmt;
@@ -149,7 +150,8 @@ SubroutineSymbol* SubroutineSymbol::fromSyntax(Compilation& compilation,
     }
 
     const Symbol* last = result->getLastMember();
-    result->blocks = Statement::createAndAddBlockItems(*result, syntax.items);
+    result->blocks = Statement::createAndAddBlockItems(
+        *result, compilation.getSubroutineItems(syntax, parent));
 
     // Subroutines can also declare arguments inside their bodies as port declarations.
     // Find them by walking through members that were added by setItems().
@@ -1001,12 +1003,18 @@ const SubroutineSymbol* MethodPrototypeSymbol::getSubroutine() const {
                             MethodFlags::InterfaceExtern));
 
     // The out-of-block definition must be in our parent scope.
-    auto [declSyntax, index, used] = comp.findOutOfBlockDecl(outerScope, parentSym.name, name);
     const FunctionDeclarationSyntax* syntax = nullptr;
-    if (declSyntax && (declSyntax->kind == SyntaxKind::FunctionDeclaration ||
-                       declSyntax->kind == SyntaxKind::TaskDeclaration)) {
-        syntax = &declSyntax->as<FunctionDeclarationSyntax>();
-        *used = true;
+    SymbolIndex index;
+    {
+        auto lock = comp.lockSharedState();
+        auto [declSyntax, declIndex, used] = comp.findOutOfBlockDecl(outerScope, parentSym.name,
+                                                                     name);
+        index = declIndex;
+        if (declSyntax && (declSyntax->kind == SyntaxKind::FunctionDeclaration ||
+                           declSyntax->kind == SyntaxKind::TaskDeclaration)) {
+            syntax = &declSyntax->as<FunctionDeclarationSyntax>();
+            *used = true;
+        }
     }
 
     if (flags.has(MethodFlags::Pure)) {
@@ -222,7 +222,10 @@ void ValueSymbol::addDriver(std::pair<uint32_t, uint32_t> bounds, const ValueDri
     auto scope = getParentScope();
     SLANG_ASSERT(scope);
 
+    // Variables in packages can be driven from any top-level instance,
+    // and all of the driver maps share an allocator.
     auto& comp = scope->getCompilation();
+    auto lock = comp.lockSharedState();
 
     if (driverMap.empty()) {
         // The first time we add a driver, check whether there is also an
@@ -249,12 +249,13 @@ EnumType::EnumType(Compilation& compilation, SourceLocation loc, const Type& bas
                    const ASTContext& context) :
     IntegralType(SymbolKind::EnumType, "", loc, baseType_.getBitWidth(), baseType_.isSigned(),
                  baseType_.isFourState()),
-    Scope(compilation, this), baseType(baseType_), systemId(compilation.getNextEnumSystemId()) {
+    Scope(compilation, this), baseType(baseType_) {
 
     // Enum types don't live as members of the parent scope (they're "owned" by the declaration
     // containing them) but we hook up the parent pointer so that it can participate in name
     // lookups.
     setParent(*context.scope, context.lookupIndex);
+    compilation.assignEnumSystemId(systemId);
 }
 
 static void checkEnumRange(const ASTContext& context, const VariableDimensionSyntax& syntax) {
@@ -749,12 +750,13 @@ ConstantValue QueueType::getDefaultValueImpl() const {
 PackedStructType::PackedStructType(Compilation& compilation, bool isSigned, SourceLocation loc,
                                    const ASTContext& context) :
     IntegralType(SymbolKind::PackedStructType, "", loc, 0, isSigned, false),
-    Scope(compilation, this), systemId(compilation.getNextStructSystemId()) {
+    Scope(compilation, this) {
 
     // Struct types don't live as members of the parent scope (they're "owned" by
     // the declaration containing them) but we hook up the parent pointer so that
     // it can participate in name lookups.
     setParent(*context.scope, context.lookupIndex);
+    compilation.assignStructSystemId(systemId);
 }
 
 const Type& PackedStructType::fromSyntax(Compilation& comp, const StructUnionTypeSyntax& syntax,
@@ -834,12 +836,13 @@ const Type& PackedStructType::fromSyntax(Compilation& comp, const StructUnionTyp
 UnpackedStructType::UnpackedStructType(Compilation& compilation, SourceLocation loc,
                                        const ASTContext& context) :
     Type(SymbolKind::UnpackedStructType, "", loc),
-    Scope(compilation, this), systemId(compilation.getNextStructSystemId()) {
+    Scope(compilation, this) {
 
     // Struct types don't live as members of the parent scope (they're "owned" by
     // the declaration containing them) but we hook up the parent pointer so that
     // it can participate in name lookups.
     setParent(*context.scope, context.lookupIndex);
+    compilation.assignStructSystemId(systemId);
 }
 
 ConstantValue UnpackedStructType::getDefaultValueImpl() const {
@@ -911,13 +914,13 @@ const Type& UnpackedStructType::fromSyntax(const ASTContext& context,
 PackedUnionType::PackedUnionType(Compilation& compilation, bool isSigned, bool isTagged,
                                  SourceLocation loc, const ASTContext& context) :
     IntegralType(SymbolKind::PackedUnionType, "", loc, 0, isSigned, false),
-    Scope(compilation, this), systemId(compilation.getNextUnionSystemId()), isTagged(isTagged),
-    tagBits(0) {
+    Scope(compilation, this), isTagged(isTagged), tagBits(0) {
 
     // Union types don't live as members of the parent scope (they're "owned" by
     // the declaration containing them) but we hook up the parent pointer so that
     // it can participate in name lookups.
     setParent(*context.scope, context.lookupIndex);
+    compilation.assignUnionSystemId(systemId);
 }
 
 const Type& PackedUnionType::fromSyntax(Compilation& comp, const StructUnionTypeSyntax& syntax,
@@ -1003,12 +1006,13 @@ const Type& PackedUnionType::fromSyntax(Compilation& comp, const StructUnionType
 UnpackedUnionType::UnpackedUnionType(Compilation& compilation, bool isTagged, SourceLocation loc,
                                      const ASTContext& context) :
     Type(SymbolKind::UnpackedUnionType, "", loc),
-    Scope(compilation, this), systemId(compilation.getNextUnionSystemId()), isTagged(isTagged) {
+    Scope(compilation, this), isTagged(isTagged) {
 
     // Union types don't live as members of the parent scope (they're "owned" by
     // the declaration containing them) but we hook up the parent pointer so that
     // it can participate in name lookups.
     setParent(*context.scope, context.lookupIndex);
+    compilation.assignUnionSystemId(systemId);
 }
 
 ConstantValue UnpackedUnionType::getDefaultValueImpl() const {
@@ -1182,10 +1182,13 @@ bool Type::isKind(SymbolKind kind) {
 
 void Type::resolveCanonical() const {
     SLANG_ASSERT(kind == SymbolKind::TypeAlias);
-    canonical = this;
+
+    // Only store the final result, since other threads can be looking at it.
+    const Type* result = this;
     do {
-        canonical = &canonical->as<TypeAliasType>().targetType.getType();
-    } while (canonical->isAlias());
+        result = &result->as<TypeAliasType>().targetType.getType();
+    } while (result->isAlias());
+    canonical = result;
 }
 
 const Type& Type::lookupNamedType(Compilation& compilation, const NameSyntax& syntax,
@@ -9,8 +9,10 @@
 #include "slang/driver/Driver.h"
 
 #include <fmt/color.h>
+#include <fstream>
 
 #include "slang/ast/Compilation.h"
+#include "slang/ast/PackageImage.h"
 #include "slang/ast/symbols/CompilationUnitSymbols.h"
 #include "slang/ast/symbols/InstanceSymbols.h"
 #include "slang/diagnostics/DeclarationsDiags.h"
@@ -22,8 +24,11 @@
 #include "slang/diagnostics/TextDiagnosticClient.h"
 #include "slang/parsing/Parser.h"
 #include "slang/parsing/Preprocessor.h"
+#include "slang/parsing/TokenCache.h"
 #include "slang/syntax/SyntaxPrinter.h"
 #include "slang/syntax/SyntaxTree.h"
+#include "slang/syntax/SyntaxTreeCache.h"
+#include "slang/util/Function.h"
 #include "slang/util/Random.h"
 #include "slang/util/String.h"
 #include "slang/util/ThreadPool.h"
@@ -36,6 +41,11 @@ using namespace ast;
 using namespace parsing;
 using namespace syntax;
 
+// Parsing or preprocessing only fans out to a thread pool when there are more
+// source buffers than this; for just a few files the cost of starting up the
+// pool's threads outweighs what can be gained by processing them in parallel.
+static constexpr size_t ParallelBufferThreshold = 4;
+
 Driver::Driver() : diagEngine(sourceManager) {
     diagClient = std::make_shared<TextDiagnosticClient>();
     diagEngine.addClient(diagClient);
@@ -95,7 +105,21 @@ void Driver::addStandardArgs() {
                 "is skipped",
                 "<count>");
     cmdLine.add("-j,--threads", options.numThreads,
-                "The number of threads to use to parallelize parsing", "<count>");
+                "The number of threads to use to parallelize parsing and, if explicitly set, "
+                "elaboration of independent top-level instances",
+                "<count>");
+    cmdLine.add("--cache-dir", options.syntaxCacheDir,
+                "Directory in which to cache parsed syntax trees across runs. Files whose "
+                "contents, includes, and preprocessor options haven't changed are loaded "
+                "from the cache instead of being parsed again.",
+                "<dir>", /* isFileName */ true);
+    cmdLine.add("--defer-library-bodies", options.deferLibraryBodies,
+                "Don't parse the bodies of functions and tasks in library files until "
+                "they are needed during elaboration. Syntax errors in bodies that are "
+                "never needed will not be reported.");
+    cmdLine.add("--lean-trivia", options.leanTrivia,
+                "Don't keep whitespace and comments in parsed syntax trees, which reduces "
+                "memory usage. Syntax trees can't be printed back to their original text.");
 
     // Compilation
     cmdLine.add("--max-hierarchy-depth", options.maxInstanceDepth,
@@ -138,6 +162,9 @@ void Driver::addStandardArgs() {
     cmdLine.add("--strict-driver-checking", options.strictDriverChecking,
                 "Perform strict driver checking, which currently means disabling "
                 "procedural 'for' loop unrolling.");
+    cmdLine.add("--disable-instance-caching", options.disableInstanceCaching,
+                "Elaborate the body of every instance separately, even instances whose "
+                "definition and parameter values are identical to another instance.");
     cmdLine.add("--lint-only", options.onlyLint,
                 "Only perform linting of code, don't try to elaborate a full hierarchy");
     cmdLine.add("--top", options.topModules,
@@ -148,6 +175,11 @@ void Driver::addStandardArgs() {
                 "One or more parameter overrides to apply when "
                 "instantiating top-level modules",
                 "<name>=<value>");
+    cmdLine.add("--elab-scope", options.elabScopes,
+                "One or more hierarchical paths of instances or generate blocks to restrict "
+                "elaboration to. Only these scopes are fully elaborated and checked; the "
+                "rest of the design is resolved only as far as needed to connect them.",
+                "<path>");
 
     // Diagnostics control
     cmdLine.add("-W", options.warningOptions, "Control the specified warning", "<warning>");
@@ -189,6 +221,18 @@ void Driver::addStandardArgs() {
                 "where modules are not automatically instantiated.",
                 "<filename>", /* isFileName */ true);
 
+    cmdLine.add("--package-image", options.packageImages,
+                "One or more precompiled package images to load in place of the packages' "
+                "source. The images must have been written with the same options.",
+                "<filename>", /* isFileName */ true);
+
+    cmdLine.add("--write-package-image", options.writePackageImages,
+                "One or more packages to write precompiled images of after compiling.",
+                "<name>=<filename>");
+
+    cmdLine.add("--mmap-files", options.memoryMapFiles,
+                "Memory map source files instead of reading them into memory.");
+
     cmdLine.setPositional(
         [this](std::string_view fileName) {
             if (!options.excludeExts.empty()) {
@@ -199,11 +243,23 @@ void Driver::addStandardArgs() {
                 }
             }
 
-            SourceBuffer buffer = readSource(fileName);
-            if (!buffer)
+            // Reading is deferred until processOptions so that options which
+            // affect how files are read apply regardless of where they appear,
+            // but missing files are still reported here. Command files can change
+            // the current directory while parsing, so remember the absolute path.
+            std::error_code ec;
+            fs::path path = fs::absolute(widen(fileName), ec);
+            if (ec)
+                path = widen(fileName);
+
+            if (!fs::exists(path, ec)) {
+                OS::printE(fg(diagClient->errorColor), "error: ");
+                OS::printE(fmt::format("no such file or directory: '{}'\n", fileName));
                 anyFailedLoads = true;
+                return "";
+            }
 
-            buffers.push_back(buffer);
+            pendingSources.emplace_back(std::string(fileName), std::move(path));
             return "";
         },
         "files", /* isFileName */ true);
@@ -241,8 +297,12 @@ void Driver::addStandardArgs() {
 }
 
 SourceBuffer Driver::readSource(std::string_view fileName) {
+    return readSource(widen(fileName), fileName);
+}
+
+SourceBuffer Driver::readSource(const fs::path& path, std::string_view fileName) {
     // TODO: handle library mapping
-    SourceBuffer buffer = sourceManager.readSource(widen(fileName), /* library */ nullptr);
+    SourceBuffer buffer = sourceManager.readSource(path, /* library */ nullptr);
     if (!buffer) {
         OS::printE(fg(diagClient->errorColor), "error: ");
         OS::printE(fmt::format("no such file or directory: '{}'\n", fileName));
@@ -355,6 +415,18 @@ bool Driver::processOptions() {
         }
     }
 
+    if (options.memoryMapFiles.has_value())
+        sourceManager.setMemoryMapFiles(*options.memoryMapFiles);
+
+    for (auto& [fileName, path] : pendingSources) {
+        SourceBuffer buffer = readSource(path, fileName);
+        if (!buffer)
+            anyFailedLoads = true;
+
+        buffers.push_back(buffer);
+    }
+    pendingSources.clear();
+
     if (anyFailedLoads)
         return false;
 
@@ -437,18 +509,17 @@ static std::string generateRandomAlphanumericString(TGenerator& gen, size_t len)
     return result;
 }
 
-bool Driver::runPreprocessor(bool includeComments, bool includeDirectives, bool obfuscateIds,
-                             bool useFixedObfuscationSeed) {
-    BumpAllocator alloc;
-    Diagnostics diagnostics;
-    Preprocessor preprocessor(sourceManager, alloc, diagnostics, createOptionBag());
-
-    for (auto it = buffers.rbegin(); it != buffers.rend(); it++)
-        preprocessor.pushSource(*it);
+// The preprocessed output is handed off in chunks of roughly this size as it's
+// produced, so that large designs never need to be held in memory all at once.
+static constexpr size_t PreprocessChunkSize = 256 * 1024;
 
-    SyntaxPrinter output;
-    output.setIncludeComments(includeComments);
-    output.setIncludeDirectives(includeDirectives);
+bool Driver::runPreprocessor(bool includeComments, bool includeDirectives, bool obfuscateIds,
+                             bool useFixedObfuscationSeed, std::string_view outputDir) {
+    // Printing the output needs all of the original whitespace and comments.
+    auto optionBag = createOptionBag();
+    auto loptions = optionBag.getOrDefault<LexerOptions>();
+    loptions.leanTrivia = false;
+    optionBag.set(loptions);
 
     std::optional<std::mt19937> rng;
     flat_hash_map<std::string, std::string> obfuscationMap;
@@ -460,32 +531,148 @@ bool Driver::runPreprocessor(bool includeComments, bool includeDirectives, bool
             rng = createRandomGenerator<std::mt19937>();
     }
 
-    while (true) {
-        Token token = preprocessor.next();
-        if (token.kind == TokenKind::IntegerBase) {
-            // This is needed for the case where obfuscation is enabled,
-            // the digits of a vector literal may be lexed initially as
-            // an identifier and we don't have the parser here to fix things
-            // up for us.
-            do {
-                output.print(token);
-                token = preprocessor.next();
-            } while (SyntaxFacts::isPossibleVectorDigit(token.kind));
+    // Preprocesses the given sources as one stream of tokens, passing the
+    // printed text along to the sink a chunk at a time.
+    auto preprocess = [&](std::span<const SourceBuffer> sources, Diagnostics& diagnostics,
+                          function_ref<void(std::string_view)> sink) {
+        BumpAllocator alloc;
+        Preprocessor preprocessor(sourceManager, alloc, diagnostics, optionBag);
+
+        for (auto it = sources.rbegin(); it != sources.rend(); it++)
+            preprocessor.pushSource(*it);
+
+        SyntaxPrinter output;
+        output.setIncludeComments(includeComments);
+        output.setIncludeDirectives(includeDirectives);
+
+        while (true) {
+            Token token = preprocessor.next();
+            if (token.kind == TokenKind::IntegerBase) {
+                // This is needed for the case where obfuscation is enabled,
+                // the digits of a vector literal may be lexed initially as
+                // an identifier and we don't have the parser here to fix things
+                // up for us.
+                do {
+                    output.print(token);
+                    token = preprocessor.next();
+                } while (SyntaxFacts::isPossibleVectorDigit(token.kind));
+            }
+
+            if (obfuscateIds && token.kind == TokenKind::Identifier) {
+                auto name = std::string(token.valueText());
+                auto translation = obfuscationMap.find(name);
+                if (translation == obfuscationMap.end()) {
+                    auto newName = generateRandomAlphanumericString(*rng, 16);
+                    translation = obfuscationMap.emplace(name, newName).first;
+                }
+                token = token.withRawText(alloc, translation->second);
+            }
+
+            output.print(token);
+            if (token.kind == TokenKind::EndOfFile)
+                break;
+
+            if (output.size() >= PreprocessChunkSize)
+                sink(output.take());
         }
 
-        if (obfuscateIds && token.kind == TokenKind::Identifier) {
-            auto name = std::string(token.valueText());
-            auto translation = obfuscationMap.find(name);
-            if (translation == obfuscationMap.end()) {
-                auto newName = generateRandomAlphanumericString(*rng, 16);
-                translation = obfuscationMap.emplace(name, newName).first;
+        sink(output.take());
+        sink("\n"sv);
+    };
+
+    bool ok = true;
+    Diagnostics diagnostics;
+    if (outputDir.empty()) {
+        preprocess(buffers, diagnostics, [](std::string_view text) { OS::print(text); });
+    }
+    else {
+        std::error_code ec;
+        fs::path dir = widen(outputDir);
+        fs::create_directories(dir, ec);
+        if (ec) {
+            OS::printE(fg(diagClient->errorColor), "error: ");
+            OS::printE(fmt::format("unable to create output directory '{}': {}\n", outputDir,
+                                   ec.message()));
+            return false;
+        }
+
+        // Each output file is named after its source file, with a numeric
+        // suffix added to keep files with the same name from colliding.
+        flat_hash_set<std::string> usedNames;
+        auto getOutputPath = [&](const SourceBuffer& buffer) {
+            auto fileName = sourceManager.getFullPath(buffer.id).filename();
+            auto result = fileName;
+            for (int i = 1; !usedNames.emplace(getU8Str(result)).second; i++) {
+                result = fileName.stem();
+                result += fmt::format("_{}", i);
+                result += fileName.extension();
+            }
+            return dir / result;
+        };
+
+        auto writeFile = [&](std::span<const SourceBuffer> sources, const fs::path& path,
+                             Diagnostics& diags) {
+            std::ofstream file(path, std::ios::binary);
+            preprocess(sources, diags, [&](std::string_view text) {
+                file.write(text.data(), std::streamsize(text.size()));
+            });
+
+            file.close();
+            return !file.fail();
+        };
+
+        auto reportWriteError = [&](const fs::path& path) {
+            OS::printE(fg(diagClient->errorColor), "error: ");
+            OS::printE(fmt::format("unable to write output file '{}'\n", getU8Str(path)));
+            ok = false;
+        };
+
+        if (options.singleUnit == true) {
+            // All files share macro state, so they have to be processed as a
+            // single stream, which goes to a file named after the first source.
+            if (!buffers.empty()) {
+                auto path = getOutputPath(buffers[0]);
+                if (!writeFile(buffers, path, diagnostics))
+                    reportWriteError(path);
             }
-            token = token.withRawText(alloc, translation->second);
         }
+        else {
+            std::vector<fs::path> paths;
+            for (auto& buffer : buffers)
+                paths.emplace_back(getOutputPath(buffer));
+
+            std::vector<Diagnostics> fileDiags(buffers.size());
+            std::vector<char> fileResults(buffers.size());
+            auto process = [&](size_t index) {
+                fileResults[index] = writeFile(std::span(&buffers[index], 1), paths[index],
+                                               fileDiags[index]);
+            };
+
+            // Files are independent of each other, so unless their identifiers
+            // have to be obfuscated consistently they can be processed in parallel.
+            if (buffers.size() > ParallelBufferThreshold && options.numThreads != 1u &&
+                !obfuscateIds) {
+                ThreadPool threadPool(options.numThreads.value_or(0u));
+                threadPool.pushLoop(
+                    size_t(0), buffers.size(),
+                    [&](size_t start, size_t end) {
+                        for (size_t i = start; i < end; i++)
+                            process(i);
+                    },
+                    buffers.size());
+                threadPool.waitForAll();
+            }
+            else {
+                for (size_t i = 0; i < buffers.size(); i++)
+                    process(i);
+            }
 
-        output.print(token);
-        if (token.kind == TokenKind::EndOfFile)
-            break;
+            for (size_t i = 0; i < buffers.size(); i++) {
+                if (!fileResults[i])
+                    reportWriteError(paths[i]);
+                diagnostics.append_range(fileDiags[i]);
+            }
+        }
     }
 
     // Only print diagnostics if actual errors occurred.
@@ -496,8 +683,7 @@ bool Driver::runPreprocessor(bool includeComments, bool includeDirectives, bool
         }
     }
 
-    OS::print(fmt::format("{}\n", output.str()));
-    return true;
+    return ok;
 }
 
 void Driver::reportMacros() {
@@ -533,16 +719,57 @@ void Driver::reportMacros() {
     }
 }
 
+void Driver::reportPreprocessorStats() {
+    IncludeStats includeStats;
+    MacroStats macroStats;
+    for (auto& tree : syntaxTrees) {
+        auto& meta = tree->getMetadata();
+        includeStats.numIncludes += meta.includeStats.numIncludes;
+        includeStats.numEntered += meta.includeStats.numEntered;
+        includeStats.numSkippedPragmaOnce += meta.includeStats.numSkippedPragmaOnce;
+        includeStats.numSkippedGuard += meta.includeStats.numSkippedGuard;
+        includeStats.numGuardsDetected += meta.includeStats.numGuardsDetected;
+        macroStats.numExpansions += meta.macroStats.numExpansions;
+        macroStats.numCacheHits += meta.macroStats.numCacheHits;
+        macroStats.numCacheInvalidations += meta.macroStats.numCacheInvalidations;
+    }
+
+    OS::print(fmt::format("includes: {} ({} entered, {} skipped by `pragma once, "
+                          "{} skipped by include guards, {} guards detected)\n",
+                          includeStats.numIncludes, includeStats.numEntered,
+                          includeStats.numSkippedPragmaOnce, includeStats.numSkippedGuard,
+                          includeStats.numGuardsDetected));
+    OS::print(fmt::format("macro expansions: {} ({} cache hits, {} cache invalidations)\n",
+                          macroStats.numExpansions, macroStats.numCacheHits,
+                          macroStats.numCacheInvalidations));
+}
+
 bool Driver::parseAllSources() {
     bool singleUnit = options.singleUnit == true;
     bool onlyLint = options.onlyLint == true;
 
+    // Share lexed tokens for commonly included files among all of the
+    // trees we're about to parse, which may be done in parallel.
     auto optionBag = createOptionBag();
+    auto ppoptions = optionBag.getOrDefault<PreprocessorOptions>();
+    ppoptions.tokenCache = std::make_shared<TokenCache>(sourceManager);
+    optionBag.set(ppoptions);
+
     if (singleUnit) {
-        auto tree = SyntaxTree::fromBuffers(buffers, sourceManager, optionBag);
+        std::shared_ptr<SyntaxTree> tree;
+        if (buffers.size() > ParallelBufferThreshold && options.numThreads != 1u) {
+            ThreadPool threadPool(options.numThreads.value_or(0u));
+            tree = SyntaxTree::fromBuffersInParallel(buffers, sourceManager, threadPool,
+                                                     optionBag);
+        }
+        else {
+            tree = SyntaxTree::fromBuffers(buffers, sourceManager, optionBag);
+        }
+
         if (onlyLint)
             tree->isLibrary = true;
 
+        definitionIndex.add(*tree);
         syntaxTrees.emplace_back(std::move(tree));
     }
     else {
@@ -551,12 +778,13 @@ bool Driver::parseAllSources() {
             if (onlyLint)
                 tree->isLibrary = true;
 
+            definitionIndex.add(*tree);
             return tree;
         };
 
         // If there are enough buffers to parse and the user hasn't disabled
         // the use of threads, do the parsing via a thread pool.
-        if (buffers.size() > 4 && options.numThreads != 1u) {
+        if (buffers.size() > ParallelBufferThreshold && options.numThreads != 1u) {
             ThreadPool threadPool(options.numThreads.value_or(0u));
 
             std::vector<std::future<std::shared_ptr<SyntaxTree>>> tasks;
@@ -578,6 +806,14 @@ bool Driver::parseAllSources() {
     if (options.librariesInheritMacros == true)
         inheritedMacros = syntaxTrees.back()->getDefinedMacros();
 
+    // Library files are mostly full of code that never gets used,
+    // so optionally skip over their subroutine bodies until needed.
+    if (options.deferLibraryBodies == true) {
+        auto poptions = optionBag.getOrDefault<ParserOptions>();
+        poptions.deferSubroutineBodies = true;
+        optionBag.set(poptions);
+    }
+
     bool ok = true;
     for (auto& file : options.libraryFiles) {
         SourceBuffer buffer = readSource(file);
@@ -588,9 +824,48 @@ bool Driver::parseAllSources() {
 
         auto tree = SyntaxTree::fromBuffer(buffer, sourceManager, optionBag, inheritedMacros);
         tree->isLibrary = true;
+        definitionIndex.add(*tree);
         syntaxTrees.emplace_back(std::move(tree));
     }
 
+    for (auto& file : options.packageImages) {
+        std::vector<char> data;
+        if (!OS::readFile(widen(file), data)) {
+            OS::printE(fg(diagClient->errorColor), "error: ");
+            OS::printE(fmt::format("no such file or directory: '{}'\n", file));
+            ok = false;
+            continue;
+        }
+
+        // readFile null terminates the data, which isn't part of the image.
+        data.pop_back();
+
+        auto result = PackageImage::load(std::string_view(data.data(), data.size()), file,
+                                         sourceManager, optionBag);
+        if (result.status != PackageImage::Status::Ok) {
+            OS::printE(fg(diagClient->errorColor), "error: ");
+            switch (result.status) {
+                case PackageImage::Status::VersionMismatch:
+                    OS::printE(fmt::format(
+                        "package image '{}' was written by a different version of slang\n", file));
+                    break;
+                case PackageImage::Status::OptionsMismatch:
+                    OS::printE(fmt::format(
+                        "package image '{}' was written with different options\n", file));
+                    break;
+                default:
+                    OS::printE(fmt::format("'{}' is not a valid package image\n", file));
+                    break;
+            }
+            ok = false;
+            continue;
+        }
+
+        definitionIndex.add(*result.tree);
+        packageImageDiags.emplace(result.tree.get(), std::move(result.diagnostics));
+        syntaxTrees.emplace_back(std::move(result.tree));
+    }
+
     if (!options.libDirs.empty()) {
         std::vector<fs::path> directories;
         directories.reserve(options.libDirs.size());
@@ -609,58 +884,9 @@ bool Driver::parseAllSources() {
 
         // If library directories are specified, see if we have any unknown instantiations
         // or package names for which we should search for additional source files to load.
-        flat_hash_set<std::string_view> knownNames;
-        auto addKnownNames = [&](const std::shared_ptr<SyntaxTree>& tree) {
-            auto& meta = tree->getMetadata();
-            for (auto& [n, _] : meta.nodeMap) {
-                auto decl = &n->as<ModuleDeclarationSyntax>();
-                std::string_view name = decl->header->name.valueText();
-                if (!name.empty())
-                    knownNames.emplace(name);
-            }
-
-            for (auto classDecl : meta.classDecls) {
-                std::string_view name = classDecl->name.valueText();
-                if (!name.empty())
-                    knownNames.emplace(name);
-            }
-        };
-
-        auto findMissingNames = [&](const std::shared_ptr<SyntaxTree>& tree,
-                                    flat_hash_set<std::string_view>& missing) {
-            auto& meta = tree->getMetadata();
-            for (auto name : meta.globalInstances) {
-                if (knownNames.find(name) == knownNames.end())
-                    missing.emplace(name);
-            }
-
-            for (auto idName : meta.classPackageNames) {
-                std::string_view name = idName->identifier.valueText();
-                if (!name.empty() && knownNames.find(name) == knownNames.end())
-                    missing.emplace(name);
-            }
-
-            for (auto importDecl : meta.packageImports) {
-                for (auto importItem : importDecl->items) {
-                    std::string_view name = importItem->package.valueText();
-                    if (!name.empty() && knownNames.find(name) == knownNames.end())
-                        missing.emplace(name);
-                }
-            }
-
-            for (auto intf : meta.interfacePorts) {
-                std::string_view name = intf->nameOrKeyword.valueText();
-                if (knownNames.find(name) == knownNames.end())
-                    missing.emplace(name);
-            }
-        };
-
-        for (auto& tree : syntaxTrees)
-            addKnownNames(tree);
-
         flat_hash_set<std::string_view> missingNames;
         for (auto& tree : syntaxTrees)
-            findMissingNames(tree, missingNames);
+            definitionIndex.findMissingNames(*tree, missingNames);
 
         // Keep loading new files as long as we are making forward progress.
         flat_hash_set<std::string_view> nextMissingNames;
@@ -691,8 +917,8 @@ bool Driver::parseAllSources() {
                     tree->isLibrary = true;
                     syntaxTrees.emplace_back(tree);
 
-                    addKnownNames(tree);
-                    findMissingNames(tree, nextMissingNames);
+                    definitionIndex.add(*tree);
+                    definitionIndex.findMissingNames(*tree, nextMissingNames);
                 }
             }
 
@@ -726,6 +952,8 @@ Bag Driver::createOptionBag() const {
     LexerOptions loptions;
     if (options.maxLexerErrors.has_value())
         loptions.maxErrors = *options.maxLexerErrors;
+    if (options.leanTrivia == true)
+        loptions.leanTrivia = true;
 
     ParserOptions poptions;
     if (options.maxParseDepth.has_value())
@@ -746,6 +974,8 @@ Bag Driver::createOptionBag() const {
         coptions.maxConstexprBacktrace = *options.maxConstexprBacktrace;
     if (options.maxInstanceArray.has_value())
         coptions.maxInstanceArray = *options.maxInstanceArray;
+    if (options.numThreads.has_value())
+        coptions.numThreads = *options.numThreads;
     if (options.errorLimit.has_value())
         coptions.errorLimit = *options.errorLimit * 2;
     if (options.onlyLint == true) {
@@ -760,6 +990,8 @@ Bag Driver::createOptionBag() const {
         coptions.relaxEnumConversions = true;
     if (options.strictDriverChecking == true)
         coptions.strictDriverChecking = true;
+    if (options.disableInstanceCaching == true)
+        coptions.disableInstanceCaching = true;
     if (options.ignoreUnknownModules == true)
         coptions.ignoreUnknownModules = true;
     if (options.allowUseBeforeDeclare == true)
@@ -769,6 +1001,8 @@ Bag Driver::createOptionBag() const {
         coptions.topModules.emplace(name);
     for (auto& opt : options.paramOverrides)
         coptions.paramOverrides.emplace_back(opt);
+    for (auto& path : options.elabScopes)
+        coptions.elabScopes.emplace_back(path);
 
     if (options.minTypMax.has_value()) {
         if (options.minTypMax == "min")
@@ -788,17 +1022,27 @@ Bag Driver::createOptionBag() const {
     bag.set(poptions);
     bag.set(coptions);
 
+    if (options.syntaxCacheDir.has_value())
+        bag.set(SyntaxTreeCacheOptions{*options.syntaxCacheDir});
+
     return bag;
 }
 
 std::unique_ptr<Compilation> Driver::createCompilation() const {
     auto compilation = std::make_unique<Compilation>(createOptionBag());
-    for (auto& tree : syntaxTrees)
-        compilation->addSyntaxTree(tree);
-
+    addSyntaxTrees(*compilation);
     return compilation;
 }
 
+void Driver::addSyntaxTrees(Compilation& compilation) const {
+    for (auto& tree : syntaxTrees) {
+        if (auto it = packageImageDiags.find(tree.get()); it != packageImageDiags.end())
+            compilation.addPrecompiledPackage(tree, it->second);
+        else
+            compilation.addSyntaxTree(tree);
+    }
+}
+
 bool Driver::reportParseDiags() {
     auto compilation = createCompilation();
     for (auto& diag : compilation->getParseDiagnostics())
@@ -845,4 +1089,46 @@ bool Driver::reportCompilation(Compilation& compilation, bool quiet) {
     return succeeded;
 }
 
+bool Driver::writePackageImages(Compilation& compilation) {
+    bool ok = true;
+    auto optionBag = createOptionBag();
+    for (auto& arg : options.writePackageImages) {
+        auto error = [&](std::string_view message) {
+            OS::printE(fg(diagClient->errorColor), "error: ");
+            OS::printE(fmt::format("{}\n", message));
+            ok = false;
+        };
+
+        auto index = arg.find('=');
+        if (index == std::string::npos || index == 0 || index == arg.size() - 1) {
+            error(fmt::format("invalid package image argument '{}', expected <name>=<filename>",
+                              arg));
+            continue;
+        }
+
+        auto name = std::string_view(arg).substr(0, index);
+        auto fileName = arg.substr(index + 1);
+        auto package = compilation.getPackage(name);
+        if (!package) {
+            error(fmt::format("unknown package '{}'", name));
+            continue;
+        }
+
+        auto image = PackageImage::save(compilation, *package, optionBag);
+        if (!image) {
+            error(fmt::format("cannot write an image of package '{}' because the design was "
+                              "not fully elaborated",
+                              name));
+            continue;
+        }
+
+        std::ofstream file(fs::path(widen(fileName)), std::ios::binary);
+        file.write(image->data(), std::streamsize(image->size()));
+        if (!file.flush())
+            error(fmt::format("unable to write package image '{}'", fileName));
+    }
+
+    return ok;
+}
+
 } // namespace slang::driver
@@ -125,13 +125,16 @@ SourceLoader::SyntaxTreeList SourceLoader::loadAndParseSources() {
     SyntaxTreeList syntaxTrees;
     std::span<const DefineDirectiveSyntax* const> inheritedMacros;
 
-    auto parseSingleUnit = [&](std::span<const SourceBuffer> buffers) {
+    auto parseSingleUnit = [&](std::span<const SourceBuffer> buffers, ThreadPool* threadPool) {
         // If we waited to parse direct buffers due to wanting a single unit, parse that unit now.
         if (!buffers.empty()) {
-            auto tree = SyntaxTree::fromBuffers(buffers, sourceManager, optionBag);
+            auto tree = threadPool ? SyntaxTree::fromBuffersInParallel(buffers, sourceManager,
+                                                                       *threadPool, optionBag)
+                                   : SyntaxTree::fromBuffers(buffers, sourceManager, optionBag);
             if (srcOptions.onlyLint)
                 tree->isLibrary = true;
 
+            definitionIndex.add(*tree);
             syntaxTrees.emplace_back(std::move(tree));
             inheritedMacros = syntaxTrees.back()->getDefinedMacros();
         }
@@ -173,7 +176,7 @@ SourceLoader::SyntaxTreeList SourceLoader::loadAndParseSources() {
         });
         threadPool.waitForAll();
 
-        parseSingleUnit(singleUnitBuffers);
+        parseSingleUnit(singleUnitBuffers, &threadPool);
 
         // If we deferred libraries due to wanting to inherit macros, parse them now.
         threadPool.pushLoop(size_t(0), deferredLibBuffers.size(), [&](size_t start, size_t end) {
@@ -184,6 +187,7 @@ SourceLoader::SyntaxTreeList SourceLoader::loadAndParseSources() {
                 auto tree = SyntaxTree::fromBuffer(deferredLibBuffers[i], sourceManager, optionBag,
                                                    inheritedMacros);
                 tree->isLibrary = true;
+                definitionIndex.add(*tree);
                 localTrees.emplace_back(std::move(tree));
             }
 
@@ -206,7 +210,7 @@ SourceLoader::SyntaxTreeList SourceLoader::loadAndParseSources() {
         for (auto& [path, isLibrary] : filePaths)
             loadSource(path, isLibrary, singleUnitBuffers, deferredLibBuffers, syntaxTrees);
 
-        parseSingleUnit(singleUnitBuffers);
+        parseSingleUnit(singleUnitBuffers, nullptr);
 
         // If we deferred libraries due to wanting to inherit macros, parse them now.
         if (!deferredLibBuffers.empty()) {
@@ -215,6 +219,7 @@ SourceLoader::SyntaxTreeList SourceLoader::loadAndParseSources() {
                 auto tree = SyntaxTree::fromBuffer(buffer, sourceManager, optionBag,
                                                    inheritedMacros);
                 tree->isLibrary = true;
+                definitionIndex.add(*tree);
                 syntaxTrees.emplace_back(std::move(tree));
             }
         }
@@ -223,58 +228,9 @@ SourceLoader::SyntaxTreeList SourceLoader::loadAndParseSources() {
     if (!searchDirectories.empty()) {
         // If library directories are specified, see if we have any unknown instantiations
         // or package names for which we should search for additional source files to load.
-        flat_hash_set<std::string_view> knownNames;
-        auto addKnownNames = [&](const std::shared_ptr<SyntaxTree>& tree) {
-            auto& meta = tree->getMetadata();
-            for (auto& [n, _] : meta.nodeMap) {
-                auto decl = &n->as<ModuleDeclarationSyntax>();
-                std::string_view name = decl->header->name.valueText();
-                if (!name.empty())
-                    knownNames.emplace(name);
-            }
-
-            for (auto classDecl : meta.classDecls) {
-                std::string_view name = classDecl->name.valueText();
-                if (!name.empty())
-                    knownNames.emplace(name);
-            }
-        };
-
-        auto findMissingNames = [&](const std::shared_ptr<SyntaxTree>& tree,
-                                    flat_hash_set<std::string_view>& missing) {
-            auto& meta = tree->getMetadata();
-            for (auto name : meta.globalInstances) {
-                if (knownNames.find(name) == knownNames.end())
-                    missing.emplace(name);
-            }
-
-            for (auto idName : meta.classPackageNames) {
-                std::string_view name = idName->identifier.valueText();
-                if (!name.empty() && knownNames.find(name) == knownNames.end())
-                    missing.emplace(name);
-            }
-
-            for (auto importDecl : meta.packageImports) {
-                for (auto importItem : importDecl->items) {
-                    std::string_view name = importItem->package.valueText();
-                    if (!name.empty() && knownNames.find(name) == knownNames.end())
-                        missing.emplace(name);
-                }
-            }
-
-            for (auto intf : meta.interfacePorts) {
-                std::string_view name = intf->nameOrKeyword.valueText();
-                if (knownNames.find(name) == knownNames.end())
-                    missing.emplace(name);
-            }
-        };
-
-        for (auto& tree : syntaxTrees)
-            addKnownNames(tree);
-
         flat_hash_set<std::string_view> missingNames;
         for (auto& tree : syntaxTrees)
-            findMissingNames(tree, missingNames);
+            definitionIndex.findMissingNames(*tree, missingNames);
 
         // Keep loading new files as long as we are making forward progress.
         flat_hash_set<std::string_view> nextMissingNames;
@@ -306,8 +262,8 @@ SourceLoader::SyntaxTreeList SourceLoader::loadAndParseSources() {
                     tree->isLibrary = true;
                     syntaxTrees.emplace_back(tree);
 
-                    addKnownNames(tree);
-                    findMissingNames(tree, nextMissingNames);
+                    definitionIndex.add(*tree);
+                    definitionIndex.findMissingNames(*tree, nextMissingNames);
                 }
             }
 
@@ -380,6 +336,7 @@ void SourceLoader::loadSource(const std::filesystem::path& path, bool isLibrary,
         if (isLibrary || srcOptions.onlyLint)
             tree->isLibrary = true;
 
+        definitionIndex.add(*tree);
         syntaxTrees.emplace_back(std::move(tree));
     }
 };
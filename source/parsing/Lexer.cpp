@@ -19,6 +19,8 @@
 #include "slang/util/ScopeGuard.h"
 #include "slang/util/String.h"
 
+#include "../text/CharScan.h"
+
 static_assert(std::numeric_limits<double>::is_iec559, "SystemVerilog requires IEEE 754");
 
 static const double BitsPerDecimal = log2(10.0);
@@ -35,6 +37,22 @@ Lexer::Lexer(SourceBuffer buffer, BumpAllocator& alloc, Diagnostics& diagnostics
     library = buffer.library;
 }
 
+Lexer::Lexer(SourceBuffer buffer, std::span<const Token> cachedTokens,
+             KeywordVersion keywordVersion, BumpAllocator& alloc, Diagnostics& diagnostics,
+             LexerOptions options) :
+    Lexer(buffer, alloc, diagnostics, options) {
+    SLANG_ASSERT(cachedTokens.empty() || cachedTokens.back().kind == TokenKind::EndOfFile);
+    this->cachedTokens = cachedTokens;
+    cachedKeywordVersion = keywordVersion;
+}
+
+Lexer::Lexer(SourceBuffer buffer, size_t startOffset, BumpAllocator& alloc,
+             Diagnostics& diagnostics, LexerOptions options) :
+    Lexer(buffer.id, buffer.data, buffer.data.data() + startOffset, alloc, diagnostics, options) {
+    SLANG_ASSERT(startOffset < buffer.data.size());
+    library = buffer.library;
+}
+
 Lexer::Lexer(BufferID bufferId, std::string_view source, const char* startPtr, BumpAllocator& alloc,
              Diagnostics& diagnostics, LexerOptions options) :
     alloc(alloc),
@@ -194,6 +212,12 @@ void Lexer::splitTokens(BumpAllocator& alloc, Diagnostics& diagnostics,
 }
 
 Token Lexer::lex(KeywordVersion keywordVersion) {
+    if (!cachedTokens.empty()) {
+        if (keywordVersion == cachedKeywordVersion)
+            return replayToken();
+        stopReplay();
+    }
+
     triviaBuffer.clear();
     lexTrivia<false>();
 
@@ -207,14 +231,201 @@ Token Lexer::lex(KeywordVersion keywordVersion) {
         sourceBuffer = sourceEnd - 1;
 
         triviaBuffer.push_back(Trivia(TriviaKind::DisabledText, lexeme()));
-        return Token(alloc, TokenKind::EndOfFile, triviaBuffer.copy(alloc), token.rawText(),
+        return Token(alloc, TokenKind::EndOfFile, triviaBuffer, token.rawText(),
                      token.location());
     }
 
     return token;
 }
 
+std::optional<std::string_view> Lexer::skipDisabledRegion(KeywordVersion keywordVersion) {
+    if (!cachedTokens.empty())
+        return std::nullopt;
+
+    // The skipped text stops at the end of the last token in the region; any trivia
+    // after that gets lexed again as part of the directive that ends the region,
+    // just as it would have been without skipping. This tracks where that point is
+    // so that we can back up to it, along with any diagnostics issued since.
+    struct Checkpoint {
+        const char* ptr;
+        uint32_t errorCount;
+        size_t numDiags;
+    };
+
+    auto save = [&] { return Checkpoint{sourceBuffer, errorCount, diagnostics.size()}; };
+    auto restore = [&](const Checkpoint& checkpoint) {
+        sourceBuffer = checkpoint.ptr;
+        errorCount = checkpoint.errorCount;
+        while (diagnostics.size() > checkpoint.numDiags)
+            diagnostics.pop_back();
+        triviaBuffer.clear();
+    };
+
+    // Steps over a string literal that has nothing in it worth diagnosing,
+    // returning false (without moving) if it needs to be lexed properly.
+    auto skipPlainString = [&] {
+        auto ptr = sourceBuffer + 1;
+        while (true) {
+            ptr = charscan::findStringLiteralSpecial(ptr, sourceEnd);
+            if (*ptr != '\\')
+                break;
+
+            switch (ptr[1]) {
+                case 'n':
+                case 't':
+                case 'v':
+                case 'f':
+                case 'a':
+                case '\\':
+                case '"':
+                case '\n':
+                    ptr += 2;
+                    break;
+                case '\r':
+                    ptr += ptr[2] == '\n' ? 3 : 2;
+                    break;
+                default:
+                    return false;
+            }
+        }
+
+        if (*ptr != '"')
+            return false;
+
+        sourceBuffer = ptr + 1;
+        return true;
+    };
+
+    const auto start = save();
+    auto lastToken = start;
+    while (true) {
+        // Once the error limit is hit the rest of the buffer gets
+        // skipped; let the normal lexing path take care of that.
+        if (errorCount > options.maxErrors) {
+            restore(start);
+            return std::nullopt;
+        }
+
+        mark();
+        bool handled = true;
+        char c = peek();
+        switch (c) {
+            case ' ':
+            case '\t':
+            case '\v':
+            case '\f':
+                sourceBuffer = charscan::skipWhitespace(sourceBuffer, sourceEnd);
+                continue;
+            case '\r':
+            case '\n':
+                advance();
+                continue;
+            case '/':
+                if (peek(1) == '/') {
+                    advance(2);
+                    scanLineComment();
+                    triviaBuffer.clear();
+                    continue;
+                }
+                if (peek(1) == '*') {
+                    advance(2);
+                    scanBlockComment();
+                    triviaBuffer.clear();
+                    continue;
+                }
+                advance();
+                break;
+            case '"':
+                handled = skipPlainString();
+                break;
+            case '!':
+            case '#':
+            case '%':
+            case '&':
+            case '(':
+            case ')':
+            case '*':
+            case '+':
+            case ',':
+            case '-':
+            case '.':
+            case ':':
+            case ';':
+            case '<':
+            case '=':
+            case '>':
+            case '?':
+            case '@':
+            case '[':
+            case ']':
+            case '^':
+            case '{':
+            case '|':
+            case '}':
+            case '~':
+                // Operators never produce diagnostics and can't contain
+                // the start of anything interesting, so just step over them.
+                advance();
+                break;
+            default:
+                if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '$') {
+                    advance();
+                    scanIdentifier();
+                }
+                else {
+                    handled = false;
+                }
+                break;
+        }
+
+        if (!handled) {
+            // Everything else (numbers, escapes, directives, strings with unusual
+            // contents, and any invalid characters) goes through the normal lexing
+            // path so that we find the same token boundaries and diagnostics.
+            triviaBuffer.clear();
+            Token token = lexToken(keywordVersion);
+            if (token.kind == TokenKind::EndOfFile) {
+                restore(start);
+                return std::nullopt;
+            }
+
+            if (token.kind == TokenKind::Directive) {
+                switch (token.directiveKind()) {
+                    case SyntaxKind::IfDefDirective:
+                    case SyntaxKind::IfNDefDirective:
+                    case SyntaxKind::ElsIfDirective:
+                    case SyntaxKind::ElseDirective:
+                    case SyntaxKind::EndIfDirective:
+                        restore(lastToken);
+                        return std::string_view(start.ptr, size_t(lastToken.ptr - start.ptr));
+                    default:
+                        break;
+                }
+            }
+        }
+        lastToken = save();
+    }
+}
+
 bool Lexer::isNextTokenOnSameLine() {
+    if (!cachedTokens.empty()) {
+        // Mirror the scan below using the trivia of the next cached token.
+        auto token = cachedTokens[cachedIndex];
+        for (auto& trivia : token.trivia()) {
+            switch (trivia.kind) {
+                case TriviaKind::Whitespace:
+                case TriviaKind::BlockComment:
+                    break;
+                case TriviaKind::EndOfLine:
+                case TriviaKind::LineComment:
+                    return false;
+                default:
+                    return true;
+            }
+        }
+        return token.kind != TokenKind::EndOfFile;
+    }
+
     auto guard = ScopeGuard([this, currBuff = sourceBuffer] { sourceBuffer = currBuff; });
 
     while (true) {
@@ -248,6 +459,9 @@ bool Lexer::isNextTokenOnSameLine() {
 }
 
 Token Lexer::lexEncodedText(ProtectEncoding encoding, uint32_t expectedBytes, bool singleLine) {
+    if (!cachedTokens.empty())
+        stopReplay();
+
     triviaBuffer.clear();
     lexTrivia<true>();
     mark();
@@ -255,6 +469,29 @@ Token Lexer::lexEncodedText(ProtectEncoding encoding, uint32_t expectedBytes, bo
     return create(TokenKind::Unknown);
 }
 
+Token Lexer::replayToken() {
+    // Cached tokens were lexed from the same text but possibly for a different
+    // buffer, so give them our own location. The final EndOfFile token is
+    // returned indefinitely, just like when lexing normally.
+    auto token = cachedTokens[cachedIndex];
+    if (token.kind != TokenKind::EndOfFile)
+        cachedIndex++;
+
+    return token.clone(alloc, token.trivia(), token.rawText(),
+                       SourceLocation(bufferId, token.location().offset()));
+}
+
+void Lexer::stopReplay() {
+    // Tokens are lexed contiguously, so the last replayed token ends right where
+    // we need to pick up lexing the source text. (The next token's leading trivia
+    // can't be used to find that spot since lean trivia doesn't match the source.)
+    if (cachedIndex > 0) {
+        auto token = cachedTokens[cachedIndex - 1];
+        sourceBuffer = originalBegin + token.location().offset() + token.rawText().length();
+    }
+    cachedTokens = {};
+}
+
 Token Lexer::lexToken(KeywordVersion keywordVersion) {
     char c = peek();
     advance();
@@ -536,10 +773,10 @@ Token Lexer::lexToken(KeywordVersion keywordVersion) {
             scanIdentifier();
 
             // might be a keyword
-            auto table = LF::getKeywordTable(keywordVersion);
-            SLANG_ASSERT(table);
-            if (auto it = table->find(lexeme()); it != table->end())
-                return create(it->second);
+            if (auto kind = LF::getKeywordKind(lexeme(), keywordVersion);
+                kind != TokenKind::Unknown) {
+                return create(kind);
+            }
 
             return create(TokenKind::Identifier);
         }
@@ -637,6 +874,14 @@ Token Lexer::lexStringLiteral() {
     stringBuffer.clear();
     bool sawUTF8Error = false;
     while (true) {
+        // Copy over runs of ordinary characters in bulk.
+        auto next = charscan::findStringLiteralSpecial(sourceBuffer, sourceEnd);
+        if (next != sourceBuffer) {
+            stringBuffer.append(sourceBuffer, next);
+            sourceBuffer = next;
+            sawUTF8Error = false;
+        }
+
         size_t offset = currentOffset();
         char c = peek();
 
@@ -1123,36 +1368,26 @@ void Lexer::lexTrivia() {
 }
 
 void Lexer::scanIdentifier() {
-    while (true) {
-        char c = peek();
-        if (isAlphaNumeric(c) || c == '_' || c == '$')
-            advance();
-        else
-            return;
-    }
+    // The buffer is always null terminated, so these scans are
+    // guaranteed to stop before running off the end.
+    sourceBuffer = charscan::skipIdentifier(sourceBuffer, sourceEnd);
 }
 
 void Lexer::scanWhitespace() {
-    bool done = false;
-    while (!done) {
-        switch (peek()) {
-            case ' ':
-            case '\t':
-            case '\v':
-            case '\f':
-                advance();
-                break;
-            default:
-                done = true;
-                break;
-        }
-    }
+    sourceBuffer = charscan::skipWhitespace(sourceBuffer, sourceEnd);
     addTrivia(TriviaKind::Whitespace);
 }
 
 void Lexer::scanLineComment() {
     bool sawUTF8Error = false;
     while (true) {
+        // Skip quickly over the plain ASCII text that makes up most comments.
+        auto next = charscan::findLineCommentSpecial(sourceBuffer, sourceEnd);
+        if (next != sourceBuffer) {
+            sourceBuffer = next;
+            sawUTF8Error = false;
+        }
+
         char c = peek();
         if (isASCII(c)) {
             if (isNewline(c))
@@ -1180,6 +1415,12 @@ void Lexer::scanLineComment() {
 void Lexer::scanBlockComment() {
     bool sawUTF8Error = false;
     while (true) {
+        auto next = charscan::findBlockCommentSpecial(sourceBuffer, sourceEnd);
+        if (next != sourceBuffer) {
+            sourceBuffer = next;
+            sawUTF8Error = false;
+        }
+
         char c = peek();
         if (isASCII(c)) {
             sawUTF8Error = false;
@@ -1409,8 +1650,59 @@ void Lexer::scanEncodedText(ProtectEncoding encoding, uint32_t expectedBytes, bo
 template<typename... Args>
 Token Lexer::create(TokenKind kind, Args&&... args) {
     SourceLocation location(bufferId, size_t(marker - originalBegin));
-    return Token(alloc, kind, triviaBuffer.copy(alloc), lexeme(), location,
-                 std::forward<Args>(args)...);
+    return Token(alloc, kind, getTrivia(), lexeme(), location, std::forward<Args>(args)...);
+}
+
+std::span<Trivia const> Lexer::getTrivia() {
+    if (!options.leanTrivia || triviaBuffer.empty())
+        return triviaBuffer;
+
+    // In lean mode a run of whitespace and comments collapses down to a single
+    // newline or space, which tokens can hold on to without storing anything.
+    // Newlines need to be kept so that the preprocessor can find the end of
+    // directives, and any whitespace at all needs to be kept so that macro
+    // pasting and stringification work the same way.
+    static const Trivia newlineTrivia(TriviaKind::EndOfLine, "\n"sv);
+    static const Trivia spaceTrivia(TriviaKind::Whitespace, " "sv);
+
+    bool sawNewline = false;
+    for (auto& trivia : triviaBuffer) {
+        switch (trivia.kind) {
+            case TriviaKind::Whitespace:
+                break;
+            case TriviaKind::EndOfLine:
+                sawNewline = true;
+                break;
+            case TriviaKind::LineComment:
+                // A line comment can end in a line continuation, which the
+                // preprocessor cares about; keep those as they are.
+                if (trivia.getRawText().ends_with('\\'))
+                    return triviaBuffer;
+                sawNewline = true;
+                break;
+            case TriviaKind::BlockComment:
+                if (trivia.getRawText().find_first_of("\r\n") != std::string_view::npos)
+                    sawNewline = true;
+                break;
+            default:
+                return triviaBuffer;
+        }
+    }
+
+    const Trivia* result = &newlineTrivia;
+    if (!sawNewline) {
+        // Whitespace that isn't a single space is kept so that stringified
+        // macro arguments come out with their original spacing.
+        if (triviaBuffer.size() == 1 && triviaBuffer[0].getRawText() != " "sv)
+            return triviaBuffer;
+        result = &spaceTrivia;
+    }
+
+    if (triviaBuffer.size() > 1 || triviaBuffer[0].kind != result->kind ||
+        triviaBuffer[0].getRawText() != result->getRawText()) {
+        triviaBytesSaved += triviaBuffer.size() * sizeof(Trivia);
+    }
+    return {result, 1};
 }
 
 void Lexer::addTrivia(TriviaKind kind) {
@@ -7,6 +7,9 @@
 //------------------------------------------------------------------------------
 #include "slang/parsing/LexerFacts.h"
 
+#include <algorithm>
+#include <array>
+
 #include "slang/parsing/TokenKind.h"
 #include "slang/syntax/SyntaxKind.h"
 
@@ -164,7 +167,6 @@ const static flat_hash_map<std::string_view, KeywordVersion> keywordVersionTable
     { "endgenerate", TokenKind::EndGenerateKeyword },\
     { "generate", TokenKind::GenerateKeyword },\
     { "genvar", TokenKind::GenVarKeyword },\
-    { "ifnone", TokenKind::IfNoneKeyword },\
     { "localparam", TokenKind::LocalParamKeyword },\
     { "noshowcancelled", TokenKind::NoShowCancelledKeyword },\
     { "pulsestyle_ondetect", TokenKind::PulseStyleOnDetectKeyword },\
@@ -318,55 +320,160 @@ const static flat_hash_map<std::string_view, KeywordVersion> keywordVersionTable
     { "nettype", TokenKind::NetTypeKeyword },\
     { "soft", TokenKind::SoftKeyword }
 
-// We maintain a separate table of keywords for all the various specifications,
-// to allow for easy switching between them when requested
-const static flat_hash_map<std::string_view, TokenKind> allKeywords[8] =
-{ { // IEEE 1364-1995
-    KEYWORDS_1364_1995
-}, { // IEEE 1364-2001-noconfig
-    KEYWORDS_1364_1995,
-    NEWKEYWORDS_1364_2001_noconfig
-}, { // IEEE 1364-2001
-    KEYWORDS_1364_1995,
-    NEWKEYWORDS_1364_2001_noconfig,
-    NEWKEYWORDS_1364_2001
-}, { // IEEE 1364-2005
-    KEYWORDS_1364_1995,
-    NEWKEYWORDS_1364_2001_noconfig,
-    NEWKEYWORDS_1364_2001,
-    NEWKEYWORDS_1364_2005
-}, { // IEEE 1800-2005
-    KEYWORDS_1364_1995,
-    NEWKEYWORDS_1364_2001_noconfig,
-    NEWKEYWORDS_1364_2001,
-    NEWKEYWORDS_1364_2005,
-    NEWKEYWORDS_1800_2005
-}, { // IEEE 1800-2009
-    KEYWORDS_1364_1995,
-    NEWKEYWORDS_1364_2001_noconfig,
-    NEWKEYWORDS_1364_2001,
-    NEWKEYWORDS_1364_2005,
-    NEWKEYWORDS_1800_2005,
-    NEWKEYWORDS_1800_2009
-}, { // IEEE 1800-2012
-    KEYWORDS_1364_1995,
-    NEWKEYWORDS_1364_2001_noconfig,
-    NEWKEYWORDS_1364_2001,
-    NEWKEYWORDS_1364_2005,
-    NEWKEYWORDS_1800_2005,
-    NEWKEYWORDS_1800_2009,
-    NEWKEYWORDS_1800_2012
-}, { // IEEE 1800-2017
-    KEYWORDS_1364_1995,
-    NEWKEYWORDS_1364_2001_noconfig,
-    NEWKEYWORDS_1364_2001,
-    NEWKEYWORDS_1364_2005,
-    NEWKEYWORDS_1800_2005,
-    NEWKEYWORDS_1800_2009,
-    NEWKEYWORDS_1800_2012
-} };
+using KeywordList = std::pair<std::string_view, TokenKind>[];
+constexpr KeywordList keywords1364_1995 = { KEYWORDS_1364_1995 };
+constexpr KeywordList newKeywords1364_2001_noconfig = { NEWKEYWORDS_1364_2001_noconfig };
+constexpr KeywordList newKeywords1364_2001 = { NEWKEYWORDS_1364_2001 };
+constexpr KeywordList newKeywords1364_2005 = { NEWKEYWORDS_1364_2005 };
+constexpr KeywordList newKeywords1800_2005 = { NEWKEYWORDS_1800_2005 };
+constexpr KeywordList newKeywords1800_2009 = { NEWKEYWORDS_1800_2009 };
+constexpr KeywordList newKeywords1800_2012 = { NEWKEYWORDS_1800_2012 };
 
 // clang-format on
+
+// Keywords are looked up for every identifier the lexer sees, so instead of
+// a hash map we use a perfect hash table that is built at compile time. Each
+// keyword version is a superset of the ones before it, so a single table that
+// records the version in which each keyword was introduced serves them all.
+//
+// The hash only looks at the length and a few characters of the text, which
+// is enough to tell all of the keywords apart. Keywords are first hashed into
+// buckets, and then each bucket is assigned a displacement that rehashes its
+// keywords into distinct slots of the final table ("hash and displace").
+class KeywordTable {
+public:
+    static constexpr size_t MaxKeywords = 256;
+    static constexpr size_t NumBuckets = 128;
+    static constexpr size_t NumSlots = 512;
+
+    template<size_t N>
+    constexpr void add(const std::pair<std::string_view, TokenKind> (&list)[N],
+                       KeywordVersion version) {
+        for (auto& [text, kind] : list) {
+            auto& entry = keywords[numKeywords++];
+            entry.text = text;
+            entry.kind = kind;
+            entry.version = version;
+
+            minLength = std::min(minLength, text.size());
+            maxLength = std::max(maxLength, text.size());
+        }
+    }
+
+    constexpr void build() {
+        // Place the buckets with the most keywords first, while the table is emptiest.
+        std::array<size_t, NumBuckets> bucketSizes{};
+        for (size_t i = 0; i < numKeywords; i++)
+            bucketSizes[hash(keywords[i].text) % NumBuckets]++;
+
+        std::array<size_t, NumBuckets> order{};
+        for (size_t i = 0; i < NumBuckets; i++)
+            order[i] = i;
+        std::ranges::sort(order, [&](size_t a, size_t b) {
+            return bucketSizes[a] > bucketSizes[b] || (bucketSizes[a] == bucketSizes[b] && a < b);
+        });
+
+        for (size_t bucket : order) {
+            if (!bucketSizes[bucket])
+                break;
+
+            uint32_t disp = 1;
+            while (!tryPlace(bucket, disp)) {
+                if (++disp == 1024)
+                    return;
+            }
+            displacements[bucket] = uint16_t(disp);
+        }
+        valid = true;
+    }
+
+    constexpr bool isValid() const { return valid; }
+
+    constexpr TokenKind find(std::string_view text, KeywordVersion version) const {
+        if (text.size() < minLength || text.size() > maxLength)
+            return TokenKind::Unknown;
+
+        // Almost all non-keywords are rejected here by the length check
+        // inside the string comparison.
+        uint32_t h = hash(text);
+        auto& entry = slots[slotFor(h, displacements[h % NumBuckets])];
+        if (entry.text != text || entry.version > version)
+            return TokenKind::Unknown;
+
+        return entry.kind;
+    }
+
+private:
+    struct Entry {
+        std::string_view text;
+        TokenKind kind = TokenKind::Unknown;
+        KeywordVersion version = KeywordVersion::v1364_1995;
+    };
+
+    static constexpr uint32_t hash(std::string_view text) {
+        uint32_t h = uint32_t(text.size());
+        for (char c : {text[0], text[1], text[text.size() / 2], text.back()})
+            h = (h ^ uint8_t(c)) * 0x01000193;
+        return h;
+    }
+
+    static constexpr size_t slotFor(uint32_t h, uint32_t disp) {
+        h ^= disp * 0x9e3779b1;
+        h ^= h >> 16;
+        h *= 0x85ebca6b;
+        h ^= h >> 13;
+        return h % NumSlots;
+    }
+
+    constexpr bool tryPlace(size_t bucket, uint32_t disp) {
+        std::array<size_t, MaxKeywords> placed{};
+        size_t numPlaced = 0;
+        for (size_t i = 0; i < numKeywords; i++) {
+            uint32_t h = hash(keywords[i].text);
+            if (h % NumBuckets != bucket)
+                continue;
+
+            size_t slot = slotFor(h, disp);
+            if (!slots[slot].text.empty()) {
+                for (size_t j = 0; j < numPlaced; j++)
+                    slots[placed[j]] = {};
+                return false;
+            }
+
+            slots[slot] = keywords[i];
+            placed[numPlaced++] = slot;
+        }
+        return true;
+    }
+
+    std::array<Entry, MaxKeywords> keywords{};
+    size_t numKeywords = 0;
+    size_t minLength = SIZE_MAX;
+    size_t maxLength = 0;
+
+    std::array<uint16_t, NumBuckets> displacements{};
+    std::array<Entry, NumSlots> slots{};
+    bool valid = false;
+};
+
+constexpr KeywordTable keywordTable = [] {
+    KeywordTable table;
+    table.add(keywords1364_1995, KeywordVersion::v1364_1995);
+    table.add(newKeywords1364_2001_noconfig, KeywordVersion::v1364_2001_noconfig);
+    table.add(newKeywords1364_2001, KeywordVersion::v1364_2001);
+    table.add(newKeywords1364_2005, KeywordVersion::v1364_2005);
+    table.add(newKeywords1800_2005, KeywordVersion::v1800_2005);
+    table.add(newKeywords1800_2009, KeywordVersion::v1800_2009);
+    table.add(newKeywords1800_2012, KeywordVersion::v1800_2012);
+
+    table.build();
+    return table;
+}();
+
+// If this fails then either a keyword was duplicated or the hash function
+// needs to look at another character to tell two keywords apart.
+static_assert(keywordTable.isValid(), "Failed to build perfect hash table for keywords");
+
 bool LexerFacts::isKeyword(TokenKind kind) {
     switch (kind) {
         case TokenKind::OneStep:
@@ -646,9 +753,8 @@ std::optional<KeywordVersion> LexerFacts::getKeywordVersion(std::string_view tex
     return std::nullopt;
 }
 
-const flat_hash_map<std::string_view, TokenKind>* LexerFacts::getKeywordTable(
-    KeywordVersion version) {
-    return &allKeywords[(uint8_t)version];
+TokenKind LexerFacts::getKeywordKind(std::string_view text, KeywordVersion version) {
+    return keywordTable.find(text, version);
 }
 
 // clang-format off
@@ -8,6 +8,7 @@
 #include "slang/parsing/Parser.h"
 
 #include "slang/diagnostics/ParserDiags.h"
+#include "slang/parsing/Preprocessor.h"
 
 namespace slang::parsing {
 
@@ -64,6 +65,9 @@ ParserMetadata&& Parser::getMetadata() {
     if (meta.eofToken.kind != TokenKind::EndOfFile && peek(TokenKind::EndOfFile))
         meta.eofToken = consume();
 
+    meta.includeStats = getPP().getIncludeStats();
+    meta.macroStats = getPP().getMacroStats();
+    meta.triviaBytesSaved = getPP().getTriviaBytesSaved();
     return std::move(meta);
 }
 
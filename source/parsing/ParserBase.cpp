@@ -25,7 +25,7 @@ void ParserBase::prependSkippedTokens(Token& token) {
     buffer.push_back(Trivia{TriviaKind::SkippedTokens, skippedTokens.copy(alloc)});
     buffer.append_range(token.trivia());
 
-    token = token.withTrivia(alloc, buffer.copy(alloc));
+    token = token.withTrivia(alloc, buffer);
     skippedTokens.clear();
 }
 
@@ -253,9 +253,22 @@ void ParserBase::Window::insertHead(std::span<const Token> tokens) {
     }
 
     size_t existing = count - currentOffset;
-    SLANG_ASSERT(tokens.size() + existing < capacity);
+    if (tokens.size() + existing >= capacity) {
+        // Large runs of tokens (such as deferred subroutine bodies)
+        // may not fit in the buffer, so grow it to make room.
+        while (tokens.size() + existing >= capacity)
+            capacity *= 2;
+
+        Token* newBuffer = new Token[capacity];
+        memcpy(newBuffer + tokens.size(), buffer + currentOffset, existing * sizeof(Token));
+
+        delete[] buffer;
+        buffer = newBuffer;
+    }
+    else {
+        memmove(buffer + tokens.size(), buffer + currentOffset, existing * sizeof(Token));
+    }
 
-    memmove(buffer + tokens.size(), buffer + currentOffset, existing * sizeof(Token));
     memcpy(buffer, tokens.data(), tokens.size() * sizeof(Token));
 
     currentOffset = 0;
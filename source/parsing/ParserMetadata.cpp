@@ -21,6 +21,17 @@ public:
 
     explicit MetadataVisitor(const SourceLibrary* library) : library(library) {}
 
+    // Walks a subtree of an edited tree, starting with the given state. If the
+    // subtree's @a root was inserted by the edit, @a rootParent is its parent.
+    MetadataVisitor(const ParserMetadata::Node& state,
+                    flat_hash_set<std::string_view> enclosingModuleNames,
+                    const SyntaxNode* root = nullptr, const SyntaxNode* rootParent = nullptr) :
+        library(state.library), defaultNetType(state.defaultNetType),
+        unconnectedDrive(state.unconnectedDrive), timeScale(state.timeScale), root(root),
+        rootParent(rootParent) {
+        moduleDeclStack.emplace_back(std::move(enclosingModuleNames));
+    }
+
     void handle(const CompilationUnitSyntax& syntax) {
         meta.eofToken = syntax.endOfFile;
         visitDefault(syntax);
@@ -82,7 +93,8 @@ public:
     }
 
     void handle(const ModuleDeclarationSyntax& syntax) {
-        if (syntax.parent && syntax.parent->kind != SyntaxKind::CompilationUnit) {
+        auto parent = &syntax == root ? rootParent : syntax.parent;
+        if (parent && parent->kind != SyntaxKind::CompilationUnit) {
             auto name = syntax.header->name.valueText();
             moduleDeclStack.back().emplace(name);
         }
@@ -147,8 +159,74 @@ private:
     TokenKind defaultNetType = TokenKind::Unknown;
     TokenKind unconnectedDrive = TokenKind::Unknown;
     std::optional<TimeScale> timeScale;
+    const SyntaxNode* root = nullptr;
+    const SyntaxNode* rootParent = nullptr;
 };
 
+// Gets the state to use for a node inserted by a shared edit, which is taken from the
+// closest module declaration before it (or around it). Unlike a full walk this doesn't
+// see any directives between that declaration and the inserted node.
+ParserMetadata::Node getInsertedState(
+    const SyntaxNode& inserted, const decltype(ParserMetadata::nodeMap)& nodeMap,
+    function_ref<const SyntaxNode*(const SyntaxNode&)> getParent, const SourceLibrary* library) {
+    for (auto node = &inserted; auto parent = getParent(*node); node = parent) {
+        const ParserMetadata::Node* closest = nullptr;
+        auto check = [&](const SyntaxNode* child) {
+            if (child == node)
+                return true;
+            if (auto it = nodeMap.find(child); it != nodeMap.end())
+                closest = &it->second;
+            return false;
+        };
+
+        bool found = false;
+        for (size_t i = 0; i < parent->getChildCount() && !found; i++) {
+            auto child = parent->childNode(i);
+            if (!child)
+                continue;
+
+            // Elements of a list have the list's owner as their parent.
+            if (SyntaxListBase::isKind(child->kind)) {
+                for (size_t j = 0; j < child->getChildCount() && !found; j++) {
+                    if (auto elem = child->childNode(j))
+                        found = check(elem);
+                }
+            }
+            else {
+                found = check(child);
+            }
+        }
+
+        if (closest)
+            return *closest;
+        if (auto it = nodeMap.find(parent); it != nodeMap.end())
+            return it->second;
+    }
+    return {library, TokenKind::Unknown, TokenKind::Unknown, std::nullopt};
+}
+
+// Gets the names of the modules declared in the scopes around the given node,
+// which instantiations beneath it refer to instead of global modules.
+flat_hash_set<std::string_view> getEnclosingModuleNames(
+    const SyntaxNode& node, function_ref<const SyntaxNode*(const SyntaxNode&)> getParent) {
+    flat_hash_set<std::string_view> result;
+    for (auto parent = getParent(node); parent; parent = getParent(*parent)) {
+        const SyntaxList<MemberSyntax>* members = nullptr;
+        if (ModuleDeclarationSyntax::isKind(parent->kind))
+            members = &parent->as<ModuleDeclarationSyntax>().members;
+        else if (parent->kind == SyntaxKind::GenerateBlock)
+            members = &parent->as<GenerateBlockSyntax>().members;
+        else
+            continue;
+
+        for (auto member : *members) {
+            if (ModuleDeclarationSyntax::isKind(member->kind))
+                result.emplace(member->as<ModuleDeclarationSyntax>().header->name.valueText());
+        }
+    }
+    return result;
+}
+
 } // namespace
 
 ParserMetadata ParserMetadata::fromSyntax(const SyntaxNode& root, const SourceLibrary* library) {
@@ -157,4 +235,103 @@ ParserMetadata ParserMetadata::fromSyntax(const SyntaxNode& root, const SourceLi
     return visitor.meta;
 }
 
+ParserMetadata ParserMetadata::fromSharedEdit(
+    const ParserMetadata& original, const SyntaxNode& root,
+    const flat_hash_map<const SyntaxNode*, SyntaxNode*>& rebuilt,
+    std::span<const SyntaxNode* const> removed, std::span<const SyntaxNode* const> inserted,
+    function_ref<const SyntaxNode*(const SyntaxNode&)> getParent, const SourceLibrary* library) {
+    // Anything found in the removed subtrees gets dropped from the original metadata.
+    MetadataVisitor removedVisitor({library, TokenKind::Unknown, TokenKind::Unknown, {}}, {});
+    for (auto node : removed)
+        node->visit(removedVisitor);
+
+    auto& removedMeta = removedVisitor.meta;
+    flat_hash_set<const SyntaxNode*> dropped;
+    for (auto& [node, _] : removedMeta.nodeMap)
+        dropped.emplace(node);
+    dropped.insert(removedMeta.classPackageNames.begin(), removedMeta.classPackageNames.end());
+    dropped.insert(removedMeta.packageImports.begin(), removedMeta.packageImports.end());
+    dropped.insert(removedMeta.classDecls.begin(), removedMeta.classDecls.end());
+    dropped.insert(removedMeta.interfacePorts.begin(), removedMeta.interfacePorts.end());
+
+    // Everything else carries over, pointing at the copies of any nodes that were rebuilt.
+    auto getNode = [&](const SyntaxNode* node) -> const SyntaxNode* {
+        if (auto it = rebuilt.find(node); it != rebuilt.end())
+            return it->second;
+        return node;
+    };
+
+    auto carryOver = [&]<typename T>(std::vector<const T*>& to,
+                                     const std::vector<const T*>& from) {
+        for (auto node : from) {
+            if (!dropped.contains(node))
+                to.push_back(&getNode(node)->template as<T>());
+        }
+    };
+
+    ParserMetadata result;
+    for (auto& [node, info] : original.nodeMap) {
+        if (!dropped.contains(node))
+            result.nodeMap.emplace(getNode(node), info);
+    }
+
+    for (auto& [node, tokens] : original.deferredBodies)
+        result.deferredBodies.emplace(&getNode(node)->as<FunctionDeclarationSyntax>(), tokens);
+
+    carryOver(result.classPackageNames, original.classPackageNames);
+    carryOver(result.packageImports, original.packageImports);
+    carryOver(result.classDecls, original.classDecls);
+    carryOver(result.interfacePorts, original.interfacePorts);
+
+    // Removing defparams or binds can't clear these without looking at the rest
+    // of the tree, but leaving them set only makes consumers more conservative.
+    result.globalInstances = original.globalInstances;
+    result.hasDefparams = original.hasDefparams;
+    result.hasBindDirectives = original.hasBindDirectives;
+
+    flat_hash_set<std::string_view> insertedInstances;
+    for (auto node : inserted) {
+        MetadataVisitor visitor(getInsertedState(*node, result.nodeMap, getParent, library),
+                                getEnclosingModuleNames(*node, getParent), node,
+                                getParent(*node));
+        node->visit(visitor);
+
+        auto& meta = visitor.meta;
+        for (auto& [child, info] : meta.nodeMap)
+            result.nodeMap.insert_or_assign(child, info);
+
+        insertedInstances.insert(meta.globalInstances.begin(), meta.globalInstances.end());
+        result.classPackageNames.insert(result.classPackageNames.end(),
+                                        meta.classPackageNames.begin(),
+                                        meta.classPackageNames.end());
+        result.packageImports.insert(result.packageImports.end(), meta.packageImports.begin(),
+                                     meta.packageImports.end());
+        result.classDecls.insert(result.classDecls.end(), meta.classDecls.begin(),
+                                 meta.classDecls.end());
+        result.interfacePorts.insert(result.interfacePorts.end(), meta.interfacePorts.begin(),
+                                     meta.interfacePorts.end());
+        result.hasDefparams |= meta.hasDefparams;
+        result.hasBindDirectives |= meta.hasBindDirectives;
+    }
+
+    // A removed instantiation might have been the last one of its module, which is
+    // then a top-level candidate again. Only a walk of the whole tree can tell.
+    bool removedInstances = std::ranges::any_of(removedMeta.globalInstances, [&](auto name) {
+        return !insertedInstances.contains(name);
+    });
+    if (removedInstances)
+        result.globalInstances = fromSyntax(root, library).globalInstances;
+    else
+        result.globalInstances.insert(insertedInstances.begin(), insertedInstances.end());
+
+    result.eofToken = original.eofToken;
+    if (root.kind == SyntaxKind::CompilationUnit)
+        result.eofToken = root.as<CompilationUnitSyntax>().endOfFile;
+
+    result.includeStats = original.includeStats;
+    result.macroStats = original.macroStats;
+    result.triviaBytesSaved = original.triviaBytesSaved;
+    return result;
+}
+
 } // namespace slang::parsing
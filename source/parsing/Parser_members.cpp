@@ -717,15 +717,111 @@ FunctionDeclarationSyntax& Parser::parseFunctionDeclaration(AttrList attributes,
                                              &isConstructor);
 
     auto semi = expect(TokenKind::Semicolon);
-    auto items = parseBlockItems(endKind, end, isConstructor);
+
+    // Subroutines without a port list can declare their ports in the body, which
+    // are needed as soon as the subroutine is created, so they can't be deferred.
+    std::span<SyntaxNode*> items;
+    std::span<Token> deferredTokens;
+    bool deferred = parseOptions.deferSubroutineBodies && prototype.portList &&
+                    !semi.isMissing() && skipDeferredBody(endKind, deferredTokens);
+    if (deferred)
+        end = consume();
+    else
+        items = parseBlockItems(endKind, end, isConstructor);
+
     auto endBlockName = parseNamedBlockClause();
 
     Token nameToken = prototype.name->getLastToken();
     if (nameToken.kind == TokenKind::Identifier || nameToken.kind == TokenKind::NewKeyword)
         checkBlockNames(nameToken, endBlockName);
 
-    return factory.functionDeclaration(functionKind, attributes, prototype, semi, items, end,
-                                       endBlockName);
+    auto& result = factory.functionDeclaration(functionKind, attributes, prototype, semi, items,
+                                               end, endBlockName);
+    if (deferred)
+        meta.deferredBodies.emplace(&result, deferredTokens);
+
+    return result;
+}
+
+bool Parser::skipDeferredBody(TokenKind endKind, std::span<Token>& tokens) {
+    // Look ahead for the end of the body, keeping track of nested blocks so that
+    // we can tell whether the body is well formed. If it isn't, the body gets
+    // parsed normally instead so that errors are reported as they usually would be.
+    uint32_t count = 0;
+    uint32_t depth = 0;
+    while (true) {
+        auto kind = peek(count).kind;
+        if (kind == endKind && depth == 0)
+            break;
+
+        switch (kind) {
+            case TokenKind::BeginKeyword:
+            case TokenKind::CaseKeyword:
+            case TokenKind::CaseXKeyword:
+            case TokenKind::CaseZKeyword:
+            case TokenKind::RandCaseKeyword:
+            case TokenKind::RandSequenceKeyword:
+                depth++;
+                break;
+            case TokenKind::ForkKeyword:
+                // 'wait fork' and 'disable fork' don't have a matching join.
+                if (count == 0 || (peek(count - 1).kind != TokenKind::WaitKeyword &&
+                                   peek(count - 1).kind != TokenKind::DisableKeyword)) {
+                    depth++;
+                }
+                break;
+            case TokenKind::EndKeyword:
+            case TokenKind::EndCaseKeyword:
+            case TokenKind::EndSequenceKeyword:
+            case TokenKind::JoinKeyword:
+            case TokenKind::JoinAnyKeyword:
+            case TokenKind::JoinNoneKeyword:
+                if (depth == 0)
+                    return false;
+                depth--;
+                break;
+            case TokenKind::EndOfFile:
+                return false;
+            default:
+                if (isEndKeyword(kind))
+                    return false;
+                break;
+        }
+        count++;
+    }
+
+    SmallVector<Token> buffer;
+    buffer.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+        buffer.push_back(consume());
+
+    // Names used with a scope operator are collected as possible package
+    // references even in skipped bodies, since they can cause library
+    // files to be loaded.
+    for (size_t i = 0; i + 1 < buffer.size(); i++) {
+        if (buffer[i].kind == TokenKind::Identifier &&
+            buffer[i + 1].kind == TokenKind::DoubleColon &&
+            (i == 0 || (buffer[i - 1].kind != TokenKind::DoubleColon &&
+                        buffer[i - 1].kind != TokenKind::Dot))) {
+            meta.classPackageNames.push_back(&factory.identifierName(buffer[i]));
+        }
+    }
+
+    tokens = buffer.copy(alloc);
+    return true;
+}
+
+std::span<SyntaxNode*> Parser::parseDeferredBody(const FunctionDeclarationSyntax& syntax,
+                                                 std::span<const Token> tokens) {
+    SmallVector<Token> buffer;
+    buffer.reserve(tokens.size() + 1);
+    buffer.append_range(tokens);
+    buffer.push_back(syntax.end);
+    pushTokens(buffer);
+
+    Token end;
+    bool isConstructor = syntax.prototype->name->getLastToken().kind == TokenKind::NewKeyword;
+    return parseBlockItems(syntax.end.kind, end, isConstructor);
 }
 
 GenvarDeclarationSyntax& Parser::parseGenvarDeclaration(AttrList attributes) {
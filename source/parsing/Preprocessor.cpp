@@ -8,6 +8,7 @@
 #include "slang/parsing/Preprocessor.h"
 
 #include "slang/diagnostics/PreprocessorDiags.h"
+#include "slang/parsing/TokenCache.h"
 #include "slang/syntax/AllSyntax.h"
 #include "slang/text/SourceManager.h"
 #include "slang/util/BumpAllocator.h"
@@ -31,6 +32,9 @@ Preprocessor::Preprocessor(SourceManager& sourceManager, BumpAllocator& alloc,
     resetAllDirectives();
     undefineAll();
 
+    if (options.tokenCache && &options.tokenCache->getSourceManager() == &sourceManager)
+        tokenCache = options.tokenCache.get();
+
     // Add in any inherited macros that aren't already set in our map.
     for (auto define : inheritedMacros) {
         auto name = define->name.valueText();
@@ -91,16 +95,84 @@ void Preprocessor::pushSource(std::string_view source, std::string_view name) {
         sourceManager.addLineDirective(SourceLocation(buffer.id, 0), 2, name, 0);
 }
 
-void Preprocessor::pushSource(SourceBuffer buffer) {
+void Preprocessor::pushSource(SourceBuffer buffer, size_t startOffset) {
     SLANG_ASSERT(buffer.id);
 
-    lexerStack.emplace_back(std::make_unique<Lexer>(buffer, alloc, diagnostics, lexerOptions));
+    lexerStack.emplace_back(
+        std::make_unique<Lexer>(buffer, startOffset, alloc, diagnostics, lexerOptions));
+    includeGuardStack.emplace_back(buffer);
+}
+
+void Preprocessor::pushIncludedSource(SourceBuffer buffer) {
+    // Files that get included often can have their tokens replayed
+    // from the shared cache instead of being lexed again.
+    std::span<const Token> cachedTokens;
+    if (tokenCache)
+        cachedTokens = tokenCache->get(buffer, keywordVersionStack.back(), lexerOptions);
+
+    if (cachedTokens.empty()) {
+        pushSource(buffer);
+        return;
+    }
+
+    lexerStack.emplace_back(std::make_unique<Lexer>(buffer, cachedTokens,
+                                                    keywordVersionStack.back(), alloc,
+                                                    diagnostics, lexerOptions));
+    includeGuardStack.emplace_back(buffer);
 }
 
 void Preprocessor::popSource() {
     if (includeDepth)
         includeDepth--;
+    triviaBytesSaved += lexerStack.back()->getTriviaBytesSaved();
     lexerStack.pop_back();
+    includeGuardStack.pop_back();
+
+    // At the end of all input, note the final state of the directives
+    // that carry over into the next file.
+    if (lexerStack.empty() && dependencies) {
+        auto& changes = dependencies->changes;
+        changes.timeScale = activeTimeScale;
+        changes.defaultNetType = defaultNetType;
+        changes.unconnectedDrive = unconnectedDrive;
+
+        if (!branchStack.empty() || keywordVersionStack.size() > 1 || protectEncryptDepth ||
+            protectDecryptDepth) {
+            dependencies->unbalanced = true;
+        }
+    }
+}
+
+void Preprocessor::trackIncludeGuard(Token token) {
+    auto& guard = includeGuardStack.back();
+    if (token.kind == TokenKind::EndOfFile) {
+        // If the guard's `endif was the last thing in the file we can
+        // remember it for future includes.
+        if (guard.state == IncludeGuardState::Closed &&
+            includeGuards.emplace(guard.bufferStart, guard.macroName).second) {
+            includeStats.numGuardsDetected++;
+            if (dependencies)
+                dependencies->changes.includeGuards.emplace(guard.bufferStart, guard.macroName);
+        }
+        return;
+    }
+
+    switch (guard.state) {
+        case IncludeGuardState::Start:
+            if (token.kind == TokenKind::Directive &&
+                token.directiveKind() == SyntaxKind::IfNDefDirective) {
+                guard.state = IncludeGuardState::Opening;
+            }
+            else {
+                guard.state = IncludeGuardState::Invalid;
+            }
+            break;
+        case IncludeGuardState::Closed:
+            guard.state = IncludeGuardState::Invalid;
+            break;
+        default:
+            break;
+    }
 }
 
 void Preprocessor::predefine(const std::string& definition, std::string_view name) {
@@ -125,6 +197,7 @@ bool Preprocessor::undefine(std::string_view name) {
     auto it = macros.find(name);
     if (it != macros.end() && !it->second.isIntrinsic()) {
         macros.erase(it);
+        invalidateCachedExpansion(name);
         return true;
     }
     return false;
@@ -132,6 +205,7 @@ bool Preprocessor::undefine(std::string_view name) {
 
 void Preprocessor::undefineAll() {
     macros.clear();
+    expansionCache.clear();
     macros["__FILE__"] = MacroIntrinsic::File;
     macros["__LINE__"] = MacroIntrinsic::Line;
 
@@ -173,6 +247,7 @@ void Preprocessor::undefineAll() {
 }
 
 bool Preprocessor::isDefined(std::string_view name) {
+    noteMacroUse(name);
     return !name.empty() && macros.find(name) != macros.end();
 }
 
@@ -191,6 +266,129 @@ const SourceLibrary* Preprocessor::getCurrentLibrary() const {
     return lexerStack.empty() ? nullptr : lexerStack.back()->getLibrary();
 }
 
+PreprocessorState Preprocessor::getState() const {
+    PreprocessorState state;
+    for (auto& [name, def] : macros) {
+        if (def.syntax && !def.builtIn)
+            state.macros.emplace(name, def.syntax);
+    }
+
+    state.includeGuards = includeGuards;
+    state.includeOnceHeaders = includeOnceHeaders;
+    state.timeScale = activeTimeScale;
+    state.defaultNetType = defaultNetType;
+    state.unconnectedDrive = unconnectedDrive;
+    return state;
+}
+
+void Preprocessor::setState(const PreprocessorState& state) {
+    // Built-in macros can't be changed by source code, so keep our own.
+    flat_hash_map<std::string_view, MacroDef> newMacros;
+    for (auto& [name, def] : macros) {
+        if (def.builtIn)
+            newMacros.emplace(name, def);
+    }
+
+    for (auto& [name, syntax] : state.macros)
+        newMacros.emplace(name, syntax);
+
+    macros = std::move(newMacros);
+    expansionCache.clear();
+    includeGuards = state.includeGuards;
+    includeOnceHeaders = state.includeOnceHeaders;
+    activeTimeScale = state.timeScale;
+    defaultNetType = state.defaultNetType;
+    unconnectedDrive = state.unconnectedDrive;
+}
+
+void Preprocessor::noteMacroUse(std::string_view name) {
+    // Once a file has changed a macro (or all of them), later lookups of it
+    // no longer depend on the state the file started with.
+    if (dependencies && !dependencies->undefinedAll &&
+        !dependencies->changes.macros.contains(name)) {
+        dependencies->usedMacros.emplace(name);
+    }
+}
+
+void Preprocessor::noteMacroChange(std::string_view name, const DefineDirectiveSyntax* syntax) {
+    if (dependencies)
+        dependencies->changes.macros[name] = syntax;
+}
+
+void PreprocessorState::apply(const PreprocessorDependencies& dependencies) {
+    auto& changes = dependencies.changes;
+    if (dependencies.undefinedAll)
+        macros.clear();
+
+    for (auto& [name, syntax] : changes.macros) {
+        if (syntax)
+            macros[name] = syntax;
+        else
+            macros.erase(name);
+    }
+
+    includeGuards.insert(changes.includeGuards.begin(), changes.includeGuards.end());
+    includeOnceHeaders.insert(changes.includeOnceHeaders.begin(), changes.includeOnceHeaders.end());
+    timeScale = changes.timeScale;
+    defaultNetType = changes.defaultNetType;
+    unconnectedDrive = changes.unconnectedDrive;
+}
+
+void PreprocessorDependencies::applyDirectives(SourceManager& sourceManager) const {
+    for (auto& directive : lineDirectives) {
+        sourceManager.addLineDirective(directive.location, directive.lineNum, directive.name,
+                                       directive.level);
+    }
+
+    for (auto& directive : diagDirectives)
+        sourceManager.addDiagnosticDirective(directive.location, directive.name, directive.severity);
+}
+
+bool PreprocessorDependencies::isSatisfiedBy(const PreprocessorState& assumed,
+                                             const PreprocessorState& actual) const {
+    if (assumed.timeScale != actual.timeScale || assumed.defaultNetType != actual.defaultNetType ||
+        assumed.unconnectedDrive != actual.unconnectedDrive) {
+        return false;
+    }
+
+    // Macros need to be the very same definitions, not just the same text,
+    // since expanded tokens refer back to the location of their definition.
+    auto findMacro = [](const PreprocessorState& state, std::string_view name) {
+        auto it = state.macros.find(name);
+        return it == state.macros.end() ? nullptr : it->second;
+    };
+
+    for (auto name : usedMacros) {
+        if (findMacro(assumed, name) != findMacro(actual, name))
+            return false;
+    }
+
+    // Whether an include gets skipped depends on what's known about the file.
+    auto findGuard = [](const PreprocessorState& state,
+                        const char* file) -> std::optional<std::string_view> {
+        auto it = state.includeGuards.find(file);
+        if (it == state.includeGuards.end())
+            return std::nullopt;
+        return it->second;
+    };
+
+    for (auto file : usedHeaders) {
+        if (assumed.includeOnceHeaders.contains(file) != actual.includeOnceHeaders.contains(file) ||
+            findGuard(assumed, file) != findGuard(actual, file)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+size_t Preprocessor::getTriviaBytesSaved() const {
+    size_t result = triviaBytesSaved;
+    for (auto& lexer : lexerStack)
+        result += lexer->getTriviaBytesSaved();
+    return result;
+}
+
 std::vector<const DefineDirectiveSyntax*> Preprocessor::getDefinedMacros() const {
     std::vector<const DefineDirectiveSyntax*> results;
     for (auto& [name, def] : macros) {
@@ -331,7 +529,7 @@ Token Preprocessor::handleDirectives(Token token) {
                 break;
             default:
                 trivia.append_range(token.trivia());
-                return token.withTrivia(alloc, trivia.copy(alloc));
+                return token.withTrivia(alloc, trivia);
         }
 
         token = nextRaw();
@@ -361,6 +559,7 @@ Token Preprocessor::nextRaw() {
     // This is the common case.
     auto& source = lexerStack.back();
     auto token = source->lex(keywordVersionStack.back());
+    trackIncludeGuard(token);
     if (token.kind != TokenKind::EndOfFile)
         return token;
 
@@ -384,6 +583,7 @@ Token Preprocessor::nextRaw() {
     while (true) {
         auto& nextSource = lexerStack.back();
         token = nextSource->lex(keywordVersionStack.back());
+        trackIncludeGuard(token);
         appendTrivia(token);
         if (token.kind != TokenKind::EndOfFile)
             break;
@@ -394,7 +594,7 @@ Token Preprocessor::nextRaw() {
     }
 
     // finally found a real token to return, so update trivia and get out of here
-    return token.withTrivia(alloc, trivia.copy(alloc));
+    return token.withTrivia(alloc, trivia);
 }
 
 Trivia Preprocessor::handleIncludeDirective(Token directive) {
@@ -417,7 +617,7 @@ Trivia Preprocessor::handleIncludeDirective(Token directive) {
                     SmallVector<Trivia, 4> trivia;
                     trivia.push_back(Trivia(TriviaKind::SkippedTokens, tokens.copy(alloc)));
                     trivia.append_range(fileName.trivia());
-                    fileName = fileName.withTrivia(alloc, trivia.copy(alloc));
+                    fileName = fileName.withTrivia(alloc, trivia);
                 }
                 break;
             }
@@ -472,9 +672,25 @@ Trivia Preprocessor::handleIncludeDirective(Token directive) {
         else if (includeDepth >= options.maxIncludeDepth) {
             addDiag(diag::ExceededMaxIncludeDepth, fileName.range());
         }
-        else if (includeOnceHeaders.find(buffer.data.data()) == includeOnceHeaders.end()) {
-            includeDepth++;
-            pushSource(buffer);
+        else {
+            includeStats.numIncludes++;
+            if (dependencies)
+                dependencies->usedHeaders.emplace(buffer.data.data());
+
+            if (includeOnceHeaders.contains(buffer.data.data())) {
+                includeStats.numSkippedPragmaOnce++;
+            }
+            else if (auto it = includeGuards.find(buffer.data.data());
+                     it != includeGuards.end() && isDefined(it->second)) {
+                // The file is guarded by a macro that is still defined, so
+                // including it again would produce nothing; skip it entirely.
+                includeStats.numSkippedGuard++;
+            }
+            else {
+                includeStats.numEntered++;
+                includeDepth++;
+                pushIncludedSource(buffer);
+            }
         }
     }
 
@@ -590,6 +806,7 @@ Trivia Preprocessor::handleDefineDirective(Token directive) {
     auto result = alloc.emplace<DefineDirectiveSyntax>(directive, name, formalArguments,
                                                        scratchTokenBuffer.copy(alloc));
 
+    noteMacroUse(name.valueText());
     if (auto it = macros.find(name.valueText()); it != macros.end()) {
         if (it->second.builtIn) {
             addDiag(diag::InvalidMacroName, name.range());
@@ -602,8 +819,11 @@ Trivia Preprocessor::handleDefineDirective(Token directive) {
         }
     }
 
-    if (!bad)
+    if (!bad) {
         macros[name.valueText()] = result;
+        noteMacroChange(name.valueText(), result);
+        invalidateCachedExpansion(name.valueText());
+    }
     return Trivia(TriviaKind::Directive, result);
 }
 
@@ -623,11 +843,23 @@ Trivia Preprocessor::handleIfDefDirective(Token directive, bool inverted) {
     bool take = false;
     if (branchStack.empty() || branchStack.back().currentActive) {
         // decide whether the branch is taken or skipped
+        noteMacroUse(name.valueText());
         take = macros.find(name.valueText()) != macros.end();
         if (inverted)
             take = !take;
     }
 
+    if (auto guard = getIncludeGuard(); guard && guard->state == IncludeGuardState::Opening) {
+        if (inverted && !name.isMissing() && guard->buffer == directive.location().buffer()) {
+            guard->state = IncludeGuardState::Open;
+            guard->macroName = name.valueText();
+            guard->branchDepth = branchStack.size();
+        }
+        else {
+            guard->state = IncludeGuardState::Invalid;
+        }
+    }
+
     branchStack.emplace_back(BranchEntry(take));
 
     return parseBranchDirective(directive, name, take);
@@ -647,6 +879,14 @@ Trivia Preprocessor::handleElseDirective(Token directive) {
 
 bool Preprocessor::shouldTakeElseBranch(SourceLocation location, bool isElseIf,
                                         std::string_view macroName) {
+    // An `else or `elsif attached to an include guard means that the file
+    // isn't actually guarded, since including it again could produce output.
+    auto guard = getIncludeGuard();
+    if (guard && guard->state == IncludeGuardState::Open &&
+        branchStack.size() == guard->branchDepth + 1) {
+        guard->state = IncludeGuardState::Invalid;
+    }
+
     // empty stack is an error
     if (branchStack.empty()) {
         addDiag(diag::UnexpectedConditionalDirective, location);
@@ -666,6 +906,8 @@ bool Preprocessor::shouldTakeElseBranch(SourceLocation location, bool isElseIf,
         // only take this branch if we're the only one in the stack, or our parent is active
         if (branchStack.size() == 1 || branchStack[branchStack.size() - 2].currentActive) {
             // if this is an elseif, the macro name needs to be defined
+            if (isElseIf)
+                noteMacroUse(macroName);
             taken = !isElseIf || macros.find(macroName) != macros.end();
         }
     }
@@ -679,9 +921,26 @@ bool Preprocessor::shouldTakeElseBranch(SourceLocation location, bool isElseIf,
 Trivia Preprocessor::parseBranchDirective(Token directive, Token condition, bool taken) {
     scratchTokenBuffer.clear();
     if (!taken) {
+        // If we're reading straight from a source file we can usually skip over the
+        // raw text of the whole region at once, without creating tokens. None of it
+        // needs anything else from us, not even include guard tracking, since the
+        // region starts after a directive.
+        std::optional<std::string_view> disabledText;
+        if (!currentToken && !currentMacroToken && !lexerStack.empty())
+            disabledText = lexerStack.back()->skipDisabledRegion(keywordVersionStack.back());
+
         // skip over everything until we find another conditional compilation directive
         while (true) {
             auto token = nextRaw();
+            if (disabledText) {
+                if (!disabledText->empty()) {
+                    SmallVector<Trivia, 8> trivia;
+                    trivia.push_back(Trivia(TriviaKind::DisabledText, *disabledText));
+                    trivia.append_range(token.trivia());
+                    token = token.withTrivia(alloc, trivia);
+                }
+                disabledText.reset();
+            }
 
             // EoF or conditional directive stops the skipping process
             bool done = false;
@@ -735,6 +994,13 @@ Trivia Preprocessor::handleEndIfDirective(Token directive) {
         branchStack.pop_back();
         if (!branchStack.empty() && !branchStack.back().currentActive)
             taken = false;
+
+        auto guard = getIncludeGuard();
+        if (guard && guard->state == IncludeGuardState::Open &&
+            branchStack.size() == guard->branchDepth &&
+            guard->buffer == directive.location().buffer()) {
+            guard->state = IncludeGuardState::Closed;
+        }
     }
     return parseBranchDirective(directive, Token(), taken);
 }
@@ -826,8 +1092,14 @@ Trivia Preprocessor::handleLineDirective(Token directive) {
         else if (lineNum) {
             // We should only notify the source manager about the line directive if it
             // is well formed, to avoid very strange line number issues.
-            sourceManager.addLineDirective(directive.location(), *lineNum, fileName.valueText(),
-                                           *levNum);
+            if (dependencies) {
+                dependencies->lineDirectives.push_back(
+                    {directive.location(), *lineNum, fileName.valueText(), *levNum});
+            }
+            else {
+                sourceManager.addLineDirective(directive.location(), *lineNum,
+                                               fileName.valueText(), *levNum);
+            }
         }
     }
     return Trivia(TriviaKind::Directive, result);
@@ -876,12 +1148,17 @@ Trivia Preprocessor::handleUndefDirective(Token directive) {
 
     if (!nameToken.isMissing()) {
         std::string_view name = nameToken.valueText();
+        noteMacroUse(name);
         auto it = macros.find(name);
         if (it != macros.end()) {
-            if (!it->second.builtIn)
+            if (!it->second.builtIn) {
                 macros.erase(it);
-            else
+                noteMacroChange(name, nullptr);
+                invalidateCachedExpansion(name);
+            }
+            else {
                 addDiag(diag::UndefineBuiltinDirective, nameToken.range());
+            }
         }
     }
 
@@ -891,6 +1168,13 @@ Trivia Preprocessor::handleUndefDirective(Token directive) {
 
 Trivia Preprocessor::handleUndefineAllDirective(Token directive) {
     undefineAll();
+
+    // Everything defined from here on (including any predefines
+    // that were just recreated) is a change to the starting state.
+    if (dependencies) {
+        dependencies->undefinedAll = true;
+        dependencies->changes.macros = getState().macros;
+    }
     return createSimpleDirective(directive);
 }
 
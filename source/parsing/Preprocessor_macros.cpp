@@ -24,6 +24,7 @@ Preprocessor::MacroDef Preprocessor::findMacro(Token directive) {
     if (!name.empty() && name[0] == '\\')
         name = name.substr(1);
 
+    noteMacroUse(name);
     auto it = macros.find(name);
     if (it == macros.end())
         return nullptr;
@@ -91,6 +92,10 @@ std::pair<MacroActualArgumentListSyntax*, Trivia> Preprocessor::handleTopLevelMa
             return {nullptr, Trivia()};
     }
 
+    macroStats.numExpansions++;
+    if (!actualArgs && expandCachedMacro(macro, directive))
+        return {nullptr, Trivia()};
+
     // Expand out the macro
     SmallVector<Token, 32> buffer;
     MacroExpansion expansion{sourceManager, alloc, buffer, directive, true};
@@ -124,6 +129,9 @@ std::pair<MacroActualArgumentListSyntax*, Trivia> Preprocessor::handleTopLevelMa
         tokens = expandedTokens;
     }
 
+    if (!actualArgs)
+        cacheMacroExpansion(macro);
+
     // if the macro expanded into any tokens at all, set the pointer
     // so that we'll pull from them next
     if (!expandedTokens.empty())
@@ -132,6 +140,81 @@ std::pair<MacroActualArgumentListSyntax*, Trivia> Preprocessor::handleTopLevelMa
     return {actualArgs, Trivia()};
 }
 
+bool Preprocessor::expandCachedMacro(MacroDef macro, Token directive) {
+    if (macro.isIntrinsic())
+        return false;
+
+    auto it = expansionCache.find(macro.syntax->name.valueText());
+    if (it == expansionCache.end() || it->second.syntax != macro.syntax ||
+        !it->second.cacheable) {
+        return false;
+    }
+
+    // The expansion itself can be reused as-is; each usage just needs its
+    // own expansion location for the tokens to point at.
+    SourceRange range(directive.location(), directive.location() + directive.rawText().length());
+    SourceLocation expansionLoc = sourceManager.createExpansionLoc(macro.syntax->body[0].location(),
+                                                                   range,
+                                                                   macro.syntax->name.valueText());
+
+    expandedTokens.clear();
+    for (auto token : it->second.tokens)
+        expandedTokens.push_back(
+            token.withLocation(alloc, expansionLoc + token.location().offset()));
+
+    if (!expandedTokens.empty())
+        currentMacroToken = expandedTokens.begin();
+
+    macroStats.numCacheHits++;
+    return true;
+}
+
+void Preprocessor::cacheMacroExpansion(MacroDef macro) {
+    if (macro.isIntrinsic())
+        return;
+
+    auto name = macro.syntax->name.valueText();
+    auto [it, inserted] = expansionCache.try_emplace(name);
+    if (!inserted && it->second.syntax == macro.syntax)
+        return;
+
+    // A macro always expands to the same tokens if its body can't refer to any
+    // other macros (which might be redefined later) and doesn't need any token
+    // stringification or concatenation performed.
+    auto& entry = it->second;
+    entry.syntax = macro.syntax;
+    entry.cacheable = !macro.syntax->body.empty();
+    for (auto token : macro.syntax->body) {
+        switch (token.kind) {
+            case TokenKind::Directive:
+            case TokenKind::MacroQuote:
+            case TokenKind::MacroEscapedQuote:
+            case TokenKind::MacroPaste:
+                entry.cacheable = false;
+                break;
+            default:
+                break;
+        }
+    }
+
+    // All of the expanded tokens must point into the single expansion buffer
+    // created for this usage, or we won't be able to move them to a new one.
+    for (auto token : expandedTokens) {
+        if (token.location().buffer() != expandedTokens[0].location().buffer())
+            entry.cacheable = false;
+    }
+
+    entry.tokens = entry.cacheable ? expandedTokens.copy(alloc) : std::span<const Token>();
+}
+
+void Preprocessor::invalidateCachedExpansion(std::string_view name) {
+    if (auto it = expansionCache.find(name); it != expansionCache.end()) {
+        if (it->second.cacheable)
+            macroStats.numCacheInvalidations++;
+        expansionCache.erase(it);
+    }
+}
+
 bool Preprocessor::applyMacroOps(std::span<Token const> tokens, SmallVectorBase<Token>& dest) {
     SmallVector<Trivia, 8> emptyArgTrivia;
     SmallVector<Token, 8> stringifyBuffer;
@@ -266,7 +349,7 @@ bool Preprocessor::applyMacroOps(std::span<Token const> tokens, SmallVectorBase<
 
         if (!emptyArgTrivia.empty()) {
             emptyArgTrivia.append_range(newToken.trivia());
-            newToken = newToken.withTrivia(alloc, emptyArgTrivia.copy(alloc));
+            newToken = newToken.withTrivia(alloc, emptyArgTrivia);
             emptyArgTrivia.clear();
         }
 
@@ -536,7 +619,7 @@ bool Preprocessor::expandMacro(MacroDef macro, MacroExpansion& expansion,
                     triviaBuf.emplace_back(TriviaKind::Whitespace, " "sv);
 
                     auto loc = splits.back().location() + splits.back().rawText().length();
-                    Token empty(alloc, TokenKind::EmptyMacroArgument, triviaBuf.copy(alloc), ""sv,
+                    Token empty(alloc, TokenKind::EmptyMacroArgument, triviaBuf, ""sv,
                                 loc);
 
                     if (!handleToken(empty))
@@ -596,7 +679,7 @@ void Preprocessor::MacroExpansion::append(Token token, SourceLocation location,
         newTrivia.push_back(Trivia(TriviaKind::EndOfLine, token.rawText().substr(1)));
 
         dest.push_back(
-            Token(alloc, TokenKind::EmptyMacroArgument, newTrivia.copy(alloc), "", location));
+            Token(alloc, TokenKind::EmptyMacroArgument, newTrivia, "", location));
     }
     else {
         dest.push_back(token.withLocation(alloc, location));
@@ -667,6 +750,11 @@ bool Preprocessor::expandReplacementList(
 }
 
 bool Preprocessor::expandIntrinsic(MacroIntrinsic intrinsic, MacroExpansion& expansion) {
+    // The file and line we report here would miss any `line directives that are
+    // being held back, so such results can't be reused as-is.
+    if (dependencies && !dependencies->lineDirectives.empty())
+        dependencies->unbalanced = true;
+
     auto loc = expansion.getRange().start();
     SmallVector<char> text;
     switch (intrinsic) {
@@ -237,8 +237,11 @@ void Preprocessor::applyOncePragma(const PragmaDirectiveSyntax& pragma) {
     ensurePragmaArgs(pragma, 0);
 
     auto text = sourceManager.getSourceText(pragma.directive.location().buffer());
-    if (!text.empty())
+    if (!text.empty()) {
         includeOnceHeaders.emplace(text.data());
+        if (dependencies)
+            dependencies->changes.includeOnceHeaders.emplace(text.data());
+    }
 }
 
 void Preprocessor::applyDiagnosticPragma(const PragmaDirectiveSyntax& pragma) {
@@ -253,12 +256,12 @@ void Preprocessor::applyDiagnosticPragma(const PragmaDirectiveSyntax& pragma) {
             auto& simple = arg->as<SimplePragmaExpressionSyntax>();
             std::string_view action = simple.value.rawText();
             if (simple.value.kind == TokenKind::Identifier && action == "push") {
-                sourceManager.addDiagnosticDirective(simple.value.location(), "__push__",
-                                                     DiagnosticSeverity::Ignored);
+                addDiagnosticDirective(simple.value.location(), "__push__",
+                                       DiagnosticSeverity::Ignored);
             }
             else if (simple.value.kind == TokenKind::Identifier && action == "pop") {
-                sourceManager.addDiagnosticDirective(simple.value.location(), "__pop__",
-                                                     DiagnosticSeverity::Ignored);
+                addDiagnosticDirective(simple.value.location(), "__pop__",
+                                       DiagnosticSeverity::Ignored);
             }
             else {
                 addDiag(diag::UnknownDiagPragmaArg, simple.value.range()) << action;
@@ -286,8 +289,8 @@ void Preprocessor::applyDiagnosticPragma(const PragmaDirectiveSyntax& pragma) {
                 if (expr.kind == SyntaxKind::SimplePragmaExpression) {
                     auto& simple = expr.as<SimplePragmaExpressionSyntax>();
                     if (simple.value.kind == TokenKind::StringLiteral) {
-                        sourceManager.addDiagnosticDirective(simple.value.location(),
-                                                             simple.value.valueText(), severity);
+                        addDiagnosticDirective(simple.value.location(),
+                                               simple.value.valueText(), severity);
                     }
                     else {
                         addDiag(diag::ExpectedDiagPragmaArg, simple.value.range());
@@ -313,6 +316,14 @@ void Preprocessor::applyDiagnosticPragma(const PragmaDirectiveSyntax& pragma) {
     }
 }
 
+void Preprocessor::addDiagnosticDirective(SourceLocation location, std::string_view name,
+                                          DiagnosticSeverity severity) {
+    if (dependencies)
+        dependencies->diagDirectives.push_back({location, name, severity});
+    else
+        sourceManager.addDiagnosticDirective(location, name, severity);
+}
+
 void Preprocessor::ensurePragmaArgs(const PragmaDirectiveSyntax& pragma, size_t count) {
     if (pragma.args.size() > count) {
         auto& diag = addDiag(diag::ExtraPragmaArgs, pragma.args[count]->getFirstToken().location());
@@ -183,7 +183,8 @@ Trivia Trivia::clone(BumpAllocator& alloc) const {
 }
 
 Token::Token() :
-    kind(TokenKind::Unknown), missing(false), triviaCountSmall(0), reserved(0), numFlags() {
+    kind(TokenKind::Unknown), missing(false), triviaCountSmall(0), implicitTrivia(0), reserved(0),
+    numFlags() {
 }
 
 Token::Token(BumpAllocator& alloc, TokenKind kind, std::span<Trivia const> trivia,
@@ -305,21 +306,26 @@ SourceLocation Token::location() const {
     return info->location;
 }
 
+static const Trivia ImplicitTrivia[] = {Trivia(), Trivia(TriviaKind::Whitespace, " "sv),
+                                         Trivia(TriviaKind::EndOfLine, "\n"sv)};
+
 std::span<Trivia const> Token::trivia() const {
-    if (triviaCountSmall == 0)
+    if (triviaCountSmall == 0) {
+        if (implicitTrivia)
+            return {&ImplicitTrivia[implicitTrivia], 1};
         return {};
+    }
 
-    const Trivia* trivia;
     byte* ptr = info->extra() + getExtraSize(kind);
-    memcpy(&trivia, ptr, sizeof(trivia));
-
     if (triviaCountSmall == MaxTriviaSmallCount + 1) {
+        const Trivia* trivia;
         size_t size;
+        memcpy(&trivia, ptr, sizeof(trivia));
         memcpy(&size, ptr + sizeof(trivia), sizeof(size_t));
         return {trivia, size};
     }
 
-    return {trivia, triviaCountSmall};
+    return {reinterpret_cast<const Trivia*>(ptr), triviaCountSmall};
 }
 
 std::string Token::toString() const {
@@ -386,6 +392,11 @@ Token Token::withLocation(BumpAllocator& alloc, SourceLocation location) const {
     return clone(alloc, trivia(), rawText(), location);
 }
 
+void Token::setLocation(SourceLocation location) {
+    SLANG_ASSERT(info);
+    info->location = location;
+}
+
 Token Token::withRawText(BumpAllocator& alloc, std::string_view rawText) const {
     return clone(alloc, trivia(), rawText, location());
 }
@@ -411,7 +422,7 @@ Token Token::deepClone(BumpAllocator& alloc) const {
     SmallVector<Trivia> triviaBuffer(trivia().size(), UninitializedTag());
     for (const auto& t : trivia())
         triviaBuffer.push_back(t.clone(alloc));
-    return clone(alloc, triviaBuffer.copy(alloc), rawText(), location());
+    return clone(alloc, triviaBuffer, rawText(), location());
 }
 
 void Token::init(BumpAllocator& alloc, TokenKind kind_, std::span<Trivia const> trivia,
@@ -419,6 +430,7 @@ void Token::init(BumpAllocator& alloc, TokenKind kind_, std::span<Trivia const>
     kind = kind_;
     missing = false;
     triviaCountSmall = 0;
+    implicitTrivia = getImplicitTrivia(trivia);
     reserved = 0;
     numFlags.raw = 0;
     rawLen = uint32_t(rawText.size());
@@ -427,13 +439,13 @@ void Token::init(BumpAllocator& alloc, TokenKind kind_, std::span<Trivia const>
     SLANG_ASSERT(extra % alignof(void*) == 0);
 
     size_t size = sizeof(Info) + extra;
-    if (!trivia.empty()) {
-        size += sizeof(Trivia*);
+    if (!trivia.empty() && !implicitTrivia) {
         if (trivia.size() > MaxTriviaSmallCount) {
-            size += sizeof(size_t);
+            size += sizeof(Trivia*) + sizeof(size_t);
             triviaCountSmall = MaxTriviaSmallCount + 1;
         }
         else {
+            size += trivia.size() * sizeof(Trivia);
             triviaCountSmall = uint8_t(trivia.size());
         }
     }
@@ -442,18 +454,33 @@ void Token::init(BumpAllocator& alloc, TokenKind kind_, std::span<Trivia const>
     info->location = location;
     info->rawTextPtr = rawText.data();
 
-    if (!trivia.empty()) {
-        const Trivia* triviaPtr = trivia.data();
-        byte* dest = info->extra() + extra;
+    // The trivia is always copied, so callers are free to pass in temporary storage.
+    byte* dest = info->extra() + extra;
+    if (triviaCountSmall == MaxTriviaSmallCount + 1) {
+        auto triviaPtr = (Trivia*)alloc.allocate(trivia.size() * sizeof(Trivia), alignof(Trivia));
+        memcpy(triviaPtr, trivia.data(), trivia.size() * sizeof(Trivia));
         memcpy(dest, &triviaPtr, sizeof(triviaPtr));
 
-        if (trivia.size() > MaxTriviaSmallCount) {
-            size = trivia.size();
-            memcpy(dest + sizeof(triviaPtr), &size, sizeof(size_t));
-        }
+        size = trivia.size();
+        memcpy(dest + sizeof(triviaPtr), &size, sizeof(size_t));
+    }
+    else if (triviaCountSmall) {
+        memcpy(dest, trivia.data(), trivia.size() * sizeof(Trivia));
     }
 }
 
+uint8_t Token::getImplicitTrivia(std::span<Trivia const> trivia) {
+    if (trivia.size() != 1 || trivia[0].hasFullLocation)
+        return 0;
+
+    auto& t = trivia[0];
+    if (t.kind == TriviaKind::Whitespace && t.getRawText() == " "sv)
+        return 1;
+    if (t.kind == TriviaKind::EndOfLine && t.getRawText() == "\n"sv)
+        return 2;
+    return 0;
+}
+
 Token Token::createMissing(BumpAllocator& alloc, TokenKind kind, SourceLocation location) {
     Token result;
     switch (kind) {
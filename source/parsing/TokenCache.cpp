@@ -0,0 +1,69 @@
+//------------------------------------------------------------------------------
+// TokenCache.cpp
+// Thread-safe cache of lexed tokens for commonly included files
+//
+// SPDX-FileCopyrightText: Michael Popoloski
+// SPDX-License-Identifier: MIT
+//------------------------------------------------------------------------------
+#include "slang/parsing/TokenCache.h"
+
+#include <mutex>
+
+namespace slang::parsing {
+
+TokenCache::TokenCache(const SourceManager& sourceManager) : sourceManager(sourceManager) {
+}
+
+std::span<const Token> TokenCache::get(const SourceBuffer& buffer, KeywordVersion keywordVersion,
+                                       const LexerOptions& options) {
+    Key key{buffer.data.data(), keywordVersion, options.maxErrors, options.leanTrivia};
+    {
+        std::shared_lock lock(mutex);
+        if (auto it = entries.find(key); it != entries.end() && it->second.state == State::Cached)
+            return it->second.tokens;
+    }
+
+    {
+        // The first time we see a buffer just note that fact and have the caller
+        // lex it normally; most files are only ever included once and there's
+        // no sense in paying to store their tokens.
+        std::unique_lock lock(mutex);
+        auto [it, inserted] = entries.try_emplace(key);
+        auto& entry = it->second;
+        if (inserted || entry.state != State::Seen)
+            return entry.tokens;
+
+        entry.state = State::Lexing;
+    }
+
+    // Lex the buffer without holding the lock so that other threads can continue
+    // to use the cache. Anyone else that wants this buffer in the meantime will
+    // just lex it themselves.
+    auto alloc = std::make_unique<BumpAllocator>();
+    Diagnostics diagnostics;
+    Lexer lexer(buffer, *alloc, diagnostics, options);
+
+    SmallVector<Token> tokens;
+    while (true) {
+        auto token = lexer.lex(keywordVersion);
+        tokens.push_back(token);
+        if (token.kind == TokenKind::EndOfFile)
+            break;
+    }
+
+    std::unique_lock lock(mutex);
+    auto& entry = entries[key];
+    if (!diagnostics.empty()) {
+        // Lexer errors need to be reported in each tree that includes the file,
+        // so don't try to cache it.
+        entry.state = State::Uncacheable;
+        return {};
+    }
+
+    entry.tokens = tokens.copy(*alloc);
+    entry.alloc = std::move(alloc);
+    entry.state = State::Cached;
+    return entry.tokens;
+}
+
+} // namespace slang::parsing
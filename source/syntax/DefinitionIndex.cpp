@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------------
+// DefinitionIndex.cpp
+// Thread-safe index of the definitions declared in syntax trees
+//
+// SPDX-FileCopyrightText: Michael Popoloski
+// SPDX-License-Identifier: MIT
+//------------------------------------------------------------------------------
+#include "slang/syntax/DefinitionIndex.h"
+
+#include <mutex>
+
+#include "slang/syntax/AllSyntax.h"
+#include "slang/syntax/SyntaxTree.h"
+#include "slang/util/SmallVector.h"
+
+namespace slang::syntax {
+
+void DefinitionIndex::add(const SyntaxTree& tree) {
+    // Gather everything up front so that the lock is held only briefly.
+    SmallVector<std::pair<std::string_view, const SyntaxNode*>> names;
+    auto& meta = tree.getMetadata();
+    for (auto& [node, _] : meta.nodeMap) {
+        auto name = node->as<ModuleDeclarationSyntax>().header->name.valueText();
+        if (!name.empty())
+            names.emplace_back(name, node);
+    }
+
+    for (auto classDecl : meta.classDecls) {
+        auto name = classDecl->name.valueText();
+        if (!name.empty())
+            names.emplace_back(name, classDecl);
+    }
+
+    if (names.empty())
+        return;
+
+    std::unique_lock lock(mutex);
+    for (auto [name, node] : names)
+        entries[name].push_back({node, &tree});
+}
+
+bool DefinitionIndex::contains(std::string_view name) const {
+    std::shared_lock lock(mutex);
+    return entries.contains(name);
+}
+
+std::vector<DefinitionIndex::Entry> DefinitionIndex::find(std::string_view name) const {
+    std::shared_lock lock(mutex);
+    if (auto it = entries.find(name); it != entries.end())
+        return it->second;
+    return {};
+}
+
+size_t DefinitionIndex::size() const {
+    std::shared_lock lock(mutex);
+    return entries.size();
+}
+
+void DefinitionIndex::findMissingNames(const SyntaxTree& tree,
+                                       flat_hash_set<std::string_view>& results) const {
+    std::shared_lock lock(mutex);
+    auto check = [&](std::string_view name) {
+        if (!name.empty() && !entries.contains(name))
+            results.emplace(name);
+    };
+
+    auto& meta = tree.getMetadata();
+    for (auto name : meta.globalInstances)
+        check(name);
+
+    for (auto idName : meta.classPackageNames)
+        check(idName->identifier.valueText());
+
+    for (auto importDecl : meta.packageImports) {
+        for (auto importItem : importDecl->items)
+            check(importItem->package.valueText());
+    }
+
+    for (auto intf : meta.interfacePorts)
+        check(intf->nameOrKeyword.valueText());
+}
+
+} // namespace slang::syntax
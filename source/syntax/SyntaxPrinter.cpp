@@ -10,6 +10,7 @@
 #include "slang/parsing/ParserMetadata.h"
 #include "slang/syntax/SyntaxNode.h"
 #include "slang/syntax/SyntaxTree.h"
+#include "slang/text/CharInfo.h"
 #include "slang/text/SourceManager.h"
 
 namespace slang::syntax {
@@ -25,8 +26,12 @@ SyntaxPrinter& SyntaxPrinter::print(Trivia trivia) {
             if (includeDirectives)
                 print(*trivia.syntax());
             else if (includePreprocessed) {
-                for (const auto& t : trivia.syntax()->getFirstToken().trivia())
-                    print(t);
+                // Text from a disabled region that ended at this directive
+                // is just as excluded as the directive itself.
+                for (const auto& t : trivia.syntax()->getFirstToken().trivia()) {
+                    if (t.kind != TriviaKind::DisabledText)
+                        print(t);
+                }
             }
             break;
         case TriviaKind::SkippedSyntax:
@@ -45,6 +50,11 @@ SyntaxPrinter& SyntaxPrinter::print(Trivia trivia) {
                 break;
             [[fallthrough]];
         default:
+            if (trivia.kind == TriviaKind::DisabledText && (squashNewlines || !includeComments)) {
+                appendDisabledText(trivia.getRawText());
+                break;
+            }
+
             append(trivia.getRawText());
             break;
     }
@@ -103,12 +113,91 @@ SyntaxPrinter& SyntaxPrinter::print(const SyntaxNode& node) {
 }
 
 SyntaxPrinter& SyntaxPrinter::print(const SyntaxTree& tree) {
-    print(tree.root());
+    if (tree.canPrintUnchangedFromSource() && printsExactSourceText())
+        printFromSource(tree.root(), tree, false);
+    else
+        print(tree.root());
+
     if (tree.root().kind != SyntaxKind::CompilationUnit && tree.getMetadata().eofToken)
         print(tree.getMetadata().eofToken);
     return *this;
 }
 
+bool SyntaxPrinter::printsExactSourceText() const {
+    // Unchanged syntax only prints back out as its original source
+    // text with the same settings that printFile uses.
+    return sourceManager && includeTrivia && !includeMissing && includeSkipped &&
+           includeDirectives && !includePreprocessed && includeComments && !squashNewlines;
+}
+
+void SyntaxPrinter::printFromSource(const SyntaxNode& node, const SyntaxTree& tree,
+                                    bool knownUnchanged) {
+    auto editKind = knownUnchanged ? SyntaxEditKind::Unchanged : tree.getEditKind(node);
+    if (editKind == SyntaxEditKind::Inserted) {
+        print(node);
+        return;
+    }
+
+    bool unchanged = editKind == SyntaxEditKind::Unchanged;
+    if (unchanged) {
+        if (auto text = getSourceText(node)) {
+            append(*text);
+            return;
+        }
+    }
+
+    size_t childCount = node.getChildCount();
+    for (size_t i = 0; i < childCount; i++) {
+        if (auto childNode = node.childNode(i); childNode)
+            printFromSource(*childNode, tree, unchanged);
+        else if (auto token = node.childToken(i); token)
+            print(token);
+    }
+}
+
+std::optional<std::string_view> SyntaxPrinter::getSourceText(const SyntaxNode& node) const {
+    // The node's text is a single contiguous range of its source buffer if its first
+    // and last tokens come directly from that buffer (not from a macro or an include)
+    // and the first token's leading trivia is all plain text.
+    Token first = node.getFirstToken();
+    Token last = node.getLastToken();
+    if (!first || !last || first.isMissing() || last.isMissing())
+        return std::nullopt;
+
+    auto startLoc = first.location();
+    auto endLoc = last.location();
+    if (startLoc.buffer() != endLoc.buffer() || sourceManager->isPreprocessedLoc(startLoc) ||
+        sourceManager->isPreprocessedLoc(endLoc)) {
+        return std::nullopt;
+    }
+
+    size_t triviaLength = 0;
+    for (const auto& trivia : first.trivia()) {
+        switch (trivia.kind) {
+            case TriviaKind::Whitespace:
+            case TriviaKind::EndOfLine:
+            case TriviaKind::LineComment:
+            case TriviaKind::BlockComment:
+                triviaLength += trivia.getRawText().length();
+                break;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    auto text = sourceManager->getSourceText(startLoc.buffer());
+    size_t start = startLoc.offset();
+    size_t end = endLoc.offset() + last.rawText().length();
+    if (triviaLength > start || start > end || end > text.length() ||
+        text.substr(start, first.rawText().length()) != first.rawText() ||
+        text.substr(endLoc.offset(), last.rawText().length()) != last.rawText()) {
+        return std::nullopt;
+    }
+
+    start -= triviaLength;
+    return text.substr(start, end - start);
+}
+
 std::string SyntaxPrinter::printFile(const SyntaxTree& tree) {
     return SyntaxPrinter(tree.sourceManager())
         .setIncludeDirectives(true)
@@ -120,6 +209,92 @@ std::string SyntaxPrinter::printFile(const SyntaxTree& tree) {
         .str();
 }
 
+std::string SyntaxPrinter::take() {
+    if (!buffer.empty())
+        lastTaken = buffer.back();
+    return std::exchange(buffer, {});
+}
+
+void SyntaxPrinter::appendDisabledText(std::string_view text) {
+    // The text of a disabled region is skipped over without being split up into
+    // tokens and trivia, so find the newlines and comments that would have been
+    // trivia of their own in order to squash or exclude them in the same way.
+    size_t pending = 0;
+    auto flush = [&](size_t end) {
+        if (end > pending)
+            append(text.substr(pending, end - pending));
+    };
+
+    auto newlineLength = [&](size_t i) -> size_t {
+        if (i >= text.length() || !isNewline(text[i]))
+            return 0;
+        return text[i] == '\r' && i + 1 < text.length() && text[i + 1] == '\n' ? 2 : 1;
+    };
+
+    size_t i = 0;
+    while (i < text.length()) {
+        size_t end = i + 1;
+        switch (text[i]) {
+            case '\r':
+            case '\n':
+                flush(i);
+                end = i + newlineLength(i);
+                append(text.substr(i, end - i));
+                pending = end;
+                break;
+            case '/':
+                if (end < text.length() && (text[end] == '/' || text[end] == '*')) {
+                    end = text[end] == '/' ? text.find_first_of("\r\n", end)
+                                           : text.find("*/", end + 1);
+                    if (end == std::string_view::npos)
+                        end = text.length();
+                    else if (text[end] == '*')
+                        end += 2;
+
+                    flush(i);
+                    if (includeComments)
+                        append(text.substr(i, end - i));
+                    pending = end;
+                }
+                break;
+            case '"':
+                // Newlines can be escaped inside of a string literal; an
+                // unescaped one ends it, just as a closing quote does.
+                while (end < text.length() && text[end] != '"' && !isNewline(text[end])) {
+                    if (text[end] == '\\')
+                        end += std::max(newlineLength(end + 1), size_t(1));
+                    end++;
+                }
+                if (end < text.length() && text[end] == '"')
+                    end++;
+                break;
+            case '`':
+                // Skip over macro quotes so that they aren't taken as the
+                // start of a string. Escaped names are handled below.
+                if (text.substr(i, 4) == "`\\`\""sv)
+                    end = i + 4;
+                else if (end < text.length() && (text[end] == '"' || text[end] == '`'))
+                    end++;
+                break;
+            case '\\':
+                // An escaped identifier, or a line continuation.
+                if (auto len = newlineLength(end))
+                    end += len;
+                else {
+                    while (end < text.length() && isPrintableASCII(text[end]) &&
+                           !isWhitespace(text[end])) {
+                        end++;
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+        i = end;
+    }
+    flush(text.length());
+}
+
 SyntaxPrinter& SyntaxPrinter::append(std::string_view text) {
     if (!squashNewlines) {
         buffer.append(text);
@@ -141,15 +316,14 @@ SyntaxPrinter& SyntaxPrinter::append(std::string_view text) {
             i++;
         }
 
-        for (; i < text.length(); i++) {
-            if (text[i] == '\r' || text[i] == '\n')
-                i++;
-        }
+        while (i < text.length() && (text[i] == '\r' || text[i] == '\n'))
+            i++;
 
         text = text.substr(i);
     }
 
-    if (buffer.empty() || buffer.back() != '\n') {
+    char last = buffer.empty() ? lastTaken : buffer.back();
+    if (last != '\n') {
         if (carriage)
             buffer.push_back('\r');
         if (newline)
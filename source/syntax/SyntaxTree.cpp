@@ -10,13 +10,137 @@
 #include "slang/parsing/Parser.h"
 #include "slang/parsing/ParserMetadata.h"
 #include "slang/parsing/Preprocessor.h"
+#include "slang/syntax/AllSyntax.h"
+#include "slang/syntax/SyntaxTreeCache.h"
+#include "slang/text/CharInfo.h"
 #include "slang/text/SourceManager.h"
+#include "slang/util/ThreadPool.h"
 #include "slang/util/TimeTrace.h"
 
 namespace slang::syntax {
 
 using namespace parsing;
 
+namespace {
+
+// The results of parsing one of the buffers of a compilation unit on its own.
+struct SpeculativeParse {
+    BumpAllocator alloc;
+    Diagnostics diagnostics;
+    CompilationUnitSyntax* root = nullptr;
+    ParserMetadata metadata;
+    const PreprocessorState* startState = nullptr;
+    PreprocessorDependencies dependencies;
+
+    // Set if the buffer ends in the middle of some construct that would
+    // continue on into the next buffer when parsed together.
+    bool incomplete = false;
+};
+
+// Replaces the first token in a syntax node's subtree.
+struct FirstTokenReplacer {
+    Token token;
+
+    template<typename T>
+    bool visit(T& node) {
+        for (size_t i = 0; i < node.getChildCount(); i++) {
+            auto child = node.getChild(i);
+            if (child.isToken()) {
+                if (child.token()) {
+                    node.setChild(i, token);
+                    return true;
+                }
+            }
+            else if (child.node() && child.node()->visit(*this)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Moves syntax that is being reused from an edited tree into the source buffer of the
+// new tree, by changing the locations of its tokens in place. Locations are shifted by
+// a fixed amount and have to be within the given range of offsets; anything else, such
+// as a token from an include file or a macro expansion, or trivia with a location of
+// its own, makes the move fail since there's no sensible place to put it. Each token
+// is only moved once, even if it's referenced from more than one place.
+//
+// Along the way this notes things about the syntax that the parser metadata needs.
+struct SyntaxMover {
+    BufferID fromBuffer;
+    BufferID toBuffer;
+    ptrdiff_t shift;
+    size_t minOffset;
+    size_t maxOffset;
+    const flat_hash_set<std::string_view>& watchedNames;
+
+    bool failed = false;
+    bool hasDefparams = false;
+    bool hasBindDirectives = false;
+
+    // Set if the syntax instantiates one of the watched names.
+    bool isWatched = false;
+
+    template<typename T>
+    void visit(const T& node) {
+        if constexpr (std::is_same_v<T, DefParamSyntax>) {
+            hasDefparams = true;
+        }
+        else if constexpr (std::is_same_v<T, BindDirectiveSyntax>) {
+            hasBindDirectives = true;
+        }
+        else if constexpr (std::is_same_v<T, HierarchyInstantiationSyntax>) {
+            if (watchedNames.contains(node.type.valueText()))
+                isWatched = true;
+        }
+
+        for (size_t i = 0; i < node.getChildCount() && !failed; i++) {
+            auto child = node.getChild(i);
+            if (child.isToken())
+                move(child.token());
+            else if (auto childNode = child.node())
+                childNode->visit(*this);
+        }
+    }
+
+    void move(Token token) {
+        if (!token)
+            return;
+
+        for (auto& trivia : token.trivia()) {
+            // Trivia holding syntax or tokens gets its location from them, but any
+            // other trivia with a location of its own has nowhere for us to change it.
+            if (auto syntax = trivia.syntax()) {
+                syntax->visit(*this);
+            }
+            else if (trivia.kind == TriviaKind::SkippedTokens) {
+                for (auto skipped : trivia.getSkippedTokens())
+                    move(skipped);
+            }
+            else if (trivia.getExplicitLocation()) {
+                failed = true;
+                return;
+            }
+        }
+
+        auto location = token.location();
+        if (location.buffer() == toBuffer)
+            return;
+
+        if (location.buffer() != fromBuffer || location.offset() < minOffset ||
+            location.offset() > maxOffset) {
+            failed = true;
+            return;
+        }
+
+        token.setLocation(
+            SourceLocation(toBuffer, size_t(ptrdiff_t(location.offset()) + shift)));
+    }
+};
+
+} // namespace
+
 SyntaxTree::SyntaxTree(SyntaxNode* root, SourceManager& sourceManager, BumpAllocator&& alloc,
                        const SourceLibrary* library, std::shared_ptr<SyntaxTree> parent) :
     rootNode(root),
@@ -26,6 +150,37 @@ SyntaxTree::SyntaxTree(SyntaxNode* root, SourceManager& sourceManager, BumpAlloc
         metadata->eofToken = parentTree->getMetadata().eofToken;
 }
 
+SyntaxTree::SyntaxTree(SyntaxNode* root, SourceManager& sourceManager, BumpAllocator&& alloc,
+                       std::shared_ptr<SyntaxTree> parent, ParserMetadata&& metadata,
+                       flat_hash_map<const SyntaxNode*, SyntaxEditKind>&& editedNodes,
+                       flat_hash_map<const SyntaxNode*, const SyntaxNode*>&& parents) :
+    rootNode(root), sourceMan(sourceManager), alloc(std::move(alloc)),
+    metadata(std::make_unique<ParserMetadata>(std::move(metadata))), parentTree(std::move(parent)),
+    editedNodes(std::move(editedNodes)), parents(std::move(parents)) {
+    SLANG_ASSERT(parentTree);
+    sharesParentNodes = true;
+    exactSourceText = parentTree->exactSourceText;
+    options_ = parentTree->options_;
+}
+
+SyntaxEditKind SyntaxTree::getEditKind(const SyntaxNode& node) const {
+    // Nodes that aren't recorded as edited here came from the parent tree,
+    // which may itself have been produced by an earlier shared edit.
+    for (auto tree = this; tree && tree->sharesParentNodes; tree = tree->parentTree.get()) {
+        if (auto it = tree->editedNodes.find(&node); it != tree->editedNodes.end())
+            return it->second;
+    }
+    return SyntaxEditKind::Unchanged;
+}
+
+const SyntaxNode* SyntaxTree::getParent(const SyntaxNode& node) const {
+    for (auto tree = this; tree && tree->sharesParentNodes; tree = tree->parentTree.get()) {
+        if (auto it = tree->parents.find(&node); it != tree->parents.end())
+            return it->second;
+    }
+    return node.parent;
+}
+
 SyntaxTree::~SyntaxTree() = default;
 
 std::shared_ptr<SyntaxTree> SyntaxTree::fromFile(std::string_view path) {
@@ -105,6 +260,606 @@ std::shared_ptr<SyntaxTree> SyntaxTree::fromBuffers(std::span<const SourceBuffer
     return create(sourceManager, buffers, options, inheritedMacros, false);
 }
 
+std::shared_ptr<SyntaxTree> SyntaxTree::fromBuffersInParallel(
+    std::span<const SourceBuffer> buffers, SourceManager& sourceManager, ThreadPool& threadPool,
+    const Bag& options, MacroList inheritedMacros) {
+    // Cached trees are stored for the unit as a whole, so let the normal path handle them.
+    auto cacheOptions = options.get<SyntaxTreeCacheOptions>();
+    if (buffers.size() < 2 || (cacheOptions && !cacheOptions->directory.empty()))
+        return create(sourceManager, buffers, options, inheritedMacros, false);
+
+    TimeTraceScope timeScope("parseFile"sv, "<multi-buffer>"sv);
+
+    // This preprocessor provides the state the first buffer starts with; it
+    // also owns any diagnostics from setting up predefined macros.
+    BumpAllocator alloc;
+    Diagnostics diagnostics;
+    Preprocessor preprocessor(sourceManager, alloc, diagnostics, options, inheritedMacros);
+    const PreprocessorState initialState = preprocessor.getState();
+
+    auto parse = [&](size_t index, const PreprocessorState& startState) {
+        auto result = std::make_unique<SpeculativeParse>();
+        Preprocessor pp(sourceManager, result->alloc, result->diagnostics, options,
+                        inheritedMacros);
+        pp.setState(startState);
+        pp.pushSource(buffers[index]);
+
+        // Diagnostics from predefines were already issued above.
+        result->diagnostics.clear();
+        result->startState = &startState;
+        pp.trackDependencies(result->dependencies);
+
+        Parser parser(pp, options);
+        result->root = &parser.parseCompilationUnit();
+        result->metadata = parser.getMetadata();
+
+        auto& unit = *result->root;
+        auto eofLoc = unit.endOfFile.location();
+        result->incomplete = result->dependencies.unbalanced ||
+                             (!unit.members.empty() &&
+                              (unit.members.front()->getFirstToken().isMissing() ||
+                               unit.members.back()->getLastToken().isMissing())) ||
+                             std::ranges::any_of(result->diagnostics, [&](const Diagnostic& diag) {
+                                 return diag.location == eofLoc;
+                             });
+        return result;
+    };
+
+    // Start off by parsing each buffer as if nothing came before it.
+    std::vector<std::unique_ptr<SpeculativeParse>> parses(buffers.size());
+    threadPool.pushLoop(size_t(0), buffers.size(), [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++)
+            parses[i] = parse(i, initialState);
+    });
+    threadPool.waitForAll();
+
+    // Anything that was parsed again is kept around since later
+    // snapshots of the state may refer to macros it defined.
+    std::vector<std::unique_ptr<SpeculativeParse>> discarded;
+    std::deque<PreprocessorState> snapshots;
+    PreprocessorState state;
+    while (true) {
+        // Walk the buffers in order to find the state each one actually starts
+        // with, and collect the ones that depended on some wrong part of their
+        // starting state. The first of these is now known to have the right
+        // state, so each round makes progress.
+        SmallVector<size_t> stale;
+        state = initialState;
+        for (size_t i = 0; i < parses.size(); i++) {
+            auto& result = *parses[i];
+            if (result.incomplete)
+                return create(sourceManager, buffers, options, inheritedMacros, false);
+
+            if (!result.dependencies.isSatisfiedBy(*result.startState, state)) {
+                stale.push_back(i);
+                snapshots.push_back(state);
+            }
+            state.apply(result.dependencies);
+        }
+
+        if (stale.empty())
+            break;
+
+        const size_t firstSnapshot = snapshots.size() - stale.size();
+        for (auto index : stale)
+            discarded.emplace_back(std::move(parses[index]));
+
+        threadPool.pushLoop(size_t(0), stale.size(), [&](size_t start, size_t end) {
+            for (size_t i = start; i < end; i++)
+                parses[stale[i]] = parse(stale[i], snapshots[firstSnapshot + i]);
+        });
+        threadPool.waitForAll();
+    }
+
+    // Stitch the separately parsed buffers together. Trivia at the end of each
+    // buffer gets attached to the first token of the next one, the same way the
+    // preprocessor does it when reading the buffers one after another.
+    SmallVector<MemberSyntax*> members;
+    SmallVector<Trivia, 8> pendingTrivia;
+    auto appendTrivia = [&](Token token) {
+        for (auto& t : token.trivia())
+            pendingTrivia.push_back(t.withLocation(alloc, token.location()));
+    };
+
+    Token eof;
+    ParserMetadata metadata;
+    for (size_t i = 0; i < parses.size(); i++) {
+        auto& result = *parses[i];
+        auto& unit = *result.root;
+        if (i > 0 && !unit.members.empty()) {
+            auto first = unit.members[0]->getFirstToken();
+            appendTrivia(first);
+
+            FirstTokenReplacer replacer{first.withTrivia(alloc, pendingTrivia)};
+            unit.members[0]->visit(replacer);
+            pendingTrivia.clear();
+        }
+
+        members.append_range(unit.members);
+        if (i + 1 < parses.size()) {
+            appendTrivia(unit.endOfFile);
+        }
+        else if (pendingTrivia.empty()) {
+            eof = unit.endOfFile;
+        }
+        else {
+            appendTrivia(unit.endOfFile);
+            eof = unit.endOfFile.withTrivia(alloc, pendingTrivia);
+        }
+
+        auto& meta = result.metadata;
+        metadata.nodeMap.insert(meta.nodeMap.begin(), meta.nodeMap.end());
+        metadata.globalInstances.insert(meta.globalInstances.begin(), meta.globalInstances.end());
+        metadata.classPackageNames.insert(metadata.classPackageNames.end(),
+                                          meta.classPackageNames.begin(),
+                                          meta.classPackageNames.end());
+        metadata.packageImports.insert(metadata.packageImports.end(), meta.packageImports.begin(),
+                                       meta.packageImports.end());
+        metadata.classDecls.insert(metadata.classDecls.end(), meta.classDecls.begin(),
+                                   meta.classDecls.end());
+        metadata.interfacePorts.insert(metadata.interfacePorts.end(), meta.interfacePorts.begin(),
+                                       meta.interfacePorts.end());
+        metadata.deferredBodies.insert(meta.deferredBodies.begin(), meta.deferredBodies.end());
+        metadata.hasDefparams |= meta.hasDefparams;
+        metadata.hasBindDirectives |= meta.hasBindDirectives;
+
+        auto& stats = metadata.includeStats;
+        stats.numIncludes += meta.includeStats.numIncludes;
+        stats.numEntered += meta.includeStats.numEntered;
+        stats.numSkippedPragmaOnce += meta.includeStats.numSkippedPragmaOnce;
+        stats.numSkippedGuard += meta.includeStats.numSkippedGuard;
+        stats.numGuardsDetected += meta.includeStats.numGuardsDetected;
+
+        auto& mstats = metadata.macroStats;
+        mstats.numExpansions += meta.macroStats.numExpansions;
+        mstats.numCacheHits += meta.macroStats.numCacheHits;
+        mstats.numCacheInvalidations += meta.macroStats.numCacheInvalidations;
+
+        metadata.triviaBytesSaved += meta.triviaBytesSaved;
+
+        diagnostics.append_range(result.diagnostics);
+
+        // Only now that this parse is being kept can its directives take effect.
+        result.dependencies.applyDirectives(sourceManager);
+    }
+
+    SyntaxFactory factory(alloc);
+    auto& root = factory.compilationUnit(members.copy(alloc), eof);
+    metadata.eofToken = eof;
+
+    // The defined macros are the built-in ones plus whatever the
+    // state ended up with after the last buffer.
+    std::vector<const DefineDirectiveSyntax*> macros;
+    for (auto macro : preprocessor.getDefinedMacros()) {
+        if (!initialState.macros.contains(macro->name.valueText()))
+            macros.push_back(macro);
+    }
+    for (auto& [name, macro] : state.macros)
+        macros.push_back(macro);
+
+    std::ranges::sort(macros, [](const DefineDirectiveSyntax* a, const DefineDirectiveSyntax* b) {
+        return a->name.valueText() < b->name.valueText();
+    });
+
+    for (auto& result : parses)
+        alloc.steal(std::move(result->alloc));
+    for (auto& result : discarded)
+        alloc.steal(std::move(result->alloc));
+
+    return std::shared_ptr<SyntaxTree>(new SyntaxTree(&root, sourceManager, std::move(alloc),
+                                                      std::move(diagnostics), std::move(metadata),
+                                                      std::move(macros), options));
+}
+
+std::shared_ptr<SyntaxTree> SyntaxTree::fromEdits(std::shared_ptr<SyntaxTree> oldTree,
+                                                  std::span<const TextEdit> edits,
+                                                  std::string_view name, std::string_view path) {
+    SLANG_ASSERT(oldTree);
+    auto& sourceManager = oldTree->sourceMan;
+    auto& meta = oldTree->getMetadata();
+    if (!meta.eofToken || !sourceManager.isFileLoc(meta.eofToken.location()))
+        SLANG_THROW(std::invalid_argument("tree was not parsed from a source buffer"));
+
+    // Strip the null terminator that the source manager keeps at the end of buffers.
+    auto oldText = sourceManager.getSourceText(meta.eofToken.location().buffer());
+    if (!oldText.empty() && oldText.back() == '\0')
+        oldText.remove_suffix(1);
+
+    std::string newText;
+    size_t pos = 0;
+    for (auto& edit : edits) {
+        if (edit.offset < pos || edit.offset > oldText.size() ||
+            edit.length > oldText.size() - edit.offset) {
+            SLANG_THROW(std::invalid_argument(
+                "edits must be sorted, non-overlapping, and within the source text"));
+        }
+
+        newText.append(oldText.substr(pos, edit.offset - pos));
+        newText.append(edit.newText);
+        pos = edit.offset + edit.length;
+    }
+    newText.append(oldText.substr(pos));
+
+    // All of the nodes in a tree parsed from a single buffer share its library.
+    const SourceLibrary* library = nullptr;
+    if (!meta.nodeMap.empty())
+        library = meta.nodeMap.begin()->second.library;
+
+    SourceBuffer buffer = sourceManager.assignText(path, newText, SourceLocation(), library);
+    if (!buffer)
+        return nullptr;
+
+    if (!name.empty())
+        sourceManager.addLineDirective(SourceLocation(buffer.id, 0), 2, name, 0);
+
+    // The old tree's syntax gets changed as it's moved over, so that can only happen if
+    // nothing else can see it. Syntax that was replaced stays in the old tree's memory,
+    // so once that adds up to more than the size of the file we start over instead.
+    std::shared_ptr<SyntaxTree> tree;
+    if (oldTree.use_count() == 1 && oldTree->replacedTextSize <= oldText.size())
+        tree = reparse(*oldTree, edits, oldText, buffer);
+
+    if (!tree) {
+        bool guess = oldTree->root().kind != SyntaxKind::CompilationUnit;
+        tree = create(sourceManager, std::span(&buffer, 1), oldTree->options(), {}, guess);
+    }
+
+    tree->isLibrary = oldTree->isLibrary;
+    return tree;
+}
+
+std::shared_ptr<SyntaxTree> SyntaxTree::reparse(SyntaxTree& oldTree,
+                                                std::span<const TextEdit> edits,
+                                                std::string_view oldText,
+                                                const SourceBuffer& buffer) {
+    // Syntax that is shared with another tree, or deferred subroutine bodies that
+    // hold on to tokens, can't be changed without affecting something else.
+    auto& oldMeta = oldTree.getMetadata();
+    if (oldTree.root().kind != SyntaxKind::CompilationUnit || oldTree.parentTree ||
+        !oldMeta.deferredBodies.empty()) {
+        return nullptr;
+    }
+
+    // These directives change how all of the text after them is lexed or
+    // how locations map to line numbers, which we can't account for here.
+    for (auto directive : {"`begin_keywords"sv, "`line"sv, "`pragma"sv, "`__LINE__"sv}) {
+        if (oldText.find(directive) != std::string_view::npos)
+            return nullptr;
+    }
+
+    // Each top-level member owns the text from the end of the previous member
+    // (its leading trivia) through the end of its last token. The EOF token
+    // owns whatever is left over.
+    auto& unit = oldTree.root().as<CompilationUnitSyntax>();
+    auto oldBuffer = unit.endOfFile.location().buffer();
+    const size_t numMembers = unit.members.size();
+
+    SmallVector<size_t> ends;
+    for (auto member : unit.members) {
+        auto last = member->getLastToken();
+        if (!last || last.location().buffer() != oldBuffer)
+            return nullptr;
+        ends.push_back(last.location().offset() + last.rawText().size());
+    }
+
+    auto newText = buffer.data.substr(0, buffer.data.size() - 1);
+    const ptrdiff_t delta = ptrdiff_t(newText.size()) - ptrdiff_t(oldText.size());
+
+    size_t damageStart = 0;
+    size_t damageEnd = 0;
+    if (!edits.empty()) {
+        damageStart = edits.front().offset;
+        damageEnd = edits.back().offset + edits.back().length;
+    }
+
+    // Parsing starts over at the end of the last member before the damage. The parser
+    // looks at the token after a member to decide where it ends, and the lexer looks at
+    // the character after a token, so those have to be left alone by the edits too.
+    auto firstTokenEnd = [&](size_t index) {
+        auto token = index < numMembers ? unit.members[index]->getFirstToken() : unit.endOfFile;
+        return token.location().offset() + token.rawText().size();
+    };
+
+    size_t first = 0;
+    while (first < numMembers && ends[first] < damageStart)
+        first++;
+
+    while (first > 0 && (firstTokenEnd(first) >= damageStart ||
+                         !(isWhitespace(newText[ends[first - 1]]) ||
+                           isNewline(newText[ends[first - 1]])))) {
+        first--;
+    }
+
+    // Parse members straight out of the new buffer until one of them ends in the same
+    // place as an old member does, with the same text after it; everything after that
+    // is unchanged and can be reused. Since the rest of the text is available, an edit
+    // that unbalances a member just makes the window of reparsed members bigger.
+    const size_t windowStart = first ? ends[first - 1] : 0;
+    const size_t newDamageEnd = size_t(ptrdiff_t(damageEnd) + delta);
+    auto& options = oldTree.options();
+
+    BumpAllocator alloc;
+    Diagnostics windowDiags;
+    Preprocessor preprocessor(oldTree.sourceMan, alloc, windowDiags, options);
+    preprocessor.pushSource(buffer, windowStart);
+
+    Parser parser(preprocessor, options);
+    SmallVector<MemberSyntax*> windowMembers;
+    size_t resume = numMembers;
+    size_t newWindowEnd = newText.size();
+    bool includesEof = false;
+    SLANG_TRY {
+        while (true) {
+            if (parser.isDone()) {
+                includesEof = true;
+                break;
+            }
+
+            // Anything that isn't a member gets skipped token by token and attached
+            // to whatever comes next, which is more than we want to deal with here.
+            auto member = parser.parseSingleMember(SyntaxKind::CompilationUnit);
+            if (!member)
+                return nullptr;
+
+            windowMembers.push_back(member);
+            auto last = member->getLastToken();
+            if (!last || last.isMissing() || last.location().buffer() != buffer.id)
+                continue;
+
+            // Past the damage the new text is the old text shifted by delta, so if the
+            // text up to there matches as well then everything after this member is the
+            // same as what came after the old member.
+            size_t end = last.location().offset() + last.rawText().size();
+            auto oldEnd = ptrdiff_t(end) - delta;
+            if (oldEnd < ptrdiff_t(windowStart))
+                continue;
+
+            auto it = std::ranges::lower_bound(ends, size_t(oldEnd));
+            if (it == ends.end() || *it != size_t(oldEnd) || size_t(it - ends.begin()) + 1 < first)
+                continue;
+
+            if (end < newDamageEnd &&
+                newText.substr(end, newDamageEnd - end) !=
+                    oldText.substr(size_t(oldEnd), newDamageEnd - end)) {
+                continue;
+            }
+
+            resume = size_t(it - ends.begin()) + 1;
+            if (!unit.members[resume - 1]->getLastToken().isMissing()) {
+                newWindowEnd = end;
+                break;
+            }
+        }
+    }
+    SLANG_CATCH(const std::runtime_error&) {
+        // The parser gave up on something too deeply nested.
+        return nullptr;
+    }
+
+    if (includesEof)
+        resume = numMembers;
+
+    auto windowMeta = parser.getMetadata();
+    const size_t oldWindowEnd = includesEof ? oldText.size() : ends[resume - 1];
+    if (!windowMeta.deferredBodies.empty())
+        return nullptr;
+
+    // Any directive or macro usage in the damaged text could have effects
+    // well beyond it, so fall back to a full parse.
+    auto oldWindow = oldText.substr(windowStart, oldWindowEnd - windowStart);
+    auto newWindow = newText.substr(windowStart, newWindowEnd - windowStart);
+    if (oldWindow.find('`') != std::string_view::npos ||
+        newWindow.find('`') != std::string_view::npos) {
+        return nullptr;
+    }
+
+    // Definitions in the window were parsed with default preprocessor state;
+    // figure out what the state actually was at the start of the window.
+    auto offsetOf = [](const SyntaxNode* node) {
+        return node->getFirstToken().location().offset();
+    };
+
+    if (!windowMeta.nodeMap.empty()) {
+        ParserMetadata::Node windowState{buffer.library, TokenKind::Unknown, TokenKind::Unknown,
+                                         std::nullopt};
+        size_t stateOffset = 0;
+        for (auto& [node, info] : oldMeta.nodeMap) {
+            size_t offset = offsetOf(node);
+            if (offset < windowStart && offset >= stateOffset) {
+                stateOffset = offset;
+                windowState = info;
+            }
+        }
+
+        if (oldText.substr(stateOffset, windowStart - stateOffset).find('`') !=
+            std::string_view::npos) {
+            return nullptr;
+        }
+
+        for (auto& [node, info] : windowMeta.nodeMap)
+            info = windowState;
+    }
+
+    // Carry over diagnostics from outside of the window, and take the rest from the
+    // window's parse, which may have looked at some of the text after the window.
+    enum class Region { Before, Window, After };
+    auto regionOf = [&](size_t offset) {
+        if (offset <= windowStart)
+            return Region::Before;
+        if (offset >= oldWindowEnd && !includesEof)
+            return Region::After;
+        return Region::Window;
+    };
+
+    auto relocateLoc = [&](SourceLocation& loc) {
+        if (loc.buffer() != oldBuffer)
+            return false;
+
+        size_t offset = loc.offset();
+        switch (regionOf(offset)) {
+            case Region::Before:
+                break;
+            case Region::After:
+                offset = size_t(ptrdiff_t(offset) + delta);
+                break;
+            case Region::Window:
+                return false;
+        }
+
+        loc = SourceLocation(buffer.id, offset);
+        return true;
+    };
+
+    auto relocateDiag = [&](Diagnostic& diag, auto& self) -> bool {
+        if (!relocateLoc(diag.location))
+            return false;
+
+        for (auto& range : diag.ranges) {
+            auto start = range.start();
+            auto end = range.end();
+            if (!relocateLoc(start) || !relocateLoc(end))
+                return false;
+            range = SourceRange(start, end);
+        }
+
+        for (auto& note : diag.notes) {
+            if (!self(note, self))
+                return false;
+        }
+        return true;
+    };
+
+    Diagnostics diagnostics;
+    Diagnostics afterDiags;
+    for (auto& diag : oldTree.diagnosticsBuffer) {
+        if (diag.location.buffer() != oldBuffer)
+            return nullptr;
+
+        auto region = regionOf(diag.location.offset());
+        if (region == Region::Window)
+            continue;
+
+        Diagnostic copy = diag;
+        if (!relocateDiag(copy, relocateDiag))
+            return nullptr;
+
+        if (region == Region::Before)
+            diagnostics.emplace_back(std::move(copy));
+        else
+            afterDiags.emplace_back(std::move(copy));
+    }
+
+    for (auto& diag : windowDiags) {
+        if (diag.location.buffer() != buffer.id)
+            return nullptr;
+
+        if (includesEof || diag.location.offset() < newWindowEnd)
+            diagnostics.emplace_back(std::move(diag));
+    }
+    diagnostics.append_range(afterDiags);
+
+    // Instantiations in the members being replaced might be the only
+    // ones of their kind, so watch for any others in the rest of the tree.
+    flat_hash_set<std::string_view> watchedNames;
+    for (size_t i = first; i < resume; i++) {
+        auto removed = ParserMetadata::fromSyntax(*unit.members[i], buffer.library);
+        watchedNames.insert(removed.globalInstances.begin(), removed.globalInstances.end());
+    }
+
+    // Carry over the metadata for the reused nodes, in tree order.
+    auto remap = [&]<typename T>(std::vector<const T*>& result,
+                                 const std::vector<const T*>& oldNodes,
+                                 const std::vector<const T*>& windowNodes) {
+        for (auto node : oldNodes) {
+            if (regionOf(offsetOf(node)) == Region::Before)
+                result.push_back(node);
+        }
+        result.insert(result.end(), windowNodes.begin(), windowNodes.end());
+        for (auto node : oldNodes) {
+            if (regionOf(offsetOf(node)) == Region::After)
+                result.push_back(node);
+        }
+    };
+
+    ParserMetadata metadata;
+    remap(metadata.classPackageNames, oldMeta.classPackageNames, windowMeta.classPackageNames);
+    remap(metadata.packageImports, oldMeta.packageImports, windowMeta.packageImports);
+    remap(metadata.classDecls, oldMeta.classDecls, windowMeta.classDecls);
+    remap(metadata.interfacePorts, oldMeta.interfacePorts, windowMeta.interfacePorts);
+
+    for (auto& [node, info] : oldMeta.nodeMap) {
+        if (regionOf(offsetOf(node)) != Region::Window)
+            metadata.nodeMap.emplace(node, info);
+    }
+    metadata.nodeMap.insert(windowMeta.nodeMap.begin(), windowMeta.nodeMap.end());
+
+    for (auto& name : oldMeta.globalInstances) {
+        if (!watchedNames.contains(name))
+            metadata.globalInstances.emplace(name);
+    }
+    metadata.globalInstances.insert(windowMeta.globalInstances.begin(),
+                                    windowMeta.globalInstances.end());
+
+    // Now move the reused members over into the new buffer. This is the point of no
+    // return for the old tree; if it fails the caller will throw the old tree away.
+    SmallVector<MemberSyntax*> members;
+    SmallVector<const SyntaxNode*> watchedMembers;
+    auto moveMember = [&](SyntaxMover& mover, MemberSyntax& member) {
+        mover.isWatched = false;
+        member.visit(mover);
+        if (mover.isWatched)
+            watchedMembers.push_back(&member);
+        members.push_back(&member);
+    };
+
+    SyntaxMover before{oldBuffer, buffer.id, 0, 0, windowStart, watchedNames};
+    for (size_t i = 0; i < first; i++)
+        moveMember(before, *unit.members[i]);
+
+    members.append_range(windowMembers);
+
+    SyntaxMover after{oldBuffer, buffer.id, delta, oldWindowEnd, oldText.size(), watchedNames};
+    Token eof = windowMeta.eofToken;
+    if (!includesEof) {
+        for (size_t i = resume; i < numMembers; i++)
+            moveMember(after, *unit.members[i]);
+
+        eof = unit.endOfFile;
+        after.move(eof);
+    }
+
+    if (before.failed || after.failed)
+        return nullptr;
+
+    for (auto member : watchedMembers) {
+        auto watched = ParserMetadata::fromSyntax(*member, buffer.library);
+        metadata.globalInstances.insert(watched.globalInstances.begin(),
+                                        watched.globalInstances.end());
+    }
+
+    metadata.eofToken = eof;
+    metadata.hasDefparams = before.hasDefparams || windowMeta.hasDefparams || after.hasDefparams;
+    metadata.hasBindDirectives = before.hasBindDirectives || windowMeta.hasBindDirectives ||
+                                 after.hasBindDirectives;
+    metadata.includeStats = oldMeta.includeStats;
+    metadata.macroStats = oldMeta.macroStats;
+    metadata.triviaBytesSaved = oldMeta.triviaBytesSaved;
+
+    // The new tree takes over the memory of the old one.
+    SyntaxFactory factory(alloc);
+    auto& root = factory.compilationUnit(members.copy(alloc), eof);
+    alloc.steal(std::move(oldTree.alloc));
+
+    auto macros = oldTree.macros;
+    auto tree = std::shared_ptr<SyntaxTree>(new SyntaxTree(&root, oldTree.sourceMan,
+                                                           std::move(alloc),
+                                                           std::move(diagnostics),
+                                                           std::move(metadata), std::move(macros),
+                                                           options));
+    tree->replacedTextSize = oldTree.replacedTextSize + oldWindow.size();
+    return tree;
+}
+
 SourceManager& SyntaxTree::getDefaultSourceManager() {
     static SourceManager instance;
     return instance;
@@ -117,6 +872,7 @@ SyntaxTree::SyntaxTree(SyntaxNode* root, SourceManager& sourceManager, BumpAlloc
     sourceMan(sourceManager), alloc(std::move(alloc)), diagnosticsBuffer(std::move(diagnostics)),
     options_(std::move(options)), metadata(std::make_unique<ParserMetadata>(std::move(metadata))),
     macros(std::move(macros)) {
+    exactSourceText = !options_.getOrDefault<LexerOptions>().leanTrivia;
 }
 
 std::shared_ptr<SyntaxTree> SyntaxTree::create(SourceManager& sourceManager,
@@ -133,6 +889,17 @@ std::shared_ptr<SyntaxTree> SyntaxTree::create(SourceManager& sourceManager,
             return "<multi-buffer>"s;
     });
 
+    // Guessed trees are only used for small snippets, so don't bother caching them.
+    std::optional<SyntaxTreeCache> cache;
+    std::vector<char> cacheKey;
+    if (auto cacheOptions = options.get<SyntaxTreeCacheOptions>();
+        cacheOptions && !cacheOptions->directory.empty() && !guess) {
+        cache.emplace(cacheOptions->directory);
+        cacheKey = SyntaxTreeCache::getKey(sourceManager, sources, options, inheritedMacros);
+        if (auto tree = cache->load(cacheKey, sourceManager, sources, options))
+            return tree;
+    }
+
     BumpAllocator alloc;
     Diagnostics diagnostics;
     Preprocessor preprocessor(sourceManager, alloc, diagnostics, options, inheritedMacros);
@@ -151,9 +918,14 @@ std::shared_ptr<SyntaxTree> SyntaxTree::create(SourceManager& sourceManager,
             return create(sourceManager, sources, options, inheritedMacros, false);
     }
 
-    return std::shared_ptr<SyntaxTree>(new SyntaxTree(root, sourceManager, std::move(alloc),
-                                                      std::move(diagnostics), parser.getMetadata(),
-                                                      preprocessor.getDefinedMacros(), options));
+    auto tree = std::shared_ptr<SyntaxTree>(
+        new SyntaxTree(root, sourceManager, std::move(alloc), std::move(diagnostics),
+                       parser.getMetadata(), preprocessor.getDefinedMacros(), options));
+
+    if (cache)
+        cache->store(cacheKey, *tree, sources);
+
+    return tree;
 }
 
 std::shared_ptr<SyntaxTree> SyntaxTree::fromLibraryMapFile(std::string_view path,
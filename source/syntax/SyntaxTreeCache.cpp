@@ -0,0 +1,1177 @@
+//------------------------------------------------------------------------------
+// SyntaxTreeCache.cpp
+// Persistent on-disk cache of parsed syntax trees
+//
+// SPDX-FileCopyrightText: Michael Popoloski
+// SPDX-License-Identifier: MIT
+//------------------------------------------------------------------------------
+#include "slang/syntax/SyntaxTreeCache.h"
+
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <map>
+#include <random>
+#include <tuple>
+
+#include "slang/diagnostics/Diagnostics.h"
+#include "slang/parsing/LexerFacts.h"
+#include "slang/parsing/Parser.h"
+#include "slang/parsing/ParserMetadata.h"
+#include "slang/parsing/Preprocessor.h"
+#include "slang/syntax/AllSyntax.h"
+#include "slang/syntax/SyntaxTree.h"
+#include "slang/text/SourceManager.h"
+#include "slang/util/Hash.h"
+#include "slang/util/OS.h"
+#include "slang/util/String.h"
+
+namespace fs = std::filesystem;
+
+namespace slang::syntax {
+
+using namespace parsing;
+
+namespace {
+
+// Bump this whenever the format of the cache files changes,
+// or whenever the parser starts producing different trees.
+constexpr uint32_t FormatVersion = 1;
+constexpr char Magic[] = {'S', 'L', 'T', 'C'};
+
+enum class EntryKind : uint8_t { Root, File, Text, Expansion };
+enum class NodeTag : uint8_t { Null, Node, List, Token, Ref };
+
+uint64_t hashText(std::string_view text) {
+    return slang::detail::hashing::hash(text.data(), text.size());
+}
+
+class ByteWriter {
+public:
+    std::vector<char> data;
+
+    void u8(uint8_t value) { data.push_back(char(value)); }
+
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            u8(uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        u8(uint8_t(value));
+    }
+
+    void u64(uint64_t value) { bytes(&value, sizeof(value)); }
+
+    void bytes(const void* ptr, size_t size) {
+        auto p = reinterpret_cast<const char*>(ptr);
+        data.insert(data.end(), p, p + size);
+    }
+
+    void string(std::string_view str) {
+        varint(str.size());
+        bytes(str.data(), str.size());
+    }
+
+    void append(const ByteWriter& other) {
+        data.insert(data.end(), other.data.begin(), other.data.end());
+    }
+};
+
+class ByteReader {
+public:
+    bool failed = false;
+
+    explicit ByteReader(std::span<const char> data) : data(data) {}
+
+    uint8_t u8() {
+        if (pos >= data.size()) {
+            failed = true;
+            return 0;
+        }
+        return uint8_t(data[pos++]);
+    }
+
+    uint64_t varint() {
+        uint64_t result = 0;
+        for (uint32_t shift = 0; shift < 64; shift += 7) {
+            uint8_t b = u8();
+            result |= uint64_t(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+                return result;
+        }
+        failed = true;
+        return 0;
+    }
+
+    uint64_t u64() {
+        uint64_t result = 0;
+        if (auto ptr = bytes(sizeof(result)))
+            memcpy(&result, ptr, sizeof(result));
+        return result;
+    }
+
+    const char* bytes(size_t size) {
+        if (size > data.size() - pos) {
+            failed = true;
+            pos = data.size();
+            return nullptr;
+        }
+
+        auto result = data.data() + pos;
+        pos += size;
+        return result;
+    }
+
+    std::string_view string() {
+        size_t size = varint();
+        auto ptr = bytes(size);
+        return ptr ? std::string_view(ptr, size) : std::string_view();
+    }
+
+    bool atEnd() const { return pos == data.size(); }
+
+private:
+    std::span<const char> data;
+    size_t pos = 0;
+};
+
+// Serializes a syntax tree. Buffers referenced by source locations are collected
+// into a table (dependencies first) so that the reader can recreate them in order.
+class TreeWriter {
+public:
+    ByteWriter table;
+    ByteWriter body;
+    uint32_t numEntries = 0;
+    bool ok = true;
+
+    TreeWriter(const SourceManager& sm, std::span<const SourceBuffer> sources) :
+        sm(sm), sources(sources) {}
+
+    void writeTree(const SyntaxTree& tree) {
+        writeNode(body, &tree.root());
+
+        auto macros = tree.getDefinedMacros();
+        body.varint(macros.size());
+        for (auto macro : macros)
+            writeNode(body, macro);
+
+        writeMetadata(tree.getMetadata());
+        writeDiagnosticDirectives();
+    }
+
+private:
+    void writeLoc(ByteWriter& out, SourceLocation loc) {
+        if (auto index = getBufferIndex(loc.buffer())) {
+            out.varint(*index + 1);
+            out.varint(loc.offset());
+        }
+        else {
+            // Not a buffer we know about (an invalid location, or NoLocation);
+            // these are stored as-is since they don't depend on buffer numbering.
+            out.varint(0);
+            out.varint(loc.buffer().getId());
+            out.varint(loc.offset());
+        }
+    }
+
+    std::optional<uint32_t> getBufferIndex(BufferID buffer) {
+        if (!buffer || buffer == SourceLocation::NoLocation.buffer())
+            return std::nullopt;
+
+        if (auto it = bufferIndices.find(buffer.getId()); it != bufferIndices.end())
+            return it->second;
+
+        // Dependencies are written into a separate buffer first so that their
+        // table entries end up before the entry that refers to them.
+        ByteWriter entry;
+        SourceLocation start(buffer, 0);
+        std::string_view text;
+        if (sm.isMacroLoc(start)) {
+            auto range = sm.getExpansionRange(start);
+            bool isMacroArg = sm.isMacroArgLoc(start);
+
+            entry.u8(uint8_t(EntryKind::Expansion));
+            writeLoc(entry, sm.getOriginalLoc(start));
+            writeLoc(entry, range.start());
+            writeLoc(entry, range.end());
+            entry.u8(isMacroArg);
+            entry.string(isMacroArg ? ""sv : sm.getMacroName(start));
+        }
+        else if (auto root = std::ranges::find(sources, buffer, &SourceBuffer::id);
+                 root != sources.end()) {
+            entry.u8(uint8_t(EntryKind::Root));
+            entry.varint(size_t(root - sources.begin()));
+            text = root->data;
+        }
+        else {
+            auto& fullPath = sm.getFullPath(buffer);
+            if (fullPath.empty())
+                return std::nullopt;
+
+            text = sm.getSourceText(buffer);
+            if (fullPath.is_absolute()) {
+                // An included file; the reader reloads it from disk and checks
+                // that the contents haven't changed.
+                entry.u8(uint8_t(EntryKind::File));
+                entry.string(getU8Str(fullPath));
+                entry.u64(hashText(text));
+            }
+            else {
+                // Text that was assigned directly to the source manager,
+                // such as predefined macros. The text is stored inline.
+                auto name = sm.getFileName(start);
+                entry.u8(uint8_t(EntryKind::Text));
+                entry.string(text);
+                entry.string(name == sm.getRawFileName(buffer) ? ""sv : name);
+            }
+            writeLoc(entry, sm.getIncludedFrom(buffer));
+        }
+
+        uint32_t index = numEntries++;
+        table.append(entry);
+        bufferIndices.emplace(buffer.getId(), index);
+        buffers.push_back(buffer);
+        if (!text.empty())
+            textRanges.emplace(text.data(), std::pair{text.data() + text.size(), index});
+
+        return index;
+    }
+
+    void writeText(ByteWriter& out, std::string_view text) {
+        if (text.empty()) {
+            out.varint(0);
+            return;
+        }
+
+        // Most text points directly into one of the source buffers; store
+        // just an offset into the buffer in that case.
+        auto it = textRanges.upper_bound(text.data());
+        if (it != textRanges.begin()) {
+            --it;
+            auto [end, index] = it->second;
+            if (text.data() + text.size() <= end) {
+                out.varint(1);
+                out.varint(index);
+                out.varint(size_t(text.data() - it->first));
+                out.varint(text.size());
+                return;
+            }
+        }
+
+        out.varint(2);
+        out.string(text);
+    }
+
+    void writeToken(ByteWriter& out, Token token) {
+        out.u8(uint8_t(NodeTag::Token));
+        if (!token) {
+            out.u8(0);
+            return;
+        }
+
+        auto trivia = token.trivia();
+        out.u8(1 | uint8_t(token.isMissing()) << 1 | uint8_t(!trivia.empty()) << 2);
+        out.varint(uint64_t(token.kind));
+        writeLoc(out, token.location());
+
+        if (!token.isMissing()) {
+            if (LexerFacts::getTokenKindText(token.kind).empty())
+                writeText(out, token.rawText());
+
+            switch (token.kind) {
+                case TokenKind::StringLiteral:
+                    writeText(out, token.valueText());
+                    break;
+                case TokenKind::Directive:
+                case TokenKind::MacroUsage:
+                    out.varint(uint64_t(token.directiveKind()));
+                    break;
+                case TokenKind::UnbasedUnsizedLiteral:
+                    out.u8(token.bitValue().value);
+                    break;
+                case TokenKind::IntegerLiteral: {
+                    SVInt value = token.intValue();
+                    out.varint(value.getBitWidth());
+                    out.u8(uint8_t(value.isSigned()) | uint8_t(value.hasUnknown()) << 1);
+                    out.bytes(value.getRawPtr(), sizeof(uint64_t) * value.getNumWords());
+                    break;
+                }
+                case TokenKind::RealLiteral:
+                case TokenKind::TimeLiteral: {
+                    double value = token.realValue();
+                    out.bytes(&value, sizeof(value));
+                    out.u8(token.numericFlags().raw);
+                    break;
+                }
+                case TokenKind::IntegerBase:
+                    out.u8(token.numericFlags().raw);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        if (!trivia.empty()) {
+            out.varint(trivia.size());
+            for (auto& t : trivia)
+                writeTrivia(out, t);
+        }
+    }
+
+    void writeTrivia(ByteWriter& out, const Trivia& trivia) {
+        out.u8(uint8_t(trivia.kind));
+        switch (trivia.kind) {
+            case TriviaKind::Directive:
+            case TriviaKind::SkippedSyntax:
+                writeNode(out, trivia.syntax());
+                break;
+            case TriviaKind::SkippedTokens: {
+                auto tokens = trivia.getSkippedTokens();
+                out.varint(tokens.size());
+                for (auto token : tokens)
+                    writeToken(out, token);
+                break;
+            }
+            default: {
+                auto loc = trivia.getExplicitLocation();
+                out.u8(loc.has_value());
+                if (loc)
+                    writeLoc(out, *loc);
+                writeText(out, trivia.getRawText());
+                break;
+            }
+        }
+    }
+
+    void writeNode(ByteWriter& out, const SyntaxNode* node) {
+        if (!node) {
+            out.u8(uint8_t(NodeTag::Null));
+            return;
+        }
+
+        if (auto it = nodeIndices.find(node); it != nodeIndices.end()) {
+            out.u8(uint8_t(NodeTag::Ref));
+            out.varint(it->second);
+            return;
+        }
+
+        bool isList = SyntaxListBase::isKind(node->kind);
+        size_t count = node->getChildCount();
+        out.u8(uint8_t(isList ? NodeTag::List : NodeTag::Node));
+        out.varint(uint64_t(node->kind));
+        out.varint(count);
+
+        for (size_t i = 0; i < count; i++) {
+            if (auto child = node->childNode(i))
+                writeNode(out, child);
+            else if (auto token = node->childToken(i))
+                writeToken(out, token);
+            else
+                out.u8(uint8_t(NodeTag::Null));
+        }
+
+        // Lists are recreated by copying into their parent so they
+        // can't be referenced; all other nodes are numbered in post-order.
+        if (!isList)
+            nodeIndices.emplace(node, numNodes++);
+    }
+
+    template<typename T>
+    void writeNodeRefs(const std::vector<const T*>& nodes) {
+        body.varint(nodes.size());
+        for (auto node : nodes)
+            writeNodeRef(node);
+    }
+
+    void writeNodeRef(const SyntaxNode* node) {
+        auto it = nodeIndices.find(node);
+        if (it == nodeIndices.end()) {
+            ok = false;
+            body.varint(0);
+        }
+        else {
+            body.varint(it->second);
+        }
+    }
+
+    void writeMetadata(const ParserMetadata& meta) {
+        body.varint(meta.nodeMap.size());
+        for (auto& [node, info] : meta.nodeMap) {
+            writeNodeRef(node);
+
+            size_t libIndex = 0;
+            if (info.library) {
+                auto it = std::ranges::find(sources, info.library, &SourceBuffer::library);
+                if (it == sources.end())
+                    ok = false;
+                libIndex = size_t(it - sources.begin()) + 1;
+            }
+            body.varint(libIndex);
+            body.varint(uint64_t(info.defaultNetType));
+            body.varint(uint64_t(info.unconnectedDrive));
+            body.u8(info.timeScale.has_value());
+            if (info.timeScale) {
+                body.u8(uint8_t(info.timeScale->base.unit));
+                body.u8(uint8_t(info.timeScale->base.magnitude));
+                body.u8(uint8_t(info.timeScale->precision.unit));
+                body.u8(uint8_t(info.timeScale->precision.magnitude));
+            }
+        }
+
+        body.varint(meta.globalInstances.size());
+        for (auto name : meta.globalInstances)
+            body.string(name);
+
+        writeNodeRefs(meta.classPackageNames);
+        writeNodeRefs(meta.packageImports);
+        writeNodeRefs(meta.classDecls);
+        writeNodeRefs(meta.interfacePorts);
+
+        writeToken(body, meta.eofToken);
+        body.u8(uint8_t(meta.hasDefparams) | uint8_t(meta.hasBindDirectives) << 1);
+    }
+
+    void writeDiagnosticDirectives() {
+        // Diagnostic directives are stored in the source manager as a side effect of
+        // preprocessing, so they need to be replayed when the tree is loaded.
+        SmallVector<std::pair<uint32_t, std::span<const SourceManager::DiagnosticDirectiveInfo>>>
+            entries;
+        for (uint32_t i = 0; i < buffers.size(); i++) {
+            auto directives = sm.getDiagnosticDirectives(buffers[i]);
+            if (!directives.empty())
+                entries.emplace_back(i, directives);
+        }
+
+        body.varint(entries.size());
+        for (auto& [index, directives] : entries) {
+            body.varint(index);
+            body.varint(directives.size());
+            for (auto& directive : directives) {
+                body.string(directive.name);
+                body.varint(directive.offset);
+                body.u8(uint8_t(directive.severity));
+            }
+        }
+    }
+
+    const SourceManager& sm;
+    std::span<const SourceBuffer> sources;
+    flat_hash_map<uint32_t, uint32_t> bufferIndices;
+    std::vector<BufferID> buffers;
+    std::map<const char*, std::pair<const char*, uint32_t>> textRanges;
+    flat_hash_map<const SyntaxNode*, uint32_t> nodeIndices;
+    uint32_t numNodes = 0;
+};
+
+// Deserializes a syntax tree written by TreeWriter, recreating the buffers it
+// refers to in the given source manager.
+class TreeReader {
+public:
+    ByteReader in;
+    BumpAllocator alloc;
+
+    TreeReader(std::span<const char> data, SourceManager& sm,
+               std::span<const SourceBuffer> sources) :
+        in(data), sm(sm), sources(sources), factory(alloc) {}
+
+    // Checks that every entry in the buffer table can be recreated, without
+    // modifying the source manager, so that a stale cache file doesn't leave
+    // behind buffers and expansions for a tree that never gets used.
+    bool checkTable() {
+        auto start = in;
+        size_t count = in.varint();
+        for (size_t i = 0; i < count && !in.failed; i++) {
+            if (!checkEntry(i))
+                return false;
+        }
+
+        bool result = !in.failed;
+        in = start;
+        return result;
+    }
+
+    bool readTable() {
+        size_t count = in.varint();
+        for (size_t i = 0; i < count && !in.failed; i++) {
+            if (!readEntry())
+                return false;
+        }
+        return !in.failed;
+    }
+
+    SyntaxNode* root = nullptr;
+    std::vector<const DefineDirectiveSyntax*> macros;
+    ParserMetadata meta;
+
+    bool readTree() {
+        root = readNode();
+        if (!root || in.failed)
+            return false;
+
+        size_t numMacros = in.varint();
+        for (size_t i = 0; i < numMacros && !in.failed; i++) {
+            auto node = readNode();
+            if (!node || !DefineDirectiveSyntax::isKind(node->kind))
+                return false;
+            macros.push_back(&node->as<DefineDirectiveSyntax>());
+        }
+
+        return readMetadata(meta) && readDiagnosticDirectives() && in.atEnd() && !in.failed;
+    }
+
+    // Adds the diagnostic directives that were read to the source manager. This is
+    // deferred until the whole tree has been read successfully.
+    void addDiagnosticDirectives() {
+        for (auto& [loc, name, severity] : diagDirectives)
+            sm.addDiagnosticDirective(loc, name, severity);
+    }
+
+private:
+    struct Entry {
+        BufferID buffer;
+        std::string_view text;
+        const SourceLibrary* library = nullptr;
+    };
+
+    bool checkEntry(size_t numEntries) {
+        switch (EntryKind(in.u8())) {
+            case EntryKind::Root:
+                return in.varint() < sources.size() && !in.failed;
+            case EntryKind::File: {
+                auto path = in.string();
+                auto hash = in.u64();
+                if (!skipLoc(numEntries) || path.empty())
+                    return false;
+
+                std::vector<char> text;
+                return OS::readFile(widen(path), text) &&
+                       hashText(std::string_view(text.data(), text.size())) == hash;
+            }
+            case EntryKind::Text:
+                in.string();
+                in.string();
+                return skipLoc(numEntries);
+            case EntryKind::Expansion:
+                if (!skipLoc(numEntries) || !skipLoc(numEntries) || !skipLoc(numEntries))
+                    return false;
+                in.u8();
+                in.string();
+                return !in.failed;
+            default:
+                return false;
+        }
+    }
+
+    bool skipLoc(size_t numEntries) {
+        size_t index = in.varint();
+        if (index == 0)
+            in.varint();
+        in.varint();
+        return !in.failed && index <= numEntries;
+    }
+
+    bool readEntry() {
+        Entry entry;
+        switch (EntryKind(in.u8())) {
+            case EntryKind::Root: {
+                size_t index = in.varint();
+                if (index >= sources.size())
+                    return false;
+                entry = {sources[index].id, sources[index].data, sources[index].library};
+                break;
+            }
+            case EntryKind::File: {
+                auto path = in.string();
+                auto hash = in.u64();
+                auto includedFrom = readLoc();
+                if (in.failed || path.empty())
+                    return false;
+
+                auto library = getLibrary(includedFrom);
+                auto buffer = sm.readHeader(path, includedFrom, library, false);
+                if (!buffer || hashText(buffer.data) != hash)
+                    return false;
+
+                entry = {buffer.id, buffer.data, library};
+                break;
+            }
+            case EntryKind::Text: {
+                auto text = in.string();
+                auto name = in.string();
+                auto includedFrom = readLoc();
+                if (in.failed)
+                    return false;
+
+                auto library = getLibrary(includedFrom);
+                auto buffer = sm.assignText(text, includedFrom, library);
+                if (!name.empty())
+                    sm.addLineDirective(SourceLocation(buffer.id, 0), 2, name, 0);
+
+                entry = {buffer.id, buffer.data, library};
+                break;
+            }
+            case EntryKind::Expansion: {
+                auto original = readLoc();
+                auto start = readLoc();
+                auto end = readLoc();
+                bool isMacroArg = in.u8() != 0;
+                auto name = in.string();
+                if (in.failed)
+                    return false;
+
+                SourceLocation loc;
+                if (isMacroArg)
+                    loc = sm.createExpansionLoc(original, SourceRange(start, end), true);
+                else
+                    loc = sm.createExpansionLoc(original, SourceRange(start, end),
+                                                copyText(name));
+
+                entry = {loc.buffer(), {}, getLibrary(original)};
+                break;
+            }
+            default:
+                return false;
+        }
+
+        entries.push_back(entry);
+        return true;
+    }
+
+    const SourceLibrary* getLibrary(SourceLocation loc) const {
+        for (auto& entry : entries) {
+            if (entry.buffer == loc.buffer())
+                return entry.library;
+        }
+        return nullptr;
+    }
+
+    SourceLocation readLoc() {
+        size_t index = in.varint();
+        if (index == 0) {
+            auto id = uint32_t(in.varint());
+            auto offset = in.varint();
+            return SourceLocation(BufferID(id, ""sv), offset);
+        }
+
+        auto offset = in.varint();
+        if (--index >= entries.size()) {
+            in.failed = true;
+            return SourceLocation();
+        }
+        return SourceLocation(entries[index].buffer, offset);
+    }
+
+    std::string_view copyText(std::string_view text) {
+        if (text.empty())
+            return {};
+
+        auto ptr = (char*)alloc.allocate(text.size(), 1);
+        memcpy(ptr, text.data(), text.size());
+        return std::string_view(ptr, text.size());
+    }
+
+    std::string_view readText() {
+        switch (in.varint()) {
+            case 0:
+                return {};
+            case 1: {
+                size_t index = in.varint();
+                size_t offset = in.varint();
+                size_t size = in.varint();
+                if (index >= entries.size() || offset > entries[index].text.size() ||
+                    size > entries[index].text.size() - offset) {
+                    in.failed = true;
+                    return {};
+                }
+                return entries[index].text.substr(offset, size);
+            }
+            case 2:
+                return copyText(in.string());
+            default:
+                in.failed = true;
+                return {};
+        }
+    }
+
+    Token readToken() {
+        uint8_t flags = in.u8();
+        if ((flags & 1) == 0)
+            return Token();
+
+        auto kind = TokenKind(in.varint());
+        auto loc = readLoc();
+
+        Token result;
+        if (flags & 2) {
+            result = Token::createMissing(alloc, kind, loc);
+        }
+        else {
+            std::string_view rawText = LexerFacts::getTokenKindText(kind);
+            if (rawText.empty())
+                rawText = readText();
+
+            switch (kind) {
+                case TokenKind::StringLiteral:
+                    result = Token(alloc, kind, {}, rawText, loc, readText());
+                    break;
+                case TokenKind::Directive:
+                case TokenKind::MacroUsage:
+                    result = Token(alloc, kind, {}, rawText, loc, SyntaxKind(in.varint()));
+                    break;
+                case TokenKind::UnbasedUnsizedLiteral:
+                    result = Token(alloc, kind, {}, rawText, loc, logic_t(in.u8()));
+                    break;
+                case TokenKind::IntegerLiteral: {
+                    auto bits = bitwidth_t(in.varint());
+                    uint8_t intFlags = in.u8();
+                    if (!bits || bits > SVInt::MAX_BITS) {
+                        in.failed = true;
+                        return Token();
+                    }
+
+                    SVIntStorage storage(bits, intFlags & 1, (intFlags & 2) != 0);
+                    size_t numWords = (bits + SVInt::BITS_PER_WORD - 1) / SVInt::BITS_PER_WORD;
+                    if (storage.unknownFlag)
+                        numWords *= 2;
+                    auto words = in.bytes(sizeof(uint64_t) * numWords);
+                    if (!words)
+                        return Token();
+
+                    SmallVector<uint64_t> buffer(numWords, UninitializedTag());
+                    buffer.resize(numWords);
+                    memcpy(buffer.data(), words, sizeof(uint64_t) * numWords);
+                    if (numWords == 1)
+                        storage.val = buffer[0];
+                    else
+                        storage.pVal = buffer.data();
+
+                    result = Token(alloc, kind, {}, rawText, loc, SVInt(storage));
+                    break;
+                }
+                case TokenKind::RealLiteral:
+                case TokenKind::TimeLiteral: {
+                    double value = 0;
+                    if (auto ptr = in.bytes(sizeof(value)))
+                        memcpy(&value, ptr, sizeof(value));
+
+                    NumericTokenFlags numFlags{in.u8()};
+                    std::optional<TimeUnit> unit;
+                    if (kind == TokenKind::TimeLiteral)
+                        unit = numFlags.unit();
+
+                    result = Token(alloc, kind, {}, rawText, loc, value, numFlags.outOfRange(),
+                                   unit);
+                    break;
+                }
+                case TokenKind::IntegerBase: {
+                    NumericTokenFlags numFlags{in.u8()};
+                    result = Token(alloc, kind, {}, rawText, loc, numFlags.base(),
+                                   numFlags.isSigned());
+                    break;
+                }
+                default:
+                    result = Token(alloc, kind, {}, rawText, loc);
+                    break;
+            }
+        }
+
+        if (flags & 4) {
+            size_t count = in.varint();
+            SmallVector<Trivia> trivia;
+            for (size_t i = 0; i < count && !in.failed; i++)
+                trivia.push_back(readTrivia());
+
+            result = result.withTrivia(alloc, trivia);
+        }
+
+        return result;
+    }
+
+    Trivia readTrivia() {
+        auto kind = TriviaKind(in.u8());
+        switch (kind) {
+            case TriviaKind::Directive:
+            case TriviaKind::SkippedSyntax: {
+                auto node = readNode();
+                if (!node)
+                    in.failed = true;
+                return Trivia(kind, node);
+            }
+            case TriviaKind::SkippedTokens: {
+                size_t count = in.varint();
+                SmallVector<Token> tokens;
+                for (size_t i = 0; i < count && !in.failed; i++) {
+                    if (in.u8() != uint8_t(NodeTag::Token)) {
+                        in.failed = true;
+                        break;
+                    }
+                    tokens.push_back(readToken());
+                }
+                return Trivia(kind, tokens.copy(alloc));
+            }
+            default: {
+                std::optional<SourceLocation> loc;
+                if (in.u8())
+                    loc = readLoc();
+
+                Trivia result(kind, readText());
+                if (loc)
+                    result = result.withLocation(alloc, *loc);
+                return result;
+            }
+        }
+    }
+
+    bool readChild(TokenOrSyntax& child, BumpAllocator& listAlloc) {
+        switch (NodeTag(in.u8())) {
+            case NodeTag::Null:
+                child = nullptr;
+                return true;
+            case NodeTag::Token:
+                child = readToken();
+                return !in.failed;
+            case NodeTag::Node:
+                child = readNodeBody();
+                return child.node() != nullptr;
+            case NodeTag::List:
+                child = readList(listAlloc);
+                return child.node() != nullptr;
+            case NodeTag::Ref: {
+                size_t index = in.varint();
+                if (index >= nodes.size())
+                    return false;
+                child = nodes[index];
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    SyntaxNode* readNode() {
+        // Lists that aren't children of another node must live in the tree itself.
+        TokenOrSyntax child = nullptr;
+        if (!readChild(child, alloc) || !child.isNode())
+            return nullptr;
+        return child.node();
+    }
+
+    SyntaxNode* readNodeBody() {
+        auto kind = SyntaxKind(in.varint());
+        size_t count = in.varint();
+
+        SmallVector<TokenOrSyntax> children;
+        for (size_t i = 0; i < count; i++) {
+            if (!readChild(children.emplace_back(nullptr), scratchAlloc))
+                return nullptr;
+        }
+
+        auto node = factory.createNode(kind, children);
+        if (node)
+            nodes.push_back(node);
+        return node;
+    }
+
+    SyntaxListBase* readList(BumpAllocator& listAlloc) {
+        auto kind = SyntaxKind(in.varint());
+        size_t count = in.varint();
+
+        SmallVector<TokenOrSyntax> children;
+        for (size_t i = 0; i < count; i++) {
+            if (!readChild(children.emplace_back(nullptr), scratchAlloc))
+                return nullptr;
+        }
+
+        // The element type doesn't matter here; these lists are only used
+        // as a source of children to copy into the typed list of their parent.
+        switch (kind) {
+            case SyntaxKind::SyntaxList: {
+                SmallVector<SyntaxNode*> elements;
+                for (auto& child : children) {
+                    if (!child.isNode() || !child.node())
+                        return nullptr;
+                    elements.push_back(child.node());
+                }
+                return listAlloc.emplace<SyntaxList<SyntaxNode>>(elements.copy(listAlloc));
+            }
+            case SyntaxKind::TokenList: {
+                SmallVector<Token> elements;
+                for (auto& child : children) {
+                    if (!child.isToken())
+                        return nullptr;
+                    elements.push_back(child.token());
+                }
+                return listAlloc.emplace<TokenList>(elements.copy(listAlloc));
+            }
+            case SyntaxKind::SeparatedList:
+                return listAlloc.emplace<SeparatedSyntaxList<SyntaxNode>>(
+                    children.copy(listAlloc));
+            default:
+                return nullptr;
+        }
+    }
+
+    template<typename T>
+    bool readNodeRefs(std::vector<const T*>& results) {
+        size_t count = in.varint();
+        for (size_t i = 0; i < count; i++) {
+            auto node = readNodeRef();
+            if (!node || !T::isKind(node->kind))
+                return false;
+            results.push_back(&node->template as<T>());
+        }
+        return true;
+    }
+
+    SyntaxNode* readNodeRef() {
+        size_t index = in.varint();
+        if (in.failed || index >= nodes.size())
+            return nullptr;
+        return nodes[index];
+    }
+
+    bool readMetadata(ParserMetadata& meta) {
+        size_t count = in.varint();
+        for (size_t i = 0; i < count; i++) {
+            auto node = readNodeRef();
+            size_t libIndex = in.varint();
+            if (!node || libIndex > sources.size())
+                return false;
+
+            ParserMetadata::Node info;
+            info.library = libIndex ? sources[libIndex - 1].library : nullptr;
+            info.defaultNetType = TokenKind(in.varint());
+            info.unconnectedDrive = TokenKind(in.varint());
+            if (in.u8()) {
+                TimeScale ts;
+                ts.base.unit = TimeUnit(in.u8());
+                ts.base.magnitude = TimeScaleMagnitude(in.u8());
+                ts.precision.unit = TimeUnit(in.u8());
+                ts.precision.magnitude = TimeScaleMagnitude(in.u8());
+                info.timeScale = ts;
+            }
+            meta.nodeMap.emplace(node, info);
+        }
+
+        count = in.varint();
+        for (size_t i = 0; i < count && !in.failed; i++)
+            meta.globalInstances.emplace(copyText(in.string()));
+
+        if (!readNodeRefs(meta.classPackageNames) || !readNodeRefs(meta.packageImports) ||
+            !readNodeRefs(meta.classDecls) || !readNodeRefs(meta.interfacePorts)) {
+            return false;
+        }
+
+        if (in.u8() != uint8_t(NodeTag::Token))
+            return false;
+
+        meta.eofToken = readToken();
+        uint8_t flags = in.u8();
+        meta.hasDefparams = (flags & 1) != 0;
+        meta.hasBindDirectives = (flags & 2) != 0;
+        return !in.failed;
+    }
+
+    bool readDiagnosticDirectives() {
+        size_t count = in.varint();
+        for (size_t i = 0; i < count && !in.failed; i++) {
+            size_t index = in.varint();
+            size_t numDirectives = in.varint();
+            if (index >= entries.size())
+                return false;
+
+            for (size_t j = 0; j < numDirectives && !in.failed; j++) {
+                auto name = copyText(in.string());
+                size_t offset = in.varint();
+                auto severity = DiagnosticSeverity(in.u8());
+                diagDirectives.push_back(
+                    {SourceLocation(entries[index].buffer, offset), name, severity});
+            }
+        }
+        return !in.failed;
+    }
+
+    SourceManager& sm;
+    std::span<const SourceBuffer> sources;
+    SyntaxFactory factory;
+    BumpAllocator scratchAlloc;
+    std::vector<Entry> entries;
+    std::vector<SyntaxNode*> nodes;
+    std::vector<std::tuple<SourceLocation, std::string_view, DiagnosticSeverity>> diagDirectives;
+};
+
+bool hasLineDirectives(const SyntaxNode& node);
+
+bool hasLineDirectives(Token token) {
+    for (auto& trivia : token.trivia()) {
+        if (auto syntax = trivia.syntax()) {
+            if (syntax->kind == SyntaxKind::LineDirective || hasLineDirectives(*syntax))
+                return true;
+        }
+        for (auto skipped : trivia.getSkippedTokens()) {
+            if (hasLineDirectives(skipped))
+                return true;
+        }
+    }
+    return false;
+}
+
+bool hasLineDirectives(const SyntaxNode& node) {
+    for (size_t i = 0; i < node.getChildCount(); i++) {
+        if (auto child = node.childNode(i)) {
+            if (hasLineDirectives(*child))
+                return true;
+        }
+        else if (auto token = node.childToken(i); token && hasLineDirectives(token)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+SyntaxTreeCache::SyntaxTreeCache(fs::path directory) : directory(std::move(directory)) {
+}
+
+std::vector<char> SyntaxTreeCache::getKey(const SourceManager& sourceManager,
+                                          std::span<const SourceBuffer> sources,
+                                          const Bag& options, MacroList inheritedMacros) {
+    ByteWriter key;
+    key.bytes(Magic, sizeof(Magic));
+    key.varint(FormatVersion);
+
+    key.varint(sources.size());
+    for (auto& buffer : sources) {
+        key.string(getU8Str(sourceManager.getFullPath(buffer.id)));
+        key.u64(hashText(buffer.data));
+    }
+
+    // Included files are stored by their full path, so any change to the
+    // directories that were searched to find them can change the result.
+    for (auto& dirs : {sourceManager.getUserDirectories(), sourceManager.getSystemDirectories()}) {
+        key.varint(dirs.size());
+        for (auto& dir : dirs)
+            key.string(getU8Str(dir));
+    }
+
+    auto ppOptions = options.getOrDefault<PreprocessorOptions>();
+    key.varint(ppOptions.maxIncludeDepth);
+    key.string(ppOptions.predefineSource);
+    key.varint(ppOptions.predefines.size());
+    for (auto& str : ppOptions.predefines)
+        key.string(str);
+    key.varint(ppOptions.undefines.size());
+    for (auto& str : ppOptions.undefines)
+        key.string(str);
+
+    std::vector<std::string_view> ignored(ppOptions.ignoreDirectives.begin(),
+                                          ppOptions.ignoreDirectives.end());
+    std::ranges::sort(ignored);
+    key.varint(ignored.size());
+    for (auto str : ignored)
+        key.string(str);
+
+    key.varint(options.getOrDefault<LexerOptions>().maxErrors);
+    key.varint(options.getOrDefault<LexerOptions>().leanTrivia);
+    auto parserOptions = options.getOrDefault<ParserOptions>();
+    key.varint(parserOptions.maxRecursionDepth);
+    key.varint(parserOptions.deferSubroutineBodies);
+
+    key.varint(inheritedMacros.size());
+    for (auto macro : inheritedMacros)
+        key.string(macro->toString());
+
+    return std::move(key.data);
+}
+
+fs::path SyntaxTreeCache::getPath(std::span<const char> key) const {
+    auto hash = slang::detail::hashing::hash(key.data(), key.size());
+    return directory / fmt::format("{:016x}.sltc", hash);
+}
+
+std::shared_ptr<SyntaxTree> SyntaxTreeCache::load(std::span<const char> key,
+                                                  SourceManager& sourceManager,
+                                                  std::span<const SourceBuffer> sources,
+                                                  const Bag& options) const {
+    std::vector<char> data;
+    if (!OS::readFile(getPath(key), data))
+        return nullptr;
+
+    // Remove the null terminator added by readFile along with the trailing checksum.
+    if (data.size() < sizeof(uint64_t) + 1)
+        return nullptr;
+
+    size_t payloadSize = data.size() - sizeof(uint64_t) - 1;
+    uint64_t checksum;
+    memcpy(&checksum, data.data() + payloadSize, sizeof(checksum));
+    if (checksum != slang::detail::hashing::hash(data.data(), payloadSize))
+        return nullptr;
+
+    ByteReader header({data.data(), payloadSize});
+    auto storedKey = header.string();
+    if (header.failed || storedKey != std::string_view(key.data(), key.size()))
+        return nullptr;
+
+    size_t headerSize = storedKey.data() + storedKey.size() - data.data();
+    TreeReader reader(std::span(data.data() + headerSize, payloadSize - headerSize), sourceManager,
+                      sources);
+    // Everything the tree refers to is checked up front; after that, reading
+    // can only fail if the file is malformed despite passing its checksum.
+    if (!reader.checkTable() || !reader.readTable() || !reader.readTree())
+        return nullptr;
+
+    reader.addDiagnosticDirectives();
+
+    return std::shared_ptr<SyntaxTree>(new SyntaxTree(reader.root, sourceManager,
+                                                      std::move(reader.alloc), {},
+                                                      std::move(reader.meta),
+                                                      std::move(reader.macros), options));
+}
+
+bool SyntaxTreeCache::store(std::span<const char> key, const SyntaxTree& tree,
+                            std::span<const SourceBuffer> sources) const {
+    // Trees with diagnostics aren't cached, since reproducing them would require
+    // serializing the diagnostics as well. `line directives modify state in the
+    // source manager that can't be reconstructed when the tree is loaded.
+    // Deferred subroutine bodies aren't part of the tree, so they'd be lost.
+    if (!tree.diagnostics().empty() || !tree.getMetadata().deferredBodies.empty() ||
+        hasLineDirectives(tree.root())) {
+        return false;
+    }
+
+    TreeWriter writer(tree.sourceManager(), sources);
+    writer.writeTree(tree);
+    if (!writer.ok)
+        return false;
+
+    ByteWriter out;
+    out.string({key.data(), key.size()});
+    out.varint(writer.numEntries);
+    out.append(writer.table);
+    out.append(writer.body);
+    out.u64(slang::detail::hashing::hash(out.data.data(), out.data.size()));
+
+    // Write to a temporary file first and then rename it into place, so that
+    // concurrent readers never see a partially written file.
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+
+    auto path = getPath(key);
+    auto tempPath = path;
+    tempPath += fmt::format(".{:x}.tmp", std::random_device()());
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file.write(out.data.data(), std::streamsize(out.data.size())))
+            return false;
+    }
+
+    fs::rename(tempPath, path, ec);
+    if (ec) {
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+} // namespace slang::syntax
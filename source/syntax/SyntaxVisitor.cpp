@@ -7,6 +7,8 @@
 //------------------------------------------------------------------------------
 #include "slang/syntax/SyntaxVisitor.h"
 
+#include "slang/parsing/ParserMetadata.h"
+
 namespace {
 
 using namespace slang;
@@ -17,16 +19,60 @@ struct CloneVisitor {
     BumpAllocator& alloc;
     const ChangeCollection& commits;
 
+    // When sharing unchanged nodes, only the nodes in this set (those with
+    // changes somewhere beneath them) get cloned; everything else is reused,
+    // and any nodes that are cloned or inserted are recorded in editedNodes.
+    const flat_hash_set<const SyntaxNode*>* toRebuild = nullptr;
+    flat_hash_map<const SyntaxNode*, SyntaxEditKind>* editedNodes = nullptr;
+
+    // The changes that were made, in tree order, for updating parser metadata.
+    flat_hash_map<const SyntaxNode*, SyntaxNode*> rebuiltNodes;
+    SmallVector<const SyntaxNode*> removedNodes;
+    SmallVector<const SyntaxNode*> insertedNodes;
+
+    // The parents in the new tree of shared and inserted nodes, whose own
+    // parent pointers can't be changed without affecting the trees they're from.
+    flat_hash_map<const SyntaxNode*, const SyntaxNode*> parents;
+
     CloneVisitor(BumpAllocator& alloc, const ChangeCollection& commits) :
         alloc(alloc), commits(commits) {}
 
+    SyntaxNode* inserted(SyntaxNode* node) {
+        if (editedNodes && node) {
+            editedNodes->emplace(node, SyntaxEditKind::Inserted);
+            insertedNodes.push_back(node);
+        }
+        return node;
+    }
+
+    template<typename T>
+    void setChild(T& parent, size_t index, SyntaxNode* child) {
+        parent.setChild(index, child);
+
+        // Lists are stored by value in their parent, so setting one copies it
+        // and the copy needs to be recorded with the same kind of edit.
+        if (editedNodes && child) {
+            if (auto actual = parent.childNode(index); actual && actual != child) {
+                if (auto it = editedNodes->find(child); it != editedNodes->end())
+                    editedNodes->emplace(actual, it->second);
+            }
+        }
+    }
+
 #ifdef _MSC_VER
 #    pragma warning(push)
 #    pragma warning(disable : 4127) // conditional expression is constant
 #endif
     template<typename T>
     SyntaxNode* visit(const T& node) {
+        if (toRebuild && !toRebuild->contains(&node))
+            return const_cast<T*>(&node);
+
         T* cloned = clone(node, alloc);
+        if (editedNodes) {
+            editedNodes->emplace(cloned, SyntaxEditKind::Rebuilt);
+            rebuiltNodes.emplace(&node, cloned);
+        }
 
         constexpr bool IsList = std::is_same_v<T, SyntaxListBase>;
         SmallVector<TokenOrSyntax, 8> listBuffer;
@@ -39,7 +85,7 @@ struct CloneVisitor {
                 for (const auto& change : it->second) {
                     if (!listBuffer.empty() && change.separator)
                         listBuffer.push_back(change.separator);
-                    listBuffer.push_back(change.second);
+                    listBuffer.push_back(inserted(change.second));
                     lastChange = &change;
                 }
 
@@ -63,16 +109,19 @@ struct CloneVisitor {
                 }
 
                 for (const auto& change : it->second)
-                    listBuffer.push_back(change.second);
+                    listBuffer.push_back(inserted(change.second));
             }
 
             if (auto it = commits.removeOrReplace.find(child);
                 it != commits.removeOrReplace.end()) {
+                if (editedNodes)
+                    removedNodes.push_back(child);
+
                 if (auto replaceChange = std::get_if<ReplaceChange>(&it->second)) {
                     if constexpr (IsList)
-                        listBuffer.push_back(replaceChange->second);
+                        listBuffer.push_back(inserted(replaceChange->second));
                     else
-                        cloned->setChild(i, replaceChange->second);
+                        setChild(*cloned, i, inserted(replaceChange->second));
                 }
                 else {
                     if constexpr (!IsList) {
@@ -86,7 +135,7 @@ struct CloneVisitor {
                     listBuffer.push_back(child->visit(*this));
                 }
                 else {
-                    cloned->setChild(i, child->visit(*this));
+                    setChild(*cloned, i, child->visit(*this));
                 }
             }
 
@@ -97,7 +146,7 @@ struct CloneVisitor {
                 }
 
                 for (const auto& change : it->second)
-                    listBuffer.push_back(change.second);
+                    listBuffer.push_back(inserted(change.second));
             }
         }
 
@@ -108,12 +157,43 @@ struct CloneVisitor {
                 for (const auto& change : it->second) {
                     if (!listBuffer.empty() && change.separator)
                         listBuffer.push_back(change.separator);
-                    listBuffer.push_back(change.second);
+                    listBuffer.push_back(inserted(change.second));
                 }
             }
 
             cloned->resetAll(alloc, listBuffer);
         }
+        else if (editedNodes) {
+            // Point the children at their new parent. Only the ones copied here belong
+            // to the new tree; the rest are recorded on the side. Elements of a list
+            // have the node that owns the list (which embeds the list) as their parent.
+            auto setParent = [&](SyntaxNode& child) {
+                if (auto it = editedNodes->find(&child);
+                    it != editedNodes->end() && it->second == SyntaxEditKind::Rebuilt) {
+                    child.parent = cloned;
+                }
+                else {
+                    parents[&child] = cloned;
+                }
+            };
+
+            for (size_t i = 0; i < cloned->getChildCount(); i++) {
+                auto child = cloned->childNode(i);
+                if (!child)
+                    continue;
+
+                if (SyntaxListBase::isKind(child->kind)) {
+                    child->parent = cloned;
+                    for (size_t j = 0; j < child->getChildCount(); j++) {
+                        if (auto elem = child->childNode(j))
+                            setParent(*elem);
+                    }
+                }
+                else {
+                    setParent(*child);
+                }
+            }
+        }
 
         return cloned;
     }
@@ -122,6 +202,94 @@ struct CloneVisitor {
 #endif
 };
 
+// Marks every node beneath (and including) the given one that has to be rebuilt
+// to apply the changes: parents of changed nodes, lists being inserted into,
+// and all of their ancestors. Returns true if the given node was marked.
+bool markNodesToRebuild(const SyntaxNode& node, const ChangeCollection& commits,
+                        flat_hash_set<const SyntaxNode*>& results) {
+    bool any = commits.listInsertAtFront.contains(&node) ||
+               commits.listInsertAtBack.contains(&node);
+
+    for (size_t i = 0; i < node.getChildCount(); i++) {
+        if (auto child = node.childNode(i)) {
+            if (commits.insertBefore.contains(child) || commits.insertAfter.contains(child) ||
+                commits.removeOrReplace.contains(child)) {
+                any = true;
+            }
+            any |= markNodesToRebuild(*child, commits, results);
+        }
+    }
+
+    if (any)
+        results.insert(&node);
+    return any;
+}
+
+// Finds the node that directly holds the given one as a child in the given tree.
+// Elements of a list have the node that owns the list as their parent rather than
+// the list itself, so this has to look through the parent's lists to find it.
+const SyntaxNode* findContainer(const SyntaxTree& tree, const SyntaxNode& node) {
+    auto parent = tree.getParent(node);
+    if (!parent)
+        return nullptr;
+
+    for (size_t i = 0; i < parent->getChildCount(); i++) {
+        auto child = parent->childNode(i);
+        if (child == &node)
+            return parent;
+
+        if (child && SyntaxListBase::isKind(child->kind)) {
+            for (size_t j = 0; j < child->getChildCount(); j++) {
+                if (child->childNode(j) == &node)
+                    return child;
+            }
+        }
+    }
+    return nullptr;
+}
+
+flat_hash_set<const SyntaxNode*> findNodesToRebuild(const SyntaxTree& tree,
+                                                    const ChangeCollection& commits) {
+    // Walking up the parents of each change only touches the nodes along the way
+    // (and their siblings). If a walk doesn't reach the root, for instance because
+    // a change refers to a node that isn't in the tree, we fall back to searching
+    // the whole tree.
+    auto& root = tree.root();
+    flat_hash_set<const SyntaxNode*> results;
+    SmallVector<const SyntaxNode*> path;
+    auto markFrom = [&](const SyntaxNode* node) {
+        path.clear();
+        while (node && node != &root && !results.contains(node)) {
+            path.push_back(node);
+            node = findContainer(tree, *node);
+        }
+
+        if (!node)
+            return false;
+
+        path.push_back(node);
+        results.insert(path.begin(), path.end());
+        return true;
+    };
+
+    auto markAll = [&](auto& map, bool fromContainer) {
+        for (auto& [node, _] : map) {
+            if (!markFrom(fromContainer ? findContainer(tree, *node) : node))
+                return false;
+        }
+        return true;
+    };
+
+    if (!markAll(commits.insertBefore, true) || !markAll(commits.insertAfter, true) ||
+        !markAll(commits.removeOrReplace, true) || !markAll(commits.listInsertAtFront, false) ||
+        !markAll(commits.listInsertAtBack, false)) {
+        results.clear();
+        markNodesToRebuild(root, commits, results);
+    }
+
+    return results;
+}
+
 } // namespace
 
 namespace slang::syntax::detail {
@@ -130,8 +298,17 @@ std::shared_ptr<SyntaxTree> transformTree(BumpAllocator&& alloc,
                                           const std::shared_ptr<SyntaxTree>& tree,
                                           const ChangeCollection& commits,
                                           const std::vector<std::shared_ptr<SyntaxTree>>& tempTrees,
-                                          const SourceLibrary* library) {
+                                          const SourceLibrary* library,
+                                          bool shareUnchanged) {
     CloneVisitor visitor(alloc, commits);
+    flat_hash_set<const SyntaxNode*> toRebuild;
+    flat_hash_map<const SyntaxNode*, SyntaxEditKind> editedNodes;
+    if (shareUnchanged) {
+        toRebuild = findNodesToRebuild(*tree, commits);
+        visitor.toRebuild = &toRebuild;
+        visitor.editedNodes = &editedNodes;
+    }
+
     SyntaxNode* root = tree->root().visit(visitor);
 
     // Steal ownership of any temporary syntax trees that the user created; once we return the
@@ -139,6 +316,25 @@ std::shared_ptr<SyntaxTree> transformTree(BumpAllocator&& alloc,
     for (auto& t : tempTrees)
         alloc.steal(std::move(t->allocator()));
 
+    if (shareUnchanged) {
+        // Nodes not reparented by this edit have the same parent as in the tree it was
+        // applied to (copies made here aren't in that tree and use their own pointers).
+        auto getParent = [&](const SyntaxNode& node) {
+            if (auto it = visitor.parents.find(&node); it != visitor.parents.end())
+                return it->second;
+            return tree->getParent(node);
+        };
+
+        auto metadata = parsing::ParserMetadata::fromSharedEdit(tree->getMetadata(), *root,
+                                                                visitor.rebuiltNodes,
+                                                                visitor.removedNodes,
+                                                                visitor.insertedNodes, getParent,
+                                                                library);
+        return std::make_shared<SyntaxTree>(root, tree->sourceManager(), std::move(alloc), tree,
+                                            std::move(metadata), std::move(editedNodes),
+                                            std::move(visitor.parents));
+    }
+
     return std::make_shared<SyntaxTree>(root, tree->sourceManager(), std::move(alloc), library,
                                         tree);
 }
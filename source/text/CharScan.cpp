@@ -0,0 +1,243 @@
+//------------------------------------------------------------------------------
+// CharScan.cpp
+// Vectorized helpers for scanning through source text
+//
+// SPDX-FileCopyrightText: Michael Popoloski
+// SPDX-License-Identifier: MIT
+//------------------------------------------------------------------------------
+#include "CharScan.h"
+
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    define SLANG_CHARSCAN_X86
+#    if defined(_MSC_VER) && !defined(__clang__)
+#        include <intrin.h>
+#        define SLANG_TARGET_AVX2
+#    else
+#        include <immintrin.h>
+#        define SLANG_TARGET_AVX2 __attribute__((target("avx2")))
+#    endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#    define SLANG_CHARSCAN_NEON
+#    include <arm_neon.h>
+#endif
+
+namespace slang::charscan {
+
+// Each matcher describes a class of characters to search for, with one
+// implementation per supported instruction set. The vector versions return
+// a bitmask with one bit set for each matching byte in the input.
+
+// Matches any of the given characters, and optionally also any byte
+// outside of the ASCII range (so that callers can validate UTF-8 sequences).
+template<bool NonASCII, char... Cs>
+struct AnyOfMatcher {
+    static bool scalar(char c) {
+        return (NonASCII && (unsigned char)c >= 0x80) || ((c == Cs) || ...);
+    }
+
+#if defined(SLANG_CHARSCAN_X86)
+    static uint32_t sse2(__m128i v) {
+        __m128i result = NonASCII ? v : _mm_setzero_si128();
+        ((result = _mm_or_si128(result, _mm_cmpeq_epi8(v, _mm_set1_epi8(Cs)))), ...);
+        return (uint32_t)_mm_movemask_epi8(result);
+    }
+
+    SLANG_TARGET_AVX2 static uint32_t avx2(__m256i v) {
+        __m256i result = NonASCII ? v : _mm256_setzero_si256();
+        ((result = _mm256_or_si256(result, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(Cs)))), ...);
+        return (uint32_t)_mm256_movemask_epi8(result);
+    }
+#elif defined(SLANG_CHARSCAN_NEON)
+    static uint8x16_t neon(uint8x16_t v) {
+        uint8x16_t result = NonASCII ? vcgeq_u8(v, vdupq_n_u8(0x80)) : vdupq_n_u8(0);
+        ((result = vorrq_u8(result, vceqq_u8(v, vdupq_n_u8((uint8_t)Cs)))), ...);
+        return result;
+    }
+#endif
+};
+
+// Matches the characters that can appear in an identifier: [a-zA-Z0-9_$]
+struct IdentifierMatcher {
+    static bool scalar(char c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+               c == '_' || c == '$';
+    }
+
+#if defined(SLANG_CHARSCAN_X86)
+    // Note that the signed comparisons below never match bytes >= 0x80,
+    // which is what we want since those can't be part of an identifier.
+    static uint32_t sse2(__m128i v) {
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                      _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                      _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+        __m128i other = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('$')));
+        return (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), other));
+    }
+
+    SLANG_TARGET_AVX2 static uint32_t avx2(__m256i v) {
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i alpha = _mm256_andnot_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('z')),
+                                            _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)));
+        __m256i digit = _mm256_andnot_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('9')),
+                                            _mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)));
+        __m256i other = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')),
+                                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('$')));
+        return (uint32_t)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_or_si256(alpha, digit), other));
+    }
+#elif defined(SLANG_CHARSCAN_NEON)
+    static uint8x16_t neon(uint8x16_t v) {
+        uint8x16_t lower = vorrq_u8(v, vdupq_n_u8(0x20));
+        uint8x16_t alpha = vandq_u8(vcgeq_u8(lower, vdupq_n_u8('a')),
+                                    vcleq_u8(lower, vdupq_n_u8('z')));
+        uint8x16_t digit = vandq_u8(vcgeq_u8(v, vdupq_n_u8('0')), vcleq_u8(v, vdupq_n_u8('9')));
+        uint8x16_t other = vorrq_u8(vceqq_u8(v, vdupq_n_u8('_')), vceqq_u8(v, vdupq_n_u8('$')));
+        return vorrq_u8(vorrq_u8(alpha, digit), other);
+    }
+#endif
+};
+
+// Matches every character that the wrapped matcher does not.
+template<typename TMatcher>
+struct NotMatcher {
+    static bool scalar(char c) { return !TMatcher::scalar(c); }
+
+#if defined(SLANG_CHARSCAN_X86)
+    static uint32_t sse2(__m128i v) { return ~TMatcher::sse2(v) & 0xffff; }
+    SLANG_TARGET_AVX2 static uint32_t avx2(__m256i v) { return ~TMatcher::avx2(v); }
+#elif defined(SLANG_CHARSCAN_NEON)
+    static uint8x16_t neon(uint8x16_t v) { return vmvnq_u8(TMatcher::neon(v)); }
+#endif
+};
+
+using NewlineMatcher = AnyOfMatcher<false, '\n', '\r'>;
+using WhitespaceMatcher = AnyOfMatcher<false, ' ', '\t', '\v', '\f'>;
+using LineCommentMatcher = AnyOfMatcher<true, '\n', '\r', '\0'>;
+using BlockCommentMatcher = AnyOfMatcher<true, '*', '/', '\0'>;
+using StringLiteralMatcher = AnyOfMatcher<true, '"', '\\', '\n', '\r', '\0'>;
+
+template<typename TMatcher>
+static const char* scanScalar(const char* ptr, const char* end) {
+    while (ptr != end && !TMatcher::scalar(*ptr))
+        ptr++;
+    return ptr;
+}
+
+#if defined(SLANG_CHARSCAN_X86)
+
+template<typename TMatcher>
+static const char* scanSSE2(const char* ptr, const char* end) {
+    while (end - ptr >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        if (uint32_t mask = TMatcher::sse2(v))
+            return ptr + std::countr_zero(mask);
+        ptr += 16;
+    }
+    return scanScalar<TMatcher>(ptr, end);
+}
+
+template<typename TMatcher>
+SLANG_TARGET_AVX2 static const char* scanAVX2(const char* ptr, const char* end) {
+    while (end - ptr >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+        if (uint32_t mask = TMatcher::avx2(v))
+            return ptr + std::countr_zero(mask);
+        ptr += 32;
+    }
+    return scanSSE2<TMatcher>(ptr, end);
+}
+
+static bool cpuHasAVX2() {
+#    if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    // Check that the OS saves the AVX register state (OSXSAVE + AVX bits),
+    // and then check for AVX2 itself.
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+        return false;
+    if ((_xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#    else
+    return __builtin_cpu_supports("avx2");
+#    endif
+}
+
+#elif defined(SLANG_CHARSCAN_NEON)
+
+template<typename TMatcher>
+static const char* scanNEON(const char* ptr, const char* end) {
+    while (end - ptr >= 16) {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(ptr));
+        uint8x16_t matches = TMatcher::neon(v);
+
+        // Narrow each 8-bit lane result down to 4 bits so that the
+        // whole comparison fits in a single 64-bit integer.
+        uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+        if (mask)
+            return ptr + (std::countr_zero(mask) >> 2);
+        ptr += 16;
+    }
+    return scanScalar<TMatcher>(ptr, end);
+}
+
+#endif
+
+// Selects the best implementation of a scan for the current CPU.
+// The choice is made once, the first time a given scan is used.
+template<typename TMatcher>
+static const char* scan(const char* ptr, const char* end) {
+    using ScanFunc = const char* (*)(const char*, const char*);
+    static const ScanFunc func = []() -> ScanFunc {
+#if defined(SLANG_CHARSCAN_X86)
+        if (cpuHasAVX2())
+            return &scanAVX2<TMatcher>;
+        return &scanSSE2<TMatcher>;
+#elif defined(SLANG_CHARSCAN_NEON)
+        return &scanNEON<TMatcher>;
+#else
+        return &scanScalar<TMatcher>;
+#endif
+    }();
+
+    return func(ptr, end);
+}
+
+const char* findNewline(const char* ptr, const char* end) {
+    return scan<NewlineMatcher>(ptr, end);
+}
+
+const char* skipWhitespace(const char* ptr, const char* end) {
+    return scan<NotMatcher<WhitespaceMatcher>>(ptr, end);
+}
+
+const char* skipIdentifier(const char* ptr, const char* end) {
+    return scan<NotMatcher<IdentifierMatcher>>(ptr, end);
+}
+
+const char* findLineCommentSpecial(const char* ptr, const char* end) {
+    return scan<LineCommentMatcher>(ptr, end);
+}
+
+const char* findBlockCommentSpecial(const char* ptr, const char* end) {
+    return scan<BlockCommentMatcher>(ptr, end);
+}
+
+const char* findStringLiteralSpecial(const char* ptr, const char* end) {
+    return scan<StringLiteralMatcher>(ptr, end);
+}
+
+} // namespace slang::charscan
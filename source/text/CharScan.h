@@ -0,0 +1,41 @@
+//------------------------------------------------------------------------------
+// CharScan.h
+// Vectorized helpers for scanning through source text
+//
+// SPDX-FileCopyrightText: Michael Popoloski
+// SPDX-License-Identifier: MIT
+//------------------------------------------------------------------------------
+#pragma once
+
+namespace slang::charscan {
+
+// Each of these functions scans forward through the range [ptr, end) looking
+// for a particular class of character, returning a pointer to the first one
+// found or @a end if there is none. They process 16 or 32 bytes at a time
+// using whichever vector instruction set the CPU supports (checked once at
+// runtime) and fall back to a simple loop for the tail of the range.
+
+/// Finds the first newline character ('\n' or '\r').
+const char* findNewline(const char* ptr, const char* end);
+
+/// Finds the first character that is not horizontal whitespace
+/// (' ', '\t', '\v', or '\f').
+const char* skipWhitespace(const char* ptr, const char* end);
+
+/// Finds the first character that can't be part of an identifier,
+/// i.e. anything other than [a-zA-Z0-9_$].
+const char* skipIdentifier(const char* ptr, const char* end);
+
+/// Finds the first character that needs special handling inside a line
+/// comment: a newline, a null, or a non-ASCII byte.
+const char* findLineCommentSpecial(const char* ptr, const char* end);
+
+/// Finds the first character that needs special handling inside a block
+/// comment: '*', '/', a null, or a non-ASCII byte.
+const char* findBlockCommentSpecial(const char* ptr, const char* end);
+
+/// Finds the first character that needs special handling inside a string
+/// literal: '"', '\\', a newline, a null, or a non-ASCII byte.
+const char* findStringLiteralSpecial(const char* ptr, const char* end);
+
+} // namespace slang::charscan
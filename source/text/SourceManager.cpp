@@ -7,8 +7,11 @@
 //------------------------------------------------------------------------------
 #include "slang/text/SourceManager.h"
 
+#include "CharScan.h"
+#include <bit>
 #include <string>
 
+#include "slang/text/CharInfo.h"
 #include "slang/util/OS.h"
 #include "slang/util/String.h"
 
@@ -20,8 +23,7 @@ static const fs::path emptyPath;
 
 SourceManager::SourceManager() {
     // add a dummy entry to the start of the directory list so that our file IDs line up
-    FileInfo file;
-    bufferEntries.emplace_back(file);
+    bufferEntries.append(FileInfo());
 }
 
 std::string SourceManager::makeAbsolutePath(std::string_view path) const {
@@ -38,6 +40,9 @@ bool SourceManager::addSystemDirectory(std::string_view pathStr) {
     // Note: locking the separate mutex for include dirs here.
     std::unique_lock lock(includeDirMutex);
     systemDirectories.emplace_back(std::move(path));
+    lock.unlock();
+
+    clearIncludeCache();
     return true;
 }
 
@@ -50,17 +55,31 @@ bool SourceManager::addUserDirectory(std::string_view pathStr) {
     // Note: locking the separate mutex for include dirs here.
     std::unique_lock lock(includeDirMutex);
     userDirectories.emplace_back(std::move(path));
+    lock.unlock();
+
+    clearIncludeCache();
     return true;
 }
 
+std::vector<fs::path> SourceManager::getSystemDirectories() const {
+    std::shared_lock lock(includeDirMutex);
+    return systemDirectories;
+}
+
+std::vector<fs::path> SourceManager::getUserDirectories() const {
+    std::shared_lock lock(includeDirMutex);
+    return userDirectories;
+}
+
 size_t SourceManager::getLineNumber(SourceLocation location) const {
+    SourceLocation fileLocation = getFullyExpandedLocImpl(location);
+
     std::shared_lock lock(mutex);
-    SourceLocation fileLocation = getFullyExpandedLocImpl(location, lock);
     size_t rawLineNumber = getRawLineNumber(fileLocation, lock);
     if (rawLineNumber == 0)
         return 0;
 
-    auto info = getFileInfo(fileLocation.buffer(), lock);
+    auto info = getFileInfo(fileLocation.buffer());
 
     auto lineDirective = info->getPreviousLineDirective(rawLineNumber);
     if (!lineDirective)
@@ -70,28 +89,28 @@ size_t SourceManager::getLineNumber(SourceLocation location) const {
 }
 
 size_t SourceManager::getColumnNumber(SourceLocation location) const {
-    std::shared_lock lock(mutex);
-    auto info = getFileInfo(location.buffer(), lock);
+    auto info = getFileInfo(location.buffer());
     if (!info || !info->data)
         return 0;
 
     // walk backward to find start of line
-    auto fd = info->data;
+    auto text = info->data->text();
     size_t lineStart = location.offset();
-    SLANG_ASSERT(lineStart < fd->mem.size());
-    while (lineStart > 0 && fd->mem[lineStart - 1] != '\n' && fd->mem[lineStart - 1] != '\r')
+    SLANG_ASSERT(lineStart < text.size());
+    while (lineStart > 0 && text[lineStart - 1] != '\n' && text[lineStart - 1] != '\r')
         lineStart--;
 
     return location.offset() - lineStart + 1;
 }
 
 std::string_view SourceManager::getFileName(SourceLocation location) const {
-    std::shared_lock lock(mutex);
-    SourceLocation fileLocation = getFullyExpandedLocImpl(location, lock);
-    auto info = getFileInfo(fileLocation.buffer(), lock);
+    SourceLocation fileLocation = getFullyExpandedLocImpl(location);
+    auto info = getFileInfo(fileLocation.buffer());
     if (!info || !info->data)
         return "";
 
+    std::shared_lock lock(mutex);
+
     // Avoid computing line offsets if we just need a name of `line-less file
     if (info->lineDirectives.empty())
         return info->data->name;
@@ -105,8 +124,7 @@ std::string_view SourceManager::getFileName(SourceLocation location) const {
 }
 
 std::string_view SourceManager::getRawFileName(BufferID buffer) const {
-    std::shared_lock lock(mutex);
-    auto info = getFileInfo(buffer, lock);
+    auto info = getFileInfo(buffer);
     if (!info || !info->data)
         return "";
 
@@ -114,8 +132,7 @@ std::string_view SourceManager::getRawFileName(BufferID buffer) const {
 }
 
 const fs::path& SourceManager::getFullPath(BufferID buffer) const {
-    std::shared_lock lock(mutex);
-    auto info = getFileInfo(buffer, lock);
+    auto info = getFileInfo(buffer);
     if (!info || !info->data)
         return emptyPath;
 
@@ -123,8 +140,7 @@ const fs::path& SourceManager::getFullPath(BufferID buffer) const {
 }
 
 SourceLocation SourceManager::getIncludedFrom(BufferID buffer) const {
-    std::shared_lock lock(mutex);
-    auto info = getFileInfo(buffer, lock);
+    auto info = getFileInfo(buffer);
     if (!info)
         return SourceLocation();
 
@@ -132,16 +148,10 @@ SourceLocation SourceManager::getIncludedFrom(BufferID buffer) const {
 }
 
 std::string_view SourceManager::getMacroName(SourceLocation location) const {
-    std::shared_lock lock(mutex);
-    while (isMacroArgLocImpl(location, lock))
-        location = getExpansionRangeImpl(location, lock).start();
+    while (isMacroArgLocImpl(location))
+        location = getExpansionRangeImpl(location).start();
 
-    auto buffer = location.buffer();
-    if (!buffer)
-        return {};
-
-    SLANG_ASSERT(buffer.getId() < bufferEntries.size());
-    auto info = std::get_if<ExpansionInfo>(&bufferEntries[buffer.getId()]);
+    auto info = getExpansionInfo(location.buffer());
     if (!info)
         return {};
 
@@ -152,18 +162,15 @@ bool SourceManager::isFileLoc(SourceLocation location) const {
     if (location.buffer() == SourceLocation::NoLocation.buffer())
         return false;
 
-    std::shared_lock lock(mutex);
-    return getFileInfo(location.buffer(), lock) != nullptr;
+    return getFileInfo(location.buffer()) != nullptr;
 }
 
 bool SourceManager::isMacroLoc(SourceLocation location) const {
-    std::shared_lock lock(mutex);
-    return isMacroLocImpl(location, lock);
+    return isMacroLocImpl(location);
 }
 
 bool SourceManager::isMacroArgLoc(SourceLocation location) const {
-    std::shared_lock lock(mutex);
-    return isMacroArgLocImpl(location, lock);
+    return isMacroArgLocImpl(location);
 }
 
 bool SourceManager::isIncludedFileLoc(SourceLocation location) const {
@@ -213,57 +220,46 @@ bool SourceManager::isBeforeInCompilationUnit(SourceLocation left, SourceLocatio
 }
 
 SourceLocation SourceManager::getExpansionLoc(SourceLocation location) const {
-    std::shared_lock lock(mutex);
-    return getExpansionRangeImpl(location, lock).start();
+    return getExpansionRangeImpl(location).start();
 }
 
 SourceRange SourceManager::getExpansionRange(SourceLocation location) const {
-    std::shared_lock lock(mutex);
-    return getExpansionRangeImpl(location, lock);
+    return getExpansionRangeImpl(location);
 }
 
 SourceLocation SourceManager::getOriginalLoc(SourceLocation location) const {
-    std::shared_lock lock(mutex);
-    return getOriginalLocImpl(location, lock);
+    return getOriginalLocImpl(location);
 }
 
 SourceLocation SourceManager::getFullyOriginalLoc(SourceLocation location) const {
-    std::shared_lock lock(mutex);
-    while (isMacroLocImpl(location, lock))
-        location = getOriginalLocImpl(location, lock);
+    while (isMacroLocImpl(location))
+        location = getOriginalLocImpl(location);
     return location;
 }
 
 SourceLocation SourceManager::getFullyExpandedLoc(SourceLocation location) const {
-    std::shared_lock lock(mutex);
-    return getFullyExpandedLocImpl(location, lock);
+    return getFullyExpandedLocImpl(location);
 }
 
 std::string_view SourceManager::getSourceText(BufferID buffer) const {
-    std::shared_lock lock(mutex);
-    auto info = getFileInfo(buffer, lock);
+    auto info = getFileInfo(buffer);
     if (!info || !info->data)
         return "";
 
-    auto fd = info->data;
-    return std::string_view(fd->mem.data(), fd->mem.size());
+    return info->data->text();
 }
 
 SourceLocation SourceManager::createExpansionLoc(SourceLocation originalLoc,
                                                  SourceRange expansionRange, bool isMacroArg) {
-    std::unique_lock lock(mutex);
-
-    bufferEntries.emplace_back(ExpansionInfo(originalLoc, expansionRange, isMacroArg));
-    return SourceLocation(BufferID((uint32_t)(bufferEntries.size() - 1), ""sv), 0);
+    uint32_t id = bufferEntries.append(ExpansionInfo(originalLoc, expansionRange, isMacroArg));
+    return SourceLocation(BufferID(id, ""sv), 0);
 }
 
 SourceLocation SourceManager::createExpansionLoc(SourceLocation originalLoc,
                                                  SourceRange expansionRange,
                                                  std::string_view macroName) {
-    std::unique_lock lock(mutex);
-
-    bufferEntries.emplace_back(ExpansionInfo(originalLoc, expansionRange, macroName));
-    return SourceLocation(BufferID((uint32_t)(bufferEntries.size() - 1), macroName), 0);
+    uint32_t id = bufferEntries.append(ExpansionInfo(originalLoc, expansionRange, macroName));
+    return SourceLocation(BufferID(id, macroName), 0);
 }
 
 SourceBuffer SourceManager::assignText(std::string_view text, SourceLocation includedFrom,
@@ -304,8 +300,12 @@ SourceBuffer SourceManager::assignBuffer(std::string_view bufferPath, std::vecto
         }
     }
 
+    // The new buffer may be found by header lookups that previously failed.
+    if (path.is_absolute())
+        clearIncludeCache();
+
     return cacheBuffer(std::move(path), std::move(pathStr), includedFrom, library,
-                       std::move(buffer));
+                       std::move(buffer), MappedFile());
 }
 
 SourceBuffer SourceManager::readSource(const fs::path& path, const SourceLibrary* library) {
@@ -320,51 +320,81 @@ SourceBuffer SourceManager::readHeader(std::string_view path, SourceLocation inc
     if (p.is_absolute())
         return openCached(p, includedFrom, library);
 
-    // system path lookups only look in system directories
-    if (isSystemPath) {
+    // non-system includes search relative to the current file first
+    const fs::path* currFileDir = nullptr;
+    if (!isSystemPath) {
+        if (auto info = getFileInfo(includedFrom.buffer()); info && info->data)
+            currFileDir = info->data->directory;
+    }
+
+    // If we've resolved this same include from this same directory before
+    // we can skip searching the include directories all over again.
+    IncludeKey key{currFileDir, isSystemPath, std::string(path)};
+    {
+        std::shared_lock lock(includeCacheMutex);
+        if (auto it = includeResolutions.find(key); it != includeResolutions.end()) {
+            FileData* fd = it->second;
+            lock.unlock();
+
+            if (!fd)
+                return SourceBuffer();
+
+            std::unique_lock bufferLock(mutex);
+            return createBufferEntry(fd, includedFrom, library, bufferLock);
+        }
+    }
+
+    auto search = [&]() -> SourceBuffer {
+        if (currFileDir) {
+            SourceBuffer result = openHeader(*currFileDir, p, includedFrom, library);
+            if (result.id)
+                return result;
+        }
+
         // Separate lock for the include dirs here so that we can iterate
         // over them without having to make a copy. It's unlikely that the
         // list is being modified while we're reading headers anyway.
+        // System path lookups only look in system directories.
         std::shared_lock includeDirLock(includeDirMutex);
-        for (auto& d : systemDirectories) {
-            SourceBuffer result = openCached(d / p, includedFrom, library);
+        for (auto& d : isSystemPath ? systemDirectories : userDirectories) {
+            SourceBuffer result = openHeader(d, p, includedFrom, library);
             if (result.id)
                 return result;
         }
         return SourceBuffer();
-    }
+    };
 
-    // search relative to the current file
-    const fs::path* currFileDir = nullptr;
-    {
-        std::shared_lock lock(mutex);
-        auto info = getFileInfo(includedFrom.buffer(), lock);
-        if (info && info->data)
-            currFileDir = info->data->directory;
-    }
+    SourceBuffer result = search();
 
-    if (currFileDir) {
-        SourceBuffer result = openCached(*currFileDir / p, includedFrom, library);
-        if (result.id)
-            return result;
+    FileData* fd = nullptr;
+    if (result.id) {
+        auto info = getFileInfo(result.id);
+        SLANG_ASSERT(info && info->data);
+        fd = info->data;
     }
 
-    // See comment above about this separate mutex / lock.
-    std::shared_lock includeDirLock(includeDirMutex);
-    for (auto& d : userDirectories) {
-        SourceBuffer result = openCached(d / p, includedFrom, library);
-        if (result.id)
-            return result;
+    std::unique_lock lock(includeCacheMutex);
+    includeResolutions.emplace(std::move(key), fd);
+    return result;
+}
+
+void SourceManager::clearIncludeCache() {
+    {
+        std::unique_lock lock(includeCacheMutex);
+        directoryListings.clear();
+        missingHeaders.clear();
+        includeResolutions.clear();
     }
 
-    return SourceBuffer();
+    // Also forget about any files that we previously failed to read.
+    std::unique_lock lock(mutex);
+    erase_if(lookupCache, [](auto& pair) { return pair.second == nullptr; });
 }
 
 void SourceManager::addLineDirective(SourceLocation location, size_t lineNum, std::string_view name,
                                      uint8_t level) {
-    std::unique_lock lock(mutex);
-    SourceLocation fileLocation = getFullyExpandedLocImpl(location, lock);
-    FileInfo* info = getFileInfo(fileLocation.buffer(), lock);
+    SourceLocation fileLocation = getFullyExpandedLocImpl(location);
+    FileInfo* info = getFileInfo(fileLocation.buffer());
     if (!info || !info->data)
         return;
 
@@ -376,15 +406,16 @@ void SourceManager::addLineDirective(SourceLocation location, size_t lineNum, st
     else
         full = fs::path(widen(info->data->name)).replace_filename(linePath);
 
+    std::unique_lock lock(mutex);
     size_t sourceLineNum = getRawLineNumber(fileLocation, lock);
     info->lineDirectives.emplace_back(getU8Str(full), sourceLineNum, lineNum, level);
 }
 
 void SourceManager::addDiagnosticDirective(SourceLocation location, std::string_view name,
                                            DiagnosticSeverity severity) {
-    std::unique_lock lock(mutex);
-    SourceLocation fileLocation = getFullyExpandedLocImpl(location, lock);
+    SourceLocation fileLocation = getFullyExpandedLocImpl(location);
 
+    std::unique_lock lock(mutex);
     size_t offset = fileLocation.offset();
     auto& vec = diagDirectives[fileLocation.buffer()];
     if (vec.empty() || offset >= vec.back().offset)
@@ -406,37 +437,48 @@ std::span<const SourceManager::DiagnosticDirectiveInfo> SourceManager::getDiagno
 }
 
 std::vector<BufferID> SourceManager::getAllBuffers() const {
-    std::shared_lock lock(mutex);
     std::vector<BufferID> result;
-    for (size_t i = 1; i < bufferEntries.size(); i++)
-        result.push_back(BufferID((uint32_t)i, ""sv));
+    uint32_t size = bufferEntries.size();
+    for (uint32_t i = 1; i < size; i++) {
+        // Skip over any entries that are still being created by another thread.
+        if (bufferEntries.get(i))
+            result.push_back(BufferID(i, ""sv));
+    }
 
     return result;
 }
 
-template<IsLock TLock>
-SourceManager::FileInfo* SourceManager::getFileInfo(BufferID buffer, TLock&) {
-    if (!buffer || buffer.getId() >= bufferEntries.size())
+SourceManager::FileInfo* SourceManager::getFileInfo(BufferID buffer) {
+    if (!buffer)
         return nullptr;
 
-    return std::get_if<FileInfo>(&bufferEntries[buffer.getId()]);
+    auto entry = bufferEntries.get(buffer.getId());
+    return entry ? std::get_if<FileInfo>(entry) : nullptr;
 }
 
-template<IsLock TLock>
-const SourceManager::FileInfo* SourceManager::getFileInfo(BufferID buffer, TLock&) const {
-    if (!buffer || buffer.getId() >= bufferEntries.size())
+const SourceManager::FileInfo* SourceManager::getFileInfo(BufferID buffer) const {
+    if (!buffer)
         return nullptr;
 
-    return std::get_if<FileInfo>(&bufferEntries[buffer.getId()]);
+    auto entry = bufferEntries.get(buffer.getId());
+    return entry ? std::get_if<FileInfo>(entry) : nullptr;
+}
+
+const SourceManager::ExpansionInfo* SourceManager::getExpansionInfo(BufferID buffer) const {
+    if (!buffer)
+        return nullptr;
+
+    auto entry = bufferEntries.get(buffer.getId());
+    SLANG_ASSERT(entry);
+    return std::get_if<ExpansionInfo>(entry);
 }
 
 SourceBuffer SourceManager::createBufferEntry(FileData* fd, SourceLocation includedFrom,
                                               const SourceLibrary* library,
                                               std::unique_lock<std::shared_mutex>&) {
     SLANG_ASSERT(fd);
-    bufferEntries.emplace_back(FileInfo(fd, includedFrom));
-    return SourceBuffer{std::string_view(fd->mem.data(), fd->mem.size()), library,
-                        BufferID((uint32_t)(bufferEntries.size() - 1), fd->name)};
+    uint32_t id = bufferEntries.append(FileInfo(fd, includedFrom));
+    return SourceBuffer{fd->text(), library, BufferID(id, fd->name)};
 }
 
 bool SourceManager::isCached(const fs::path& path) const {
@@ -482,21 +524,97 @@ SourceBuffer SourceManager::openCached(const fs::path& fullPath, SourceLocation
         }
     }
 
-    // do the read
+    // do the read, preferring to map the file if that's enabled
     std::vector<char> buffer;
-    if (!OS::readFile(absPath, buffer)) {
-        std::unique_lock lock(mutex);
-        lookupCache.emplace(pathStr, nullptr);
-        return SourceBuffer();
+    MappedFile mapped;
+    if (!memoryMapFiles || !OS::mapFile(absPath, MinMappedFileSize, mapped)) {
+        if (!OS::readFile(absPath, buffer)) {
+            std::unique_lock lock(mutex);
+            lookupCache.emplace(pathStr, nullptr);
+            return SourceBuffer();
+        }
     }
 
     return cacheBuffer(std::move(absPath), std::move(pathStr), includedFrom, library,
-                       std::move(buffer));
+                       std::move(buffer), std::move(mapped));
+}
+
+SourceBuffer SourceManager::openHeader(const fs::path& directory, const fs::path& path,
+                                       SourceLocation includedFrom, const SourceLibrary* library) {
+    if (!mayContain(directory, path))
+        return SourceBuffer();
+
+    auto fullPath = directory / path;
+    {
+        std::shared_lock lock(includeCacheMutex);
+        if (missingHeaders.contains(fullPath.native()))
+            return SourceBuffer();
+    }
+
+    SourceBuffer result = openCached(fullPath, includedFrom, library);
+    if (!result.id) {
+        std::unique_lock lock(includeCacheMutex);
+        missingHeaders.emplace(fullPath.native());
+    }
+    return result;
+}
+
+bool SourceManager::mayContain(const fs::path& directory, const fs::path& path) {
+    // Look at the first component of the path, which is the entry that has
+    // to exist in the directory for the lookup to have any chance of succeeding.
+    // Names are compared case insensitively so that we never rule out a file that
+    // exists on a case insensitive file system. Non-ASCII names aren't checked
+    // since we can't know how the file system would fold their case.
+    auto first = path.begin();
+    if (first == path.end() || *first == "." || *first == "..")
+        return true;
+
+    std::string name = getU8Str(*first);
+    for (auto& c : name) {
+        if (!isASCII(c))
+            return true;
+        c = charToLower(c);
+    }
+
+    {
+        std::shared_lock lock(includeCacheMutex);
+        if (auto it = directoryListings.find(directory.native()); it != directoryListings.end())
+            return !it->second || it->second->contains(name);
+    }
+
+    // Read the directory once, so that later lookups for files that
+    // don't exist in it don't need to touch the file system at all.
+    DirectoryListing listing;
+    std::error_code ec;
+    fs::directory_iterator it(directory, ec);
+    if (!ec) {
+        listing.emplace();
+        for (; it != fs::directory_iterator(); it.increment(ec)) {
+            if (ec)
+                break;
+
+            std::string entry = getU8Str(it->path().filename());
+            for (auto& c : entry) {
+                if (isASCII(c))
+                    c = charToLower(c);
+            }
+            listing->emplace(std::move(entry));
+        }
+
+        if (ec)
+            listing.reset();
+    }
+
+    bool result = !listing || listing->contains(name);
+
+    std::unique_lock lock(includeCacheMutex);
+    directoryListings.emplace(directory.native(), std::move(listing));
+    return result;
 }
 
 SourceBuffer SourceManager::cacheBuffer(fs::path&& path, std::string&& pathStr,
                                         SourceLocation includedFrom, const SourceLibrary* library,
-                                        std::vector<char>&& buffer) {
+                                        std::vector<char>&& buffer, MappedFile&& mapped) {
     std::string name;
     if (!disableProximatePaths) {
         std::error_code ec;
@@ -512,7 +630,7 @@ SourceBuffer SourceManager::cacheBuffer(fs::path&& path, std::string&& pathStr,
 
     auto directory = &*directories.insert(path.parent_path()).first;
     auto fd = std::make_unique<FileData>(directory, std::move(name), std::move(buffer),
-                                         std::move(path));
+                                         std::move(mapped), std::move(path));
 
     auto [it, inserted] = lookupCache.emplace(pathStr, std::move(fd));
     SLANG_ASSERT(inserted);
@@ -523,33 +641,34 @@ SourceBuffer SourceManager::cacheBuffer(fs::path&& path, std::string&& pathStr,
 
 template<IsLock TLock>
 size_t SourceManager::getRawLineNumber(SourceLocation location, TLock& readLock) const {
-    FileData* fd;
-    {
-        // Separate scope so that info isn't used after it may potentially
-        // get invalidated when we briefly unloack a read lock and grab a
-        // write lock below.
-        const FileInfo* info = getFileInfo(location.buffer(), readLock);
-        if (!info || !info->data)
-            return 0;
+    const FileInfo* info = getFileInfo(location.buffer());
+    if (!info || !info->data)
+        return 0;
 
-        fd = info->data;
-    }
+    FileData* fd = info->data;
 
     if (fd->lineOffsets.empty()) {
         // We need to compute line offsets. If the lock is a write lock then
         // we can just go ahead and do that; if not we need to unlock the
         // read lock and grab a write lock.
+        // The text itself is immutable, so the scan can happen without holding
+        // any lock; another thread may beat us to storing the result, in which
+        // case we just throw ours away.
         if constexpr (std::is_same_v<TLock, std::shared_lock<std::shared_mutex>>) {
             readLock.unlock();
 
+            std::vector<size_t> offsets;
+            computeLineOffsets(fd->text(), offsets);
+
             std::unique_lock writeLock(mutex);
-            computeLineOffsets(fd->mem, fd->lineOffsets);
+            if (fd->lineOffsets.empty())
+                fd->lineOffsets = std::move(offsets);
 
             writeLock.unlock();
             readLock.lock();
         }
         else {
-            computeLineOffsets(fd->mem, fd->lineOffsets);
+            computeLineOffsets(fd->text(), fd->lineOffsets);
         }
     }
 
@@ -565,82 +684,64 @@ size_t SourceManager::getRawLineNumber(SourceLocation location, TLock& readLock)
     return line;
 }
 
-template<IsLock TLock>
-SourceLocation SourceManager::getFullyExpandedLocImpl(SourceLocation location, TLock& lock) const {
-    while (isMacroLocImpl(location, lock)) {
-        if (isMacroArgLocImpl(location, lock))
-            location = getOriginalLocImpl(location, lock);
+SourceLocation SourceManager::getFullyExpandedLocImpl(SourceLocation location) const {
+    while (isMacroLocImpl(location)) {
+        if (isMacroArgLocImpl(location))
+            location = getOriginalLocImpl(location);
         else
-            location = getExpansionRangeImpl(location, lock).start();
+            location = getExpansionRangeImpl(location).start();
     }
     return location;
 }
 
-template<IsLock TLock>
-bool SourceManager::isMacroLocImpl(SourceLocation location, TLock&) const {
+bool SourceManager::isMacroLocImpl(SourceLocation location) const {
     if (location.buffer() == SourceLocation::NoLocation.buffer())
         return false;
 
-    auto buffer = location.buffer();
-    if (!buffer)
-        return false;
-
-    SLANG_ASSERT(buffer.getId() < bufferEntries.size());
-    return std::get_if<ExpansionInfo>(&bufferEntries[buffer.getId()]) != nullptr;
+    return getExpansionInfo(location.buffer()) != nullptr;
 }
 
-template<IsLock TLock>
-bool SourceManager::isMacroArgLocImpl(SourceLocation location, TLock&) const {
+bool SourceManager::isMacroArgLocImpl(SourceLocation location) const {
     if (location == SourceLocation::NoLocation)
         return false;
 
-    auto buffer = location.buffer();
-    if (!buffer)
-        return false;
-
-    SLANG_ASSERT(buffer.getId() < bufferEntries.size());
-    auto info = std::get_if<ExpansionInfo>(&bufferEntries[buffer.getId()]);
+    auto info = getExpansionInfo(location.buffer());
     return info && info->isMacroArg;
 }
 
-template<IsLock TLock>
-SourceRange SourceManager::getExpansionRangeImpl(SourceLocation location, TLock&) const {
-    auto buffer = location.buffer();
-    if (!buffer)
+SourceRange SourceManager::getExpansionRangeImpl(SourceLocation location) const {
+    auto info = getExpansionInfo(location.buffer());
+    if (!info)
         return SourceRange();
 
-    SLANG_ASSERT(buffer.getId() < bufferEntries.size());
-    return std::get<ExpansionInfo>(bufferEntries[buffer.getId()]).expansionRange;
+    return info->expansionRange;
 }
 
-template<IsLock TLock>
-SourceLocation SourceManager::getOriginalLocImpl(SourceLocation location, TLock&) const {
-    auto buffer = location.buffer();
-    if (!buffer)
+SourceLocation SourceManager::getOriginalLocImpl(SourceLocation location) const {
+    auto info = getExpansionInfo(location.buffer());
+    if (!info)
         return SourceLocation();
 
-    SLANG_ASSERT(buffer.getId() < bufferEntries.size());
-    return std::get<ExpansionInfo>(bufferEntries[buffer.getId()]).originalLoc + location.offset();
+    return info->originalLoc + location.offset();
 }
 
-void SourceManager::computeLineOffsets(const std::vector<char>& buffer,
+void SourceManager::computeLineOffsets(std::string_view text,
                                        std::vector<size_t>& offsets) noexcept {
     // first line always starts at offset 0
     offsets.push_back(0);
 
-    const char* ptr = buffer.data();
-    const char* end = buffer.data() + buffer.size();
-    while (ptr != end) {
-        if (ptr[0] == '\n' || ptr[0] == '\r') {
-            // if we see \r\n or \n\r skip both chars
-            if ((ptr[1] == '\n' || ptr[1] == '\r') && ptr[0] != ptr[1])
-                ptr++;
-            ptr++;
-            offsets.push_back((size_t)(ptr - buffer.data()));
-        }
-        else {
+    const char* ptr = text.data();
+    const char* end = text.data() + text.size();
+    while (true) {
+        ptr = charscan::findNewline(ptr, end);
+        if (ptr == end)
+            break;
+
+        // if we see \r\n or \n\r skip both chars
+        if ((ptr[1] == '\n' || ptr[1] == '\r') && ptr[0] != ptr[1])
             ptr++;
-        }
+        ptr++;
+        offsets.push_back((size_t)(ptr - text.data()));
     }
 }
 
@@ -671,4 +772,64 @@ const SourceManager::LineDirectiveInfo* SourceManager::FileInfo::getPreviousLine
     }
 }
 
+SourceManager::BufferEntryStore::~BufferEntryStore() {
+    for (auto& chunk : chunks)
+        delete[] chunk.load(std::memory_order_relaxed);
+}
+
+uint32_t SourceManager::BufferEntryStore::append(BufferEntry&& entry) {
+    uint32_t index = count.fetch_add(1, std::memory_order_acq_rel);
+    if (index == UINT32_MAX)
+        SLANG_THROW(std::runtime_error("Too many source buffers have been created"));
+
+    Slot* slot = getSlot(index, /* create */ true);
+    slot->entry = std::move(entry);
+    slot->ready.store(true, std::memory_order_release);
+    return index;
+}
+
+const SourceManager::BufferEntry* SourceManager::BufferEntryStore::get(uint32_t index) const {
+    if (index >= size())
+        return nullptr;
+
+    Slot* slot = getSlot(index, /* create */ false);
+    if (!slot || !slot->ready.load(std::memory_order_acquire))
+        return nullptr;
+
+    return &slot->entry;
+}
+
+SourceManager::BufferEntry* SourceManager::BufferEntryStore::get(uint32_t index) {
+    return const_cast<BufferEntry*>(std::as_const(*this).get(index));
+}
+
+SourceManager::BufferEntryStore::Slot* SourceManager::BufferEntryStore::getSlot(
+    uint32_t index, bool create) const {
+    // Chunk k holds (1 << (FirstChunkBits + k)) entries, so biasing the index
+    // by the size of the first chunk lets us find the chunk from the top bit.
+    uint64_t biased = uint64_t(index) + (uint64_t(1) << FirstChunkBits);
+    uint32_t chunkIndex = uint32_t(std::bit_width(biased)) - 1 - FirstChunkBits;
+    uint64_t chunkSize = uint64_t(1) << (FirstChunkBits + chunkIndex);
+    SLANG_ASSERT(chunkIndex < NumChunks);
+
+    auto& chunkPtr = chunks[chunkIndex];
+    Slot* chunk = chunkPtr.load(std::memory_order_acquire);
+    if (!chunk) {
+        if (!create)
+            return nullptr;
+
+        // Race to install a new chunk; if someone else wins we use theirs.
+        Slot* newChunk = new Slot[chunkSize];
+        if (chunkPtr.compare_exchange_strong(chunk, newChunk, std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+            chunk = newChunk;
+        }
+        else {
+            delete[] newChunk;
+        }
+    }
+
+    return &chunk[biased - chunkSize];
+}
+
 } // namespace slang
@@ -7,16 +7,41 @@
 //------------------------------------------------------------------------------
 #include "slang/util/BumpAllocator.h"
 
+#include <atomic>
+#include <mutex>
 #include <new>
+#include <thread>
+#include <vector>
 
 namespace slang {
 
+struct BumpAllocator::ThreadAllocators {
+    // Identifies this run of multithreaded mode in the per-thread caches below;
+    // never reused, so stale cache entries can't match a later run.
+    uint64_t id;
+
+    std::mutex mutex;
+    std::vector<std::pair<std::thread::id, BumpAllocator*>> allocators;
+};
+
+static std::atomic<uint64_t> nextThreadAllocatorsId = 1;
+
+// Each thread remembers the allocators it has been handed most recently,
+// so that looking them up doesn't need to take a lock.
+struct ThreadAllocatorCache {
+    static constexpr size_t Size = 8;
+    std::pair<uint64_t, BumpAllocator*> entries[Size]{};
+    size_t next = 0;
+};
+static thread_local ThreadAllocatorCache threadAllocatorCache;
+
 BumpAllocator::BumpAllocator() {
     head = allocSegment(nullptr, INITIAL_SIZE);
     endPtr = (byte*)head + INITIAL_SIZE;
 }
 
 BumpAllocator::~BumpAllocator() {
+    SLANG_ASSERT(!threadAllocators);
     Segment* seg = head;
     while (seg) {
         Segment* prev = seg->prev;
@@ -27,6 +52,7 @@ BumpAllocator::~BumpAllocator() {
 
 BumpAllocator::BumpAllocator(BumpAllocator&& other) noexcept :
     head(std::exchange(other.head, nullptr)), endPtr(other.endPtr) {
+    SLANG_ASSERT(!other.threadAllocators);
 }
 
 BumpAllocator& BumpAllocator::operator=(BumpAllocator&& other) noexcept {
@@ -38,6 +64,7 @@ BumpAllocator& BumpAllocator::operator=(BumpAllocator&& other) noexcept {
 }
 
 void BumpAllocator::steal(BumpAllocator&& other) {
+    SLANG_ASSERT(!threadAllocators && !other.threadAllocators);
     Segment* seg = other.head;
     if (!seg)
         return;
@@ -49,6 +76,56 @@ void BumpAllocator::steal(BumpAllocator&& other) {
     head->prev = std::exchange(other.head, nullptr);
 }
 
+void BumpAllocator::setMultiThreaded(bool enabled) {
+    if (enabled) {
+        if (!threadAllocators) {
+            threadAllocators = new ThreadAllocators();
+            threadAllocators->id = nextThreadAllocatorsId++;
+        }
+        return;
+    }
+
+    if (!threadAllocators)
+        return;
+
+    auto state = std::exchange(threadAllocators, nullptr);
+    for (auto [_, alloc] : state->allocators) {
+        steal(std::move(*alloc));
+        delete alloc;
+    }
+    delete state;
+}
+
+byte* BumpAllocator::allocateForThread(size_t size, size_t alignment) {
+    auto& cache = threadAllocatorCache;
+    auto id = threadAllocators->id;
+    for (auto& [entryId, alloc] : cache.entries) {
+        if (entryId == id)
+            return alloc->allocate(size, alignment);
+    }
+
+    BumpAllocator* alloc = nullptr;
+    {
+        auto threadId = std::this_thread::get_id();
+        std::scoped_lock lock(threadAllocators->mutex);
+        for (auto& [allocThreadId, threadAlloc] : threadAllocators->allocators) {
+            if (allocThreadId == threadId) {
+                alloc = threadAlloc;
+                break;
+            }
+        }
+
+        if (!alloc) {
+            alloc = new BumpAllocator();
+            threadAllocators->allocators.emplace_back(threadId, alloc);
+        }
+    }
+
+    cache.entries[cache.next] = {id, alloc};
+    cache.next = (cache.next + 1) % ThreadAllocatorCache::Size;
+    return alloc->allocate(size, alignment);
+}
+
 byte* BumpAllocator::allocateSlow(size_t size, size_t alignment) {
     // for really large allocations, give them their own segment
     if (size > (SEGMENT_SIZE >> 1)) {
@@ -20,6 +20,9 @@
 #    include <fcntl.h>
 #    include <io.h>
 #else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
 #    include <unistd.h>
 #endif
 
@@ -119,6 +122,121 @@ bool OS::readFile(const fs::path& path, std::vector<char>& buffer) {
     return true;
 }
 
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+    data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)) {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        release();
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+#if defined(_MSC_VER)
+
+void MappedFile::release() noexcept {
+    if (data) {
+        UnmapViewOfFile(data);
+        data = nullptr;
+        size = 0;
+    }
+}
+
+bool OS::mapFile(const fs::path& path, size_t minSize, MappedFile& result) {
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    auto closeFile = ScopeGuard([file] { CloseHandle(file); });
+    if (GetFileType(file) != FILE_TYPE_DISK)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+        return false;
+
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+
+    // The bytes in the final page past the end of the file are zero filled,
+    // which gives us our null terminator for free unless the file happens
+    // to end exactly on a page boundary.
+    uint64_t size = (uint64_t)fileSize.QuadPart;
+    if (size < minSize || size == 0 || size >= SIZE_MAX || size % sysInfo.dwPageSize == 0)
+        return false;
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+        return false;
+
+    // The view keeps the mapping object alive, so the handle can be closed right away.
+    auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view)
+        return false;
+
+    result.release();
+    result.data = static_cast<const char*>(view);
+    result.size = (size_t)size + 1;
+    return true;
+}
+
+#else
+
+void MappedFile::release() noexcept {
+    if (data) {
+        // The mapping includes the null terminator, which lives in the same page
+        // as the last byte of the file, so unmapping the whole size is fine.
+        munmap(const_cast<char*>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+}
+
+bool OS::mapFile(const fs::path& path, size_t minSize, MappedFile& result) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    auto closeFile = ScopeGuard([fd] { close(fd); });
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+
+    // The bytes in the final page past the end of the file are zero filled,
+    // which gives us our null terminator for free unless the file happens
+    // to end exactly on a page boundary.
+    static const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (size_t)st.st_size;
+    if (size < minSize || size == 0 || size % pageSize == 0)
+        return false;
+
+    void* addr = mmap(nullptr, size + 1, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED)
+        return false;
+
+#    if defined(POSIX_MADV_SEQUENTIAL)
+    // The lexer makes a single forward pass over the text.
+    posix_madvise(addr, size + 1, POSIX_MADV_SEQUENTIAL);
+#    endif
+
+    result.release();
+    result.data = static_cast<const char*>(addr);
+    result.size = size + 1;
+    return true;
+}
+
+#endif
+
 void OS::print(std::string_view text) {
     if (capturingOutput)
         capturedStdout += text;
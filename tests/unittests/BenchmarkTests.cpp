@@ -0,0 +1,198 @@
+// SPDX-FileCopyrightText: Michael Popoloski
+// SPDX-License-Identifier: MIT
+
+// These benchmarks are hidden by default; run them with: unittests "[benchmark]"
+
+#include "Test.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <chrono>
+
+#include "slang/diagnostics/Diagnostics.h"
+#include "slang/parsing/Lexer.h"
+#include "slang/parsing/Preprocessor.h"
+#include "slang/syntax/SyntaxTree.h"
+#include "slang/text/SourceManager.h"
+#include "slang/util/OS.h"
+#include "slang/util/ThreadPool.h"
+
+TEST_CASE("SourceManager location query contention", "[.][benchmark]") {
+    SourceManager manager;
+    auto buffer = manager.assignText("`define FOO(x) x\nmodule m; endmodule\n"sv);
+    SourceLocation start(buffer.id, 0);
+
+    ThreadPool pool;
+    size_t numThreads = pool.getThreadCount();
+
+    // Each thread mimics what the preprocessor and parser do for nested
+    // macro expansions: register a couple of expansion locations and then
+    // query them repeatedly, as diagnostics and location lookups would.
+    BENCHMARK("Expansions and queries (" + std::to_string(numThreads) + " threads)") {
+        std::atomic<size_t> total = 0;
+        pool.pushLoop(size_t(0), numThreads, [&](size_t begin, size_t end) {
+            size_t count = 0;
+            for (size_t i = begin; i < end; i++) {
+                for (size_t j = 0; j < 1000; j++) {
+                    auto outer = manager.createExpansionLoc(start, SourceRange(start, start + 3),
+                                                            "FOO"sv);
+                    auto inner = manager.createExpansionLoc(outer, SourceRange(outer, outer + 1),
+                                                            /* isMacroArg */ true);
+                    for (size_t k = 0; k < 16; k++) {
+                        count += manager.isMacroLoc(inner);
+                        count += manager.getFullyOriginalLoc(inner).offset();
+                        count += manager.getFullyExpandedLoc(inner).offset();
+                        count += manager.getExpansionLoc(outer).offset();
+                    }
+                }
+            }
+            total += count;
+        });
+        pool.waitForAll();
+        return total.load();
+    };
+}
+
+TEST_CASE("Lexer throughput", "[.][benchmark]") {
+    // Mimic generated RTL: large comment banners, long identifiers,
+    // lots of indentation, and the odd string literal.
+    std::string text;
+    for (int i = 0; text.size() < 4 * 1024 * 1024; i++) {
+        text += "//" + std::string(76, '=') + "\n";
+        text += "// Auto-generated register block " + std::to_string(i) + "\n";
+        text += "/* " + std::string(200, '*') + "\n   description of the block\n */\n";
+        text += "        assign u_core_top_inst_" + std::to_string(i) +
+                "_very_long_generated_signal_name_q = "
+                "u_core_top_inst_very_long_generated_signal_name_d; // registered\n";
+        text += "        $display(\"register block %0d was written with a new value\", " +
+                std::to_string(i) + ");\n";
+    }
+
+    SourceManager manager;
+    auto buffer = manager.assignText(text);
+
+    auto lexAll = [&] {
+        BumpAllocator alloc;
+        Diagnostics diagnostics;
+        Lexer lexer(buffer, alloc, diagnostics);
+
+        size_t count = 0;
+        while (lexer.lex().kind != TokenKind::EndOfFile)
+            count++;
+        return count;
+    };
+
+    BENCHMARK("Lex " + std::to_string(text.size() / 1024) + " KB") {
+        return lexAll();
+    };
+
+    constexpr int iterations = 10;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        lexAll();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double megabytes = double(text.size()) * iterations / (1024 * 1024);
+    WARN("Lexer throughput: " << megabytes / elapsed.count() << " MB/s");
+}
+
+TEST_CASE("Disabled region skipping throughput", "[.][benchmark]") {
+    // Mimic vendor files that guard most of their contents per simulator,
+    // so that only a small part of the text is ever active.
+    std::string text;
+    for (int i = 0; text.size() < 4 * 1024 * 1024; i++) {
+        auto n = std::to_string(i);
+        text += "`ifdef VCS\n";
+        for (int j = 0; j < 8; j++) {
+            text += "  // simulator specific model " + n + "\n";
+            text += "  assign u_vendor_cell_" + n + "_q = {8'hff, u_vendor_cell_" + n +
+                    "_d[7:0]} ^ 16'h5a5a;\n";
+            text += "  initial $display(\"cell " + n + " uses the fast model\");\n";
+        }
+        text += "`elsif XCELIUM\n";
+        text += "  /* " + std::string(200, '*') + " */\n";
+        text += "  assign u_vendor_cell_" + n + "_q = u_vendor_cell_" + n + "_d;\n";
+        text += "`else\n";
+        text += "  wire w" + n + ";\n";
+        text += "`endif\n";
+    }
+
+    SourceManager manager;
+    auto buffer = manager.assignText(text);
+
+    auto preprocessAll = [&] {
+        BumpAllocator alloc;
+        Diagnostics diagnostics;
+        Preprocessor preprocessor(manager, alloc, diagnostics);
+        preprocessor.pushSource(buffer);
+
+        size_t count = 0;
+        while (preprocessor.next().kind != TokenKind::EndOfFile)
+            count++;
+        return count;
+    };
+
+    // For comparison, lexing every token of the text is roughly
+    // what skipping the disabled regions used to cost.
+    auto lexAll = [&] {
+        BumpAllocator alloc;
+        Diagnostics diagnostics;
+        Lexer lexer(buffer, alloc, diagnostics);
+
+        size_t count = 0;
+        while (lexer.lex().kind != TokenKind::EndOfFile)
+            count++;
+        return count;
+    };
+
+    BENCHMARK("Preprocess " + std::to_string(text.size() / 1024) + " KB") {
+        return preprocessAll();
+    };
+
+    BENCHMARK("Lex " + std::to_string(text.size() / 1024) + " KB") {
+        return lexAll();
+    };
+
+    constexpr int iterations = 10;
+    auto measure = [&](auto&& func) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            func();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return double(text.size()) * iterations / (1024 * 1024) / elapsed.count();
+    };
+
+    WARN("Preprocessor throughput: " << measure(preprocessAll) << " MB/s");
+    WARN("Lexer throughput: " << measure(lexAll) << " MB/s");
+}
+
+TEST_CASE("Parser throughput", "[.][benchmark]") {
+    // Use the regression corpus, which exercises most of the grammar,
+    // repeated enough times to get past the noise.
+    std::vector<char> corpus;
+    REQUIRE(OS::readFile(findTestDir() + "../../regression/all.sv", corpus));
+
+    std::string text;
+    std::string_view chunk(corpus.data(), corpus.size() - 1);
+    while (text.size() < 4 * 1024 * 1024)
+        text += chunk;
+
+    SourceManager manager;
+    auto buffer = manager.assignText(text);
+
+    auto parseAll = [&] {
+        auto tree = SyntaxTree::fromBuffer(buffer, manager);
+        return tree->root().getChildCount();
+    };
+
+    BENCHMARK("Parse " + std::to_string(text.size() / 1024) + " KB") {
+        return parseAll();
+    };
+
+    constexpr int iterations = 5;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        parseAll();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double megabytes = double(text.size()) * iterations / (1024 * 1024);
+    WARN("Parser throughput: " << megabytes / elapsed.count() << " MB/s");
+}
@@ -3,9 +3,11 @@
 
 #include "Test.h"
 #include <fmt/core.h>
+#include <fstream>
 #include <regex>
 
 #include "slang/driver/Driver.h"
+#include "slang/util/String.h"
 
 using namespace slang::driver;
 
@@ -177,6 +179,57 @@ TEST_CASE("Driver file preprocess with error") {
     CHECK(stderrContains("unknown macro"));
 }
 
+TEST_CASE("Driver file preprocess -- per-file output") {
+    auto guard = OS::captureOutput();
+
+    auto dir = getUniqueTempPath("slang_pp_output_test");
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir / "src" / "sub");
+
+    auto writeFile = [](const fs::path& path, std::string_view text) {
+        std::ofstream out(path, std::ios::binary);
+        out << text;
+    };
+
+    // Each file is preprocessed on its own, so the macro defined in
+    // the first one isn't visible in the rest.
+    std::vector<std::string> args = {"testfoo"};
+    for (int i = 0; i < 6; i++) {
+        auto path = dir / "src" / fmt::format("f{}.sv", i);
+        writeFile(path, i == 0 ? "`define FOO 1\nmodule m0; endmodule\n"
+                               : fmt::format("module m{}; `ifdef FOO foo `endif endmodule\n", i));
+        args.push_back(getU8Str(path));
+    }
+
+    writeFile(dir / "src" / "sub" / "f0.sv", "module dup; endmodule\n");
+    args.push_back(getU8Str(dir / "src" / "sub" / "f0.sv"));
+
+    std::vector<const char*> argv;
+    for (auto& arg : args)
+        argv.push_back(arg.c_str());
+
+    Driver driver;
+    driver.addStandardArgs();
+    CHECK(driver.parseCommandLine(int(argv.size()), argv.data()));
+    CHECK(driver.processOptions());
+
+    auto outDir = dir / "out";
+    CHECK(driver.runPreprocessor(true, false, false, false, getU8Str(outDir)));
+    CHECK(OS::capturedStdout.empty());
+
+    auto readFile = [](const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), {});
+    };
+
+    CHECK(readFile(outDir / "f0.sv") == "\nmodule m0; endmodule\n\n");
+    CHECK(readFile(outDir / "f3.sv") == "module m3;   endmodule\n\n");
+    CHECK(readFile(outDir / "f0_1.sv") == "module dup; endmodule\n\n");
+
+    fs::remove_all(dir, ec);
+}
+
 TEST_CASE("Driver report macros") {
     auto guard = OS::captureOutput();
 
@@ -290,6 +343,89 @@ TEST_CASE("Driver full compilation with defines and param overrides") {
     CHECK(stdoutContains("Build succeeded"));
 }
 
+TEST_CASE("Driver parallel elaboration of top-level instances") {
+    auto compile = [](std::string_view threads) {
+        auto guard = OS::captureOutput();
+
+        Driver driver;
+        driver.addStandardArgs();
+
+        auto args = fmt::format("testfoo \"{0}multitop.sv\" -j {1}", findTestDir(), threads);
+        CHECK(driver.parseCommandLine(args));
+        CHECK(driver.processOptions());
+        CHECK(driver.parseAllSources());
+
+        auto compilation = driver.createCompilation();
+        CHECK(!driver.reportCompilation(*compilation, false));
+        CHECK(stdoutContains("Build failed: 5 errors, 0 warnings"));
+        return OS::capturedStderr;
+    };
+
+    auto serial = compile("1");
+    CHECK(compile("2") == serial);
+    CHECK(compile("8") == serial);
+}
+
+TEST_CASE("Driver precompiled package images") {
+    auto dir = fs::temp_directory_path() / "slang_pkg_image_test";
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir);
+
+    auto writeFile = [](const fs::path& path, std::string_view text) {
+        std::ofstream out(path, std::ios::binary);
+        out << text;
+    };
+
+    writeFile(dir / "pkg.sv", R"(
+`define WIDTH 8
+package img_pkg;
+    localparam int W = `WIDTH;
+    typedef logic [W-1:0] word_t;
+    function automatic word_t twice(word_t w);
+        return w * 2;
+    endfunction
+    logic bad = pkg_missing;
+endpackage
+)");
+    writeFile(dir / "top.sv", R"(
+module top;
+    img_pkg::word_t w = img_pkg::twice(8'd3);
+    logic bad = top_missing;
+endmodule
+)");
+
+    auto pkgFile = getU8Str(dir / "pkg.sv");
+    auto topFile = getU8Str(dir / "top.sv");
+    auto imageFile = getU8Str(dir / "img_pkg.img");
+
+    auto compile = [&](const std::string& args) {
+        auto guard = OS::captureOutput();
+
+        Driver driver;
+        driver.addStandardArgs();
+        CHECK(driver.parseCommandLine("testfoo " + args));
+        CHECK(driver.processOptions());
+        if (!driver.parseAllSources())
+            return false;
+
+        auto compilation = driver.createCompilation();
+        CHECK(!driver.reportCompilation(*compilation, false));
+        CHECK(stdoutContains("Build failed: 2 errors, 0 warnings"));
+        CHECK(stderrContains("pkg_missing"));
+        return driver.writePackageImages(*compilation);
+    };
+
+    CHECK(compile(fmt::format("\"{}\" \"{}\" --write-package-image img_pkg=\"{}\"", pkgFile,
+                              topFile, imageFile)));
+
+    // The package's error is reported from the image, without its source.
+    CHECK(compile(fmt::format("\"{}\" --package-image \"{}\"", topFile, imageFile)));
+
+    CHECK(!compile(fmt::format("\"{}\" --package-image \"{}\" -DFOO", topFile, imageFile)));
+    CHECK(stderrContains("was written with different options"));
+}
+
 TEST_CASE("Driver setting a bunch of compilation options") {
     for (auto timing : {"min", "typ", "max"}) {
         auto guard = OS::captureOutput();
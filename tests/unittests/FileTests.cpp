@@ -2,10 +2,21 @@
 // SPDX-License-Identifier: MIT
 
 #include "Test.h"
+#include <fstream>
 
+#include "slang/ast/symbols/CompilationUnitSymbols.h"
+#include "slang/ast/symbols/InstanceSymbols.h"
+#include "slang/ast/symbols/ParameterSymbols.h"
+#include "slang/diagnostics/DiagnosticEngine.h"
+#include "slang/parsing/Preprocessor.h"
+#include "slang/syntax/AllSyntax.h"
+#include "slang/syntax/DefinitionIndex.h"
+#include "slang/syntax/SyntaxPrinter.h"
+#include "slang/syntax/SyntaxTreeCache.h"
 #include "slang/text/Glob.h"
 #include "slang/text/SourceManager.h"
 #include "slang/util/String.h"
+#include "slang/util/ThreadPool.h"
 
 std::string getTestInclude() {
     return findTestDir() + "/include.svh";
@@ -84,6 +95,149 @@ TEST_CASE("Read header (dev/null)") {
     }
 }
 
+TEST_CASE("Read header (lookup caching)") {
+    auto dir = fs::temp_directory_path() / "slang_include_cache_test";
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir / "inc1" / "sub");
+    fs::create_directories(dir / "inc2");
+
+    auto writeFile = [](const fs::path& path, std::string_view text) {
+        std::ofstream out(path, std::ios::binary);
+        out << text;
+    };
+    writeFile(dir / "inc1" / "sub" / "a.svh", "a");
+    writeFile(dir / "inc2" / "b.svh", "b");
+
+    SourceManager manager;
+    CHECK(manager.addUserDirectory(getU8Str(dir / "inc1")));
+    CHECK(manager.addUserDirectory(getU8Str(dir / "inc2")));
+
+    auto a1 = manager.readHeader("sub/a.svh", SourceLocation(), nullptr, false);
+    auto a2 = manager.readHeader("sub/a.svh", SourceLocation(), nullptr, false);
+    REQUIRE(a1);
+    REQUIRE(a2);
+    CHECK(a1.id != a2.id);
+    CHECK(a1.data.data() == a2.data.data());
+    CHECK(manager.getIncludedFrom(a2.id) == SourceLocation());
+
+    auto b = manager.readHeader("b.svh", SourceLocation(a1.id, 0), nullptr, false);
+    REQUIRE(b);
+    CHECK(b.data == std::string_view("b\0", 2));
+    CHECK(manager.getIncludedFrom(b.id) == SourceLocation(a1.id, 0));
+    CHECK(!manager.readHeader("b.svh", SourceLocation(), nullptr, true));
+
+    // Files created after a failed lookup aren't seen until the cache is cleared.
+    CHECK(!manager.readHeader("c.svh", SourceLocation(), nullptr, false));
+    CHECK(!manager.readHeader("sub/c.svh", SourceLocation(), nullptr, false));
+    writeFile(dir / "inc2" / "c.svh", "c");
+    writeFile(dir / "inc1" / "sub" / "c.svh", "subc");
+    CHECK(!manager.readHeader("c.svh", SourceLocation(), nullptr, false));
+
+    manager.clearIncludeCache();
+    auto c = manager.readHeader("c.svh", SourceLocation(), nullptr, false);
+    REQUIRE(c);
+    CHECK(c.data == std::string_view("c\0", 2));
+    auto subc = manager.readHeader("sub/c.svh", SourceLocation(), nullptr, false);
+    REQUIRE(subc);
+    CHECK(subc.data == std::string_view("subc\0", 5));
+
+    // Adding an include directory invalidates previous lookups.
+    CHECK(!manager.readHeader("d.svh", SourceLocation(), nullptr, false));
+    fs::create_directories(dir / "inc3");
+    writeFile(dir / "inc3" / "d.svh", "d");
+    CHECK(manager.addUserDirectory(getU8Str(dir / "inc3")));
+    CHECK(manager.readHeader("d.svh", SourceLocation(), nullptr, false));
+
+    fs::remove_all(dir, ec);
+}
+
+TEST_CASE("Read source (memory mapped)") {
+    // Make a file that's large enough to be mapped and whose size
+    // doesn't land on a page boundary.
+    std::string text;
+    while (text.size() < 64 * 1024)
+        text += "module m; logic [3:0] a = 4'b1010; endmodule\n";
+
+    auto path = fs::temp_directory_path() / "slang_mmap_test.sv";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << text;
+    }
+
+    SourceManager manager;
+    manager.setMemoryMapFiles(true);
+
+    auto buffer = manager.readSource(path, /* library */ nullptr);
+    REQUIRE(buffer);
+    REQUIRE(buffer.data.size() == text.size() + 1);
+    CHECK(buffer.data.back() == '\0');
+    CHECK(buffer.data.substr(0, text.size()) == text);
+    CHECK(manager.getSourceText(buffer.id) == buffer.data);
+    CHECK(manager.getLineNumber(SourceLocation(buffer.id, text.size() - 1)) > 1);
+
+    // Small files fall back to a normal read.
+    auto small = manager.readSource(manager.makeAbsolutePath(getTestInclude()), nullptr);
+    REQUIRE(small);
+    CHECK(small.data.back() == '\0');
+
+    std::error_code ec;
+    fs::remove(path, ec);
+}
+
+TEST_CASE("Line numbers with mixed line endings") {
+    // Vary the line lengths so that newlines land at every position
+    // within the chunks scanned at a time when building the line table.
+    const char* endings[] = {"\n", "\r\n", "\n\r", "\r"};
+    std::string text;
+    std::vector<size_t> lineStarts;
+    for (size_t i = 0; i < 200; i++) {
+        lineStarts.push_back(text.size());
+        text.append(i % 67, 'a');
+        text += endings[i % 4];
+    }
+
+    SourceManager manager;
+    auto buffer = manager.assignText(text);
+    for (size_t i = 0; i < lineStarts.size(); i++) {
+        CHECK(manager.getLineNumber(SourceLocation(buffer.id, lineStarts[i])) == i + 1);
+        CHECK(manager.getColumnNumber(SourceLocation(buffer.id, lineStarts[i])) == 1);
+    }
+}
+
+TEST_CASE("Concurrent expansion locations") {
+    SourceManager manager;
+    auto buffer = manager.assignText("module m; endmodule\n"sv);
+    SourceLocation start(buffer.id, 0);
+
+    // Create enough expansions from several threads to spill
+    // across multiple chunks of buffer entries.
+    constexpr size_t NumThreads = 4;
+    constexpr size_t PerThread = 5000;
+    std::vector<std::vector<SourceLocation>> locs(NumThreads);
+
+    ThreadPool pool(NumThreads);
+    pool.pushLoop(size_t(0), NumThreads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            for (size_t j = 0; j < PerThread; j++) {
+                locs[i].push_back(manager.createExpansionLoc(
+                    start + (j % 8), SourceRange(start, start + 1), (j & 1) != 0));
+            }
+        }
+    });
+    pool.waitForAll();
+
+    CHECK(manager.getAllBuffers().size() == NumThreads * PerThread + 1);
+    for (auto& list : locs) {
+        for (size_t j = 0; j < list.size(); j++) {
+            CHECK(manager.isMacroLoc(list[j]));
+            CHECK(manager.isMacroArgLoc(list[j]) == ((j & 1) != 0));
+            CHECK(manager.getFullyOriginalLoc(list[j]) == start + (j % 8));
+            CHECK(manager.getExpansionLoc(list[j]) == start);
+        }
+    }
+}
+
 static void globAndCheck(const fs::path& basePath, std::string_view pattern, GlobMode mode,
                          GlobRank expectedRank, std::initializer_list<const char*> expected) {
     SmallVector<fs::path> results;
@@ -109,6 +263,476 @@ static void globAndCheck(const fs::path& basePath, std::string_view pattern, Glo
     }
 }
 
+TEST_CASE("Syntax tree cache") {
+    auto dir = getUniqueTempPath("slang_tree_cache_test");
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir / "cache");
+
+    auto writeFile = [&](const fs::path& path, std::string_view text) {
+        std::ofstream out(path, std::ios::binary);
+        out << text;
+    };
+
+    writeFile(dir / "defs.svh", "`define WIDTH 4\n`define ADD(a, b) ((a) + (b))\n");
+    writeFile(dir / "top.sv", R"(
+`include "defs.svh"
+`timescale 1ns/1ps
+package p; localparam int P = `ADD(`WIDTH, 2); endpackage
+
+module top;
+    import p::*;
+    localparam real r = 1.5e3;
+    localparam logic [`WIDTH-1:0] l = 4'b10x1;
+    localparam string s = "hello\tworld";
+    leaf u();
+endmodule
+
+module leaf; endmodule
+)");
+
+    Bag options;
+    options.set(SyntaxTreeCacheOptions{getU8Str(dir / "cache")});
+
+    auto path = getU8Str(dir / "top.sv");
+    SourceManager sm1;
+    auto parsed = SyntaxTree::fromFile(path, sm1, options);
+    REQUIRE(parsed);
+    CHECK(parsed->diagnostics().empty());
+
+    // Loading the tree directly from the cache should produce an identical result.
+    SourceManager sm2;
+    auto buffer = sm2.readSource(path, /* library */ nullptr);
+    REQUIRE(buffer);
+
+    SyntaxTreeCache cache(dir / "cache");
+    auto key = SyntaxTreeCache::getKey(sm2, std::span(&buffer, 1), options, {});
+    auto loaded = cache.load(key, sm2, std::span(&buffer, 1), options);
+    REQUIRE(loaded);
+
+    CHECK(SyntaxPrinter::printFile(*loaded) == SyntaxPrinter::printFile(*parsed));
+    CHECK(SyntaxPrinter()
+              .setIncludeDirectives(false)
+              .setIncludePreprocessed(true)
+              .print(loaded->root())
+              .str() == SyntaxPrinter()
+                            .setIncludeDirectives(false)
+                            .setIncludePreprocessed(true)
+                            .print(parsed->root())
+                            .str());
+    CHECK(loaded->getDefinedMacros().size() == parsed->getDefinedMacros().size());
+
+    auto& meta = loaded->getMetadata();
+    CHECK(meta.nodeMap.size() == 3);
+    CHECK(meta.globalInstances.contains("leaf"));
+    CHECK(meta.packageImports.size() == 1);
+    CHECK(meta.eofToken.kind == TokenKind::EndOfFile);
+
+    Compilation compilation;
+    compilation.addSyntaxTree(loaded);
+    NO_COMPILATION_ERRORS;
+
+    auto& top = compilation.getRoot().lookupName<InstanceSymbol>("top");
+    CHECK(top.body.getTimeScale()->base.unit == TimeUnit::Nanoseconds);
+    auto& param = compilation.getRoot().lookupName<ParameterSymbol>("p::P");
+    CHECK(param.getValue().integer() == 6);
+
+    // Macro locations should map back to the header file.
+    auto getAddLoc = [](SyntaxTree& tree) {
+        auto& pkg =
+            tree.root().as<CompilationUnitSyntax>().members[0]->as<ModuleDeclarationSyntax>();
+        auto& param = pkg.members[0]->as<ParameterDeclarationStatementSyntax>().parameter;
+        auto decl = param->as<ParameterDeclarationSyntax>().declarators[0];
+        return decl->initializer->expr->getFirstToken().location();
+    };
+    auto loadedLoc = getAddLoc(*loaded);
+    auto parsedLoc = getAddLoc(*parsed);
+    CHECK(sm2.isMacroLoc(loadedLoc));
+    CHECK(sm2.getMacroName(loadedLoc) == sm1.getMacroName(parsedLoc));
+    CHECK(sm2.getLineNumber(sm2.getFullyOriginalLoc(loadedLoc)) ==
+          sm1.getLineNumber(sm1.getFullyOriginalLoc(parsedLoc)));
+
+    // Editing the included header invalidates the cached tree.
+    writeFile(dir / "defs.svh", "`define WIDTH 8\n`define ADD(a, b) ((a) + (b))\n");
+    SourceManager sm3;
+    buffer = sm3.readSource(path, /* library */ nullptr);
+    REQUIRE(buffer);
+    auto numBuffers = sm3.getAllBuffers().size();
+    CHECK(!cache.load(key, sm3, std::span(&buffer, 1), options));
+
+    // A failed load doesn't leave anything behind in the source manager.
+    CHECK(sm3.getAllBuffers().size() == numBuffers);
+
+    // Different options produce a different key.
+    PreprocessorOptions ppOptions;
+    ppOptions.predefines.push_back("FOO=1");
+    Bag otherOptions;
+    otherOptions.set(SyntaxTreeCacheOptions{getU8Str(dir / "cache")});
+    otherOptions.set(ppOptions);
+    CHECK(SyntaxTreeCache::getKey(sm3, std::span(&buffer, 1), otherOptions, {}) != key);
+
+    // Going through SyntaxTree reparses and refreshes the cache.
+    auto reparsed = SyntaxTree::fromFile(path, sm3, options);
+    REQUIRE(reparsed);
+    SourceManager sm4;
+    buffer = sm4.readSource(path, /* library */ nullptr);
+    auto reloaded = cache.load(key, sm4, std::span(&buffer, 1), options);
+    REQUIRE(reloaded);
+    CHECK(SyntaxPrinter::printFile(*reloaded) == SyntaxPrinter::printFile(*reparsed));
+
+    // Adding an include directory can change which header gets included,
+    // so it changes the key too.
+    SourceManager sm5;
+    REQUIRE(sm5.addUserDirectory(getU8Str(dir)));
+    buffer = sm5.readSource(path, /* library */ nullptr);
+    CHECK(SyntaxTreeCache::getKey(sm5, std::span(&buffer, 1), options, {}) != key);
+
+    fs::remove_all(dir, ec);
+}
+
+TEST_CASE("Incremental reparsing") {
+    SourceManager sm;
+    int counter = 0;
+
+    auto bufferOf = [](const SyntaxTree& tree) {
+        return tree.getMetadata().eofToken.location().buffer();
+    };
+
+    auto textOf = [&](const SyntaxTree& tree) {
+        auto text = std::string(sm.getSourceText(bufferOf(tree)));
+        text.pop_back();
+        return text;
+    };
+
+    // Gets the offset and text of every token in a tree, in order,
+    // checking that they all come from the tree's buffer.
+    auto tokensOf = [&](const SyntaxTree& tree) {
+        std::vector<std::pair<size_t, std::string_view>> result;
+        auto visit = [&](const SyntaxNode& node, auto& self) -> void {
+            for (size_t i = 0; i < node.getChildCount(); i++) {
+                if (auto token = node.childToken(i)) {
+                    CHECK(token.location().buffer() == bufferOf(tree));
+                    result.emplace_back(token.location().offset(), token.rawText());
+                }
+                else if (auto child = node.childNode(i)) {
+                    self(*child, self);
+                }
+            }
+        };
+        visit(tree.root(), visit);
+        return result;
+    };
+
+    // Applies edits to a tree and checks that the result is the same as
+    // parsing the edited text from scratch.
+    auto check = [&](std::shared_ptr<SyntaxTree> oldTree,
+                     std::vector<TextEdit> edits) -> std::shared_ptr<SyntaxTree> {
+        auto tree = SyntaxTree::fromEdits(std::move(oldTree), edits);
+        REQUIRE(tree);
+
+        auto text = textOf(*tree);
+        auto full = SyntaxTree::fromFileInMemory(text, sm, "source",
+                                                 "incremental" + std::to_string(counter++));
+
+        CHECK(SyntaxPrinter::printFile(*tree) == text);
+        CHECK(tree->root().isEquivalentTo(full->root()));
+        CHECK(tokensOf(*tree) == tokensOf(*full));
+        CHECK(DiagnosticEngine::reportAll(sm, tree->diagnostics()) ==
+              DiagnosticEngine::reportAll(sm, full->diagnostics()));
+        CHECK(tree->getDefinedMacros().size() == full->getDefinedMacros().size());
+        CHECK(tree->getMetadata().nodeMap.size() == full->getMetadata().nodeMap.size());
+        CHECK(tree->getMetadata().globalInstances == full->getMetadata().globalInstances);
+        CHECK(tree->getMetadata().classDecls.size() == full->getMetadata().classDecls.size());
+        return tree;
+    };
+
+    auto tree = SyntaxTree::fromFileInMemory(R"(`default_nettype none
+`define FOO 1
+module a;
+    logic x = "str\n";
+endmodule
+
+module b;
+    a a1();
+    int i = 12345678901234567890123;
+endmodule
+
+module c(input logic q);
+    assign q = ;
+endmodule
+
+class K; endclass
+// trailing
+)",
+                                             sm, "source", "incremental");
+    auto text = textOf(*tree);
+    CHECK(tree->diagnostics().size() == 2);
+
+    auto members = [](const SyntaxTree& tree) {
+        auto& unit = tree.root().as<CompilationUnitSyntax>();
+        return std::vector<const MemberSyntax*>(unit.members.begin(), unit.members.end());
+    };
+
+    // Rename a signal inside of the middle module; the modules around it are reused.
+    auto oldMembers = members(*tree);
+    tree = check(std::move(tree), {{text.find("int i") + 4, 1, "jj"}});
+
+    auto newMembers = members(*tree);
+    REQUIRE(newMembers.size() == 4);
+    CHECK(newMembers[0] == oldMembers[0]);
+    CHECK(newMembers[1] != oldMembers[1]);
+    CHECK(newMembers[2] == oldMembers[2]);
+    CHECK(newMembers[3] == oldMembers[3]);
+
+    auto& c = newMembers[2]->as<ModuleDeclarationSyntax>();
+    CHECK(c.parent == &tree->root());
+    CHECK(sm.getLineNumber(c.header->name.location()) == 12);
+    CHECK(sm.getColumnNumber(tree->diagnostics().back().location) == 16);
+    CHECK(tree->getMetadata().nodeMap.at(&c).defaultNetType == TokenKind::Unknown);
+
+    // Insert a new module, then delete it again.
+    text = textOf(*tree);
+    auto offset = text.find("module c");
+    tree = check(std::move(tree), {{offset, 0, "module d;\n    b b1();\nendmodule\n\n"}});
+    tree = check(std::move(tree), {{offset, 33, ""}});
+    CHECK(members(*tree)[2] == &c);
+
+    // Edits in several places at once, including at the end of the file.
+    text = textOf(*tree);
+    tree = check(std::move(tree), {{text.find("a1"), 2, "a2"},
+                                   {text.find("assign q = ;") + 11, 0, "1"},
+                                   {text.find("// trailing"), 11, "/* done */"}});
+    CHECK(tree->diagnostics().size() == 1);
+
+    // Edits right after a member can change where it ends.
+    text = textOf(*tree);
+    tree = check(std::move(tree), {{text.find("\nmodule b") + 1, 0, ": a "}});
+    text = textOf(*tree);
+    tree = check(std::move(tree), {{text.find("endclass") + 8, 0, " : K"}});
+
+    // Unbalancing a module makes the parser run on past it, and
+    // balancing it again lets the rest of the tree be reused.
+    text = textOf(*tree);
+    offset = text.find("endmodule", text.find("module b"));
+    tree = check(std::move(tree), {{offset, 9, ""}});
+    tree = check(std::move(tree), {{offset, 0, "endmodule"}});
+
+    // A tree that is still referenced elsewhere is left alone.
+    auto shared = tree;
+    oldMembers = members(*tree);
+    auto sharedText = SyntaxPrinter::printFile(*shared);
+    auto other = check(tree, {{textOf(*tree).find("jj"), 2, "k"}});
+    CHECK(members(*other)[0] != oldMembers[0]);
+    CHECK(SyntaxPrinter::printFile(*shared) == sharedText);
+    CHECK(!tokensOf(*shared).empty());
+    shared.reset();
+
+    // Edits that touch directives fall back to a full parse.
+    oldMembers = members(*tree);
+    text = textOf(*tree);
+    tree = check(std::move(tree), {{text.find("endmodule"), 0, "`define BAR `FOO\n"}});
+    CHECK(members(*tree)[0] != oldMembers[0]);
+    tree = check(std::move(tree), {{0, 21, "`default_nettype wire"}});
+    text = textOf(*tree);
+    tree = check(std::move(tree), {{text.find("/* done */") + 8, 2, ""}});
+    check(std::move(tree), {});
+
+    // A file with no members at all.
+    check(SyntaxTree::fromText("// nothing\n", sm), {{3, 7, "module e; endmodule"}});
+}
+
+TEST_CASE("Parallel single-unit parsing") {
+    SourceManager sm;
+    ThreadPool threadPool(4);
+    sm.assignText("parallel-guarded.svh", R"(
+`ifndef PARALLEL_GUARDED_SVH
+`define PARALLEL_GUARDED_SVH
+`define GUARDED_WIDTH 8
+`endif
+)");
+
+    // Parses the texts both ways and checks that the results are the same.
+    auto check = [&](std::vector<std::string_view> texts) {
+        std::vector<SourceBuffer> buffers;
+        for (auto text : texts)
+            buffers.push_back(sm.assignText(text));
+
+        auto tree = SyntaxTree::fromBuffersInParallel(buffers, sm, threadPool);
+        auto full = SyntaxTree::fromBuffers(buffers, sm);
+
+        CHECK(SyntaxPrinter::printFile(*tree) == SyntaxPrinter::printFile(*full));
+        CHECK(tree->root().isEquivalentTo(full->root()));
+        CHECK(DiagnosticEngine::reportAll(sm, tree->diagnostics()) ==
+              DiagnosticEngine::reportAll(sm, full->diagnostics()));
+        CHECK(tree->getDefinedMacros().size() == full->getDefinedMacros().size());
+        CHECK(tree->getMetadata().nodeMap.size() == full->getMetadata().nodeMap.size());
+        CHECK(tree->getMetadata().globalInstances == full->getMetadata().globalInstances);
+
+        for (auto& [node, meta] : full->getMetadata().nodeMap) {
+            auto name = node->as<ModuleDeclarationSyntax>().header->name.valueText();
+            for (auto& [other, otherMeta] : tree->getMetadata().nodeMap) {
+                if (other->as<ModuleDeclarationSyntax>().header->name.valueText() == name) {
+                    CHECK(otherMeta.defaultNetType == meta.defaultNetType);
+                    CHECK(otherMeta.timeScale == meta.timeScale);
+                }
+            }
+        }
+        return tree;
+    };
+
+    // Macros, directives and include guards that leak from one file into the next.
+    auto tree = check({R"(
+`define FOO 1
+`timescale 1ns/1ps
+`include "parallel-guarded.svh"
+module a; endmodule
+)",
+                       R"(// leading comment
+`default_nettype none
+module b; logic [`FOO:0] x; endmodule
+)",
+                       "",
+                       R"(
+`include "parallel-guarded.svh"
+`undef FOO
+`ifdef FOO
+module c; endmodule
+`else
+module d; logic [`GUARDED_WIDTH:0] y; endmodule
+`endif
+// trailing
+)",
+                       R"(
+`define FOO 2
+module e; int i = `FOO + `BAR; endmodule
+)"});
+    CHECK(tree->getMetadata().nodeMap.size() == 4);
+    CHECK(tree->diagnostics().size() == 2);
+
+    // Independent files with no shared state.
+    check({"module f; endmodule\n", "module g; f f1(); endmodule\n", "module h;\nendmodule"});
+
+    // A module split across files can't be parsed separately.
+    check({"module i;\n", "endmodule\n", "module j; endmodule\n"});
+    check({"`ifdef X\n", "`endif\nmodule k; endmodule\n"});
+    check({"`undefineall\n", "module l; int i = `FOO; endmodule\n"});
+}
+
+TEST_CASE("Parallel parsing keeps directives only from accepted parses") {
+    // Parses the texts both ways, each with its own source manager so
+    // that directives registered by one can't affect the other.
+    auto parse = [](SourceManager& sm, std::vector<std::string_view> texts, bool parallel) {
+        std::vector<SourceBuffer> buffers;
+        for (size_t i = 0; i < texts.size(); i++)
+            buffers.push_back(sm.assignText(std::string(1, char('a' + i)) + ".sv", texts[i]));
+
+        ThreadPool threadPool(4);
+        auto tree = parallel ? SyntaxTree::fromBuffersInParallel(buffers, sm, threadPool)
+                             : SyntaxTree::fromBuffers(buffers, sm);
+        return std::make_pair(tree, buffers);
+    };
+
+    // Reports the file and line of the last member of the last buffer
+    // along with the number of diagnostic directives in each buffer.
+    auto check = [&](std::vector<std::string_view> texts) {
+        SourceManager sm1, sm2;
+        auto [serial, serialBuffers] = parse(sm1, texts, false);
+        auto [parallel, parallelBuffers] = parse(sm2, texts, true);
+
+        auto describe = [](SourceManager& sm, SyntaxTree& tree, std::span<SourceBuffer> buffers) {
+            auto& unit = tree.root().as<CompilationUnitSyntax>();
+            auto loc = unit.members.back()->getLastToken().location();
+            std::string result = std::string(sm.getFileName(loc)) + ":" +
+                                 std::to_string(sm.getLineNumber(loc));
+            for (auto& buffer : buffers)
+                result += " " + std::to_string(sm.getDiagnosticDirectives(buffer.id).size());
+            return result;
+        };
+
+        auto result = describe(sm2, *parallel, parallelBuffers);
+        CHECK(result == describe(sm1, *serial, serialBuffers));
+        CHECK(SyntaxPrinter::printFile(*parallel) == SyntaxPrinter::printFile(*serial));
+        return result;
+    };
+
+    // The second file is parsed twice; the first attempt sees the directives
+    // that the macro from the first file is supposed to skip.
+    CHECK(check({"`define SKIP\n", R"(`ifndef SKIP
+`line 100 "x.sv" 0
+`pragma diagnostic ignore="-Wfoo"
+`endif
+module b; logic s;
+endmodule
+)"}) == "b.sv:6 0 0");
+
+    // Directives that are kept take effect, whichever way the file was parsed.
+    CHECK(check({"module a; endmodule\n", R"(`line 100 "x.sv" 0
+`pragma diagnostic ignore="-Wfoo"
+module b; int i = `__LINE__;
+endmodule
+)"}) == "x.sv:102 0 1");
+}
+
+TEST_CASE("Definition index") {
+    SourceManager sm;
+    std::vector<std::string> texts = {R"(
+module m1 import p1::*; (I.mod i);
+    m2 u1();
+    m3 u2();
+    int j = C::k;
+endmodule
+)",
+                                      R"(
+package p1;
+    class C; static int k; endclass
+endpackage
+interface I; modport mod(); endinterface
+)",
+                                      R"(
+module m2; endmodule
+program m3; endprogram
+class C; endclass
+)"};
+
+    // Trees can be added from multiple threads at once.
+    DefinitionIndex index;
+    std::vector<std::shared_ptr<SyntaxTree>> trees(texts.size());
+    ThreadPool threadPool(4);
+    threadPool.pushLoop(size_t(0), texts.size(), [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; i++) {
+            trees[i] = SyntaxTree::fromText(texts[i], sm);
+            index.add(*trees[i]);
+        }
+    });
+    threadPool.waitForAll();
+
+    CHECK(index.size() == 6);
+    for (auto name : {"m1", "m2", "m3", "p1", "I", "C"})
+        CHECK(index.contains(name));
+    CHECK(!index.contains("m4"));
+
+    auto entries = index.find("C");
+    REQUIRE(entries.size() == 2);
+    for (auto& entry : entries)
+        CHECK(entry.syntax->kind == SyntaxKind::ClassDeclaration);
+
+    entries = index.find("m3");
+    REQUIRE(entries.size() == 1);
+    CHECK(entries[0].syntax->kind == SyntaxKind::ProgramDeclaration);
+    CHECK(entries[0].tree == trees[2].get());
+
+    flat_hash_set<std::string_view> missing;
+    index.findMissingNames(*trees[0], missing);
+    CHECK(missing.empty());
+
+    DefinitionIndex partial;
+    partial.add(*trees[0]);
+    partial.findMissingNames(*trees[0], missing);
+    CHECK(missing.size() == 5);
+    for (auto name : {"m2", "m3", "p1", "I", "C"})
+        CHECK(missing.contains(name));
+}
+
 TEST_CASE("File globbing") {
     auto testDir = findTestDir();
     globAndCheck(testDir, "*st?.sv", GlobMode::Files, GlobRank::WildcardName,
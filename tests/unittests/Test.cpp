@@ -3,6 +3,7 @@
 
 #include "Test.h"
 
+#include <fmt/format.h>
 #include <sstream>
 
 #include "slang/ast/symbols/CompilationUnitSymbols.h"
@@ -10,6 +11,7 @@
 #include "slang/parsing/Parser.h"
 #include "slang/parsing/Preprocessor.h"
 #include "slang/text/SourceManager.h"
+#include "slang/util/Random.h"
 
 std::string findTestDir() {
     auto path = fs::current_path();
@@ -21,6 +23,12 @@ std::string findTestDir() {
     return (path / "tests/unittests/data/").string();
 }
 
+fs::path getUniqueTempPath(std::string_view prefix) {
+    // Include a random suffix so that concurrent test runs don't trample each other.
+    static auto rng = createRandomGenerator<std::mt19937_64>();
+    return fs::temp_directory_path() / fmt::format("{}_{:016x}", prefix, rng());
+}
+
 void setupSourceManager(SourceManager& sourceManager) {
     auto testDir = findTestDir();
     CHECK(sourceManager.addUserDirectory(testDir));
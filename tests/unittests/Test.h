@@ -70,6 +70,7 @@ using namespace slang::ast;
     } while (0)
 
 std::string findTestDir();
+fs::path getUniqueTempPath(std::string_view prefix);
 void setupSourceManager(SourceManager& sourceManager);
 SourceManager& getSourceManager();
 
@@ -3,10 +3,14 @@
 
 #include "Test.h"
 
+#include "slang/ast/PackageImage.h"
 #include "slang/ast/symbols/BlockSymbols.h"
+#include "slang/ast/symbols/ClassSymbols.h"
 #include "slang/ast/symbols/CompilationUnitSymbols.h"
 #include "slang/ast/symbols/InstanceSymbols.h"
 #include "slang/ast/symbols/ParameterSymbols.h"
+#include "slang/ast/types/AllTypes.h"
+#include "slang/ast/types/NetType.h"
 #include "slang/text/SourceManager.h"
 
 TEST_CASE("Finding top level") {
@@ -2226,3 +2230,353 @@ endprimitive
     CHECK(diags[2].code == diag::MissingExternWildcardPorts);
     CHECK(diags[3].code == diag::MissingExternWildcardPorts);
 }
+
+TEST_CASE("Instance body caching") {
+    auto tree = SyntaxTree::fromText(R"(
+module leaf #(parameter int W = 1)(input logic [W-1:0] a);
+    logic [W-1:0] b;
+    assign b = a;
+endmodule
+
+module mid #(parameter int W = 1);
+    logic [W-1:0] x;
+    leaf #(W) l(x);
+    if (W == 4) begin : g
+        $error("W is four");
+    end
+endmodule
+
+module top;
+    mid #(4) m1();
+    mid #(4) m2();
+    mid #(8) m3();
+    mid #(4) m4();
+    assign m4.x = '0;
+endmodule
+)");
+
+    Compilation compilation;
+    compilation.addSyntaxTree(tree);
+    auto& diags = compilation.getAllDiagnostics();
+
+    auto& root = compilation.getRoot();
+    auto& m1 = root.lookupName<InstanceSymbol>("top.m1");
+    auto& m2 = root.lookupName<InstanceSymbol>("top.m2");
+    auto& m3 = root.lookupName<InstanceSymbol>("top.m3");
+    auto& m4 = root.lookupName<InstanceSymbol>("top.m4");
+    CHECK(!m1.getCanonicalBody());
+    CHECK(m2.getCanonicalBody() == &m1.body);
+    CHECK(!m3.getCanonicalBody());
+    CHECK(!m4.getCanonicalBody());
+
+    // Diagnostics should come out the same as when every body is elaborated.
+    CompilationOptions options;
+    options.disableInstanceCaching = true;
+
+    Compilation uncached(options);
+    uncached.addSyntaxTree(tree);
+    CHECK(report(diags) == report(uncached.getAllDiagnostics()));
+    CHECK(!uncached.getRoot().lookupName<InstanceSymbol>("top.m2").getCanonicalBody());
+}
+
+TEST_CASE("Parallel elaboration of top-level instances") {
+    auto source = R"(
+package p;
+    typedef logic [7:0] byte_t;
+    logic shared;
+    class C #(type T = int);
+        T val;
+        function T get(); return val; endfunction
+    endclass
+    function automatic int f(int a); return a + 1; endfunction
+endpackage
+
+module leaf #(parameter int W = 1);
+    import p::*;
+    byte_t b;
+    C #(logic [W-1:0]) c = new;
+    logic [W-1:0] x = leaf_missing;
+    initial shared = 1;
+endmodule
+
+module a;
+    leaf #(4) l1();
+    leaf #(4) l2();
+    p::C #(shortint) c;
+    logic q = a_missing;
+    enum { A1, A2 } e = 5;
+endmodule
+
+module b;
+    leaf #(8) l();
+    p::C #(shortint) c;
+    int i = p::f(b_missing);
+    enum { B1, B2 } e = 5;
+endmodule
+
+module c;
+    typedef struct packed { logic s; } s_t;
+    s_t s = c_missing;
+endmodule
+)";
+
+    auto tree = SyntaxTree::fromText(source);
+    Compilation serial;
+    serial.addSyntaxTree(tree);
+    auto& serialDiags = serial.getAllDiagnostics();
+    CHECK(serialDiags.size() == 6);
+
+    CompilationOptions options;
+    options.numThreads = 4;
+    Compilation parallel(options);
+    parallel.addSyntaxTree(tree);
+
+    CHECK(report(parallel.getAllDiagnostics()) == report(serialDiags));
+
+    // The anonymous enums in a and b are numbered as if they were made one after the other.
+    auto enumId = [](Compilation& compilation, std::string_view name) {
+        auto& var = compilation.getRoot().lookupName<VariableSymbol>(name);
+        return var.getType().as<EnumType>().systemId;
+    };
+    CHECK(enumId(parallel, "a.e") == enumId(serial, "a.e"));
+    CHECK(enumId(parallel, "b.e") == enumId(serial, "b.e"));
+    CHECK(enumId(parallel, "a.e") != enumId(parallel, "b.e"));
+
+    // Each top-level instance makes its own specializations of package classes,
+    // so the one that is shared between a and b in serial mode is made twice.
+    auto specs = [](Compilation& compilation) {
+        auto pkg = compilation.getPackage("p");
+        REQUIRE(pkg);
+        return pkg->find("C")->as<GenericClassDefSymbol>().numSpecializations();
+    };
+    CHECK(specs(parallel) == specs(serial) + 1);
+
+    // A hierarchical reference from one top-level instance
+    // to another keeps everything on one thread.
+    auto rootTree = SyntaxTree::fromText(std::string(source) + R"(
+module d;
+    int j = $root.b.i;
+endmodule
+)");
+    Compilation rootSerial;
+    rootSerial.addSyntaxTree(rootTree);
+
+    Compilation rootParallel(options);
+    rootParallel.addSyntaxTree(rootTree);
+    CHECK(report(rootParallel.getAllDiagnostics()) == report(rootSerial.getAllDiagnostics()));
+    CHECK(specs(rootParallel) == specs(rootSerial));
+}
+
+TEST_CASE("Scoped elaboration") {
+    auto tree = SyntaxTree::fromText(R"(
+module leaf #(parameter int W = 1)(input logic [W-1:0] a);
+    logic [W-1:0] b = a + leaf_missing;
+endmodule
+
+module mid;
+    logic [7:0] s;
+    leaf #(.W(8)) l1(.a(s));
+    if (1) begin : g
+        leaf #(.W(4)) l2(.a(s[3:0]));
+    end
+    logic m = mid_missing;
+endmodule
+
+module top;
+    mid m1();
+    mid m2();
+    logic t = top_missing;
+endmodule
+)");
+
+    CompilationOptions options;
+    options.elabScopes = {"top.m1.g", "top.m2.l1", "top.m3"};
+
+    Compilation compilation(options);
+    compilation.addSyntaxTree(tree);
+
+    // Only the leaf instances inside the scopes get checked; the error
+    // in mid and top is never seen.
+    auto& diags = compilation.getAllDiagnostics();
+    REQUIRE(diags.size() == 2);
+
+    auto hasDiag = [&](DiagCode code) {
+        return std::ranges::any_of(diags, [&](auto& diag) { return diag.code == code; });
+    };
+    CHECK(hasDiag(diag::UndeclaredIdentifier));
+    CHECK(hasDiag(diag::InvalidElabScope));
+}
+
+TEST_CASE("Scoped elaboration unused interfaces") {
+    auto tree = SyntaxTree::fromText(R"(
+interface I;
+endinterface
+
+module unused(I i);
+endmodule
+
+module top;
+endmodule
+)");
+
+    CompilationOptions options;
+    options.suppressUnused = false;
+
+    Compilation full(options);
+    full.addSyntaxTree(tree);
+
+    // The interface is only referenced by a port of a top-level module that isn't
+    // inside the elaborated scope, so it must not be reported as unused.
+    options.elabScopes = {"top"};
+    Compilation scoped(options);
+    scoped.addSyntaxTree(tree);
+
+    auto& diags = scoped.getAllDiagnostics();
+    CHECK(report(diags) == report(full.getAllDiagnostics()));
+    CHECK(diags.empty());
+}
+
+TEST_CASE("Recompiling after replacing a syntax tree") {
+    auto pkgTree = SyntaxTree::fromText(R"(
+package p;
+    parameter int W = 8;
+endpackage
+)");
+    auto leafTree = SyntaxTree::fromText(R"(
+module leaf;
+    logic x = leaf_missing;
+endmodule
+)");
+    auto topTree = SyntaxTree::fromText(R"(
+module top;
+    leaf l();
+    logic [p::W-1:0] y = top_missing;
+endmodule
+
+module other;
+    struct packed { logic a; } s;
+    int i = s.b;
+endmodule
+)");
+    auto newLeafTree = SyntaxTree::fromText(R"(
+module leaf;
+    logic x;
+    logic z = x + leaf_other;
+endmodule
+)");
+
+    auto compilation = std::make_unique<Compilation>();
+    compilation->addSyntaxTree(pkgTree);
+    compilation->addSyntaxTree(leafTree);
+    compilation->addSyntaxTree(topTree);
+    CHECK(compilation->getAllDiagnostics().size() == 3);
+
+    auto recompiled = compilation->recompile(*leafTree, newLeafTree);
+    compilation.reset();
+
+    Compilation fresh;
+    fresh.addSyntaxTree(pkgTree);
+    fresh.addSyntaxTree(newLeafTree);
+    fresh.addSyntaxTree(topTree);
+
+    auto& diags = recompiled->getAllDiagnostics();
+    CHECK(report(diags) == report(fresh.getAllDiagnostics()));
+
+    // Only the leaf and its parent were elaborated again; the diagnostic in
+    // the unrelated module was carried over from the original compilation.
+    REQUIRE(diags.size() == 3);
+    for (auto& diag : diags) {
+        if (diag.code == diag::UnknownMember)
+            CHECK(!diag.symbol);
+        else
+            CHECK(diag.symbol);
+    }
+}
+
+TEST_CASE("Recompiling with bind directives and defparams") {
+    auto helperTree = SyntaxTree::fromText(R"(
+module helper #(parameter int P = 1);
+    if (P == 1) begin
+        logic x = helper_missing;
+    end
+endmodule
+
+module other;
+endmodule
+
+module top;
+    other o();
+    helper h();
+endmodule
+)");
+    auto oldTree = SyntaxTree::fromText(R"(
+module extra;
+endmodule
+
+bind other helper bh();
+)");
+    auto newTree = SyntaxTree::fromText(R"(
+module extra;
+endmodule
+
+module setter;
+    defparam top.h.P = 2;
+endmodule
+)");
+
+    auto compilation = std::make_unique<Compilation>();
+    compilation->addSyntaxTree(helperTree);
+    compilation->addSyntaxTree(oldTree);
+    CHECK(compilation->getAllDiagnostics().size() == 1);
+
+    // The bind directive that's being removed and the new defparam both
+    // affect definitions declared outside of the tree being replaced.
+    auto recompiled = compilation->recompile(*oldTree, newTree);
+    compilation.reset();
+
+    Compilation fresh;
+    fresh.addSyntaxTree(helperTree);
+    fresh.addSyntaxTree(newTree);
+
+    auto& diags = recompiled->getAllDiagnostics();
+    CHECK(report(diags) == report(fresh.getAllDiagnostics()));
+    CHECK(diags.empty());
+}
+
+TEST_CASE("Package images keep directive state") {
+    auto tree = SyntaxTree::fromText(R"(
+`timescale 1ns/1ps
+`default_nettype none
+`unconnected_drive pull1
+package p;
+    localparam int W = 4;
+endpackage
+`nounconnected_drive
+`resetall
+)");
+
+    Bag options;
+    Compilation compilation(options);
+    compilation.addSyntaxTree(tree);
+    NO_COMPILATION_ERRORS;
+
+    auto image = PackageImage::save(compilation, *compilation.getPackage("p"), options);
+    REQUIRE(image);
+
+    auto result = PackageImage::load(*image, "p.img", SyntaxTree::getDefaultSourceManager(),
+                                     options);
+    REQUIRE(result.status == PackageImage::Status::Ok);
+
+    auto& meta = result.tree->getMetadata();
+    REQUIRE(meta.nodeMap.size() == 1);
+    CHECK(meta.nodeMap.begin()->second.unconnectedDrive == TokenKind::Pull1Keyword);
+
+    Compilation loaded(options);
+    loaded.addPrecompiledPackage(result.tree, result.diagnostics);
+
+    auto package = loaded.getPackage("p");
+    REQUIRE(package);
+    CHECK(package->timeScale == TimeScale::fromString("1ns/1ps"));
+    CHECK(package->defaultNetType.netKind == NetType::Unknown);
+    CHECK(loaded.getAllDiagnostics().empty());
+}
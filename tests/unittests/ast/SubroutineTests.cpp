@@ -7,9 +7,11 @@
 #include "slang/ast/symbols/CompilationUnitSymbols.h"
 #include "slang/ast/symbols/InstanceSymbols.h"
 #include "slang/ast/symbols/MemberSymbols.h"
+#include "slang/ast/symbols/ParameterSymbols.h"
 #include "slang/ast/symbols/SubroutineSymbols.h"
 #include "slang/ast/symbols/VariableSymbols.h"
 #include "slang/ast/types/Type.h"
+#include "slang/parsing/Parser.h"
 
 TEST_CASE("Functions -- mixed param types") {
     auto tree = SyntaxTree::fromText(R"(
@@ -670,3 +672,93 @@ endmodule
     CHECK(diags[0].code == diag::MultipleAlwaysAssigns);
     CHECK(diags[1].code == diag::MultipleAlwaysAssigns);
 }
+
+TEST_CASE("Deferred subroutine body parsing") {
+    auto& sm = SyntaxTree::getDefaultSourceManager();
+    ParserOptions parserOptions;
+    parserOptions.deferSubroutineBodies = true;
+    Bag options;
+    options.set(parserOptions);
+
+    auto tree = SyntaxTree::fromFileInMemory(R"(
+package pkg;
+    function automatic int g(int i);
+        return i * 2;
+    endfunction
+endpackage
+
+module m;
+    localparam int p = f(3);
+
+    function automatic int f(int i);
+        int j = i + 1;
+        if (i > 0) begin
+            case (i)
+                1: return j;
+                default:;
+            endcase
+        end
+        return pkg::g(j);
+    endfunction
+
+    task t;
+        input int a;
+    endtask
+
+    task t2();
+        fork
+            begin end
+        join_none
+        wait fork;
+    endtask
+
+    initial t2();
+endmodule
+)",
+                                             sm, "source", "", options);
+
+    auto& meta = tree->getMetadata();
+    CHECK(meta.deferredBodies.size() == 3);
+    CHECK(std::ranges::any_of(meta.classPackageNames, [](auto name) {
+        return name->identifier.valueText() == "pkg";
+    }));
+
+    // Bodies in library modules that never get used are never parsed.
+    auto libTree = SyntaxTree::fromFileInMemory(R"(
+module l;
+    function int unused(int i);
+        this is not valid syntax
+    endfunction
+endmodule
+)",
+                                                sm, "source", "", options);
+    libTree->isLibrary = true;
+    CHECK(libTree->diagnostics().empty());
+
+    Compilation compilation;
+    compilation.addSyntaxTree(tree);
+    compilation.addSyntaxTree(libTree);
+    NO_COMPILATION_ERRORS;
+
+    auto& p = compilation.getRoot().lookupName<ParameterSymbol>("m.p");
+    CHECK(p.getValue().integer() == 8);
+
+    // Errors in bodies that do get parsed are reported by the compilation.
+    auto tree2 = SyntaxTree::fromFileInMemory(R"(
+module n;
+    function int h();
+        return 1 +;
+    endfunction
+
+    initial $display(h());
+endmodule
+)",
+                                              sm, "source", "", options);
+
+    Compilation compilation2;
+    compilation2.addSyntaxTree(tree2);
+
+    auto& diags = compilation2.getAllDiagnostics();
+    REQUIRE(diags.size() == 1);
+    CHECK(diags[0].code == diag::ExpectedExpression);
+}
@@ -0,0 +1,21 @@
+package p;
+    localparam int P = p_missing;
+endpackage
+
+module leaf;
+    logic l = leaf_missing;
+endmodule
+
+module a;
+    leaf l();
+    logic x = a_missing;
+endmodule
+
+module b;
+    leaf l();
+    logic y = b_missing;
+endmodule
+
+module c;
+    logic z = c_missing;
+endmodule
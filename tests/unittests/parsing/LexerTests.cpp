@@ -466,6 +466,41 @@ TEST_CASE("String literal (UTF8 escape)") {
     CHECK(diagnostics.back().code == diag::UnknownEscapeCode);
 }
 
+TEST_CASE("Long identifiers and trivia") {
+    // Long enough to exercise the vectorized scanning paths.
+    std::string ident = "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ$0123456789";
+    for (char term : "@[`{/:^ \x80"sv) {
+        auto str = ident + ident + term;
+        Token token = lexToken(str);
+        CHECK(token.kind == TokenKind::Identifier);
+        CHECK(token.valueText() == ident + ident);
+    }
+
+    std::string spaces(70, ' ');
+    std::string text = spaces + "\t\v\f" + spaces + "// " + std::string(50, '=') +
+                       " 的氣墊船 \xff " + std::string(50, '-') + "\n" + spaces + "/* " +
+                       std::string(40, '*') + " / " + std::string(40, '-') + " \u00F7 */" +
+                       spaces + "\"" + std::string(40, 'a') + "\\t" + std::string(40, 'b') +
+                       " 的 \"";
+
+    Token token = lexToken(text);
+    CHECK(token.kind == TokenKind::StringLiteral);
+    CHECK(token.valueText() == std::string(40, 'a') + "\t" + std::string(40, 'b') + " 的 ");
+    CHECK(token.toString() == text);
+
+    auto trivia = token.trivia();
+    REQUIRE(trivia.size() == 6);
+    CHECK(trivia[0].kind == TriviaKind::Whitespace);
+    CHECK(trivia[0].getRawText().size() == 143);
+    CHECK(trivia[1].kind == TriviaKind::LineComment);
+    CHECK(trivia[3].kind == TriviaKind::Whitespace);
+    CHECK(trivia[4].kind == TriviaKind::BlockComment);
+    CHECK(trivia[5].kind == TriviaKind::Whitespace);
+
+    REQUIRE(diagnostics.size() == 1);
+    CHECK(diagnostics[0].code == diag::InvalidUTF8Seq);
+}
+
 TEST_CASE("Integer literal") {
     auto& text = "19248";
     Token token = lexToken(text);
@@ -1015,6 +1050,26 @@ TEST_CASE("All Keywords") {
     testKeyword(TokenKind::XorKeyword);
 }
 
+TEST_CASE("Keyword lookup by version") {
+    using KV = KeywordVersion;
+    CHECK(LF::getKeywordKind("module", KV::v1364_1995) == TokenKind::ModuleKeyword);
+    CHECK(LF::getKeywordKind("ifnone", KV::v1364_1995) == TokenKind::IfNoneKeyword);
+    CHECK(LF::getKeywordKind("generate", KV::v1364_1995) == TokenKind::Unknown);
+    CHECK(LF::getKeywordKind("generate", KV::v1364_2001_noconfig) == TokenKind::GenerateKeyword);
+    CHECK(LF::getKeywordKind("config", KV::v1364_2001_noconfig) == TokenKind::Unknown);
+    CHECK(LF::getKeywordKind("config", KV::v1364_2001) == TokenKind::ConfigKeyword);
+    CHECK(LF::getKeywordKind("logic", KV::v1364_2005) == TokenKind::Unknown);
+    CHECK(LF::getKeywordKind("logic", KV::v1800_2005) == TokenKind::LogicKeyword);
+    CHECK(LF::getKeywordKind("soft", KV::v1800_2009) == TokenKind::Unknown);
+    CHECK(LF::getKeywordKind("soft", KV::v1800_2017) == TokenKind::SoftKeyword);
+
+    // Identifiers that share a length and most characters with keywords.
+    for (auto text : {"", "m", "modulx", "nodule", "moddle", "rxmos", "sync_reject_of",
+                      "pulsestyle_ondetect_", "endmodulex", "inptt"}) {
+        CHECK(LF::getKeywordKind(text, KV::v1800_2017) == TokenKind::Unknown);
+    }
+}
+
 void testPunctuation(TokenKind kind) {
     std::string_view text = LF::getTokenKindText(kind);
     Token token = lexToken(text);
@@ -1181,6 +1236,56 @@ TEST_CASE("Token with lots of trivia") {
     CHECK(trivia.getExplicitLocation()->offset() == 5);
 }
 
+TEST_CASE("Token trivia storage") {
+    auto loc = SourceLocation(BufferID(1, "asdf"), 5);
+    auto check = [&](std::span<Trivia const> trivia, std::string_view expected) {
+        // Trivia gets copied into the token, so temporary storage is fine.
+        SmallVector<Trivia> buffer;
+        buffer.append_range(trivia);
+
+        Token token(alloc, TokenKind::IntegerLiteral, buffer, "12", loc, SVInt(32, 12, true));
+        buffer.clear();
+        buffer.push_back(Trivia(TriviaKind::BlockComment, "/* clobbered */"sv));
+
+        CHECK(token.toString() == expected);
+        CHECK(token.intValue() == 12);
+        CHECK(token.location() == loc);
+
+        Token clone = token.withRawText(alloc, "13");
+        CHECK(clone.toString() == std::string(expected.substr(0, expected.size() - 2)) + "13");
+        CHECK(clone.trivia().size() == token.trivia().size());
+    };
+
+    Trivia space(TriviaKind::Whitespace, " "sv);
+    Trivia tabs(TriviaKind::Whitespace, "\t\t"sv);
+    Trivia newline(TriviaKind::EndOfLine, "\n"sv);
+    Trivia crlf(TriviaKind::EndOfLine, "\r\n"sv);
+    Trivia comment(TriviaKind::LineComment, "// hello"sv);
+
+    check({}, "12");
+    check({&space, 1}, " 12");
+    check({&newline, 1}, "\n12");
+    check({&crlf, 1}, "\r\n12");
+    check({&tabs, 1}, "\t\t12");
+
+    std::vector<Trivia> many = {comment, newline, tabs, space};
+    check(many, "// hello\n\t\t 12");
+
+    std::string expected;
+    many.clear();
+    for (int i = 0; i < 20; i++) {
+        many.push_back(i % 2 ? newline : comment);
+        expected += i % 2 ? "\n" : "// hello";
+    }
+    check(many, expected + "12");
+
+    // A single space or newline with an explicit location is stored as usual.
+    Trivia located = space.withLocation(alloc, loc);
+    Token token(alloc, TokenKind::Identifier, {&located, 1}, "foo", loc + 1);
+    REQUIRE(token.trivia().size() == 1);
+    CHECK(token.trivia()[0].getExplicitLocation() == loc);
+}
+
 void testExpect(TokenKind kind) {
     diagnostics.clear();
     Token actual(alloc, TokenKind::Identifier, {}, "SDF", SourceLocation(BufferID(1, "asdf"), 5));
@@ -1204,3 +1309,124 @@ TEST_CASE("Missing / expected tokens") {
     testExpect(TokenKind::TimeLiteral);
     testExpect(TokenKind::WithKeyword);
 }
+
+TEST_CASE("Replaying cached tokens") {
+    auto& text = R"(module m; /* multi
+line */ logic [3:0] a = 4'b10x1;
+// comment
+    string s = "hi\n"; `define FOO 1
+endmodule
+)";
+
+    diagnostics.clear();
+    auto buffer = getSourceManager().assignText(text);
+    Lexer lexer(buffer, alloc, diagnostics);
+
+    SmallVector<Token> tokens;
+    SmallVector<bool> sameLine;
+    while (true) {
+        sameLine.push_back(lexer.isNextTokenOnSameLine());
+        tokens.push_back(lexer.lex());
+        if (tokens.back().kind == TokenKind::EndOfFile)
+            break;
+    }
+    CHECK_DIAGNOSTICS_EMPTY;
+
+    // Replaying into a different buffer with the same text should produce
+    // identical tokens, relocated to the new buffer.
+    auto buffer2 = getSourceManager().assignText(text);
+    Lexer replay(buffer2, tokens, LF::getDefaultKeywordVersion(), alloc, diagnostics);
+    for (size_t i = 0; i < tokens.size(); i++) {
+        CHECK(replay.isNextTokenOnSameLine() == sameLine[i]);
+        Token token = replay.lex();
+        CHECK(token.kind == tokens[i].kind);
+        CHECK(token.toString() == tokens[i].toString());
+        CHECK(token.valueText() == tokens[i].valueText());
+        CHECK(token.location() == SourceLocation(buffer2.id, tokens[i].location().offset()));
+    }
+    CHECK(replay.lex().kind == TokenKind::EndOfFile);
+
+    // Asking for a different keyword version partway through falls back to lexing.
+    Lexer replay2(buffer2, tokens, LF::getDefaultKeywordVersion(), alloc, diagnostics);
+    CHECK(replay2.lex().kind == TokenKind::ModuleKeyword);
+    CHECK(replay2.lex().kind == TokenKind::Identifier);
+    CHECK(replay2.lex().kind == TokenKind::Semicolon);
+
+    Token logic = replay2.lex(KeywordVersion::v1364_1995);
+    CHECK(logic.kind == TokenKind::Identifier);
+    CHECK(logic.valueText() == "logic");
+    CHECK(logic.trivia().size() == 3);
+    CHECK(logic.location() == SourceLocation(buffer2.id, tokens[3].location().offset()));
+    CHECK(replay2.lex().kind == TokenKind::OpenBracket);
+    CHECK_DIAGNOSTICS_EMPTY;
+}
+
+TEST_CASE("Lean trivia") {
+    auto& text = R"(module m; /* multi
+line */ logic [3:0]   a; // comment
+`define STR(x) `"x`" // trailing
+    string s = `STR(a   b);
+    int i /* c */ = 1;
+endmodule
+)";
+
+    diagnostics.clear();
+    auto buffer = getSourceManager().assignText(text);
+
+    LexerOptions options;
+    options.leanTrivia = true;
+    Lexer lexer(buffer, alloc, diagnostics, options);
+
+    SmallVector<Token> tokens;
+    while (true) {
+        tokens.push_back(lexer.lex());
+        if (tokens.back().kind == TokenKind::EndOfFile)
+            break;
+    }
+    CHECK_DIAGNOSTICS_EMPTY;
+    CHECK(lexer.getTriviaBytesSaved() > 0);
+
+    // Runs of whitespace and comments collapse down to a single element.
+    REQUIRE(tokens[3].kind == TokenKind::LogicKeyword);
+    REQUIRE(tokens[3].trivia().size() == 1);
+    CHECK(tokens[3].trivia()[0].kind == TriviaKind::EndOfLine);
+    CHECK(!tokens[3].isOnSameLine());
+    CHECK(tokens[4].trivia()[0].getRawText() == " ");
+    CHECK(tokens[4].isOnSameLine());
+
+    // Other whitespace keeps its original text.
+    REQUIRE(tokens[9].kind == TokenKind::Identifier);
+    CHECK(tokens[9].trivia()[0].getRawText() == "   ");
+
+    // Macros still end at the end of their line and stringify with the right spacing.
+    Bag bag;
+    bag.set(options);
+
+    Preprocessor preprocessor(getSourceManager(), alloc, diagnostics, bag);
+    preprocessor.pushSource(text);
+
+    Token stringLit;
+    Token intKeyword;
+    while (true) {
+        Token token = preprocessor.next();
+        if (token.kind == TokenKind::StringLiteral)
+            stringLit = token;
+        else if (token.kind == TokenKind::IntKeyword)
+            intKeyword = token;
+        else if (token.kind == TokenKind::EndOfFile)
+            break;
+    }
+    CHECK_DIAGNOSTICS_EMPTY;
+    REQUIRE(stringLit);
+    CHECK(stringLit.valueText() == "a   b");
+    REQUIRE(intKeyword);
+    CHECK(!intKeyword.isOnSameLine());
+    CHECK(preprocessor.getTriviaBytesSaved() > 0);
+
+    auto tree = SyntaxTree::fromText(text, getSourceManager(), "source"sv, "", bag);
+    CHECK(tree->diagnostics().empty());
+    CHECK(tree->getMetadata().triviaBytesSaved > 0);
+
+    auto fullTree = SyntaxTree::fromText(text);
+    CHECK(fullTree->getMetadata().triviaBytesSaved == 0);
+}
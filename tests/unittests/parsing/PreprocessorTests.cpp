@@ -4,6 +4,7 @@
 #include "Test.h"
 
 #include "slang/parsing/Preprocessor.h"
+#include "slang/parsing/TokenCache.h"
 #include "slang/syntax/AllSyntax.h"
 #include "slang/syntax/SyntaxPrinter.h"
 #include "slang/text/SourceManager.h"
@@ -97,6 +98,229 @@ TEST_CASE("Double include, with pragma once") {
     CHECK_DIAGNOSTICS_EMPTY;
 }
 
+TEST_CASE("Multiple include optimization for include guards") {
+    auto& text = R"(
+`include "include_guard.svh"
+`include "include_guard.svh"
+`include "include_guard_trailing.svh"
+`include "include_guard_trailing.svh"
+`undef INCLUDE_GUARD_SVH
+`include "include_guard.svh"
+`include "include_once.svh"
+`include "include_once.svh"
+)";
+
+    diagnostics.clear();
+    Preprocessor preprocessor(getSourceManager(), alloc, diagnostics);
+    preprocessor.pushSource(text);
+
+    std::string result;
+    while (true) {
+        Token token = preprocessor.next();
+        if (token.kind == TokenKind::EndOfFile)
+            break;
+        result += token.valueText();
+        result += ' ';
+    }
+
+    CHECK(result == "guarded trailing trailing guarded test string ");
+    CHECK_DIAGNOSTICS_EMPTY;
+
+    auto& stats = preprocessor.getIncludeStats();
+    CHECK(stats.numIncludes == 8);
+    CHECK(stats.numEntered == 6);
+    CHECK(stats.numSkippedGuard == 1);
+    CHECK(stats.numSkippedPragmaOnce == 1);
+    CHECK(stats.numGuardsDetected == 1);
+}
+
+TEST_CASE("Include guard detection requires the whole file be guarded") {
+    auto& text = R"(
+`define FOO
+`ifdef FOO
+`include "include_guard.svh"
+`endif
+`include "include_guard.svh"
+)";
+
+    diagnostics.clear();
+    Preprocessor preprocessor(getSourceManager(), alloc, diagnostics);
+    preprocessor.pushSource(text);
+    while (preprocessor.next().kind != TokenKind::EndOfFile) {
+    }
+
+    CHECK_DIAGNOSTICS_EMPTY;
+    CHECK(preprocessor.getIncludeStats().numSkippedGuard == 1);
+
+    // Tokens after the `endif mean the file isn't guarded.
+    auto& text2 = R"(
+`include "include_guard_trailing.svh"
+`include "include_guard_trailing.svh"
+)";
+
+    Preprocessor pp2(getSourceManager(), alloc, diagnostics);
+    pp2.pushSource(text2);
+    while (pp2.next().kind != TokenKind::EndOfFile) {
+    }
+    CHECK(pp2.getIncludeStats().numGuardsDetected == 0);
+    CHECK(pp2.getIncludeStats().numEntered == 2);
+}
+
+TEST_CASE("Object-like macro expansion cache") {
+    auto& text = R"(
+`define WIDTH 8
+`define EXPR (`WIDTH + 1)
+`define PASTE a``b
+a `WIDTH `WIDTH `EXPR `EXPR `PASTE `PASTE
+`define WIDTH 16
+`WIDTH
+`undef WIDTH
+`define WIDTH 32
+`WIDTH `WIDTH
+)";
+
+    diagnostics.clear();
+    Preprocessor preprocessor(getSourceManager(), alloc, diagnostics);
+    preprocessor.pushSource(text);
+
+    std::string result;
+    SmallVector<Token> eights;
+    while (true) {
+        Token token = preprocessor.next();
+        if (token.kind == TokenKind::EndOfFile)
+            break;
+        result += token.valueText();
+        result += ' ';
+        if (token.valueText() == "8")
+            eights.push_back(token);
+    }
+
+    CHECK(result == "a 8 8 ( 8 + 1 ) ( 8 + 1 ) ab ab 16 32 32 ");
+    REQUIRE(diagnostics.size() == 1);
+    CHECK(diagnostics[0].code == diag::RedefiningMacro);
+
+    // The cached expansion still gets its own expansion location per usage,
+    // and maps back to the original macro body.
+    auto& sm = getSourceManager();
+    REQUIRE(eights.size() == 4);
+    CHECK(sm.isMacroLoc(eights[1].location()));
+    CHECK(sm.getOriginalLoc(eights[0].location()) == sm.getOriginalLoc(eights[1].location()));
+    CHECK(sm.getExpansionRange(eights[0].location()) !=
+          sm.getExpansionRange(eights[1].location()));
+    CHECK(sm.getExpansionRange(eights[1].location()).start().offset() ==
+          std::string_view(text).find("`WIDTH `EXPR"));
+
+    auto& stats = preprocessor.getMacroStats();
+    CHECK(stats.numExpansions == 9);
+    CHECK(stats.numCacheHits == 2);
+    CHECK(stats.numCacheInvalidations == 2);
+}
+
+TEST_CASE("Shared token cache for included files") {
+    auto& text = R"(
+`include "local.svh"
+`include "local.svh"
+`include "local.svh"
+)";
+
+    auto cache = std::make_shared<TokenCache>(getSourceManager());
+    PreprocessorOptions ppOptions;
+    ppOptions.tokenCache = cache;
+    Bag options;
+    options.set(ppOptions);
+
+    auto expected = preprocess(text);
+    CHECK_DIAGNOSTICS_EMPTY;
+
+    // The first time the file is seen it's lexed normally, and the second time
+    // its tokens are cached. Later preprocessors then replay those tokens.
+    for (int i = 0; i < 3; i++) {
+        CHECK(preprocess(text, options) == expected);
+        CHECK_DIAGNOSTICS_EMPTY;
+    }
+
+    auto buffer = getSourceManager().readHeader("local.svh", SourceLocation::NoLocation,
+                                                nullptr, false);
+    REQUIRE(buffer);
+    auto tokens = cache->get(buffer, LexerFacts::getDefaultKeywordVersion(), LexerOptions{});
+    REQUIRE(tokens.size() == 2);
+    CHECK(tokens[0].kind == TokenKind::StringLiteral);
+
+    // Replayed tokens are relocated into the buffer for each include.
+    diagnostics.clear();
+    Preprocessor preprocessor(getSourceManager(), alloc, diagnostics, options);
+    preprocessor.pushSource(text);
+
+    auto first = preprocessor.next();
+    auto second = preprocessor.next();
+    auto& sm = getSourceManager();
+    CHECK(first.location().buffer() != second.location().buffer());
+    CHECK(sm.getLineNumber(first.location()) == 2);
+    CHECK(sm.getLineNumber(sm.getIncludedFrom(second.location().buffer())) == 3);
+
+    // A cache created for some other source manager is ignored.
+    SourceManager otherSm;
+    PreprocessorOptions otherOptions;
+    otherOptions.tokenCache = std::make_shared<TokenCache>(otherSm);
+    Bag options2;
+    options2.set(otherOptions);
+    CHECK(preprocess(text, options2) == expected);
+}
+
+TEST_CASE("Shared token cache with lean trivia") {
+    auto& text = R"(
+`include "local.svh"
+`include "local.svh"
+`include "local.svh"
+)";
+
+    auto cache = std::make_shared<TokenCache>(getSourceManager());
+    PreprocessorOptions ppOptions;
+    ppOptions.tokenCache = cache;
+    LexerOptions lexerOptions;
+    lexerOptions.leanTrivia = true;
+    Bag options;
+    options.set(ppOptions);
+    options.set(lexerOptions);
+
+    // Every include, whether it was lexed or replayed from the cache,
+    // should get lean trivia.
+    for (int i = 0; i < 2; i++) {
+        diagnostics.clear();
+        Preprocessor preprocessor(getSourceManager(), alloc, diagnostics, options);
+        preprocessor.pushSource(text);
+
+        int count = 0;
+        while (true) {
+            auto token = preprocessor.next();
+            if (token.kind == TokenKind::EndOfFile)
+                break;
+
+            REQUIRE(token.kind == TokenKind::StringLiteral);
+            for (auto& trivia : token.trivia())
+                CHECK(trivia.kind != TriviaKind::LineComment);
+            count++;
+        }
+        CHECK(count == 3);
+        CHECK_DIAGNOSTICS_EMPTY;
+    }
+
+    // Tokens lexed with different options are cached separately.
+    auto buffer = getSourceManager().readHeader("local.svh", SourceLocation::NoLocation,
+                                                nullptr, false);
+    REQUIRE(buffer);
+    auto keywordVersion = LexerFacts::getDefaultKeywordVersion();
+    auto leanTokens = cache->get(buffer, keywordVersion, lexerOptions);
+    REQUIRE(leanTokens.size() == 2);
+    CHECK(leanTokens[0].trivia().size() <= 1);
+
+    CHECK(cache->get(buffer, keywordVersion, LexerOptions{}).empty());
+    auto fullTokens = cache->get(buffer, keywordVersion, LexerOptions{});
+    REQUIRE(fullTokens.size() == 2);
+    REQUIRE(!fullTokens[0].trivia().empty());
+    CHECK(fullTokens[0].trivia()[0].kind == TriviaKind::LineComment);
+}
+
 TEST_CASE("Include directive errors") {
     auto& text = R"(
 `include
@@ -953,6 +1177,126 @@ TEST_CASE("Nested branches") {
     CHECK_DIAGNOSTICS_EMPTY;
 }
 
+TEST_CASE("Disabled region skipping") {
+    auto& text = "`ifdef FOO\n"
+                 "  // `endif in a comment\n"
+                 "  /* `else in a\n"
+                 "     block comment */ wire [31:0] a = 32'hdead_beef;\n"
+                 "  initial $display(\"`endif \\\" %d\", 1.5e3);\n"
+                 "  `define X(a) a``_q `\"a`\"\n"
+                 "  \\escaped`endif id;\n"
+                 "  4'sd3 'x '1 1step\n"
+                 "  // trailing comment\n"
+                 "`elsif BAR\n"
+                 "`endif\n"
+                 "42";
+    Token token = lexToken(text);
+
+    REQUIRE(token.kind == TokenKind::IntegerLiteral);
+    CHECK(token.intValue() == 42);
+    CHECK(SyntaxPrinter().setIncludeDirectives(true).print(token).str() == text);
+    CHECK_DIAGNOSTICS_EMPTY;
+
+    // The region's text should be kept as a single trivia on the directive that
+    // ends it, followed by the trailing comment that the directive always had.
+    REQUIRE(token.trivia().size() == 4);
+    auto& ifdef = token.trivia()[0].syntax()->as<ConditionalBranchDirectiveSyntax>();
+    CHECK(ifdef.disabledTokens.empty());
+
+    auto elsif = token.trivia()[1].syntax()->getFirstToken();
+    REQUIRE(elsif.trivia().size() == 5);
+    CHECK(elsif.trivia()[0].kind == TriviaKind::DisabledText);
+    CHECK(elsif.trivia()[0].getRawText() == std::string_view(text).substr(10, 205));
+    CHECK(elsif.trivia()[3].kind == TriviaKind::LineComment);
+
+    // An empty region doesn't leave anything behind.
+    auto endif = token.trivia()[2].syntax()->getFirstToken();
+    REQUIRE(endif.trivia().size() == 1);
+    CHECK(endif.trivia()[0].kind == TriviaKind::EndOfLine);
+}
+
+TEST_CASE("Disabled region skipping diagnostics") {
+    auto& text = "`ifdef FOO\n"
+                 "  \"unterminated\n"
+                 "  \x01 // \xff\n"
+                 "  /* \xfe */\n"
+                 "`endif\n"
+                 "`ifdef BAR\n"
+                 "  a b";
+    Token token = lexToken(text);
+
+    CHECK(token.kind == TokenKind::EndOfFile);
+    CHECK(SyntaxPrinter().setIncludeDirectives(true).print(token).str() == text);
+
+    // The second region runs off the end of the buffer, so it
+    // gets handled token by token instead of being skipped.
+    REQUIRE(token.trivia().size() == 3);
+    auto endif = token.trivia()[1].syntax()->getFirstToken();
+    CHECK(endif.trivia()[0].kind == TriviaKind::DisabledText);
+    auto& ifdefBar = token.trivia()[2].syntax()->as<ConditionalBranchDirectiveSyntax>();
+    CHECK(ifdefBar.disabledTokens.size() == 2);
+
+    REQUIRE(diagnostics.size() == 5);
+    CHECK(diagnostics[0].code == diag::ExpectedClosingQuote);
+    CHECK(diagnostics[1].code == diag::NonPrintableChar);
+    CHECK(diagnostics[2].code == diag::InvalidUTF8Seq);
+    CHECK(diagnostics[3].code == diag::InvalidUTF8Seq);
+    CHECK(diagnostics[4].code == diag::MissingEndIfDirective);
+}
+
+TEST_CASE("Disabled region printing") {
+    auto& text = "`ifdef FOO\n"
+                 "  s = \"/*\\\n"
+                 "\";\n"
+                 "\n"
+                 "\n"
+                 "  /* block\n"
+                 "\n"
+                 "  comment */ b;\n"
+                 "  // line\n"
+                 "\n"
+                 "  \\esc/*aped c;\n"
+                 "`endif\n"
+                 "42";
+    Token token = lexToken(text);
+    REQUIRE(token.kind == TokenKind::IntegerLiteral);
+    CHECK_DIAGNOSTICS_EMPTY;
+
+    // Newlines and comments in the skipped text are squashed and excluded
+    // just as they would be if they were trivia of the region's tokens.
+    CHECK(SyntaxPrinter().setIncludeDirectives(true).print(token).str() ==
+          "`ifdef FOO\n"
+          "  s = \"/*\\\n"
+          "\";\n"
+          "  /* block\n"
+          "\n"
+          "  comment */ b;\n"
+          "  // line\n"
+          "  \\esc/*aped c;\n"
+          "`endif\n"
+          "42");
+
+    CHECK(SyntaxPrinter()
+              .setIncludeDirectives(true)
+              .setIncludeComments(false)
+              .setSquashNewlines(false)
+              .print(token)
+              .str() == "`ifdef FOO\n"
+                        "  s = \"/*\\\n"
+                        "\";\n"
+                        "\n"
+                        "\n"
+                        "   b;\n"
+                        "  \n"
+                        "\n"
+                        "  \\esc/*aped c;\n"
+                        "`endif\n"
+                        "42");
+
+    // Without directives none of the region is printed at all.
+    CHECK(SyntaxPrinter().print(token).str() == "\n42");
+}
+
 TEST_CASE("IfDef inside macro") {
     auto& text = "`define FOO \\\n"
                  "  `ifdef BAR \\\n"
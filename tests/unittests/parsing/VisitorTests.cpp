@@ -119,6 +119,146 @@ endmodule
 )");
 }
 
+TEST_CASE("Squashing newlines keeps text after them") {
+    // Only the run of newlines at the start of each chunk gets squashed,
+    // not whatever follows it in the same chunk.
+    CHECK(SyntaxPrinter().append("a\n").append("\n\n  b\n").str() == "a\n  b\n");
+    CHECK(SyntaxPrinter().append("a").append("\r\n\r\n b").str() == "a\r\n b");
+    CHECK(SyntaxPrinter().setSquashNewlines(false).append("a\n").append("\n b").str() ==
+          "a\n\n b");
+}
+
+TEST_CASE("Structurally shared rewriting") {
+    auto tree = SyntaxTree::fromText(R"(
+`define ENUM_MACRO(asdf) \
+    typedef enum int {\
+        FOO = 1,\
+        BAR = 2\
+    } asdf;
+
+module M;
+    `ENUM_MACRO(test_t)
+    typedef enum int { A, B, C } other_t;
+endmodule
+
+// Untouched
+module N  ;   wire   w ; endmodule
+)");
+
+    auto& origRoot = tree->root().as<CompilationUnitSyntax>();
+    auto origN = origRoot.members[1];
+
+    auto newTree = TestRewriter(tree).transformShared(tree);
+    CHECK(SyntaxPrinter::printFile(*newTree) == R"(
+`define ENUM_MACRO(asdf) \
+    typedef enum int {\
+        FOO = 1,\
+        BAR = 2\
+    } asdf;
+
+module M;
+    `ENUM_MACRO(test_t)
+    localparam int test_t__count = 2;
+    typedef enum int { A, B, C } other_t;
+    localparam int other_t__count = 3;
+endmodule
+
+// Untouched
+module N  ;   wire   w ; endmodule
+)");
+
+    auto& newRoot = newTree->root().as<CompilationUnitSyntax>();
+    REQUIRE(newRoot.members.size() == 2);
+    CHECK(newRoot.members[1] == origN);
+    CHECK(newTree->getParent(*origN) == &newRoot);
+    CHECK(origN->parent == &origRoot);
+    CHECK(newTree->getEditKind(newRoot) == SyntaxEditKind::Rebuilt);
+    CHECK(newTree->getEditKind(*origN) == SyntaxEditKind::Unchanged);
+
+    auto& newM = newRoot.members[0]->as<ModuleDeclarationSyntax>();
+    REQUIRE(newM.members.size() == 4);
+    CHECK(newTree->getEditKind(newM) == SyntaxEditKind::Rebuilt);
+    CHECK(newTree->getEditKind(*newM.members[1]) == SyntaxEditKind::Inserted);
+    CHECK(newTree->getEditKind(*newM.members[2]) == SyntaxEditKind::Unchanged);
+
+    // Edits on top of an already edited tree keep sharing nodes with the chain.
+    struct RemoveWriter : public SyntaxRewriter<RemoveWriter> {
+        void handle(const NetDeclarationSyntax& decl) { remove(decl); }
+    };
+    auto thirdTree = RemoveWriter().transformShared(newTree);
+    auto& thirdRoot = thirdTree->root().as<CompilationUnitSyntax>();
+    CHECK(thirdRoot.members[0] == newRoot.members[0]);
+    CHECK(thirdTree->getParent(*thirdRoot.members[0]) == &thirdRoot);
+    CHECK(thirdTree->getParent(*newM.members[1]) == &newM);
+    CHECK(thirdTree->getEditKind(*newM.members[1]) == SyntaxEditKind::Inserted);
+    CHECK(SyntaxPrinter::printFile(*thirdTree).ends_with(R"(
+// Untouched
+module N  ; endmodule
+)"));
+
+    // None of the edits touched the original tree, which
+    // stays intact once the edited trees are gone.
+    auto& origNDecl = origN->as<ModuleDeclarationSyntax>();
+    thirdTree.reset();
+    newTree.reset();
+    CHECK(origN->parent == &origRoot);
+    CHECK(origNDecl.members[0]->parent == origN);
+    CHECK(origRoot.members[0]->as<ModuleDeclarationSyntax>().members[0]->parent ==
+          origRoot.members[0]);
+    CHECK(SyntaxPrinter::printFile(*tree).ends_with(R"(
+// Untouched
+module N  ;   wire   w ; endmodule
+)"));
+}
+
+TEST_CASE("Structurally shared rewriting metadata") {
+    auto tree = SyntaxTree::fromText(R"(
+`timescale 1ns/1ps
+module A; endmodule
+module B; A a1(); endmodule
+module C; A a2(); endmodule
+)");
+
+    struct Rewriter : public SyntaxRewriter<Rewriter> {
+        std::string_view removeFrom;
+
+        void handle(const ModuleDeclarationSyntax& decl) {
+            if (decl.header->name.valueText() == "C" && removeFrom == "B")
+                insertAfter(decl, parse("\nmodule D; C c(); endmodule"));
+            visitDefault(decl);
+        }
+
+        void handle(const HierarchyInstantiationSyntax& inst) {
+            if (inst.parent->as<ModuleDeclarationSyntax>().header->name.valueText() == removeFrom)
+                remove(inst);
+        }
+    };
+
+    Rewriter rewriter;
+    rewriter.removeFrom = "B";
+    auto newTree = rewriter.transformShared(tree);
+    auto& newRoot = newTree->root().as<CompilationUnitSyntax>();
+    REQUIRE(newRoot.members.size() == 4);
+
+    auto& meta = newTree->getMetadata();
+    CHECK(meta.nodeMap.size() == 4);
+    CHECK(meta.nodeMap.contains(newRoot.members[1]));
+    CHECK(meta.nodeMap.at(newRoot.members[3]).timeScale.has_value());
+    CHECK(meta.globalInstances == flat_hash_set<std::string_view>{"A", "C"});
+    CHECK(meta.eofToken == newRoot.endOfFile);
+
+    // Each rewriter hands its allocator over to the tree it produces,
+    // so the next transform needs a new one.
+    Rewriter nextRewriter;
+    nextRewriter.removeFrom = "C";
+    auto thirdTree = nextRewriter.transformShared(newTree);
+    auto& thirdRoot = thirdTree->root().as<CompilationUnitSyntax>();
+    REQUIRE(thirdRoot.members.size() == 4);
+    CHECK(thirdRoot.members[3] == newRoot.members[3]);
+    CHECK(thirdTree->getMetadata().nodeMap.size() == 4);
+    CHECK(thirdTree->getMetadata().globalInstances == flat_hash_set<std::string_view>{"C"});
+}
+
 TEST_CASE("Advanced rewriting") {
     SECTION("Insert multiple newNodes surrounding oldNodes") {
         class MultipleRewriter : public SyntaxRewriter<MultipleRewriter> {
@@ -556,6 +696,78 @@ class C; endclass
     }
 }
 
+TEST_CASE("Syntax visiting pruned by handled kinds") {
+    CHECK(canContainKind(SyntaxKind::CompilationUnit, SyntaxKind::HierarchyInstantiation));
+    CHECK(canContainKind(SyntaxKind::GenerateBlock, SyntaxKind::HierarchyInstantiation));
+    CHECK(canContainKind(SyntaxKind::DataDeclaration, SyntaxKind::IdentifierName));
+    CHECK(canContainKind(SyntaxKind::SyntaxList, SyntaxKind::IdentifierName));
+    CHECK_FALSE(canContainKind(SyntaxKind::DataDeclaration, SyntaxKind::HierarchyInstantiation));
+    CHECK_FALSE(canContainKind(SyntaxKind::IdentifierName, SyntaxKind::IdentifierName));
+    CHECK_FALSE(canContainKind(SyntaxKind::TokenList, SyntaxKind::IdentifierName));
+
+    struct InstanceCounter : public SyntaxVisitor<InstanceCounter> {
+        size_t instances = 0;
+        size_t tokens = 0;
+
+        void handle(const HierarchyInstantiationSyntax& syntax) {
+            instances += syntax.instances.size();
+            visitDefault(syntax);
+        }
+
+        void visitToken(Token) { tokens++; }
+    };
+
+    struct PrunedInstanceCounter : public SyntaxVisitor<PrunedInstanceCounter> {
+        size_t instances = 0;
+        size_t tokens = 0;
+
+        static bool isHandledKind(SyntaxKind kind) {
+            return kind == SyntaxKind::HierarchyInstantiation;
+        }
+
+        void handle(const HierarchyInstantiationSyntax& syntax) {
+            instances += syntax.instances.size();
+            visitDefault(syntax);
+        }
+
+        void visitToken(Token) { tokens++; }
+    };
+
+    auto tree = SyntaxTree::fromText(R"(
+module m;
+    int i = 1 + 2;
+    n n1(.a(i)), n2();
+    if (1) begin : g
+        n n3();
+    end
+    initial $display("hello");
+endmodule
+)");
+
+    InstanceCounter full;
+    tree->root().visit(full);
+    CHECK(full.instances == 3);
+
+    PrunedInstanceCounter pruned;
+    tree->root().visit(pruned);
+    CHECK(pruned.instances == 3);
+    CHECK(pruned.tokens < full.tokens);
+
+    // The pruned visitor should find the same things in a file with every construct.
+    fs::path path = findTestDir();
+    path /= "../../regression/all.sv";
+    tree = SyntaxTree::fromFile(path.string());
+    REQUIRE(tree);
+
+    InstanceCounter fullAll;
+    tree->root().visit(fullAll);
+
+    PrunedInstanceCounter prunedAll;
+    tree->root().visit(prunedAll);
+    CHECK(prunedAll.instances == fullAll.instances);
+    CHECK(prunedAll.instances > 0);
+}
+
 TEST_CASE("Visit all file") {
     // Load a file containing all the SystemVerilog constructs and visit them
     // just to get coverage of all the visitor methods.
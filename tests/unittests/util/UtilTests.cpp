@@ -5,6 +5,7 @@
 #include <catch2/matchers/catch_matchers_string.hpp>
 #include <sstream>
 
+#include "slang/util/Hash.h"
 #include "slang/util/Random.h"
 #include "slang/util/ThreadPool.h"
 #include "slang/util/TimeTrace.h"
@@ -64,3 +65,23 @@ TEST_CASE("TimeTrace tests") {
     std::ostringstream sstr;
     TimeTrace::write(sstr);
 }
+
+TEST_CASE("Hash map copy assigned from empty map") {
+    flat_hash_map<int, int> map, empty;
+    map[1] = 1;
+    map[2] = 2;
+
+    map = empty;
+    CHECK(map.empty());
+
+    map[3] = 3;
+    map[4] = 4;
+    map[5] = 5;
+
+    size_t count = 0;
+    for (auto& [key, value] : map) {
+        CHECK(key == value);
+        count++;
+    }
+    CHECK(count == 3);
+}
@@ -81,6 +81,18 @@ int driverMain(int argc, TArgs argv) {
         driver.cmdLine.add("--obfuscate-ids", obfuscateIds,
                            "Randomize all identifiers in preprocessed output (with -E)");
 
+        std::optional<std::string> ppOutputDir;
+        driver.cmdLine.add("--pp-output-dir", ppOutputDir,
+                           "Write preprocessed output for each source file to a file in the "
+                           "given directory instead of to stdout (with -E)",
+                           "<dir>",
+                           /* isFileName */ true);
+
+        std::optional<bool> ppStats;
+        driver.cmdLine.add("--pp-stats", ppStats,
+                           "Print statistics about include files and macro expansions "
+                           "after parsing");
+
         std::optional<std::string> astJsonFile;
         driver.cmdLine.add(
             "--ast-json", astJsonFile,
@@ -135,7 +147,9 @@ int driverMain(int argc, TArgs argv) {
         SLANG_TRY {
             if (onlyPreprocess == true) {
                 ok = driver.runPreprocessor(includeComments == true, includeDirectives == true,
-                                            obfuscateIds == true);
+                                            obfuscateIds == true,
+                                            /* useFixedObfuscationSeed */ false,
+                                            ppOutputDir.value_or(""));
             }
             else if (onlyMacros == true) {
                 driver.reportMacros();
@@ -143,6 +157,8 @@ int driverMain(int argc, TArgs argv) {
             else if (onlyParse == true) {
                 ok = driver.parseAllSources();
                 ok &= driver.reportParseDiags();
+                if (ppStats == true)
+                    driver.reportPreprocessorStats();
             }
             else {
                 {
@@ -150,10 +166,14 @@ int driverMain(int argc, TArgs argv) {
                     ok = driver.parseAllSources();
                 }
 
+                if (ppStats == true)
+                    driver.reportPreprocessorStats();
+
                 {
                     TimeTraceScope timeScope("elaboration"sv, ""sv);
                     auto compilation = driver.createCompilation();
                     ok &= driver.reportCompilation(*compilation, quiet == true);
+                    ok &= driver.writePackageImages(*compilation);
                     if (astJsonFile)
                         printJson(*compilation, *astJsonFile, astJsonScopes);
                 }